@@ -0,0 +1,171 @@
+/**
+ * Implements a class that determines the input ranges of the layers that
+ * CompiledNN can quantize by applying a net to sample inputs.
+ */
+
+#include "Calibration.h"
+#include "SimpleNN.h"
+#include "CompiledNN/Util/QuantizationParameters.h"
+#include "Platform/BHAssert.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace NeuralNetwork
+{
+  /** The number of bins of the histograms. */
+  static constexpr std::size_t numOfBins = 2048;
+
+  /** The number of values that a quantized input can have. */
+  static constexpr std::size_t numOfLevels = 128;
+
+  Calibration::Calibration(const Model& model) :
+    model(model)
+  {}
+
+  void Calibration::add(const std::vector<TensorXf>& inputs)
+  {
+    ASSERT(inputs.size() == model.getInputs().size());
+    std::vector<TensorXf> inputsCopied(inputs);
+    std::vector<TensorXf> outputs(model.getOutputs().size());
+    SimpleNN::apply(inputsCopied, outputs, model, [this](const Node& node, const std::vector<const TensorXf*>& inputs, const std::vector<TensorXf*>&)
+    {
+      if((node.layer->type == LayerType::dense || node.layer->type == LayerType::conv2D) && !node.layer->name.empty())
+        statistics[node.layer->name].add(*inputs[0]);
+    });
+    ++numOfSamples;
+  }
+
+  bool Calibration::save(const std::string& filename, const Method method, const float percentile) const
+  {
+    CompiledNNImpl::QuantizationParameters parameters;
+    for(const auto& entry : statistics)
+    {
+      float min, max;
+      entry.second.getRange(method, percentile, min, max);
+      parameters.set(entry.first, min, max);
+    }
+    return parameters.save(filename);
+  }
+
+  void Calibration::Statistics::add(const TensorXf& tensor)
+  {
+    const auto minMax = std::minmax_element(tensor.begin(), tensor.end());
+    if(minMax.first != tensor.end())
+    {
+      min = std::min(min, *minMax.first);
+      max = std::max(max, *minMax.second);
+    }
+
+    // Double the range of the histogram until it contains all values
+    const float absMax = std::max(-min, max);
+    if(histogram.empty())
+    {
+      histogram.resize(numOfBins, 0.0);
+      range = std::max(absMax, std::numeric_limits<float>::min());
+    }
+    while(absMax > range)
+    {
+      std::vector<double> merged(numOfBins, 0.0);
+      for(std::size_t i = 0; i < numOfBins / 2; ++i)
+        merged[numOfBins / 4 + i] = histogram[2 * i] + histogram[2 * i + 1];
+      histogram.swap(merged);
+      range *= 2.f;
+    }
+
+    // 0 is represented exactly by the quantized values, so zeros (e.g. after a ReLU) would only distort the comparison of the distributions
+    for(const float value : tensor)
+      if(value != 0.f)
+        ++histogram[bin(value)];
+  }
+
+  std::size_t Calibration::Statistics::bin(const float value) const
+  {
+    const float position = (value + range) / (2.f * range) * static_cast<float>(numOfBins);
+    return std::min(static_cast<std::size_t>(std::max(position, 0.f)), numOfBins - 1);
+  }
+
+  void Calibration::Statistics::getRange(const Method method, const float percentile, float& min, float& max) const
+  {
+    min = this->min;
+    max = this->max;
+    if(histogram.empty() || method == Method::minMax)
+      return;
+
+    const float binWidth = 2.f * range / static_cast<float>(numOfBins);
+    if(method == Method::percentile)
+    {
+      // Clip the same number of values on both sides
+      const double clipped = std::accumulate(histogram.begin(), histogram.end(), 0.0) * (1.0 - percentile / 100.0) / 2.0;
+      std::size_t first = 0, last = numOfBins - 1;
+      for(double sum = histogram[first]; sum <= clipped && first < last; sum += histogram[first])
+        ++first;
+      for(double sum = histogram[last]; sum <= clipped && last > first; sum += histogram[last])
+        --last;
+      min = std::min(std::max(min, -range + static_cast<float>(first) * binWidth), 0.f);
+      max = std::max(std::min(max, -range + static_cast<float>(last + 1) * binWidth), 0.f);
+      return;
+    }
+
+    // Shrink the range (keeping the position of 0) as long as the quantized distribution can become more similar to the original one
+    const std::size_t numOfUsedBins = bin(max) - bin(min) + 1;
+    if(numOfUsedBins <= numOfLevels)
+      return;
+    double bestDivergence = std::numeric_limits<double>::max();
+    float bestFactor = 1.f;
+    for(std::size_t usedBins = numOfUsedBins; usedBins >= numOfLevels; --usedBins)
+    {
+      const float factor = static_cast<float>(usedBins) / static_cast<float>(numOfUsedBins);
+      const double d = divergence(factor * min, factor * max);
+      if(d < bestDivergence)
+      {
+        bestDivergence = d;
+        bestFactor = factor;
+      }
+    }
+    min *= bestFactor;
+    max *= bestFactor;
+  }
+
+  double Calibration::Statistics::divergence(const float min, const float max) const
+  {
+    const std::size_t first = bin(min), last = bin(max), n = last - first + 1;
+
+    // The distribution of the values with the clipped ones in the outermost bins
+    std::vector<double> p(histogram.begin() + first, histogram.begin() + last + 1);
+    p.front() += std::accumulate(histogram.begin(), histogram.begin() + first, 0.0);
+    p.back() += std::accumulate(histogram.begin() + last + 1, histogram.end(), 0.0);
+
+    // The distribution after merging the bins into the quantized values, spread evenly over the bins that were not empty
+    std::vector<double> q(n, 0.0);
+    for(std::size_t level = 0; level < numOfLevels; ++level)
+    {
+      const std::size_t begin = level * n / numOfLevels, end = (level + 1) * n / numOfLevels;
+      double sum = 0.0;
+      std::size_t nonEmpty = 0;
+      for(std::size_t i = begin; i < end; ++i)
+        if(histogram[first + i] > 0.0)
+        {
+          sum += histogram[first + i];
+          ++nonEmpty;
+        }
+      for(std::size_t i = begin; i < end; ++i)
+        if(histogram[first + i] > 0.0)
+          q[i] = sum / static_cast<double>(nonEmpty);
+    }
+
+    const double pSum = std::accumulate(p.begin(), p.end(), 0.0), qSum = std::accumulate(q.begin(), q.end(), 0.0);
+    if(pSum <= 0.0 || qSum <= 0.0)
+      return std::numeric_limits<double>::max();
+    double result = 0.0;
+    for(std::size_t i = 0; i < n; ++i)
+      if(p[i] > 0.0)
+      {
+        // Bins that only contain clipped values are missing in the quantized distribution
+        const double pi = p[i] / pSum, qi = std::max(q[i] / qSum, 1e-10);
+        result += pi * std::log(pi / qi);
+      }
+    return result;
+  }
+}
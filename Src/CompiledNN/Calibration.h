@@ -0,0 +1,84 @@
+/**
+ * Declares a class that determines the input ranges of the layers that
+ * CompiledNN can quantize by applying a net to sample inputs.
+ */
+
+#pragma once
+
+#include "Model.h"
+#include "Tensor.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace NeuralNetwork
+{
+  class Calibration final
+  {
+  public:
+    /** The ways in which the range of a tensor can be chosen from its values. */
+    enum class Method
+    {
+      minMax,     /**< The smallest and largest value. */
+      percentile, /**< The range that contains a given percentage of the values (half of the rest is clipped on each side). */
+      entropy,    /**< The range whose quantized distribution of the values is most similar to the original one (Kullback-Leibler divergence). */
+    };
+
+    /**
+     * Constructor.
+     * @param model The model whose Dense and Conv2D layers are calibrated. It must outlive this object.
+     */
+    explicit Calibration(const Model& model);
+
+    /**
+     * Applies the model (with SimpleNN) to a sample and adds the inputs of all
+     * Dense and Conv2D layers to the statistics.
+     * @param inputs The input tensors of the model.
+     */
+    void add(const std::vector<TensorXf>& inputs);
+
+    /** Returns the number of samples that have been added. */
+    inline std::size_t samples() const { return numOfSamples; }
+
+    /**
+     * Writes the ranges of the inputs of all layers that have a name to a file
+     * that can be used as CompilationSettings::quantizationParameters.
+     * @param filename The name of the file.
+     * @param method The way in which the ranges are chosen.
+     * @param percentile The percentage of the values inside the range for Method::percentile.
+     * @return Whether the file could be written.
+     */
+    bool save(const std::string& filename, Method method = Method::percentile, float percentile = 99.99f) const;
+
+  private:
+    /**
+     * The values of a tensor. The histogram covers a range that is symmetric
+     * to 0 and is doubled (merging pairs of bins) whenever a value does not
+     * fit in anymore.
+     */
+    struct Statistics final
+    {
+      float min = 0.f;               /**< The smallest value so far (at most 0). */
+      float max = 0.f;               /**< The largest value so far (at least 0). */
+      float range = 0.f;             /**< The histogram covers [-range, range]. */
+      std::vector<double> histogram; /**< The number of values other than 0 in each bin. */
+
+      /** Adds the values of a tensor. */
+      void add(const TensorXf& tensor);
+
+      /** Returns the range [min, max] of the values according to a method. */
+      void getRange(Method method, float percentile, float& min, float& max) const;
+
+    private:
+      /** Returns the bin of a value inside the range. */
+      std::size_t bin(float value) const;
+
+      /** Returns the Kullback-Leibler divergence between the values inside [min, max] and their quantized version. */
+      double divergence(float min, float max) const;
+    };
+
+    const Model& model;
+    std::map<std::string, Statistics> statistics; /**< The statistics of the inputs per layer name. */
+    std::size_t numOfSamples = 0;
+  };
+}
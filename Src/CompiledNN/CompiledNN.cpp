@@ -8,9 +8,32 @@
 
 #include "CompiledNN.h"
 #include "CompiledNN/CompiledNNImpl.h"
+#include "CompiledNN/Util/ArenaPlanner.h"
+#include "CompiledNN/Util/ElfObject.h"
+#include "CompiledNN/Util/JitRegistry.h"
+#include "CompiledNN/Util/QuantizationParameters.h"
+#include "CompiledNN/Util/TuningDatabase.h"
+#include "CompiledNN/Util/WorkerPool.h"
 #include "Model.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
 #include <numeric>
+#include <random>
+#include <sstream>
 #include <unordered_map>
+#include <unordered_set>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace NeuralNetwork
 {
@@ -25,8 +48,7 @@ namespace NeuralNetwork
 
   CompiledNN::~CompiledNN()
   {
-    if(applyFunction)
-      runtime->release(applyFunction);
+    releaseCode();
     if(externalRuntime)
       static_cast<void>(runtime.release());
   }
@@ -47,7 +69,8 @@ namespace NeuralNetwork
     return compilerPtr;
   }
 
-  std::vector<OperationCompiler*> CompiledNN::generateCompilers(const CompilationSettings& settings, const Node& node, CompilerMap& compilers)
+  std::vector<OperationCompiler*> CompiledNN::generateCompilers(const CompilationSettings& settings, const QuantizationParameters& quantizationParameters,
+                                                                const Node& node, CompilerMap& compilers)
   {
     auto activationToCompiled = [&compilers, &node, &settings](ActivationFunctionId activationId, OperationCompiler*& extCompiler) -> CompiledActivationFunctionId
     {
@@ -123,6 +146,20 @@ namespace NeuralNetwork
       return nullptr;
     };
 
+    // Convolutions are only quantized if they have enough inputs per output, but not so many that the sums of the products could overflow
+    auto quantizes = [&settings](const std::vector<unsigned int>& inputDimensions, const unsigned int inputsPerOutput)
+    {
+      return settings.quantize && inputsPerOutput >= 16 && inputsPerOutput <= 100000 && QuantizeCompiler::canQuantize(inputDimensions);
+    };
+
+    // The input of a quantized layer is converted with the calibrated range of the layer if there is one
+    auto getQuantize = [&]()
+    {
+      QuantizeCompiler::Parameters p;
+      quantizationParameters.find(node.layer->name, p.min, p.max);
+      return getCompiler<QuantizeCompiler>(settings, p, compilers);
+    };
+
     std::vector<OperationCompiler*> result;
     switch(node.layer->type)
     {
@@ -131,10 +168,23 @@ namespace NeuralNetwork
       case LayerType::dense:
       {
         const DenseLayer& layer = *static_cast<const DenseLayer*>(node.layer);
+        OperationCompiler* extActivation;
+        if(quantizes(node.inputDimensions[0], layer.weights.dims(0)))
+        {
+          result.push_back(getQuantize());
+          QuantizedConv2DCompiler::Parameters p;
+          p.weights = &layer.weights;
+          p.biases = layer.hasBiases ? &layer.biases : nullptr;
+          p.inputDimensions = {{1, 1, layer.weights.dims(0)}};
+          p.activationDesc = activationToCompiled(layer.activationId, extActivation);
+          result.push_back(getCompiler<QuantizedConv2DCompiler>(settings, p, compilers));
+          if(extActivation)
+            result.push_back(extActivation);
+          break;
+        }
         DenseCompiler::Parameters p;
         p.weights = &layer.weights;
         p.biases = layer.hasBiases ? &layer.biases : nullptr;
-        OperationCompiler* extActivation;
         p.activationDesc = activationToCompiled(layer.activationId, extActivation);
         result.push_back(getCompiler<DenseCompiler>(settings, p, compilers));
         if(extActivation)
@@ -185,16 +235,78 @@ namespace NeuralNetwork
       case LayerType::conv2D:
       {
         const Conv2DLayer& layer = *static_cast<const Conv2DLayer*>(node.layer);
-        if(layer.padding == PaddingType::same)
+        const unsigned int inputsPerOutput = layer.weights.dims(0) * layer.weights.dims(1) * layer.weights.dims(2);
+        // The direct convolution needs contiguous filter rows, so dilated convolutions are always computed as im2col and GEMM
+        const bool dilated = layer.dilation[0] > 1 || layer.dilation[1] > 1;
+        const bool winograd = !dilated && WinogradConv2DCompiler::isSuitable(settings, layer.weights, layer.strides, node.outputDimensions[0]);
+        if(dilated || (!winograd && !quantizes(node.inputDimensions[0], inputsPerOutput) &&
+                       GEMMCompiler::isFasterThanDirectConvolution(settings, layer.weights, node.outputDimensions[0])))
+        {
+          // The im2col also adds the padding (a 1x1 convolution with stride 1 is already a GEMM)
+          if(layer.weights.dims(0) > 1 || layer.weights.dims(1) > 1 || layer.strides[0] > 1 || layer.strides[1] > 1)
+          {
+            Im2Col2DCompiler::Parameters p;
+            p.kernelSize = {{layer.weights.dims(0), layer.weights.dims(1)}};
+            p.strides = layer.strides;
+            p.dilation = layer.dilation;
+            p.paddingType = layer.padding;
+            result.push_back(getCompiler<Im2Col2DCompiler>(settings, p, compilers));
+          }
+          GEMMCompiler::Parameters p;
+          p.weights = &layer.weights;
+          p.biases = layer.hasBiases ? &layer.biases : nullptr;
+          OperationCompiler* extActivation;
+          p.activationDesc = activationToCompiled(layer.activationId, extActivation);
+          result.push_back(getCompiler<GEMMCompiler>(settings, p, compilers));
+          if(extActivation)
+            result.push_back(extActivation);
+          break;
+        }
+        // The direct convolution pads the windows at the borders itself, the others need a padded copy of the input
+        std::vector<unsigned int> inputDimensions = node.inputDimensions[0];
+        PaddingType padding = layer.padding;
+        if(layer.padding == PaddingType::same && (winograd || quantizes(inputDimensions, inputsPerOutput)))
         {
           OperationCompiler* extPadding = getPadding({{layer.weights.dims(0), layer.weights.dims(1)}}, {{layer.strides[0], layer.strides[1]}});
           if(extPadding)
+          {
             result.push_back(extPadding);
+            inputDimensions = extPadding->calcOutputDimensions({inputDimensions})[0];
+          }
+          padding = PaddingType::valid;
+        }
+        if(quantizes(inputDimensions, inputsPerOutput))
+        {
+          result.push_back(getQuantize());
+          QuantizedConv2DCompiler::Parameters p;
+          p.weights = &layer.weights;
+          p.biases = layer.hasBiases ? &layer.biases : nullptr;
+          p.strides = layer.strides;
+          p.inputDimensions = {{inputDimensions[0], inputDimensions[1], inputDimensions[2]}};
+          OperationCompiler* extActivation;
+          p.activationDesc = activationToCompiled(layer.activationId, extActivation);
+          result.push_back(getCompiler<QuantizedConv2DCompiler>(settings, p, compilers));
+          if(extActivation)
+            result.push_back(extActivation);
+          break;
+        }
+        if(winograd)
+        {
+          WinogradConv2DCompiler::Parameters p;
+          p.weights = &layer.weights;
+          p.biases = layer.hasBiases ? &layer.biases : nullptr;
+          OperationCompiler* extActivation;
+          p.activationDesc = activationToCompiled(layer.activationId, extActivation);
+          result.push_back(getCompiler<WinogradConv2DCompiler>(settings, p, compilers));
+          if(extActivation)
+            result.push_back(extActivation);
+          break;
         }
         Conv2DCompiler::Parameters p;
         p.weights = &layer.weights;
         p.biases = layer.hasBiases ? &layer.biases : nullptr;
         p.strides = layer.strides;
+        p.padding = padding;
         OperationCompiler* extActivation;
         p.activationDesc = activationToCompiled(layer.activationId, extActivation);
         result.push_back(getCompiler<Conv2DCompiler>(settings, p, compilers));
@@ -205,25 +317,18 @@ namespace NeuralNetwork
       case LayerType::separableConv2D:
       {
         const SeparableConv2DLayer& layer = *static_cast<const SeparableConv2DLayer*>(node.layer);
-        if(layer.padding == PaddingType::same)
-        {
-          OperationCompiler* extPadding = getPadding({{layer.depthwiseWeights.dims(0), layer.depthwiseWeights.dims(1)}}, {{layer.strides[0], layer.strides[1]}});
-          if(extPadding)
-            result.push_back(extPadding);
-        }
-        {
-          DConv2DCompiler::Parameters p;
-          p.weights = &layer.depthwiseWeights;
-          p.strides = layer.strides;
-          result.push_back(getCompiler<DConv2DCompiler>(settings, p, compilers));
-        }
-        Conv2DCompiler::Parameters p;
-        p.weights = &layer.pointwiseWeights;
-        p.biases = layer.hasBiases ? &layer.biases : nullptr;
-        p.strides[0] = p.strides[1] = 1;
+        // The depthwise outputs are passed to the pointwise convolution in bands of rows instead of as a whole tensor
+        SeparableConv2DCompiler::Parameters p;
+        p.depthwise.weights = &layer.depthwiseWeights;
+        p.depthwise.strides = layer.strides;
+        p.depthwise.dilation = layer.dilation;
+        p.depthwise.padding = layer.padding;
+        p.pointwise.weights = &layer.pointwiseWeights;
+        p.pointwise.biases = layer.hasBiases ? &layer.biases : nullptr;
+        p.pointwise.strides[0] = p.pointwise.strides[1] = 1;
         OperationCompiler* extActivation;
-        p.activationDesc = activationToCompiled(layer.activationId, extActivation);
-        result.push_back(getCompiler<Conv2DCompiler>(settings, p, compilers));
+        p.pointwise.activationDesc = activationToCompiled(layer.activationId, extActivation);
+        result.push_back(getCompiler<SeparableConv2DCompiler>(settings, p, compilers));
         if(extActivation)
           result.push_back(extActivation);
         break;
@@ -231,16 +336,12 @@ namespace NeuralNetwork
       case LayerType::depthwiseConv2D:
       {
         const DepthwiseConv2DLayer& layer = *static_cast<const DepthwiseConv2DLayer*>(node.layer);
-        if(layer.padding == PaddingType::same)
-        {
-          OperationCompiler* extPadding = getPadding({{layer.weights.dims(0), layer.weights.dims(1)}}, {{layer.strides[0], layer.strides[1]}});
-          if(extPadding)
-            result.push_back(extPadding);
-        }
         DConv2DCompiler::Parameters p;
         p.weights = &layer.weights;
         p.biases = layer.hasBiases ? &layer.biases : nullptr;
         p.strides = layer.strides;
+        p.dilation = layer.dilation;
+        p.padding = layer.padding;
         OperationCompiler* extActivation;
         p.postActivation = activationToCompiled(layer.activationId, extActivation);
         result.push_back(getCompiler<DConv2DCompiler>(settings, p, compilers));
@@ -424,6 +525,299 @@ namespace NeuralNetwork
     return result;
   }
 
+  void CompiledNN::scheduleBranches(std::list<Operation>& operations)
+  {
+    // Determine the operations that provide the inputs of each operation and the operations that consume the outputs of each operation
+    std::unordered_map<const Operation*, std::vector<const Operation*>> providers, consumers;
+    for(const Operation& op : operations)
+      for(const OperandLocation& input : op.inputs)
+        if(input.provider && std::find(providers[&op].begin(), providers[&op].end(), input.provider) == providers[&op].end())
+        {
+          providers[&op].push_back(input.provider);
+          consumers[input.provider].push_back(&op);
+        }
+
+    // Chain each operation to its provider if they only depend on each other and assign each chain the level after the levels of the chains it depends on
+    std::unordered_map<const Operation*, std::size_t> chainOf;
+    std::vector<std::size_t> chainLevels;
+    for(Operation& op : operations)
+    {
+      const std::vector<const Operation*>& opProviders = providers[&op];
+      if(opProviders.size() == 1 && consumers[opProviders[0]].size() == 1)
+        chainOf[&op] = chainOf[opProviders[0]];
+      else
+      {
+        std::size_t level = 0;
+        for(const Operation* provider : opProviders)
+          level = std::max(level, chainLevels[chainOf[provider]] + 1);
+        chainOf[&op] = chainLevels.size();
+        chainLevels.push_back(level);
+      }
+    }
+
+    // Number the chains within each level
+    std::vector<std::size_t> chainBranches(chainLevels.size());
+    std::vector<std::size_t> branchesPerLevel;
+    for(std::size_t chain = 0; chain < chainLevels.size(); ++chain)
+    {
+      if(chainLevels[chain] >= branchesPerLevel.size())
+        branchesPerLevel.resize(chainLevels[chain] + 1, 0);
+      chainBranches[chain] = branchesPerLevel[chainLevels[chain]]++;
+    }
+    for(Operation& op : operations)
+    {
+      op.level = chainLevels[chainOf[&op]];
+      op.branch = chainBranches[chainOf[&op]];
+      op.concurrent = branchesPerLevel[op.level] > 1;
+    }
+
+    // Order the operations by level and branch (the order within a branch stays topological)
+    std::vector<std::list<Operation>::iterator> order;
+    for(auto op = operations.begin(); op != operations.end(); ++op)
+      order.push_back(op);
+    std::stable_sort(order.begin(), order.end(), [](const std::list<Operation>::iterator& a, const std::list<Operation>::iterator& b)
+    {
+      return a->level < b->level || (a->level == b->level && a->branch < b->branch);
+    });
+    for(const auto& op : order)
+      operations.splice(operations.end(), operations, op);
+  }
+
+  /**
+   * Returns the number of implicit zero rows above the input of a sliding window operation.
+   * @param window The row window of the operation.
+   * @param inputHeight The number of input rows.
+   * @param outputHeight The number of output rows.
+   */
+  static int paddingTop(const RowWindow& window, const unsigned int inputHeight, const unsigned int outputHeight)
+  {
+    return window.padding == PaddingType::same ? std::max(static_cast<int>((outputHeight - 1) * window.stride + window.height) - static_cast<int>(inputHeight), 0) / 2 : 0;
+  }
+
+  /**
+   * Returns the first input row that an output row of a sliding window operation depends on.
+   * @param window The row window of the operation.
+   * @param inputHeight The number of input rows.
+   * @param outputHeight The number of output rows.
+   * @param row The output row.
+   */
+  static unsigned int inputRowBegin(const RowWindow& window, const unsigned int inputHeight, const unsigned int outputHeight, const unsigned int row)
+  {
+    return static_cast<unsigned int>(std::max(0, std::min(static_cast<int>(row * window.stride) - paddingTop(window, inputHeight, outputHeight), static_cast<int>(inputHeight))));
+  }
+
+  /**
+   * Returns the end of the input rows that the first output rows of a sliding window operation depend on.
+   * @param window The row window of the operation.
+   * @param inputHeight The number of input rows.
+   * @param outputHeight The number of output rows.
+   * @param rowEnd The end of the output rows.
+   */
+  static unsigned int inputRowEnd(const RowWindow& window, const unsigned int inputHeight, const unsigned int outputHeight, const unsigned int rowEnd)
+  {
+    if(!rowEnd)
+      return 0;
+    return static_cast<unsigned int>(std::max(0, std::min(static_cast<int>((rowEnd - 1) * window.stride + window.height) - paddingTop(window, inputHeight, outputHeight),
+                                                          static_cast<int>(inputHeight))));
+  }
+
+  void CompiledNN::scheduleStripes(std::list<Operation>& operations, const std::vector<OperandLocation>& outputLocations, const CompilationSettings& settings)
+  {
+    // The code of the operations of a chain is generated for each stripe, so the number of stripes is limited to keep the code small
+    constexpr unsigned int maxStripes = 64;
+
+    // This function returns how the output rows of an operation depend on its input rows if the operation can be part of a chain
+    auto rowWindow = [](const Operation& op)
+    {
+      const SISOOperationCompiler* compiler = dynamic_cast<const SISOOperationCompiler*>(op.compiler);
+      if(!compiler || op.concurrent || compiler->processesBatch() || op.inputDimensions.size() != 1 || op.outputDimensions.size() != 1 ||
+         op.inputDimensions[0].size() != 3 || op.outputDimensions[0].size() != 3)
+        return RowWindow();
+      return compiler->rowWindow();
+    };
+
+    // This function checks whether the output of an operation is only used as the input of the next operation (and is not an output of the net)
+    auto isOnlyInputOf = [&operations, &outputLocations](Operation& op, const Operation& next)
+    {
+      const OperandLocation output(&op, 0);
+      if(next.inputs.size() != 1 || !(next.inputs[0] == output) || std::find(outputLocations.begin(), outputLocations.end(), output) != outputLocations.end())
+        return false;
+      std::size_t refCount = 0;
+      for(const Operation& other : operations)
+        refCount += std::count(other.inputs.begin(), other.inputs.end(), output);
+      return refCount == 1;
+    };
+
+    // This function returns the number of bytes of a tensor
+    auto tensorBytes = [](const std::vector<unsigned int>& dimensions)
+    {
+      return std::accumulate(dimensions.begin(), dimensions.end(), sizeof(float), std::multiplies<>());
+    };
+
+    // This function returns (an upper bound of) the number of bytes of the rows that a stripe with a given number of output rows touches
+    // in the intermediate tensors of a chain (i.e. in its line buffers) and in all of its tensors
+    auto stripeBytes = [](const std::vector<Operation*>& chain, const std::vector<RowWindow>& windows, unsigned int rows)
+    {
+      std::array<std::size_t, 2> bytes = {{0, 0}};
+      for(std::size_t i = chain.size(); i--;)
+      {
+        const std::vector<unsigned int>& inputDimensions = chain[i]->inputDimensions[0];
+        const std::vector<unsigned int>& outputDimensions = chain[i]->outputDimensions[0];
+        const std::size_t outputBytes = std::size_t(rows) * outputDimensions[1] * outputDimensions[2] * sizeof(float);
+        if(i + 1 < chain.size())
+          bytes[0] += outputBytes;
+        bytes[1] += outputBytes;
+        rows = std::min(inputDimensions[0], (rows - 1) * windows[i].stride + windows[i].height);
+      }
+      const std::vector<unsigned int>& inputDimensions = chain.front()->inputDimensions[0];
+      bytes[1] += std::size_t(rows) * inputDimensions[1] * inputDimensions[2] * sizeof(float);
+      return bytes;
+    };
+
+    // This function checks whether the stripes of a chain with a given number of output rows fit into the cache
+    // and whether the chain needs no more memory than the operation with the largest input and output
+    auto fits = [&](const std::vector<Operation*>& chain, const std::vector<RowWindow>& windows, const unsigned int rows, const std::size_t operationBytes)
+    {
+      const std::array<std::size_t, 2> bytes = stripeBytes(chain, windows, rows);
+      return bytes[1] <= settings.stripeCacheSize &&
+             tensorBytes(chain.front()->inputDimensions[0]) + tensorBytes(chain.back()->outputDimensions[0]) + bytes[0] <= operationBytes;
+    };
+
+    std::size_t chains = 0;
+    for(auto op = operations.begin(); op != operations.end();)
+    {
+      // Collect the longest chain that begins with this operation and whose stripes with the fewest rows fit
+      // (the input and the output of a chain are needed during the whole chain, which must not take more memory than executing it layer by layer)
+      std::vector<Operation*> chain;
+      std::vector<RowWindow> windows;
+      std::size_t operationBytes = 0;
+      for(auto next = op; next != operations.end(); ++next)
+      {
+        const RowWindow window = rowWindow(*next);
+        if(!window.height || (!chain.empty() && !isOnlyInputOf(*chain.back(), *next)))
+          break;
+        chain.push_back(&*next);
+        windows.push_back(window);
+        const std::size_t bytes = operationBytes;
+        operationBytes = std::max(operationBytes, tensorBytes(next->inputDimensions[0]) + tensorBytes(next->outputDimensions[0]));
+        if(chain.size() > 1 && !fits(chain, windows, (next->outputDimensions[0][0] + maxStripes - 1) / maxStripes, operationBytes))
+        {
+          chain.pop_back();
+          windows.pop_back();
+          operationBytes = bytes;
+          break;
+        }
+      }
+
+      // Choose the highest stripes whose rows fit into the cache (chains whose operations fit into it one by one are executed layer by layer)
+      if(chain.size() > 1 && operationBytes > settings.stripeCacheSize)
+      {
+        const unsigned int height = chain.back()->outputDimensions[0][0];
+        unsigned int rows = 1;
+        while(rows < height && fits(chain, windows, rows + 1, operationBytes))
+          ++rows;
+        rows = std::max(rows, (height + maxStripes - 1) / maxStripes);
+        if(rows < height)
+        {
+          ++chains;
+          for(Operation* member : chain)
+          {
+            member->stripeChain = chains;
+            member->stripeRowEnds.clear();
+          }
+
+          // Determine backwards up to which row each operation has to compute its output in each stripe
+          // (aligned, such that the next range of rows starts at aligned addresses)
+          for(unsigned int stripeEnd = rows;; stripeEnd += rows)
+          {
+            unsigned int rowEnd = std::min(stripeEnd, height);
+            for(std::size_t i = chain.size(); i--;)
+            {
+              const TensorPointerXf input(chain[i]->inputDimensions[0], nullptr);
+              const TensorPointerXf output(chain[i]->outputDimensions[0], nullptr);
+              const unsigned int granularity = SISOOperationCompiler::rowGranularity(input, output, windows[i].stride);
+              rowEnd = std::min(output.dims(0), (rowEnd + granularity - 1) / granularity * granularity);
+              chain[i]->stripeRowEnds.push_back(rowEnd);
+              rowEnd = inputRowEnd(windows[i], input.dims(0), output.dims(0), rowEnd);
+            }
+            if(stripeEnd >= height)
+              break;
+          }
+        }
+      }
+      std::advance(op, std::max<std::size_t>(chain.size(), 1));
+    }
+  }
+
+  void CompiledNN::assignLineBuffers(const std::list<Operation>& operations)
+  {
+    for(auto op = operations.begin(); op != operations.end();)
+    {
+      if(!op->stripeChain)
+      {
+        ++op;
+        continue;
+      }
+      std::vector<const Operation*> chain;
+      for(const std::size_t stripeChain = op->stripeChain; op != operations.end() && op->stripeChain == stripeChain; ++op)
+        chain.push_back(&*op);
+      const std::size_t stripes = chain.front()->stripeRowEnds.size();
+
+      for(std::size_t i = 0; i + 1 < chain.size(); ++i)
+      {
+        OperandPlaceholder* operand = chain[i]->outputOperands[0];
+        if(operand->rowSize || operand == chain.front()->inputOperands[0] || operand == chain.back()->outputOperands[0])
+          continue;
+
+        // Operations that work in place write to their input, so the rows of all tensors of the placeholder must have the same size
+        std::vector<std::size_t> tensors;
+        const unsigned int rowSize = chain[i]->outputDimensions[0][1] * chain[i]->outputDimensions[0][2];
+        bool sameRowSize = true;
+        for(std::size_t j = 0; j + 1 < chain.size(); ++j)
+          if(chain[j]->outputOperands[0] == operand)
+          {
+            tensors.push_back(j);
+            sameRowSize &= chain[j]->outputDimensions[0][1] * chain[j]->outputDimensions[0][2] == rowSize;
+          }
+        if(!sameRowSize)
+          continue;
+
+        // In each stripe, the buffer begins at the first row that is written or still needed by a following stripe (aligned, such that the rows keep the alignment that they have in the whole tensor)
+        unsigned int granularity = 1;
+        while((granularity * rowSize) % 8)
+          granularity *= 2;
+        std::vector<unsigned int> firstRows(stripes), rowEnds(stripes);
+        unsigned int bufferRows = 0;
+        for(std::size_t stripe = 0; stripe < stripes; ++stripe)
+        {
+          unsigned int rowBegin = std::numeric_limits<unsigned int>::max();
+          rowEnds[stripe] = 0;
+          for(const std::size_t j : tensors)
+          {
+            const Operation& consumer = *chain[j + 1];
+            const unsigned int written = stripe ? chain[j]->stripeRowEnds[stripe - 1] : 0;
+            const unsigned int consumed = stripe ? consumer.stripeRowEnds[stripe - 1] : 0;
+            rowBegin = std::min(rowBegin, written);
+            if(consumed < consumer.outputDimensions[0][0])
+              rowBegin = std::min(rowBegin, inputRowBegin(static_cast<const SISOOperationCompiler*>(consumer.compiler)->rowWindow(),
+                                                          consumer.inputDimensions[0][0], consumer.outputDimensions[0][0], consumed));
+            rowEnds[stripe] = std::max(rowEnds[stripe], chain[j]->stripeRowEnds[stripe]);
+          }
+          firstRows[stripe] = rowBegin / granularity * granularity;
+          ASSERT(!stripe || firstRows[stripe] >= firstRows[stripe - 1]);
+          bufferRows = std::max(bufferRows, rowEnds[stripe] - firstRows[stripe]);
+        }
+        if(bufferRows >= chain[i]->outputDimensions[0][0])
+          continue;
+
+        operand->rowSize = rowSize;
+        operand->firstRows = std::move(firstRows);
+        operand->rowEnds = std::move(rowEnds);
+        operand->requiredSize = std::size_t(bufferRows) * rowSize;
+      }
+    }
+  }
+
   void CompiledNN::assignOperands(std::list<Operation>& operations, const std::vector<OperandLocation>& inputLocations, const std::vector<OperandLocation>& outputLocations,
                                   std::list<OperandPlaceholder>& operands, std::vector<OperandPlaceholder*>& inputPlaceholders, std::vector<OperandPlaceholder*>& outputPlaceholders)
   {
@@ -448,6 +842,7 @@ namespace NeuralNetwork
     {
       operands.emplace_back(inputLocations[i], std::accumulate(inputDimensions[i].begin(), inputDimensions[i].end(), 1u, std::multiplies<>()), getRefCount(inputLocations[i]));
       inputPlaceholders[i] = &operands.back();
+      operands.back().pinned = bindableIO;
       for(std::size_t j = 0; j < outputLocations.size(); ++j)
         if(outputLocations[j] == inputLocations[i])
           outputPlaceholders[j] = &operands.back();
@@ -471,59 +866,48 @@ namespace NeuralNetwork
       return nullptr;
     };
 
-    // This function gets a free tensor that can be used to write the output of an operation to it
-    auto lookupOutputOperand = [&operands, &getRefCount, &outputLocations, &outputPlaceholders](const OperandLocation& location, const std::vector<unsigned int>& dimensions) -> OperandPlaceholder*
+    // This function checks whether a tensor is an output of the network
+    auto isOutput = [&outputLocations](const OperandLocation& location)
+    {
+      return std::find(outputLocations.begin(), outputLocations.end(), location) != outputLocations.end();
+    };
+
+    // This function creates a new tensor for the output of an operation (tensors whose lifetimes do not overlap share memory later anyway)
+    auto newOutputOperand = [this, &operands, &getRefCount, &outputLocations, &outputPlaceholders, &isOutput](const OperandLocation& location, const std::vector<unsigned int>& dimensions) -> OperandPlaceholder*
     {
       const std::size_t requiredSize = std::accumulate(dimensions.begin(), dimensions.end(), 1u, std::multiplies<>());
-      OperandPlaceholder* maxCapacityOperand = nullptr;
-      for(OperandPlaceholder& op : operands)
-      {
-        // Do not overwrite used tensors
-        if(op.refCount)
-          continue;
-        // If there is a free tensor with enough capacity, use it
-        if(op.requiredSize >= requiredSize)
-        {
-          op.location = location;
-          for(std::size_t i = 0; i < outputLocations.size(); ++i)
-            if(outputLocations[i] == location)
-              outputPlaceholders[i] = &op;
-          op.refCount = getRefCount(location);
-          return &op;
-        }
-        // Otherwise, try to find the tensor with maximum size (so overall memory usage is minimized)
-        if(!maxCapacityOperand || op.requiredSize > maxCapacityOperand->requiredSize)
-          maxCapacityOperand = &op;
-      }
-      if(maxCapacityOperand)
-      {
-        maxCapacityOperand->location = location;
-        maxCapacityOperand->requiredSize = requiredSize;
-        maxCapacityOperand->refCount = getRefCount(location);
-        for(std::size_t i = 0; i < outputLocations.size(); ++i)
-          if(outputLocations[i] == location)
-            outputPlaceholders[i] = maxCapacityOperand;
-        return maxCapacityOperand;
-      }
-      // Create a new tensor
       operands.emplace_back(location, requiredSize, getRefCount(location));
+      operands.back().pinned = bindableIO && isOutput(location);
       for(std::size_t i = 0; i < outputLocations.size(); ++i)
         if(outputLocations[i] == location)
           outputPlaceholders[i] = &operands.back();
       return &operands.back();
     };
 
+    // Inputs of operations of concurrently executed branches are only released after all branches of the level have been finished
+    std::vector<OperandLocation> deferredInputs;
+    std::size_t deferredLevel = 0;
+
     // Assign operands to all operations (and determine their required size)
     for(Operation& op : operations)
     {
+      if(!deferredInputs.empty() && op.level != deferredLevel)
+      {
+        decreaseRefCounters(deferredInputs);
+        deferredInputs.clear();
+      }
+
       op.inputOperands.resize(op.inputs.size());
       for(std::size_t i = 0; i < op.inputs.size(); ++i)
         op.inputOperands[i] = lookupInputOperand(op.inputs[i]);
 
       // Check which inputs the compiler wants to reuse as outputs, but only offer it inputs that will not be used by other nodes anymore
+      // (and that have been computed by the same branch if other branches are executed concurrently, and neither are nor become bindable inputs or outputs)
       std::vector<std::size_t> inputIndices;
+      const bool bindsOutput = bindableIO && std::any_of(op.outputs.begin(), op.outputs.end(), isOutput);
       for(std::size_t i = 0; i < op.inputs.size(); ++i)
-        if(op.inputOperands[i]->refCount == 1)
+        if(op.inputOperands[i]->refCount == 1 && !op.inputOperands[i]->pinned && !bindsOutput &&
+           (!op.concurrent || (op.inputs[i].provider && op.inputs[i].provider->level == op.level && op.inputs[i].provider->branch == op.branch)))
           inputIndices.push_back(i);
       auto outputMapping = op.compiler->routeIO(inputIndices, op.inputDimensions);
 
@@ -545,26 +929,128 @@ namespace NeuralNetwork
           op.outputOperands[i]->refCount = getRefCount(op.outputs[i]);
         }
         else
-          op.outputOperands[i] = lookupOutputOperand(op.outputs[i], op.outputDimensions[i]);
+          op.outputOperands[i] = newOutputOperand(op.outputs[i], op.outputDimensions[i]);
       }
 
       // Decrease the reference counters of all tensors that have been used as input to this node
-      decreaseRefCounters(op.inputs);
+      if(op.concurrent)
+      {
+        deferredInputs.insert(deferredInputs.end(), op.inputs.begin(), op.inputs.end());
+        deferredLevel = op.level;
+      }
+      else
+        decreaseRefCounters(op.inputs);
     }
+    decreaseRefCounters(deferredInputs);
   }
 
-  void CompiledNN::allocateTensors(std::list<OperandPlaceholder>& operands)
+  void CompiledNN::allocateTensors(const std::list<Operation>& operations, std::list<OperandPlaceholder>& operands,
+                                   const std::vector<OperandPlaceholder*>& inputPlaceholders, const std::vector<OperandPlaceholder*>& outputPlaceholders,
+                                   const CompilationSettings& settings)
   {
-    std::size_t i = 0;
-    tensors.resize(operands.size());
+    // Determine the steps in which each placeholder is used (all operations of concurrently executed branches of a level share their steps,
+    // as well as the operations of a chain that is executed in stripes)
+    std::unordered_map<const OperandPlaceholder*, std::pair<std::size_t, std::size_t>> lifetimes;
+    const std::size_t lastStep = operations.empty() ? 0 : operations.size() - 1;
+    std::size_t step = 0;
+    for(auto op = operations.begin(); op != operations.end();)
+    {
+      auto end = std::next(op);
+      if(op->concurrent)
+        while(end != operations.end() && end->concurrent && end->level == op->level)
+          ++end;
+      else if(op->stripeChain)
+        while(end != operations.end() && end->stripeChain == op->stripeChain)
+          ++end;
+      const std::size_t firstStep = step;
+      step += std::distance(op, end);
+      for(; op != end; ++op)
+        for(const std::vector<OperandPlaceholder*>* operandList : {&op->inputOperands, &op->outputOperands})
+          for(const OperandPlaceholder* operand : *operandList)
+          {
+            auto lifetime = lifetimes.emplace(operand, std::make_pair(firstStep, step - 1));
+            lifetime.first->second.first = std::min(lifetime.first->second.first, firstStep);
+            lifetime.first->second.second = std::max(lifetime.first->second.second, step - 1);
+          }
+    }
+
+    // The inputs are written before and the outputs are read after the net is applied, and bindable ones always keep their memory
+    for(const OperandPlaceholder* operand : inputPlaceholders)
+      lifetimes.emplace(operand, std::make_pair(0, 0)).first->second.first = 0;
+    for(const OperandPlaceholder* operand : outputPlaceholders)
+      lifetimes.emplace(operand, std::make_pair(lastStep, lastStep)).first->second.second = lastStep;
+    for(const OperandPlaceholder& operand : operands)
+      if(operand.pinned)
+        lifetimes[&operand] = std::make_pair(0, lastStep);
+
+    // The input and output tensors of a net that is not reentrant are separate tensors, which are not part of the arena
+    const auto isSeparate = [&](const OperandPlaceholder& operand)
+    {
+      return !settings.reentrant &&
+             (std::find(inputPlaceholders.begin(), inputPlaceholders.end(), &operand) != inputPlaceholders.end() ||
+              std::find(outputPlaceholders.begin(), outputPlaceholders.end(), &operand) != outputPlaceholders.end());
+    };
+
+    // Pack the placeholders into an arena (aligned to cache lines and with space for reading and writing whole vectors at their ends)
+    std::vector<ArenaBlock> blocks;
+    unsharedTensorMemorySize = 0;
+    for(const OperandPlaceholder& operand : operands)
+    {
+      const std::size_t size = ((operand.requiredSize + 3) * sizeof(float) + 63) & ~std::size_t(63);
+      unsharedTensorMemorySize += size;
+      if(!isSeparate(operand))
+      {
+        const std::pair<std::size_t, std::size_t>& lifetime = lifetimes[&operand];
+        blocks.push_back({size, lifetime.first, lifetime.second});
+      }
+    }
+    const std::size_t arenaSize = planArena(blocks);
+    tensorMemorySize = unsharedTensorMemorySize + arenaSize;
+    for(const ArenaBlock& block : blocks)
+      tensorMemorySize -= block.size;
+
+    if(settings.reentrant)
+    {
+      // The arena is preceded by the pointer table if the inputs and outputs can be bound, and the resulting workspace is repeated for each sample of a batch
+      const std::size_t tableSize = bindableIO ? ((inputDimensions.size() + outputDimensions.size()) * sizeof(void*) + 63) & ~std::size_t(63) : 0;
+      sampleWorkspaceSize = tableSize + arenaSize;
+      samplesPerBatch = settings.batchSize;
+      requiredWorkspaceSize = sampleWorkspaceSize * samplesPerBatch;
+      workspaceBuffer.resize(requiredWorkspaceSize + 63);
+      workspaceData = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(workspaceBuffer.data()) + 63) & ~uintptr_t(63));
+      std::size_t i = 0;
+      for(OperandPlaceholder& operand : operands)
+        operand.allocatedData = reinterpret_cast<float*>(workspaceData + tableSize + blocks[i++].offset);
+      return;
+    }
+
+    workspaceBuffer.resize(arenaSize + 63);
+    workspaceData = nullptr;
+    requiredWorkspaceSize = 0;
+    sampleWorkspaceSize = 0;
+    samplesPerBatch = 1;
+    unsigned char* arena = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(workspaceBuffer.data()) + 63) & ~uintptr_t(63));
+    std::size_t numOfSeparateTensors = 0;
+    for(const OperandPlaceholder& operand : operands)
+      if(isSeparate(operand))
+        ++numOfSeparateTensors;
+    tensors.clear();
+    tensors.resize(numOfSeparateTensors);
+    std::size_t i = 0, j = 0;
     for(OperandPlaceholder& operand : operands)
     {
-      tensors[i].reserve(operand.requiredSize + 3);
-      operand.allocatedTensor = &tensors[i];
-      ++i;
+      if(isSeparate(operand))
+      {
+        tensors[j].reserve(operand.requiredSize + 3);
+        operand.allocatedTensor = &tensors[j++];
+        operand.allocatedData = operand.allocatedTensor->data();
+      }
+      else
+        operand.allocatedData = reinterpret_cast<float*>(arena + blocks[i++].offset);
     }
   }
 
+
   class CompilationErrorHandler : public ErrorHandler
   {
     void handleError(Error, const char* message, BaseEmitter*) override
@@ -574,7 +1060,60 @@ namespace NeuralNetwork
     }
   };
 
-  void CompiledNN::generateCode(const std::list<Operation>& operations, const CompilerMap& compilers, ActivationFunctionHandler& afHandler)
+  /**
+   * Emits the prolog of a generated function.
+   */
+  static void emitProlog(x86::Assembler& a, const bool storeWorkspacePointer)
+  {
+    a.enter(imm(32u), imm(0u)); // Reserve stack space for the variables at the offsets -4 to -32 (see workspacePointerOffset)
+    a.push(a.zbx());
+#if ASMJIT_ARCH_X86 != 64 || defined(_WIN32)
+    // CDECL or Windows64
+    a.push(a.zdi());
+    a.push(a.zsi());
+#endif
+    if(storeWorkspacePointer)
+    {
+#if ASMJIT_ARCH_X86 != 64
+      // CDECL
+      a.mov(a.zax(), a.ptr_zbp(8, 4));
+      a.mov(a.ptr_zbp(workspacePointerOffset, 4), a.zax());
+#elif defined(_WIN32)
+      // Windows64
+      a.mov(a.ptr_zbp(workspacePointerOffset, 8), x86::rcx);
+#else
+      // System V AMD64
+      a.mov(a.ptr_zbp(workspacePointerOffset, 8), x86::rdi);
+#endif
+    }
+#if ASMJIT_ARCH_X86 == 64 && defined(_WIN32)
+    // Windows64
+    a.sub(a.zsp(), imm(10u * 4u * sizeof(float)));
+    for(unsigned int i = 6; i < 16; ++i)
+      a.movdqu(a.ptr_zsp((i - 6) * 4 * sizeof(float)), x86::xmm(i));
+#endif
+  }
+
+  /**
+   * Emits the epilog of a generated function.
+   */
+  static void emitEpilog(x86::Assembler& a)
+  {
+#if ASMJIT_ARCH_X86 == 64 && defined(_WIN32)
+    for(unsigned int i = 6; i < 16; ++i)
+      a.movdqu(x86::xmm(i), a.ptr_zsp((i - 6) * 4 * sizeof(float)));
+    a.add(a.zsp(), imm(10u * 4u * sizeof(float)));
+#endif
+#if ASMJIT_ARCH_X86 != 64 || defined(_WIN32)
+    a.pop(a.zsi());
+    a.pop(a.zdi());
+#endif
+    a.pop(a.zbx());
+    a.leave();
+    a.ret();
+  }
+
+  void CompiledNN::generateCode(const std::list<Operation>& operations, const CompilerMap& compilers, ActivationFunctionHandler& afHandler, const CompilationSettings& settings)
   {
     // Initialize assembler
     CodeHolder code;
@@ -583,24 +1122,6 @@ namespace NeuralNetwork
     CompilationErrorHandler errorHandler;
     a.setErrorHandler(&errorHandler);
 
-    // Emit Prolog
-    if(!operations.empty())
-    {
-      a.enter(imm(24u), imm(0u)); // Reserve stack space for up to six 32-bit variables, indexed as a.ptr_zbp(-i*4,4)
-      a.push(a.zbx());
-#if ASMJIT_ARCH_X86 != 64 || defined(_WIN32)
-      // CDECL or Windows64
-      a.push(a.zdi());
-      a.push(a.zsi());
-#endif
-#if ASMJIT_ARCH_X86 == 64 && defined(_WIN32)
-      // Windows64
-      a.sub(a.zsp(), imm(10u * 4u * sizeof(float)));
-      for(unsigned int i = 6; i < 16; ++i)
-        a.movdqu(a.ptr_zsp((i - 6) * 4 * sizeof(float)), x86::xmm(i));
-#endif
-    }
-
     // Declare constant labels
     for(auto& compilerType : compilers)
       for(auto& compiler : compilerType.second)
@@ -612,63 +1133,438 @@ namespace NeuralNetwork
             cs.label = a.newLabel();
       }
 
-    // Compile operations
+    // Set references to operands and determine into how many parts each operation is split
+    std::vector<std::vector<TensorPointerXf>> inputPointers, outputPointers;
+    std::vector<unsigned int> parts;
     for(const Operation& op : operations)
     {
-      // Set references to operands
-      std::vector<TensorPointerXf> inputPointers(op.inputOperands.size());
+      inputPointers.emplace_back(op.inputOperands.size());
       for(std::size_t i = 0; i < op.inputOperands.size(); ++i)
+        inputPointers.back()[i] = TensorPointerXf(op.inputDimensions[i], op.inputOperands[i]->allocatedData);
+      outputPointers.emplace_back(op.outputOperands.size());
+      for(std::size_t i = 0; i < op.outputs.size(); ++i)
+        outputPointers.back()[i] = TensorPointerXf(op.outputDimensions[i], op.outputOperands[i]->allocatedData);
+      parts.push_back(settings.threads > 1 && !op.concurrent ? std::min(settings.threads, op.compiler->maxParts(inputPointers.back(), outputPointers.back())) : 1);
+    }
+
+    // Create the counters of the operations (two 64 bit values per operation: the cycles and the calls)
+    profileCounters.assign(settings.profile ? 2 * operations.size() : 0, 0);
+    profileLayers.clear();
+    if(settings.profile)
+      for(const Operation& op : operations)
+        profileLayers.push_back(op.layer);
+    const bool hasRDTSCP = CpuInfo::host().features().x86().hasRDTSCP();
+
+    // Adds the current time stamp counter to the cycles of an operation (multiplied by the sign) and counts a call at the end of the operation (only at the end of the first stripe of an operation that is computed in stripes).
+    // The 64 bit counters are updated by two atomic 32 bit additions (with carry), which is correct as long as they are not read while the net is applied.
+    auto emitProfileCounter = [&](const std::size_t index, const bool end, const bool countCall = true)
+    {
+      if(end && hasRDTSCP)
       {
-        op.inputOperands[i]->allocatedTensor->reshape(op.inputDimensions[i]);
-        inputPointers[i] = TensorPointerXf(*op.inputOperands[i]->allocatedTensor);
+        a.rdtscp(x86::edx, x86::eax, x86::ecx);
+        a.lfence();
       }
-      std::vector<TensorPointerXf> outputPointers(op.outputOperands.size());
-      for(std::size_t i = 0; i < op.outputs.size(); ++i)
+      else
+      {
+        a.lfence();
+        a.rdtsc(x86::edx, x86::eax);
+      }
+      a.mov(a.zcx(), imm(reinterpret_cast<std::uintptr_t>(&profileCounters[2 * index])));
+      if(end)
+      {
+        a.lock().add(x86::dword_ptr(a.zcx()), x86::eax);
+        a.lock().adc(x86::dword_ptr(a.zcx(), 4), x86::edx);
+        if(countCall)
+        {
+          a.lock().add(x86::dword_ptr(a.zcx(), 8), imm(1));
+          a.lock().adc(x86::dword_ptr(a.zcx(), 12), imm(0));
+        }
+      }
+      else
       {
-        op.outputOperands[i]->allocatedTensor->reshape(op.outputDimensions[i]);
-        outputPointers[i] = TensorPointerXf(*op.outputOperands[i]->allocatedTensor);
+        a.lock().sub(x86::dword_ptr(a.zcx()), x86::eax);
+        a.lock().sbb(x86::dword_ptr(a.zcx(), 4), x86::edx);
       }
+    };
 
-      // Compile the operation
-      op.compiler->compile(a, afHandler, inputPointers, outputPointers);
-    }
+    // Compiles (a part of) an operation (in a loop over all samples of a batch unless the operation does this by itself)
+    struct OperationRange
+    {
+      std::size_t index;
+      Label begin, end;
+    };
+    std::vector<OperationRange> operationRanges;
+    auto compileOperation = [&](const Operation& op, const std::size_t index, const unsigned int part)
+    {
+      operationRanges.push_back({index, a.newLabel(), a.newLabel()});
+      a.bind(operationRanges.back().begin);
+      Label sampleLoop;
+      const bool loopOverSamples = samplesPerBatch > 1 && !op.compiler->processesBatch();
+      const bool countCycles = settings.profile && part == 0;
+      if(countCycles)
+        emitProfileCounter(index, false);
+      if(loopOverSamples)
+        op.compiler->beginSampleLoop(a, sampleLoop);
+      op.compiler->compilePart(a, afHandler, inputPointers[index], outputPointers[index], part, parts[index]);
+      if(loopOverSamples)
+        op.compiler->endSampleLoop(a, sampleLoop);
+      if(countCycles)
+        emitProfileCounter(index, true);
+      a.bind(operationRanges.back().end);
+    };
 
-    // Emit epilog
-    if(!operations.empty())
+    // Moves the rows of a line buffer that are still needed to its beginning (the source lies behind the destination, so the vectors can be copied in ascending order)
+    auto emitMove = [&](const OperationCompiler& compiler, const float* source, const float* destination, const std::size_t count)
     {
-#if ASMJIT_ARCH_X86 == 64 && defined(_WIN32)
-      for(unsigned int i = 6; i < 16; ++i)
-        a.movdqu(x86::xmm(i), a.ptr_zsp((i - 6) * 4 * sizeof(float)));
-      a.add(a.zsp(), imm(10u * 4u * sizeof(float)));
-#endif
-#if ASMJIT_ARCH_X86 != 64 || defined(_WIN32)
-      a.pop(a.zsi());
-      a.pop(a.zdi());
-#endif
-      a.pop(a.zbx());
-      a.leave();
-    }
-    a.ret();
+      compiler.loadAddress(a, a.zsi(), source);
+      compiler.loadAddress(a, a.zdi(), destination);
+      const std::size_t vectors = (count + 3) / 4;
+      if(vectors >= 4)
+      {
+        Label loop = a.newLabel();
+        a.mov(a.zcx(), imm(vectors / 4));
+        a.bind(loop);
+        for(unsigned int i = 0; i < 4; ++i)
+          a.movaps(x86::xmm(i), a.ptr_zsi(i * 4 * sizeof(float)));
+        for(unsigned int i = 0; i < 4; ++i)
+          a.movaps(a.ptr_zdi(i * 4 * sizeof(float)), x86::xmm(i));
+        a.add(a.zsi(), imm(16 * sizeof(float)));
+        a.add(a.zdi(), imm(16 * sizeof(float)));
+        a.dec(a.zcx());
+        a.jnz(loop);
+      }
+      for(unsigned int i = 0; i < vectors % 4; ++i)
+        a.movaps(x86::xmm(i), a.ptr_zsi(i * 4 * sizeof(float)));
+      for(unsigned int i = 0; i < vectors % 4; ++i)
+        a.movaps(a.ptr_zdi(i * 4 * sizeof(float)), x86::xmm(i));
+    };
 
-    // Store constants
-    afHandler.compileData(a);
-    for(auto& compilerType : compilers)
-      for(auto& compiler : compilerType.second)
+    // Compiles a chain of operations stripe by stripe, i.e. in each stripe, each operation computes the rows that the next operation needs for the rows of the stripe
+    auto compileStripes = [&](std::list<Operation>::const_iterator op, const std::size_t firstIndex, const std::size_t count)
+    {
+      std::vector<const Operation*> chain;
+      for(std::size_t i = 0; i < count; ++i, ++op)
+        chain.push_back(&*op);
+
+      // Line buffers are addressed relative to the row that is at their beginning in the current stripe
+      auto tensorPointer = [](const TensorPointerXf& pointer, const OperandPlaceholder& operand, const std::size_t stripe)
       {
-        if(!compiler->refCount)
-          continue;
-        for(NetworkConstants& cs : compiler->constants)
-          if(!cs.data.empty())
+        if(!operand.rowSize)
+          return pointer;
+        return TensorPointerXf(pointer.dims(), operand.allocatedData - static_cast<std::ptrdiff_t>(operand.firstRows[stripe]) * operand.rowSize);
+      };
+
+      Label sampleLoop;
+      const bool loopOverSamples = samplesPerBatch > 1;
+      if(loopOverSamples)
+        chain.front()->compiler->beginSampleLoop(a, sampleLoop);
+
+      std::vector<unsigned int> computedRows(count, 0);
+      for(std::size_t stripe = 0; stripe < chain.front()->stripeRowEnds.size(); ++stripe)
+      {
+        if(stripe)
+          for(std::size_t i = 0; i + 1 < count; ++i)
           {
-            a.align(AlignMode::kZero, 16);
-            a.bind(cs.label);
-            for(const float c : cs.data)
-              a.embedFloat(c);
+            // Tensors that are computed in place share the line buffer, which is only moved once
+            const OperandPlaceholder& operand = *chain[i]->outputOperands[0];
+            if(!operand.rowSize || (i && chain[i - 1]->outputOperands[0] == &operand) || operand.firstRows[stripe] == operand.firstRows[stripe - 1] ||
+               operand.rowEnds[stripe - 1] <= operand.firstRows[stripe])
+              continue;
+            emitMove(*chain[i + 1]->compiler, operand.allocatedData + (operand.firstRows[stripe] - operand.firstRows[stripe - 1]) * operand.rowSize,
+                     operand.allocatedData, (operand.rowEnds[stripe - 1] - operand.firstRows[stripe]) * operand.rowSize);
           }
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+          const unsigned int rowEnd = chain[i]->stripeRowEnds[stripe];
+          if(rowEnd <= computedRows[i])
+            continue;
+          const std::size_t index = firstIndex + i;
+          operationRanges.push_back({index, a.newLabel(), a.newLabel()});
+          a.bind(operationRanges.back().begin);
+          if(settings.profile)
+            emitProfileCounter(index, false);
+          static_cast<const SISOOperationCompiler*>(chain[i]->compiler)->compileRowRange(a, afHandler,
+                                                                                        tensorPointer(inputPointers[index][0], *chain[i]->inputOperands[0], stripe),
+                                                                                        tensorPointer(outputPointers[index][0], *chain[i]->outputOperands[0], stripe),
+                                                                                        computedRows[i], rowEnd);
+          if(settings.profile)
+            emitProfileCounter(index, true, computedRows[i] == 0);
+          a.bind(operationRanges.back().end);
+          computedRows[i] = rowEnd;
+        }
       }
 
+      if(loopOverSamples)
+        chain.front()->compiler->endSampleLoop(a, sampleLoop);
+    };
+
+    // Compile operations into stages, each of which is either a sequence of operations that is executed by the calling thread,
+    // a single operation that is split among multiple threads or a set of branches that are executed concurrently
+    std::vector<std::vector<Label>> stageLabels;
+    std::size_t opIndex = 0;
+    for(auto op = operations.begin(); op != operations.end();)
+    {
+      if(op->concurrent)
+      {
+        stageLabels.emplace_back();
+        const std::size_t level = op->level;
+        while(op != operations.end() && op->level == level)
+        {
+          const std::size_t branch = op->branch;
+          stageLabels.back().push_back(a.newLabel());
+          a.bind(stageLabels.back().back());
+          emitProlog(a, workspaceData != nullptr);
+          for(; op != operations.end() && op->level == level && op->branch == branch; ++op, ++opIndex)
+            compileOperation(*op, opIndex, 0);
+          emitEpilog(a);
+        }
+      }
+      else if(parts[opIndex] > 1)
+      {
+        stageLabels.emplace_back();
+        for(unsigned int part = 0; part < parts[opIndex]; ++part)
+        {
+          stageLabels.back().push_back(a.newLabel());
+          a.bind(stageLabels.back().back());
+          emitProlog(a, workspaceData != nullptr);
+          compileOperation(*op, opIndex, part);
+          emitEpilog(a);
+        }
+        ++op;
+        ++opIndex;
+      }
+      else
+      {
+        stageLabels.emplace_back(1, a.newLabel());
+        a.bind(stageLabels.back().back());
+        emitProlog(a, workspaceData != nullptr);
+        while(op != operations.end() && !op->concurrent && parts[opIndex] == 1)
+        {
+          if(!op->stripeChain)
+          {
+            compileOperation(*op, opIndex, 0);
+            ++op;
+            ++opIndex;
+            continue;
+          }
+          const std::size_t count = std::distance(op, std::find_if(op, operations.end(), [&op](const Operation& other) { return other.stripeChain != op->stripeChain; }));
+          compileStripes(op, opIndex, count);
+          std::advance(op, count);
+          opIndex += count;
+        }
+        emitEpilog(a);
+      }
+    }
+    if(operations.empty())
+      a.ret();
+
+    // Store constants (in a separate section, such that they can be placed in read-only data if the code is exported)
+    Section* dataSection;
+    VERIFY(static_cast<ErrorCode>(code.newSection(&dataSection, ".rodata", SIZE_MAX, SectionFlags::kNone, 64)) == ErrorCode::kErrorOk);
+    a.section(dataSection);
+    afHandler.compileData(a);
+    for(auto& compilerType : compilers)
+      for(auto& compiler : compilerType.second)
+      {
+        if(!compiler->refCount)
+          continue;
+        for(NetworkConstants& cs : compiler->constants)
+          if(!cs.data.empty())
+          {
+            a.align(AlignMode::kZero, 32);
+            a.bind(cs.label);
+            a.embed(cs.data.data(), cs.data.size() * sizeof(float));
+          }
+      }
+
+    // Remember where the code refers to the constants (these references are only resolved when the sections are laid out)
+    dataReferences.clear();
+    for(const LabelEntry* label : code.labelEntries())
+      if(label->isBoundTo(dataSection))
+        for(const LabelLink* link = label->links(); link; link = link->next)
+        {
+          ASSERT(link->sectionId == code.textSection()->id() && link->relocId == Globals::kInvalidId && link->format.valueSize() == 4);
+          dataReferences.push_back({link->offset, static_cast<std::int64_t>(label->offset()) + static_cast<std::int64_t>(link->rel)});
+        }
+
     // Bind function
     VERIFY(static_cast<ErrorCode>(runtime->add<FnType>(&applyFunction, &code)) == ErrorCode::kErrorOk);
+    codeSize = code.codeSize();
+    dataOffset = static_cast<std::size_t>(dataSection->offset());
+    positionIndependent = code.relocEntries().empty() && profileCounters.empty();
+
+    // Determine the code ranges of the operations and of the code between them
+    std::vector<const std::string*> layers;
+    for(const Operation& op : operations)
+      layers.push_back(&op.layer);
+    codeSymbols.clear();
+    std::size_t end = 0;
+    for(const OperationRange& range : operationRanges)
+    {
+      const std::size_t begin = static_cast<std::size_t>(code.labelOffsetFromBase(range.begin));
+      if(begin > end)
+        codeSymbols.push_back({end, begin - end, std::string()});
+      end = static_cast<std::size_t>(code.labelOffsetFromBase(range.end));
+      if(end > begin)
+        codeSymbols.push_back({begin, end - begin, layers[range.index]->empty() ? "operation" : *layers[range.index]});
+    }
+    if(dataOffset > end)
+      codeSymbols.push_back({end, dataOffset - end, std::string()});
+
+    // Resolve the functions of all stages if the net is split among multiple threads
+    stages.clear();
+    workers.reset();
+    if(stageLabels.size() > 1 || (stageLabels.size() == 1 && stageLabels[0].size() > 1))
+    {
+      for(const std::vector<Label>& labels : stageLabels)
+      {
+        stages.emplace_back();
+        for(const Label& label : labels)
+          stages.back().push_back(reinterpret_cast<FnType>(reinterpret_cast<uintptr_t>(applyFunction) + code.labelOffsetFromBase(label)));
+      }
+      workers = std::make_unique<WorkerPool>(settings.threads - 1);
+    }
+
+    registerCode(settings);
+  }
+
+  void CompiledNN::tuneOperations(const std::list<Operation>& operations, const std::vector<BoundTensor>& boundTensors, const CompilationSettings& settings)
+  {
+    // The pointer table of a reentrant net is part of the workspace, so it has to be filled for the benchmarks
+    if(workspaceData)
+      for(const BoundTensor& tensor : boundTensors)
+        *static_cast<const void**>(const_cast<void*>(tensor.slot)) = tensor.begin;
+
+    TuningDatabase database(settings.tuningDatabase);
+    const std::string cpu = CpuInfo::host().brand();
+    std::unordered_set<const OperationCompiler*> tunedCompilers;
+    for(const Operation& op : operations)
+    {
+      // Compilers that are shared by multiple operations are tuned for the first one
+      // (operations whose tensors are line buffers cannot be benchmarked on whole tensors, so they keep their variant unless the compiler is shared)
+      OperationCompiler& compiler = *const_cast<OperationCompiler*>(op.compiler);
+      const unsigned int variants = compiler.variants();
+      const auto isLineBuffer = [](const OperandPlaceholder* operand) { return operand->rowSize != 0; };
+      if(variants < 2 || std::any_of(op.inputOperands.begin(), op.inputOperands.end(), isLineBuffer) ||
+         std::any_of(op.outputOperands.begin(), op.outputOperands.end(), isLineBuffer) || !tunedCompilers.insert(&compiler).second)
+        continue;
+
+      // The key covers everything that the speed of the variants depends on, apart from the CPU model
+      std::string key = compiler.tuningKey() + " input";
+      for(const std::vector<unsigned int>& dimensions : op.inputDimensions)
+        for(std::size_t i = 0; i < dimensions.size(); ++i)
+          key += (i ? "x" : " ") + std::to_string(dimensions[i]);
+      key += std::string(settings.useX64 ? " x64" : " x86") + (settings.useAVX2 ? " avx2" : "") + (settings.useFMA3 ? " fma3" : "") +
+             (settings.useHalfPrecisionWeights ? " f16" : "") + " batch " + std::to_string(samplesPerBatch);
+
+      unsigned int bestVariant = 0;
+      if(!database.find(cpu, key, bestVariant) || bestVariant >= variants)
+      {
+        double bestTime = std::numeric_limits<double>::max();
+        for(unsigned int variant = 0; variant < variants; ++variant)
+        {
+          compiler.variant = variant;
+          compiler.initialize();
+          const double time = benchmarkOperation(op, compiler, settings);
+          if(time < bestTime)
+          {
+            bestTime = time;
+            bestVariant = variant;
+          }
+        }
+        database.set(cpu, key, bestVariant);
+      }
+      compiler.variant = bestVariant;
+      compiler.initialize();
+    }
+    database.save();
+  }
+
+  double CompiledNN::benchmarkOperation(const Operation& op, OperationCompiler& compiler, const CompilationSettings& settings)
+  {
+    // Generate a function that consists only of the operation
+    CodeHolder code;
+    code.init(runtime->environment());
+    x86::Assembler a(&code);
+    CompilationErrorHandler errorHandler;
+    a.setErrorHandler(&errorHandler);
+    for(NetworkConstants& cs : compiler.constants)
+      if(cs.data.size())
+        cs.label = a.newLabel();
+
+    std::vector<TensorPointerXf> inputPointers(op.inputOperands.size()), outputPointers(op.outputOperands.size());
+    for(std::size_t i = 0; i < op.inputOperands.size(); ++i)
+      inputPointers[i] = TensorPointerXf(op.inputDimensions[i], op.inputOperands[i]->allocatedData);
+    for(std::size_t i = 0; i < op.outputOperands.size(); ++i)
+      outputPointers[i] = TensorPointerXf(op.outputDimensions[i], op.outputOperands[i]->allocatedData);
+
+    ActivationFunctionHandler afHandler(settings);
+    emitProlog(a, workspaceData != nullptr);
+    Label sampleLoop;
+    const bool loopOverSamples = samplesPerBatch > 1 && !compiler.processesBatch();
+    if(loopOverSamples)
+      compiler.beginSampleLoop(a, sampleLoop);
+    compiler.compile(a, afHandler, inputPointers, outputPointers);
+    if(loopOverSamples)
+      compiler.endSampleLoop(a, sampleLoop);
+    emitEpilog(a);
+
+    Section* dataSection;
+    VERIFY(static_cast<ErrorCode>(code.newSection(&dataSection, ".rodata", SIZE_MAX, SectionFlags::kNone, 64)) == ErrorCode::kErrorOk);
+    a.section(dataSection);
+    afHandler.compileData(a);
+    for(NetworkConstants& cs : compiler.constants)
+      if(!cs.data.empty())
+      {
+        a.align(AlignMode::kZero, 32);
+        a.bind(cs.label);
+        a.embed(cs.data.data(), cs.data.size() * sizeof(float));
+      }
+
+    FnType function;
+    VERIFY(static_cast<ErrorCode>(runtime->add<FnType>(&function, &code)) == ErrorCode::kErrorOk);
+
+    // Fill the inputs with random values (and restore them before each application if the operation works in place)
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+    std::vector<std::vector<float>> inputValues;
+    std::vector<float*> inputData;
+    bool isInplace = false;
+    for(const OperandPlaceholder* operand : op.inputOperands)
+    {
+      isInplace |= std::find(op.outputOperands.begin(), op.outputOperands.end(), operand) != op.outputOperands.end();
+      for(unsigned int sample = 0; sample < samplesPerBatch; ++sample)
+      {
+        inputData.push_back(reinterpret_cast<float*>(reinterpret_cast<unsigned char*>(operand->allocatedData) + sample * sampleWorkspaceSize));
+        inputValues.emplace_back(operand->requiredSize);
+        for(float& value : inputValues.back())
+          value = distribution(generator);
+      }
+    }
+    const auto restoreInputs = [&]()
+    {
+      for(std::size_t i = 0; i < inputData.size(); ++i)
+        std::copy(inputValues[i].begin(), inputValues[i].end(), inputData[i]);
+    };
+
+    // Take the fastest of at least ten applications (but apply the operation for at least two milliseconds)
+    restoreInputs();
+    function(workspaceData);
+    double bestTime = std::numeric_limits<double>::max(), totalTime = 0.0;
+    for(unsigned int run = 0; run < 1000 && (run < 10 || totalTime < 2e6); ++run)
+    {
+      if(isInplace)
+        restoreInputs();
+      const auto start = std::chrono::steady_clock::now();
+      function(workspaceData);
+      const double time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      bestTime = std::min(bestTime, time);
+      totalTime += time;
+    }
+
+    runtime->release(function);
+    return bestTime;
   }
 
   void CompiledNN::compilerBackend(std::list<Operation>& operations, const CompilerMap& compilers,
@@ -676,47 +1572,691 @@ namespace NeuralNetwork
                                    const CompilationSettings& settings)
   {
     // Assign operands to placeholders
+    bindableIO = settings.bindIO;
     std::list<OperandPlaceholder> operands;
     std::vector<OperandPlaceholder*> inputPlaceholders(inputLocations.size()), outputPlaceholders(outputLocations.size());
     assignOperands(operations, inputLocations, outputLocations, operands, inputPlaceholders, outputPlaceholders);
+    assignLineBuffers(operations);
 
     // Actually allocate memory for all tensors and link it to the operands
-    allocateTensors(operands);
+    allocateTensors(operations, operands, inputPlaceholders, outputPlaceholders, settings);
+
+    // Create the pointer table (which is the start of the workspace of a reentrant net)
+    std::vector<BoundTensor> boundTensors;
+    ioPointers.clear();
+    if(bindableIO)
+    {
+      const std::size_t entries = inputPlaceholders.size() + outputPlaceholders.size();
+      if(!workspaceData)
+        ioPointers.resize(entries);
+      for(std::size_t i = 0; i < entries; ++i)
+      {
+        const OperandPlaceholder* operand = i < inputPlaceholders.size() ? inputPlaceholders[i] : outputPlaceholders[i - inputPlaceholders.size()];
+        const unsigned char* begin = reinterpret_cast<const unsigned char*>(operand->allocatedData);
+        boundTensors.push_back({begin, begin + operand->requiredSize * sizeof(float),
+                                workspaceData ? static_cast<const void*>(workspaceData + i * sizeof(void*)) : static_cast<const void*>(&ioPointers[i])});
+        if(!workspaceData)
+          ioPointers[i] = operand->allocatedData;
+      }
+    }
 
     // Initialize compilers
     for(auto& compilerType : compilers)
       for(auto& compiler : compilerType.second)
         if(compiler->refCount)
+        {
+          compiler->workspaceBase = workspaceData;
+          compiler->batchStride = sampleWorkspaceSize;
+          compiler->boundTensors = bindableIO ? &boundTensors : nullptr;
           compiler->initialize();
+        }
+
+    // Choose the fastest variants of the operations
+    if(settings.autotune)
+      tuneOperations(operations, boundTensors, settings);
 
     // Initialize activation functions
     ActivationFunctionHandler afHandler(settings);
 
     // Generate the function
-    generateCode(operations, compilers, afHandler);
+    generateCode(operations, compilers, afHandler, settings);
 
     // Set input/output pointers
     inputTensors.resize(inputPlaceholders.size());
     outputTensors.resize(outputPlaceholders.size());
+    if(workspaceData)
+    {
+      inputOffsets.resize(inputTensors.size());
+      outputOffsets.resize(outputTensors.size());
+      for(std::size_t i = 0; i < inputTensors.size(); ++i)
+        inputOffsets[i] = reinterpret_cast<unsigned char*>(inputPlaceholders[i]->allocatedData) - workspaceData;
+      for(std::size_t i = 0; i < outputTensors.size(); ++i)
+        outputOffsets[i] = reinterpret_cast<unsigned char*>(outputPlaceholders[i]->allocatedData) - workspaceData;
+      createStagingTensors();
+      return;
+    }
     for(std::size_t i = 0; i < inputTensors.size(); ++i)
       inputTensors[i] = inputPlaceholders[i]->allocatedTensor;
     for(std::size_t i = 0; i < outputTensors.size(); ++i)
       outputTensors[i] = outputPlaceholders[i]->allocatedTensor;
   }
 
-  void CompiledNN::compile(const std::string& filename, const CompilationSettings& settings)
+  void CompiledNN::createStagingTensors()
   {
-    compile(Model(filename), settings);
+    // The input and output tensors of a reentrant net are only used for staging
+    tensors.resize(inputOffsets.size() + outputOffsets.size());
+    inputTensors.resize(inputOffsets.size());
+    outputTensors.resize(outputOffsets.size());
+    inputSizes.resize(inputTensors.size());
+    outputSizes.resize(outputTensors.size());
+    stagedInputs.resize(inputTensors.size());
+    stagedOutputs.resize(outputTensors.size());
+    for(std::size_t i = 0; i < inputTensors.size(); ++i)
+    {
+      inputSizes[i] = std::accumulate(inputDimensions[i].begin(), inputDimensions[i].end(), std::size_t(1), std::multiplies<>());
+      if(samplesPerBatch > 1)
+        inputDimensions[i].insert(inputDimensions[i].begin(), samplesPerBatch);
+      tensors[i].reshape(inputDimensions[i]);
+      inputTensors[i] = &tensors[i];
+      stagedInputs[i] = tensors[i].data();
+    }
+    for(std::size_t i = 0; i < outputTensors.size(); ++i)
+    {
+      outputSizes[i] = std::accumulate(outputDimensions[i].begin(), outputDimensions[i].end(), std::size_t(1), std::multiplies<>());
+      if(samplesPerBatch > 1)
+        outputDimensions[i].insert(outputDimensions[i].begin(), samplesPerBatch);
+      tensors[inputTensors.size() + i].reshape(outputDimensions[i]);
+      outputTensors[i] = &tensors[inputTensors.size() + i];
+      stagedOutputs[i] = tensors[inputTensors.size() + i].data();
+    }
   }
 
-  void CompiledNN::compile(const Model& specification, const CompilationSettings& settings)
+  void CompiledNN::applyInWorkspace(const float* const* inputs, float* const* outputs, unsigned char* workspace) const
   {
-    // Reset attributes
+    if(bindableIO)
+    {
+      // The net reads and writes the given buffers directly
+      const void** table = reinterpret_cast<const void**>(workspace);
+      for(std::size_t i = 0; i < inputOffsets.size(); ++i)
+        table[i] = inputs[i];
+      for(std::size_t i = 0; i < outputOffsets.size(); ++i)
+        table[inputOffsets.size() + i] = outputs[i];
+      if(stages.empty())
+        applyFunction(workspace);
+      else
+        runStages(workspace);
+      return;
+    }
+
+    for(std::size_t i = 0; i < inputSizes.size(); ++i)
+      for(unsigned int sample = 0; sample < samplesPerBatch; ++sample)
+        std::memcpy(workspace + sample * sampleWorkspaceSize + inputOffsets[i], inputs[i] + sample * inputSizes[i], inputSizes[i] * sizeof(float));
+    if(stages.empty())
+      applyFunction(workspace);
+    else
+      runStages(workspace);
+    for(std::size_t i = 0; i < outputSizes.size(); ++i)
+      for(unsigned int sample = 0; sample < samplesPerBatch; ++sample)
+        std::memcpy(outputs[i] + sample * outputSizes[i], workspace + sample * sampleWorkspaceSize + outputOffsets[i], outputSizes[i] * sizeof(float));
+  }
+
+  void CompiledNN::runStages(void* workspace) const
+  {
+    for(const std::vector<FnType>& stage : stages)
+    {
+      if(stage.size() == 1)
+        stage[0](workspace);
+      else
+        workers->run(stage.data(), stage.size(), workspace);
+    }
+  }
+
+  void CompiledNN::registerCode(const CompilationSettings& settings)
+  {
+    if(!settings.perfMap && !settings.gdbJIT)
+      return;
+    std::vector<ElfSymbol> functions;
+    functions.reserve(codeSymbols.size());
+    for(const CodeSymbol& symbol : codeSymbols)
+      functions.push_back({symbol.offset, symbol.size, symbol.layer.empty() ? "CompiledNN" : "CompiledNN:" + symbol.layer});
+    if(settings.perfMap)
+      writePerfMap(reinterpret_cast<const void*>(applyFunction), functions);
+    if(settings.gdbJIT)
+      gdbJitRegistration = std::make_unique<GdbJitRegistration>(reinterpret_cast<const void*>(applyFunction), dataOffset, functions);
+  }
+
+  void CompiledNN::releaseCode()
+  {
+    gdbJitRegistration.reset();
     if(applyFunction)
     {
       runtime->release(applyFunction);
       applyFunction = nullptr;
     }
+  }
+
+  void CompiledNN::apply(const float* const* inputs, float* const* outputs, void* workspace) const
+  {
+    ASSERT(valid());
+    ASSERT(reentrant());
+    ASSERT(!(reinterpret_cast<uintptr_t>(workspace) & 63));
+    applyInWorkspace(inputs, outputs, static_cast<unsigned char*>(workspace));
+  }
+
+  bool CompiledNN::exportObject(const std::string& objectFilename, const std::string& headerFilename, const std::string& name) const
+  {
+    ASSERT(valid());
+    if(!reentrant() || !positionIndependent || !stages.empty() || sizeof(void*) != 8)
+      return false;
+
+    std::vector<ElfDataReference> references;
+    references.reserve(dataReferences.size());
+    for(const DataReference& reference : dataReferences)
+      references.push_back({reference.offset, reference.addend});
+    std::vector<ElfSymbol> functions;
+    functions.reserve(codeSymbols.size());
+    for(const CodeSymbol& symbol : codeSymbols)
+      if(!symbol.layer.empty())
+        functions.push_back({symbol.offset, symbol.size, name + ":" + symbol.layer});
+    const unsigned char* code = reinterpret_cast<const unsigned char*>(applyFunction);
+    if(!writeElfObject(objectFilename, name + "_run", code, dataOffset, code + dataOffset, codeSize - dataOffset, references, functions))
+      return false;
+
+    std::string prefix = name;
+    std::transform(prefix.begin(), prefix.end(), prefix.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    std::ofstream stream(headerFilename);
+    stream << "/* Generated by CompiledNN. Link with " << objectFilename.substr(objectFilename.find_last_of("/\\") + 1) << ". */\n\n"
+           << "#pragma once\n\n"
+           << "#include <stddef.h>\n"
+           << "#include <string.h>\n\n"
+           << "#ifdef __cplusplus\n"
+           << "extern \"C\" {\n"
+           << "#endif\n\n"
+           << "/* The number of bytes of a workspace (which must be aligned to 64 bytes). */\n"
+           << "#define " << prefix << "_WORKSPACE_SIZE " << requiredWorkspaceSize << "u\n"
+           << "/* The number of samples that are processed by each application. */\n"
+           << "#define " << prefix << "_BATCH_SIZE " << samplesPerBatch << "u\n"
+           << "#define " << prefix << "_NUM_INPUTS " << inputOffsets.size() << "u\n"
+           << "#define " << prefix << "_NUM_OUTPUTS " << outputOffsets.size() << "u\n";
+    const auto writeTensors = [&](const std::string& kind, const std::vector<std::vector<unsigned int>>& dimensions,
+                                  const std::vector<std::size_t>& offsets, const std::vector<std::size_t>& sizes)
+    {
+      std::string upperKind = kind;
+      std::transform(upperKind.begin(), upperKind.end(), upperKind.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+      stream << "\n";
+      for(std::size_t i = 0; i < dimensions.size(); ++i)
+      {
+        stream << "#define " << prefix << "_" << upperKind << i << "_DIMENSIONS {";
+        for(std::size_t j = 0; j < dimensions[i].size(); ++j)
+          stream << (j ? ", " : "") << dimensions[i][j] << "u";
+        stream << "}\n";
+      }
+      if(bindableIO)
+        return;
+      stream << "static const size_t " << name << "_" << kind << "_offsets[] = {";
+      for(std::size_t i = 0; i < offsets.size(); ++i)
+        stream << (i ? ", " : "") << offsets[i] << "u";
+      stream << "};\n"
+             << "static const size_t " << name << "_" << kind << "_sizes[] = {";
+      for(std::size_t i = 0; i < sizes.size(); ++i)
+        stream << (i ? ", " : "") << sizes[i] << "u";
+      stream << "};\n";
+    };
+    writeTensors("input", inputDimensions, inputOffsets, inputSizes);
+    writeTensors("output", outputDimensions, outputOffsets, outputSizes);
+    stream << "\n"
+           << "/* Applies the net on the data in the workspace. */\n"
+           << "void " << name << "_run(void* workspace);\n\n"
+           << "/*\n"
+           << " * Applies the net on the given input data and writes the results to the given output buffers.\n"
+           << " * As long as each thread uses its own workspace, this function can be called concurrently.\n";
+    if(bindableIO)
+      stream << " * The net accesses the given buffers directly, so each of them must have room for three floats more than its tensor has elements.\n";
+    stream << " */\n"
+           << "static inline void " << name << "_apply(const float* const* inputs, float* const* outputs, void* workspace)\n"
+           << "{\n";
+    if(bindableIO)
+      stream << "  size_t i;\n"
+             << "  for(i = 0; i < " << prefix << "_NUM_INPUTS; ++i)\n"
+             << "    ((const void**)workspace)[i] = inputs[i];\n"
+             << "  for(i = 0; i < " << prefix << "_NUM_OUTPUTS; ++i)\n"
+             << "    ((const void**)workspace)[" << prefix << "_NUM_INPUTS + i] = outputs[i];\n"
+             << "  " << name << "_run(workspace);\n";
+    else
+      stream << "  size_t sample, i;\n"
+             << "  for(sample = 0; sample < " << prefix << "_BATCH_SIZE; ++sample)\n"
+             << "    for(i = 0; i < " << prefix << "_NUM_INPUTS; ++i)\n"
+             << "      memcpy((char*)workspace + sample * " << sampleWorkspaceSize << "u + " << name << "_input_offsets[i], inputs[i] + sample * "
+             << name << "_input_sizes[i], " << name << "_input_sizes[i] * sizeof(float));\n"
+             << "  " << name << "_run(workspace);\n"
+             << "  for(sample = 0; sample < " << prefix << "_BATCH_SIZE; ++sample)\n"
+             << "    for(i = 0; i < " << prefix << "_NUM_OUTPUTS; ++i)\n"
+             << "      memcpy(outputs[i] + sample * " << name << "_output_sizes[i], (const char*)workspace + sample * " << sampleWorkspaceSize << "u + "
+             << name << "_output_offsets[i], " << name << "_output_sizes[i] * sizeof(float));\n";
+    stream << "}\n\n"
+           << "#ifdef __cplusplus\n"
+           << "}\n"
+           << "#endif\n";
+    return static_cast<bool>(stream);
+  }
+
+  void CompiledNN::bindInput(std::size_t index, const float* data)
+  {
+    ASSERT(bindableIO);
+    if(!data)
+      data = inputTensors[index]->data();
+    if(reentrant())
+      stagedInputs[index] = data;
+    else
+      ioPointers[index] = data;
+  }
+
+  void CompiledNN::bindOutput(std::size_t index, float* data)
+  {
+    ASSERT(bindableIO);
+    if(!data)
+      data = outputTensors[index]->data();
+    if(reentrant())
+      stagedOutputs[index] = data;
+    else
+      ioPointers[inputTensors.size() + index] = data;
+  }
+
+  std::vector<CompiledNN::OperationProfile> CompiledNN::profile() const
+  {
+    std::vector<OperationProfile> result;
+    result.reserve(profileLayers.size());
+    for(std::size_t i = 0; i < profileLayers.size(); ++i)
+      result.push_back({profileLayers[i], profileCounters[2 * i], profileCounters[2 * i + 1]});
+    return result;
+  }
+
+  void CompiledNN::resetProfile()
+  {
+    std::fill(profileCounters.begin(), profileCounters.end(), 0);
+  }
+
+  void CompiledNN::compile(const std::string& filename, const CompilationSettings& settings)
+  {
+    compile(Model(filename), settings);
+  }
+
+  /**
+   * Incrementally computes the 64 bit FNV-1a hash of some bytes.
+   */
+  static std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull)
+  {
+    for(const unsigned char* p = static_cast<const unsigned char*>(data), * end = p + size; p != end; ++p)
+      hash = (hash ^ *p) * 1099511628211ull;
+    return hash;
+  }
+
+  template<typename T>
+  static std::uint64_t hashValue(const T& value, std::uint64_t hash)
+  {
+    return hashBytes(&value, sizeof(T), hash);
+  }
+
+  /**
+   * Computes the key of the cache file of a net, which covers the model file, the (constricted) compilation settings and the features of the host CPU.
+   */
+  static std::uint64_t cacheKey(const std::string& filename, const CompilationSettings& settings)
+  {
+    // Incremented whenever the format of the cache file or the generated code changes
+    constexpr std::uint32_t version = 5;
+    std::uint64_t hash = hashValue(version, hashBytes("CompiledNN", 10));
+
+    std::ifstream stream(filename, std::ios::binary);
+    const std::vector<char> model((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    hash = hashValue(model.size(), hashBytes(model.data(), model.size(), hash));
+
+    hash = hashValue(settings.useX64, hash);
+    hash = hashValue(settings.useSSE42, hash);
+    hash = hashValue(settings.useAVX2, hash);
+    hash = hashValue(settings.useFMA3, hash);
+    hash = hashValue(settings.useExpApproxInSigmoid, hash);
+    hash = hashValue(settings.useExpApproxInTanh, hash);
+    hash = hashValue(settings.useHalfPrecisionWeights, hash);
+    hash = hashValue(settings.quantize, hash);
+    hash = hashValue(settings.useWinograd, hash);
+    if(settings.quantize && !settings.quantizationParameters.empty())
+    {
+      std::ifstream parameterStream(settings.quantizationParameters, std::ios::binary);
+      const std::vector<char> parameters((std::istreambuf_iterator<char>(parameterStream)), std::istreambuf_iterator<char>());
+      hash = hashValue(parameters.size(), hashBytes(parameters.data(), parameters.size(), hash));
+    }
+    hash = hashValue(settings.reentrant, hash);
+    hash = hashValue(settings.batchSize, hash);
+    hash = hashValue(settings.threads, hash);
+    hash = hashValue(settings.bindIO, hash);
+    hash = hashValue(settings.stripeCacheSize, hash);
+    hash = hashValue(settings.debug, hash);
+    hash = hashValue(settings.profile, hash);
+    hash = hashValue(settings.autotune, hash);
+
+    const CpuInfo& cpuInfo = CpuInfo::host();
+    hash = hashBytes(cpuInfo.vendor(), std::strlen(cpuInfo.vendor()), hash);
+    return hashBytes(cpuInfo.features().bits(), cpuInfo.features().bitWordCount() * sizeof(*cpuInfo.features().bits()), hash);
+  }
+
+  /**
+   * Reads values from a cache file that has been mapped into memory.
+   */
+  class CacheReader final
+  {
+  public:
+    CacheReader(const std::string& filename)
+    {
+#ifndef _WIN32
+      const int fd = open(filename.c_str(), O_RDONLY);
+      if(fd < 0)
+        return;
+      struct stat status;
+      if(!fstat(fd, &status) && status.st_size > 0)
+      {
+        void* mapping = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED)
+        {
+          begin = pos = static_cast<const unsigned char*>(mapping);
+          end = begin + status.st_size;
+        }
+      }
+      close(fd);
+#else
+      std::ifstream stream(filename, std::ios::binary);
+      buffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+      begin = pos = reinterpret_cast<const unsigned char*>(buffer.data());
+      end = begin + buffer.size();
+#endif
+    }
+
+    ~CacheReader()
+    {
+#ifndef _WIN32
+      if(begin)
+        munmap(const_cast<unsigned char*>(begin), static_cast<std::size_t>(end - begin));
+#endif
+    }
+
+    CacheReader(const CacheReader&) = delete;
+    CacheReader& operator=(const CacheReader&) = delete;
+
+    template<typename T>
+    bool read(T& value)
+    {
+      if(static_cast<std::size_t>(end - pos) < sizeof(T))
+        return false;
+      std::memcpy(&value, pos, sizeof(T));
+      pos += sizeof(T);
+      return true;
+    }
+
+    bool read(std::vector<unsigned int>& values)
+    {
+      std::uint64_t size;
+      if(!read(size) || size > static_cast<std::size_t>(end - pos) / sizeof(unsigned int))
+        return false;
+      values.resize(static_cast<std::size_t>(size));
+      for(unsigned int& value : values)
+        read(value);
+      return true;
+    }
+
+    /**
+     * Checks whether the bytes that have not been read yet have the given hash, i.e. whether the file has been truncated or corrupted.
+     */
+    bool matches(std::uint64_t hash) const
+    {
+      return hashBytes(pos, static_cast<std::size_t>(end - pos)) == hash;
+    }
+
+    /**
+     * Skips the given number of bytes and returns their address (or nullptr if the file is too short).
+     */
+    const unsigned char* skip(std::size_t size)
+    {
+      if(static_cast<std::size_t>(end - pos) < size)
+        return nullptr;
+      pos += size;
+      return pos - size;
+    }
+
+  private:
+    const unsigned char* begin = nullptr;
+    const unsigned char* pos = nullptr;
+    const unsigned char* end = nullptr;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+  };
+
+  template<typename T>
+  static void writeValue(std::ostream& stream, const T& value)
+  {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void CompiledNN::saveCache(const std::string& filename, std::uint64_t key) const
+  {
+    ASSERT(reentrant());
+    if(!positionIndependent)
+      return;
+
+    // Write to a temporary file first, such that other processes never map a partially written cache
+    const std::string tempFilename = filename + ".tmp";
+    {
+      // The contents are preceded by their hash, such that truncated or corrupted files are detected
+      std::ostringstream stream;
+      writeValue(stream, samplesPerBatch);
+      writeValue(stream, static_cast<std::uint64_t>(sampleWorkspaceSize));
+      writeValue(stream, static_cast<std::uint64_t>(tensorMemorySize));
+      writeValue(stream, static_cast<std::uint64_t>(unsharedTensorMemorySize));
+      const auto writeTensors = [&](const std::vector<std::vector<unsigned int>>& dimensions, const std::vector<std::size_t>& offsets)
+      {
+        writeValue(stream, static_cast<std::uint64_t>(dimensions.size()));
+        for(std::size_t i = 0; i < dimensions.size(); ++i)
+        {
+          // Only the dimensions of a single sample are stored
+          const std::size_t skip = samplesPerBatch > 1 ? 1 : 0;
+          writeValue(stream, static_cast<std::uint64_t>(dimensions[i].size() - skip));
+          for(std::size_t j = skip; j < dimensions[i].size(); ++j)
+            writeValue(stream, dimensions[i][j]);
+          writeValue(stream, static_cast<std::uint64_t>(offsets[i]));
+        }
+      };
+      writeTensors(inputDimensions, inputOffsets);
+      writeTensors(outputDimensions, outputOffsets);
+      writeValue(stream, static_cast<std::uint64_t>(stages.size()));
+      for(const std::vector<FnType>& stage : stages)
+      {
+        writeValue(stream, static_cast<std::uint64_t>(stage.size()));
+        for(const FnType function : stage)
+          writeValue(stream, static_cast<std::uint64_t>(reinterpret_cast<uintptr_t>(function) - reinterpret_cast<uintptr_t>(applyFunction)));
+      }
+      writeValue(stream, static_cast<std::uint64_t>(dataOffset));
+      writeValue(stream, static_cast<std::uint64_t>(dataReferences.size()));
+      for(const DataReference& reference : dataReferences)
+      {
+        writeValue(stream, static_cast<std::uint64_t>(reference.offset));
+        writeValue(stream, reference.addend);
+      }
+      writeValue(stream, static_cast<std::uint64_t>(codeSymbols.size()));
+      for(const CodeSymbol& symbol : codeSymbols)
+      {
+        writeValue(stream, static_cast<std::uint64_t>(symbol.offset));
+        writeValue(stream, static_cast<std::uint64_t>(symbol.size));
+        writeValue(stream, static_cast<std::uint64_t>(symbol.layer.size()));
+        stream.write(symbol.layer.data(), symbol.layer.size());
+      }
+      writeValue(stream, static_cast<std::uint64_t>(codeSize));
+      stream.write(reinterpret_cast<const char*>(applyFunction), codeSize);
+
+      const std::string contents = stream.str();
+      std::ofstream file(tempFilename, std::ios::binary);
+      writeValue(file, key);
+      writeValue(file, hashBytes(contents.data(), contents.size()));
+      file.write(contents.data(), contents.size());
+      if(!file)
+      {
+        file.close();
+        std::remove(tempFilename.c_str());
+        return;
+      }
+    }
+    std::remove(filename.c_str());
+    std::rename(tempFilename.c_str(), filename.c_str());
+  }
+
+  bool CompiledNN::loadCache(const std::string& filename, std::uint64_t key, const CompilationSettings& settings)
+  {
+    CacheReader reader(filename);
+    std::uint64_t fileKey, hash;
+    if(!reader.read(fileKey) || fileKey != key || !reader.read(hash) || !reader.matches(hash))
+      return false;
+
+    // Parse the complete file before anything is changed
+    unsigned int fileSamplesPerBatch;
+    std::uint64_t fileSampleWorkspaceSize, fileTensorMemorySize, fileUnsharedTensorMemorySize;
+    if(!reader.read(fileSamplesPerBatch) || !reader.read(fileSampleWorkspaceSize) || !reader.read(fileTensorMemorySize) || !reader.read(fileUnsharedTensorMemorySize))
+      return false;
+    std::vector<std::vector<unsigned int>> fileInputDimensions, fileOutputDimensions;
+    std::vector<std::size_t> fileInputOffsets, fileOutputOffsets;
+    const auto readTensors = [&](std::vector<std::vector<unsigned int>>& dimensions, std::vector<std::size_t>& offsets)
+    {
+      std::uint64_t count;
+      if(!reader.read(count) || count > 0xffff)
+        return false;
+      dimensions.resize(static_cast<std::size_t>(count));
+      offsets.resize(static_cast<std::size_t>(count));
+      for(std::size_t i = 0; i < dimensions.size(); ++i)
+      {
+        std::uint64_t offset;
+        if(!reader.read(dimensions[i]) || !reader.read(offset) || offset >= fileSampleWorkspaceSize)
+          return false;
+        offsets[i] = static_cast<std::size_t>(offset);
+      }
+      return true;
+    };
+    if(!readTensors(fileInputDimensions, fileInputOffsets) || !readTensors(fileOutputDimensions, fileOutputOffsets))
+      return false;
+    std::uint64_t numOfStages, fileCodeSize;
+    if(!reader.read(numOfStages) || numOfStages > 0xffff)
+      return false;
+    std::vector<std::vector<std::uint64_t>> stageOffsets(static_cast<std::size_t>(numOfStages));
+    for(std::vector<std::uint64_t>& stage : stageOffsets)
+    {
+      std::uint64_t numOfFunctions;
+      if(!reader.read(numOfFunctions) || numOfFunctions > 0xffff)
+        return false;
+      stage.resize(static_cast<std::size_t>(numOfFunctions));
+      for(std::uint64_t& offset : stage)
+        if(!reader.read(offset))
+          return false;
+    }
+    std::uint64_t fileDataOffset, numOfDataReferences;
+    if(!reader.read(fileDataOffset) || !reader.read(numOfDataReferences) || numOfDataReferences > 0xffffff)
+      return false;
+    std::vector<DataReference> fileDataReferences(static_cast<std::size_t>(numOfDataReferences));
+    for(DataReference& reference : fileDataReferences)
+    {
+      std::uint64_t offset;
+      if(!reader.read(offset) || !reader.read(reference.addend) || offset >= fileDataOffset)
+        return false;
+      reference.offset = static_cast<std::size_t>(offset);
+    }
+    std::uint64_t numOfCodeSymbols;
+    if(!reader.read(numOfCodeSymbols) || numOfCodeSymbols > 0xffffff)
+      return false;
+    std::vector<CodeSymbol> fileCodeSymbols(static_cast<std::size_t>(numOfCodeSymbols));
+    for(CodeSymbol& symbol : fileCodeSymbols)
+    {
+      std::uint64_t offset, size, length;
+      const unsigned char* layer;
+      if(!reader.read(offset) || !reader.read(size) || !reader.read(length) || offset + size > fileDataOffset
+         || length > 0xffff || !(layer = reader.skip(static_cast<std::size_t>(length))))
+        return false;
+      symbol.offset = static_cast<std::size_t>(offset);
+      symbol.size = static_cast<std::size_t>(size);
+      symbol.layer.assign(reinterpret_cast<const char*>(layer), static_cast<std::size_t>(length));
+    }
+    const unsigned char* fileCode;
+    if(!reader.read(fileCodeSize) || !fileCodeSize || !(fileCode = reader.skip(static_cast<std::size_t>(fileCodeSize))))
+      return false;
+    if(fileDataOffset > fileCodeSize)
+      return false;
+    for(const std::vector<std::uint64_t>& stage : stageOffsets)
+      for(const std::uint64_t offset : stage)
+        if(offset >= fileDataOffset)
+          return false;
+
+    // Copy the code to executable memory
+    void* rx;
+    void* rw;
+    if(runtime->allocator()->alloc(&rx, &rw, static_cast<std::size_t>(fileCodeSize)) != static_cast<Error>(ErrorCode::kErrorOk))
+      return false;
+    {
+      VirtMem::ProtectJitReadWriteScope scope(rx, static_cast<std::size_t>(fileCodeSize));
+      std::memcpy(rw, fileCode, static_cast<std::size_t>(fileCodeSize));
+    }
+    applyFunction = reinterpret_cast<FnType>(rx);
+    bindableIO = settings.bindIO;
+    ioPointers.clear();
+    codeSize = static_cast<std::size_t>(fileCodeSize);
+    dataOffset = static_cast<std::size_t>(fileDataOffset);
+    dataReferences = std::move(fileDataReferences);
+    codeSymbols = std::move(fileCodeSymbols);
+    positionIndependent = true;
+    profileCounters.clear();
+    profileLayers.clear();
+
+    stages.clear();
+    workers.reset();
+    for(const std::vector<std::uint64_t>& stage : stageOffsets)
+    {
+      stages.emplace_back();
+      for(const std::uint64_t offset : stage)
+        stages.back().push_back(reinterpret_cast<FnType>(reinterpret_cast<uintptr_t>(applyFunction) + static_cast<uintptr_t>(offset)));
+    }
+    if(!stages.empty())
+      workers = std::make_unique<WorkerPool>(settings.threads - 1);
+
+    // Restore the workspace and the staging tensors
+    samplesPerBatch = fileSamplesPerBatch;
+    sampleWorkspaceSize = static_cast<std::size_t>(fileSampleWorkspaceSize);
+    tensorMemorySize = static_cast<std::size_t>(fileTensorMemorySize);
+    unsharedTensorMemorySize = static_cast<std::size_t>(fileUnsharedTensorMemorySize);
+    requiredWorkspaceSize = sampleWorkspaceSize * samplesPerBatch;
+    workspaceBuffer.resize(requiredWorkspaceSize + 63);
+    workspaceData = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(workspaceBuffer.data()) + 63) & ~uintptr_t(63));
+    inputDimensions = std::move(fileInputDimensions);
+    outputDimensions = std::move(fileOutputDimensions);
+    inputOffsets = std::move(fileInputOffsets);
+    outputOffsets = std::move(fileOutputOffsets);
+    createStagingTensors();
+    registerCode(settings);
+    return true;
+  }
+
+  void CompiledNN::compile(const std::string& filename, const std::string& cacheFilename, const CompilationSettings& settings)
+  {
+    // The code in the cache must not depend on the addresses of the tensors
+    CompilationSettings cacheSettings(settings);
+    cacheSettings.reentrant = true;
+    const CompilationSettings effSettings = cacheSettings.constricted();
+    const std::uint64_t key = cacheKey(filename, effSettings);
+
+    releaseCode();
+    if(loadCache(cacheFilename, key, effSettings))
+      return;
+
+    compile(Model(filename), effSettings);
+    saveCache(cacheFilename, key);
+  }
+
+  void CompiledNN::compile(const Model& specification, const CompilationSettings& settings)
+  {
+    // Reset attributes
+    releaseCode();
 
     // Constrict settings to CPU features
     const CompilationSettings effSettings = settings.constricted();
@@ -736,6 +2276,9 @@ namespace NeuralNetwork
     for(std::size_t i = 0; i < inputs.size(); ++i)
       inputLocations.emplace_back(nullptr, static_cast<unsigned int>(i));
 
+    // Read the calibrated input ranges of the quantized layers
+    const QuantizationParameters quantizationParameters(effSettings.quantize ? effSettings.quantizationParameters : std::string());
+
     // Create operations for input converters (if required) and initialize mapping from operand locations to tensor locations
     CompilerMap compilers;
     std::list<Operation> operations;
@@ -749,6 +2292,7 @@ namespace NeuralNetwork
         const OperationCompiler* uInt8InputCompiler = getCompiler<UInt8InputCompiler>(effSettings, p, compilers);
         operations.emplace_back(uInt8InputCompiler);
         Operation& operation = operations.back();
+        operation.layer = inputs[i].layer->name;
         operation.inputs = {inputLocations[i]};
         operation.inputDimensions = {inputDimensions[i]};
         operation.outputDimensions = uInt8InputCompiler->calcOutputDimensions(operation.inputDimensions);
@@ -823,7 +2367,7 @@ namespace NeuralNetwork
         nodeInputs.push_back(it->second);
       }
 
-      auto opCompilers = generateCompilers(effSettings, *node, compilers);
+      auto opCompilers = generateCompilers(effSettings, quantizationParameters, *node, compilers);
 
       // Eliminate operations if they can be integrated into previous ones
       std::size_t compilerOffset;
@@ -875,6 +2419,26 @@ namespace NeuralNetwork
             nodeInputs[0].provider->compiler = getCompiler<Conv2DCompiler>(effSettings, p, compilers);
             continue;
           }
+          const WinogradConv2DCompiler* winogradConv2DCompiler = dynamic_cast<const WinogradConv2DCompiler*>(nodeInputs[0].provider->compiler);
+          if(winogradConv2DCompiler && !winogradConv2DCompiler->p.batchNormalization && winogradConv2DCompiler->p.activationDesc.id == CompiledActivationFunctionId::linear && bnCompiler->p.dimension == 2)
+          {
+            --bnCompiler->refCount;
+            --winogradConv2DCompiler->refCount;
+            WinogradConv2DCompiler::Parameters p = winogradConv2DCompiler->p;
+            p.batchNormalization = &bnCompiler->p;
+            nodeInputs[0].provider->compiler = getCompiler<WinogradConv2DCompiler>(effSettings, p, compilers);
+            continue;
+          }
+          const GEMMCompiler* gemmCompiler = dynamic_cast<const GEMMCompiler*>(nodeInputs[0].provider->compiler);
+          if(gemmCompiler && !gemmCompiler->p.batchNormalization && gemmCompiler->p.activationDesc.id == CompiledActivationFunctionId::linear && bnCompiler->p.dimension == 2)
+          {
+            --bnCompiler->refCount;
+            --gemmCompiler->refCount;
+            GEMMCompiler::Parameters p = gemmCompiler->p;
+            p.batchNormalization = &bnCompiler->p;
+            nodeInputs[0].provider->compiler = getCompiler<GEMMCompiler>(effSettings, p, compilers);
+            continue;
+          }
           const DConv2DCompiler* dConv2DCompiler = dynamic_cast<const DConv2DCompiler*>(nodeInputs[0].provider->compiler);
           if(dConv2DCompiler && !dConv2DCompiler->p.batchNormalization && dConv2DCompiler->p.postActivation.id == CompiledActivationFunctionId::linear && bnCompiler->p.dimension == 2)
           {
@@ -885,6 +2449,16 @@ namespace NeuralNetwork
             nodeInputs[0].provider->compiler = getCompiler<DConv2DCompiler>(effSettings, p, compilers);
             continue;
           }
+          const SeparableConv2DCompiler* separableConv2DCompiler = dynamic_cast<const SeparableConv2DCompiler*>(nodeInputs[0].provider->compiler);
+          if(separableConv2DCompiler && !separableConv2DCompiler->p.pointwise.batchNormalization && bnCompiler->p.dimension == 2)
+          {
+            --bnCompiler->refCount;
+            --separableConv2DCompiler->refCount;
+            SeparableConv2DCompiler::Parameters p = separableConv2DCompiler->p;
+            p.pointwise.batchNormalization = &bnCompiler->p;
+            nodeInputs[0].provider->compiler = getCompiler<SeparableConv2DCompiler>(effSettings, p, compilers);
+            continue;
+          }
         }
 
         const ActivationCompiler* activationCompiler = dynamic_cast<const ActivationCompiler*>(opCompilers[compilerOffset]);
@@ -920,6 +2494,26 @@ namespace NeuralNetwork
             nodeInputs[0].provider->compiler = getCompiler<Conv2DCompiler>(effSettings, p, compilers);
             continue;
           }
+          const WinogradConv2DCompiler* winogradConv2DCompiler = dynamic_cast<const WinogradConv2DCompiler*>(nodeInputs[0].provider->compiler);
+          if(winogradConv2DCompiler && winogradConv2DCompiler->p.activationDesc.id == CompiledActivationFunctionId::linear)
+          {
+            --activationCompiler->refCount;
+            --winogradConv2DCompiler->refCount;
+            WinogradConv2DCompiler::Parameters p = winogradConv2DCompiler->p;
+            p.activationDesc = activationCompiler->p.activationDesc;
+            nodeInputs[0].provider->compiler = getCompiler<WinogradConv2DCompiler>(effSettings, p, compilers);
+            continue;
+          }
+          const GEMMCompiler* gemmCompiler = dynamic_cast<const GEMMCompiler*>(nodeInputs[0].provider->compiler);
+          if(gemmCompiler && gemmCompiler->p.activationDesc.id == CompiledActivationFunctionId::linear)
+          {
+            --activationCompiler->refCount;
+            --gemmCompiler->refCount;
+            GEMMCompiler::Parameters p = gemmCompiler->p;
+            p.activationDesc = activationCompiler->p.activationDesc;
+            nodeInputs[0].provider->compiler = getCompiler<GEMMCompiler>(effSettings, p, compilers);
+            continue;
+          }
           const DConv2DCompiler* dConv2DCompiler = dynamic_cast<const DConv2DCompiler*>(nodeInputs[0].provider->compiler);
           if(dConv2DCompiler && dConv2DCompiler->p.postActivation.id == CompiledActivationFunctionId::linear)
           {
@@ -930,6 +2524,34 @@ namespace NeuralNetwork
             nodeInputs[0].provider->compiler = getCompiler<DConv2DCompiler>(effSettings, p, compilers);
             continue;
           }
+          const SeparableConv2DCompiler* separableConv2DCompiler = dynamic_cast<const SeparableConv2DCompiler*>(nodeInputs[0].provider->compiler);
+          if(separableConv2DCompiler && separableConv2DCompiler->p.pointwise.postActivation.id == CompiledActivationFunctionId::linear)
+          {
+            --activationCompiler->refCount;
+            --separableConv2DCompiler->refCount;
+            SeparableConv2DCompiler::Parameters p = separableConv2DCompiler->p;
+            p.pointwise.postActivation = activationCompiler->p.activationDesc;
+            nodeInputs[0].provider->compiler = getCompiler<SeparableConv2DCompiler>(effSettings, p, compilers);
+            continue;
+          }
+        }
+
+        // Compute a pointwise convolution in bands together with the depthwise convolution that computes its input
+        const Conv2DCompiler* pointwiseCompiler = dynamic_cast<const Conv2DCompiler*>(opCompilers[compilerOffset]);
+        if(pointwiseCompiler && SeparableConv2DCompiler::isPointwise(pointwiseCompiler->p) && node->inputs.size() == 1 && locationRefCounters[node->inputs[0]] == 1 && nodeInputs[0].provider)
+        {
+          const DConv2DCompiler* dConv2DCompiler = dynamic_cast<const DConv2DCompiler*>(nodeInputs[0].provider->compiler);
+          if(dConv2DCompiler && dConv2DCompiler->p.weights->dims(3) == 1)
+          {
+            --pointwiseCompiler->refCount;
+            --dConv2DCompiler->refCount;
+            SeparableConv2DCompiler::Parameters p;
+            p.depthwise = dConv2DCompiler->p;
+            p.pointwise = pointwiseCompiler->p;
+            nodeInputs[0].provider->compiler = getCompiler<SeparableConv2DCompiler>(effSettings, p, compilers);
+            nodeInputs[0].provider->outputDimensions = nodeInputs[0].provider->compiler->calcOutputDimensions(nodeInputs[0].provider->inputDimensions);
+            continue;
+          }
         }
 
         // Automatically use the quantized variant of this specific layer
@@ -963,12 +2585,15 @@ namespace NeuralNetwork
 
         break;
       }
+      if(compilerOffset > 0)
+        nodeInputs[0].provider->layer += "+" + node->layer->name;
 
       for(std::size_t i = compilerOffset; i < opCompilers.size(); ++i)
       {
         const Operation* prevOperation = (i == compilerOffset) ? nullptr : &operations.back();
         operations.emplace_back(opCompilers[i]);
         Operation& operation = operations.back();
+        operation.layer = node->layer->name;
         if(i == compilerOffset)
         {
           operation.inputs = nodeInputs;
@@ -1010,6 +2635,14 @@ namespace NeuralNetwork
       outputLocations.push_back(it->second);
     }
 
+    // Find independent branches that can be executed concurrently
+    if(effSettings.threads > 1)
+      scheduleBranches(operations);
+
+    // Find chains of operations whose intermediate tensors are computed in stripes of rows
+    if(effSettings.stripeCacheSize)
+      scheduleStripes(operations, outputLocations, effSettings);
+
     // Do the actual compilation process
     compilerBackend(operations, compilers, inputLocations, outputLocations, effSettings);
   }
@@ -1017,11 +2650,7 @@ namespace NeuralNetwork
   void CompiledNN::compile(const Node& node, const CompilationSettings& settings)
   {
     // Reset attributes
-    if(applyFunction)
-    {
-      runtime->release(applyFunction);
-      applyFunction = nullptr;
-    }
+    releaseCode();
 
     // Constrict settings to CPU features
     const CompilationSettings effSettings = settings.constricted();
@@ -1037,7 +2666,8 @@ namespace NeuralNetwork
 
     // Create compilers for the operations that the node requires
     CompilerMap compilers;
-    std::vector<OperationCompiler*> opCompilers = generateCompilers(effSettings, node, compilers);
+    const QuantizationParameters quantizationParameters(effSettings.quantize ? effSettings.quantizationParameters : std::string());
+    std::vector<OperationCompiler*> opCompilers = generateCompilers(effSettings, quantizationParameters, node, compilers);
 
     // Create a representation of an operation for each sub-compiled operation
     std::list<Operation> operations;
@@ -1047,6 +2677,7 @@ namespace NeuralNetwork
       const Operation* prevOperation = first ? nullptr : &operations.back();
       operations.emplace_back(compiler);
       Operation& operation = operations.back();
+      operation.layer = node.layer->name;
       if(first)
       {
         operation.inputs = inputLocations;
@@ -1077,6 +2708,6 @@ namespace NeuralNetwork
     }
 
     // Do the actual compilation process
-    compilerBackend(operations, compilers, inputLocations, outputLocations, settings);
+    compilerBackend(operations, compilers, inputLocations, outputLocations, effSettings);
   }
 }
@@ -12,6 +12,7 @@
 #include "Tensor.h"
 #include "CompiledNN/CompilationSettings.h"
 #include "Platform/BHAssert.h"
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
@@ -35,7 +36,11 @@ namespace NeuralNetwork
   namespace CompiledNNImpl
   {
     class ActivationFunctionHandler;
+    struct BoundTensor;
     struct OperationCompiler;
+    class GdbJitRegistration;
+    class QuantizationParameters;
+    class WorkerPool;
   }
 
   /**
@@ -78,6 +83,11 @@ namespace NeuralNetwork
       std::size_t requiredSize;
       std::size_t refCount;
       TensorXf* allocatedTensor = nullptr;
+      float* allocatedData = nullptr;
+      bool pinned = false; /**< Whether the placeholder must not be reused for other tensors (inputs and outputs of a net with bindable inputs and outputs). */
+      unsigned int rowSize = 0; /**< The number of elements of a row if the placeholder is a line buffer, which only holds the rows that a stripe of a chain needs (0 otherwise). */
+      std::vector<unsigned int> firstRows; /**< The row of the tensor that is at the beginning of the line buffer in each stripe of its chain. */
+      std::vector<unsigned int> rowEnds; /**< The end of the rows of the tensor that have been written to the line buffer after each stripe of its chain. */
 
       OperandPlaceholder(const OperandLocation& location, std::size_t requiredSize, std::size_t refCount) :
           location(location), requiredSize(requiredSize), refCount(refCount)
@@ -93,6 +103,12 @@ namespace NeuralNetwork
       std::vector<std::vector<unsigned int>> outputDimensions;
       std::vector<OperandPlaceholder*> inputOperands;
       std::vector<OperandPlaceholder*> outputOperands;
+      std::size_t level = 0; /**< The level of the branch of the operation (all branches of a level are independent of each other). */
+      std::size_t branch = 0; /**< The index of the branch of the operation within its level. */
+      bool concurrent = false; /**< Whether the branch of the operation is executed concurrently to other branches. */
+      std::size_t stripeChain = 0; /**< The number of the chain of operations that is executed in stripes of rows together with this operation (0 if the operation is executed on its own). */
+      std::vector<unsigned int> stripeRowEnds; /**< The end of the output rows that have been computed after each stripe of the chain. */
+      std::string layer; /**< The names of the layers that the operation computes (joined by '+' if layers have been merged). */
 
       Operation(const CompiledNNImpl::OperationCompiler* compiler) : compiler(compiler) {}
     };
@@ -106,23 +122,62 @@ namespace NeuralNetwork
     /**
      * Generates the compilers necessary to execute a given node (must be a sequential, atomic (i.e. non-mergeable) chain).
      */
-    static std::vector<CompiledNNImpl::OperationCompiler*> generateCompilers(const CompilationSettings& settings, const Node& node, CompilerMap& compilers);
+    static std::vector<CompiledNNImpl::OperationCompiler*> generateCompilers(const CompilationSettings& settings, const CompiledNNImpl::QuantizationParameters& quantizationParameters,
+                                                                             const Node& node, CompilerMap& compilers);
+
+    /**
+     * Groups the operations into chains and orders them by levels, such that the chains of each level can be executed concurrently.
+     */
+    static void scheduleBranches(std::list<Operation>& operations);
+
+    /**
+     * Finds chains of consecutive sliding window and elementwise operations that are executed in horizontal stripes instead of one after another (see CompilationSettings::stripeCacheSize).
+     * The operations must not be executed concurrently.
+     */
+    static void scheduleStripes(std::list<Operation>& operations, const std::vector<OperandLocation>& outputLocations, const CompilationSettings& settings);
+
+    /**
+     * Turns the placeholders of the intermediate tensors of chains that are executed in stripes into line buffers.
+     * A line buffer only holds the rows that the operations of a stripe read or write, and the rows that are still needed are moved to its beginning before each stripe.
+     * Intermediate tensors that share their placeholder with the input or output of a chain (i.e. that are computed in place) keep their whole memory.
+     */
+    static void assignLineBuffers(const std::list<Operation>& operations);
 
     /**
      * Assigns each symbolic variable a placeholder.
+     * Placeholders are only shared by the inputs and outputs of operations that work in place (which is not done across concurrently executed branches).
      */
     void assignOperands(std::list<Operation>& operations, const std::vector<OperandLocation>& inputLocations, const std::vector<OperandLocation>& outputLocations,
                         std::list<OperandPlaceholder>& operands, std::vector<OperandPlaceholder*>& inputPlaceholders, std::vector<OperandPlaceholder*>& outputPlaceholders);
 
     /**
-     * Allocates actual tensors for all placeholders with their current required sizes.
+     * Allocates memory for all placeholders with their current required sizes.
+     * The placeholders are packed into a single arena, in which placeholders that are not used at the same time may overlap.
+     * If the net is compiled to be reentrant, the arena is its workspace. Otherwise, the inputs and outputs of the net get separate tensors.
      */
-    void allocateTensors(std::list<OperandPlaceholder>& operands);
+    void allocateTensors(const std::list<Operation>& operations, std::list<OperandPlaceholder>& operands,
+                         const std::vector<OperandPlaceholder*>& inputPlaceholders, const std::vector<OperandPlaceholder*>& outputPlaceholders,
+                         const CompilationSettings& settings);
+
+    /**
+     * Chooses the fastest variant of the code of each operation that has multiple variants (see CompilationSettings::autotune).
+     * The variants are looked up in the tuning database or benchmarked on the tensors that have been allocated for the operations.
+     * The compilers must already be initialized.
+     */
+    void tuneOperations(const std::list<Operation>& operations, const std::vector<CompiledNNImpl::BoundTensor>& boundTensors, const CompilationSettings& settings);
+
+    /**
+     * Generates a function that computes only the given operation (with the current variant of its compiler) and measures how long it takes.
+     * @return The shortest duration of an application in nanoseconds.
+     */
+    double benchmarkOperation(const Operation& op, CompiledNNImpl::OperationCompiler& compiler, const CompilationSettings& settings);
 
     /**
      * Generates code for all operations (in that order) in a list.
+     * Operations that are split among multiple threads get a separate function for each part.
+     * The operations of a chain that is executed in stripes are interleaved, i.e. the code of each stripe contains a range of rows of each operation.
      */
-    void generateCode(const std::list<Operation>& operations, const CompilerMap& compilers, CompiledNNImpl::ActivationFunctionHandler& afHandler);
+    void generateCode(const std::list<Operation>& operations, const CompilerMap& compilers, CompiledNNImpl::ActivationFunctionHandler& afHandler, const CompilationSettings& settings);
 
     /**
      * Does the actual compilation process (given a list of operations, all compilers they use, input and output locations and the settings to use).
@@ -131,15 +186,105 @@ namespace NeuralNetwork
                          const std::vector<OperandLocation>& inputLocations, const std::vector<OperandLocation>& outputLocations,
                          const CompilationSettings& settings);
 
-    using FnType = void (*)();
+    /**
+     * Creates the tensors through which the inputs and outputs of a reentrant net are staged.
+     * The offsets of the inputs and outputs in the workspace must already be set.
+     */
+    void createStagingTensors();
+
+    /**
+     * Writes the generated code and everything that is needed to apply it to a cache file.
+     * Nothing is written if the code cannot be moved to another address.
+     */
+    void saveCache(const std::string& filename, std::uint64_t key) const;
+
+    /**
+     * Restores a net from a cache file if that file has been created with the given key.
+     * @return Whether the net has been restored.
+     */
+    bool loadCache(const std::string& filename, std::uint64_t key, const CompilationSettings& settings);
+
+    /**
+     * Copies the given inputs into a workspace, applies the net on it and copies the results to the given output buffers.
+     */
+    void applyInWorkspace(const float* const* inputs, float* const* outputs, unsigned char* workspace) const;
+
+    /**
+     * Executes all stages of a net that is split among multiple threads.
+     */
+    void runStages(void* workspace) const;
+
+    /**
+     * Makes the code known to profilers and debuggers as requested by the settings (see CompilationSettings::perfMap and CompilationSettings::gdbJIT).
+     */
+    void registerCode(const CompilationSettings& settings);
+
+    /**
+     * Releases the code (and its registration with debuggers).
+     */
+    void releaseCode();
+
+    /**
+     * A 32 bit displacement in the code that refers to an address in the constants.
+     */
+    struct DataReference final
+    {
+      std::size_t offset; /**< The offset of the displacement in the code. */
+      std::int64_t addend; /**< The address of the target relative to the start of the constants, minus the distance from the displacement to the end of its instruction. */
+    };
+
+    /**
+     * A range of the code that belongs to an operation (or to the code between operations).
+     */
+    struct CodeSymbol final
+    {
+      std::size_t offset; /**< The offset of the range in the code. */
+      std::size_t size; /**< The number of bytes of the range. */
+      std::string layer; /**< The names of the layers that the operation computes (empty for the code between operations). */
+    };
+
+    using FnType = void (*)(void* workspace);
     FnType applyFunction = nullptr;
+    std::size_t codeSize = 0; /**< The number of bytes of the generated code (including its constants). */
+    std::size_t dataOffset = 0; /**< The offset of the constants in the generated code. */
+    std::vector<DataReference> dataReferences; /**< The places where the code refers to its constants. */
+    bool positionIndependent = false; /**< Whether the generated code does not contain absolute addresses. */
+    std::vector<CodeSymbol> codeSymbols; /**< The ranges of the code (without the constants) in ascending order. */
+    std::unique_ptr<CompiledNNImpl::GdbJitRegistration> gdbJitRegistration;
     std::vector<TensorXf*> inputTensors, outputTensors;
     std::vector<std::vector<unsigned int>> inputDimensions, outputDimensions;
     std::vector<TensorXf> tensors;
+    std::vector<unsigned char> workspaceBuffer; /**< The buffer of the tensor arena (which is the internal workspace of a reentrant net). */
+    unsigned char* workspaceData = nullptr; /**< The aligned start of the internal workspace (nullptr if the net is not reentrant). */
+    std::size_t requiredWorkspaceSize = 0;
+    std::size_t sampleWorkspaceSize = 0; /**< The number of bytes of the workspace that are used by each sample of a batch. */
+    std::size_t tensorMemorySize = 0; /**< The number of bytes that the tensors of a sample occupy. */
+    std::size_t unsharedTensorMemorySize = 0; /**< The number of bytes that the tensors of a sample would occupy without sharing memory. */
+    unsigned int samplesPerBatch = 1;
+    std::vector<std::size_t> inputOffsets, outputOffsets; /**< Byte offsets of the inputs/outputs in the workspace of a reentrant net. */
+    std::vector<std::size_t> inputSizes, outputSizes; /**< Number of elements of each input/output per sample. */
+    std::vector<const float*> stagedInputs; /**< The data of the input tensors of a reentrant net. */
+    std::vector<float*> stagedOutputs; /**< The data of the output tensors of a reentrant net. */
+    bool bindableIO = false; /**< Whether the addresses of the inputs and outputs are loaded from a pointer table (see CompilationSettings::bindIO). */
+    std::vector<const void*> ioPointers; /**< The pointer table of a net with bindable inputs and outputs that is not reentrant (reentrant nets have it at the start of their workspace). */
+    std::vector<std::uint64_t> profileCounters; /**< The cycles and calls of each operation if the net has been compiled with CompilationSettings::profile (written by the generated code). */
+    std::vector<std::string> profileLayers; /**< The layer names of each operation if the net has been compiled with CompilationSettings::profile. */
+    std::vector<std::vector<FnType>> stages; /**< The functions of each stage of a net that is split among multiple threads (a stage with multiple functions is executed in parallel). */
+    std::unique_ptr<CompiledNNImpl::WorkerPool> workers;
     std::unique_ptr<asmjit::JitRuntime> runtime;
     bool externalRuntime;
 
   public:
+    /**
+     * The time that has been spent in an operation of a net that has been compiled with CompilationSettings::profile.
+     */
+    struct OperationProfile final
+    {
+      std::string layer; /**< The names of the layers that the operation computes (joined by '+' if layers have been merged). */
+      std::uint64_t cycles; /**< The number of time stamp counter cycles spent in the operation (in the first part only if the operation is split among multiple threads). */
+      std::uint64_t calls; /**< The number of times the operation has been executed. */
+    };
+
     explicit CompiledNN(asmjit::JitRuntime* runtime = nullptr);
     ~CompiledNN();
 
@@ -158,6 +303,14 @@ namespace NeuralNetwork
      */
     void compile(const std::string& filename, const CompilationSettings& settings = CompilationSettings());
 
+    /**
+     * Compiles the net from the given file, reusing the code from a cache file if possible.
+     * The code is only reused if it has been generated from the same model file with the same settings on a CPU with the same features.
+     * Otherwise, the net is compiled and the cache file is (re)written.
+     * Nets that are compiled this way are always reentrant, since their code must not depend on the addresses of their tensors.
+     */
+    void compile(const std::string& filename, const std::string& cacheFilename, const CompilationSettings& settings = CompilationSettings());
+
     /**
      * Checks whether the net was successfully compiled.
      */
@@ -171,8 +324,14 @@ namespace NeuralNetwork
       return inputTensors.size();
     }
 
+    /**
+     * Returns the number of samples that are processed by each call of apply() (see CompilationSettings::batchSize).
+     */
+    inline unsigned int batchSize() const { return samplesPerBatch; }
+
     /**
      * Returns a reference to an input tensor of the compiled net.
+     * If the net processes batches of more than one sample, the tensor has an additional leading dimension for the sample index.
      * Reshaping the tensor will result in undefined behavior.
      * Also note that calling apply() or output() invalidates this tensor.
      * Have fun.
@@ -183,6 +342,15 @@ namespace NeuralNetwork
       return *inputTensors[index];
     }
 
+    /**
+     * Lets the compiled net read an input directly from the given memory instead of the tensor returned by input(index).
+     * Only available if the net has been compiled with CompilationSettings::bindIO.
+     * Like the internal tensors, the memory must have room for three floats more than the input has elements, because the net may access whole vectors of four floats.
+     * @param index The index of the input.
+     * @param data The data of the input (with the dimensions of input(index)), which must stay valid while the net is applied, or nullptr to use the internal tensor again.
+     */
+    void bindInput(std::size_t index, const float* data);
+
     /**
      * Returns the number of output tensors of the compiled net.
      */
@@ -193,6 +361,7 @@ namespace NeuralNetwork
 
     /**
      * Returns a reference to an output tensor of the compiled net.
+     * If the net processes batches of more than one sample, the tensor has an additional leading dimension for the sample index.
      * Reshaping the tensor will result in undefined behavior.
      * Also note that calling input() invalidates this tensor.
      */
@@ -202,6 +371,15 @@ namespace NeuralNetwork
       return *outputTensors[index];
     }
 
+    /**
+     * Lets the compiled net write an output directly to the given memory instead of the tensor returned by output(index).
+     * Only available if the net has been compiled with CompilationSettings::bindIO.
+     * Like the internal tensors, the memory must have room for three floats more than the output has elements, because the net may write whole vectors of four floats.
+     * @param index The index of the output.
+     * @param data The buffer for the output (with the dimensions of output(index)), which must stay valid while the net is applied, or nullptr to use the internal tensor again.
+     */
+    void bindOutput(std::size_t index, float* data);
+
 
     /**
      * Applies the compiled net on the current input data.
@@ -209,7 +387,73 @@ namespace NeuralNetwork
     inline void apply() const
     {
       ASSERT(valid());
-      applyFunction();
+      if(workspaceData)
+        applyInWorkspace(stagedInputs.data(), stagedOutputs.data(), workspaceData);
+      else if(stages.empty())
+        applyFunction(nullptr);
+      else
+        runStages(nullptr);
     }
+
+    /**
+     * Checks whether the net has been compiled to be reentrant (see CompilationSettings::reentrant).
+     * Nets that process batches of more than one sample are always reentrant.
+     */
+    inline bool reentrant() const { return workspaceData != nullptr; }
+
+    /**
+     * Returns the number of bytes that a workspace for the reentrant apply method must have.
+     */
+    inline std::size_t workspaceSize() const
+    {
+      return requiredWorkspaceSize;
+    }
+
+    /**
+     * Returns the number of bytes that the tensors of a single sample occupy.
+     * Tensors that are not used at the same time share memory.
+     */
+    inline std::size_t tensorMemory() const { return tensorMemorySize; }
+
+    /**
+     * Returns the number of bytes that the tensors of a single sample would occupy if each of them had its own memory.
+     */
+    inline std::size_t unsharedTensorMemory() const { return unsharedTensorMemorySize; }
+
+    /**
+     * Returns the cycles and calls of each operation (in the order of execution) since the net has been compiled or resetProfile() has been called.
+     * The result is empty if the net has not been compiled with CompilationSettings::profile.
+     * Must not be called while the net is applied.
+     */
+    std::vector<OperationProfile> profile() const;
+
+    /**
+     * Sets the cycles and calls of all operations to zero.
+     */
+    void resetProfile();
+
+    /**
+     * Applies the compiled net on the given input data and writes the results to the given output buffers.
+     * All intermediate results are stored in the given workspace, which must be aligned to 64 bytes and have at least workspaceSize() bytes.
+     * As long as each thread uses its own workspace, this method can be called concurrently.
+     * Only available if the net has been compiled to be reentrant.
+     * If the net has been compiled with CompilationSettings::bindIO, it accesses the given buffers directly, so that they must have the same padding as for bindInput and bindOutput.
+     * @param inputs Pointers to the data of each input tensor (with the dimensions of input(i), i.e. all samples of a batch consecutively).
+     * @param outputs Pointers to the buffers for each output tensor (with the dimensions of output(i), i.e. all samples of a batch consecutively).
+     * @param workspace The workspace.
+     */
+    void apply(const float* const* inputs, float* const* outputs, void* workspace) const;
+
+    /**
+     * Writes the compiled net to a relocatable ELF object file for x86-64 and a C header, such that it can be linked into a program that does not use this library.
+     * The header defines the function <name>_apply(inputs, outputs, workspace), which behaves like the reentrant apply method, and macros for the size of the workspace and the dimensions of the inputs and outputs.
+     * The constants of the net are placed in the read-only data section of the object.
+     * Only nets that have been compiled to be reentrant and single-threaded on a 64 bit host can be exported.
+     * @param objectFilename The name of the object file.
+     * @param headerFilename The name of the header file.
+     * @param name The prefix of all symbols and macros (must be a valid C identifier).
+     * @return Whether both files have been written.
+     */
+    bool exportObject(const std::string& objectFilename, const std::string& headerFilename, const std::string& name = "model") const;
   };
 }
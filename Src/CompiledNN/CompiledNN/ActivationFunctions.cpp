@@ -884,7 +884,7 @@ namespace NeuralNetwork
     {
       ASSERT(spares.size() >= 2);
 
-      for(size_t offset = 0, i = spares.size() < 2 ? 1 : spares.size() - 2; i < spares.size(); offset++, i++)
+      for(size_t offset = 0, i = spares.size() <= 2 ? 1 : spares.size() - 2; i < spares.size(); offset++, i++)
       {
         if(single)
           a.movss(spares[i], x86::ptr(label, static_cast<unsigned int>(offset * sizeof(float))));
@@ -897,7 +897,7 @@ namespace NeuralNetwork
     void softsignApply(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
     {
       // softsign(x) = x / (abs(x) + 1)
-      const size_t constOffset = spares.size() < 2 ? 1 : spares.size() - 2;
+      const size_t constOffset = spares.size() <= 2 ? 1 : spares.size() - 2;
 
       if(spares.size() >= values.size() + 2)
       {
@@ -950,6 +950,269 @@ namespace NeuralNetwork
       }
     }
 
+    /**
+     * The constants of an activation function in ymm registers.
+     * As many of them as possible are kept in the last spare registers (after the temporaries), the others are read from memory.
+     */
+    class AVXConstants final
+    {
+    public:
+      AVXConstants(const Label& label, const std::vector<x86::Xmm>& spares, const size_t temporaries, const size_t count) :
+        label(label), spares(spares), offset(spares.size() >= temporaries + count ? spares.size() - count : temporaries), count(count)
+      {
+        ASSERT(spares.size() >= temporaries);
+      }
+
+      void load(x86::Assembler& a) const
+      {
+        for(size_t i = 0; i < count && offset + i < spares.size(); i++)
+          a.vmovaps(spares[offset + i].ymm(), x86::ptr(label, static_cast<int>(i * 8 * sizeof(float))));
+      }
+
+      Operand operator[](const size_t i) const
+      {
+        ASSERT(i < count);
+        if(offset + i < spares.size())
+          return spares[offset + i].ymm();
+        return x86::ptr(label, static_cast<int>(i * 8 * sizeof(float)));
+      }
+
+    private:
+      const Label& label;
+      const std::vector<x86::Xmm>& spares;
+      const size_t offset;
+      const size_t count;
+    };
+
+    template<void (*defineData)(std::vector<float>&, const ActivationFunctionParameters* const)>
+    void avxDefineData(std::vector<float>& data, const ActivationFunctionParameters* const params)
+    {
+      // Each constant of the xmm variant is widened from 4 to 8 elements
+      std::vector<float> packed;
+      defineData(packed, params);
+      ASSERT(packed.size() % 4 == 0);
+      for(size_t i = 0; i < packed.size(); i += 4)
+        for(int j = 2; j; --j)
+          data.insert(data.end(), packed.begin() + i, packed.begin() + i + 4);
+    }
+
+    size_t reluConstants(const ReluParameters& p)
+    {
+      return (p.threshold != 0.f ? 1 : 0) + (p.negativeSlope != 0.f ? 1 : 0) + (p.maxValue != std::numeric_limits<float>::max() ? 1 : 0);
+    }
+
+    void reluInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const params, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      const ReluParameters& p = params->asType<ReluParameters>();
+      ASSERT(!spares.empty());
+
+      if(p.negativeSlope == 0.f && p.threshold == 0.f)
+        a.vxorps(spares[0].ymm(), spares[0].ymm(), spares[0].ymm());
+      AVXConstants(label, spares, 1, reluConstants(p)).load(a);
+    }
+
+    void reluApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const params, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      const ReluParameters& p = params->asType<ReluParameters>();
+      const AVXConstants constants(label, spares, 1, reluConstants(p));
+      const size_t thresholdIndex = 0;
+      const size_t negativeSlopeIndex = p.threshold != 0.f ? 1 : 0;
+      const size_t maxValueIndex = negativeSlopeIndex + (p.negativeSlope != 0.f ? 1 : 0);
+      const x86::Ymm temp = spares[0].ymm();
+
+      if(p.negativeSlope == 0.f && p.threshold == 0.f)
+      {
+        for(const x86::Xmm& value : values)
+          a.vmaxps(value.ymm(), value.ymm(), temp);
+      }
+      else
+      {
+        // max(x, (x - threshold) * negativeSlope)
+        for(const x86::Xmm& value : values)
+        {
+          if(p.threshold != 0.f)
+            a.emit(x86::Inst::kIdVsubps, temp, value.ymm(), constants[thresholdIndex]);
+          if(p.negativeSlope != 0.f)
+            a.emit(x86::Inst::kIdVmulps, temp, p.threshold != 0.f ? temp : value.ymm(), constants[negativeSlopeIndex]);
+          a.vmaxps(value.ymm(), value.ymm(), temp);
+        }
+      }
+
+      if(p.maxValue != std::numeric_limits<float>::max())
+      {
+        for(const x86::Xmm& value : values)
+          a.emit(x86::Inst::kIdVminps, value.ymm(), value.ymm(), constants[maxValueIndex]);
+      }
+    }
+
+    void sigmoidExpApproxInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      AVXConstants(label, spares, 1, 3).load(a);
+    }
+
+    template<bool tanH>
+    void sigmoidExpApproxApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      // Calculate sigmoid as exp(x) / (exp(x) + 1) or tanh as (exp(2x) - 1) / (exp(2x) + 1), approximating exp(x)
+      const AVXConstants constants(label, spares, 1, 3);
+      std::vector<x86::Ymm> expRegs;
+      for(const x86::Xmm& value : values)
+      {
+        if(tanH)
+          a.vaddps(value.ymm(), value.ymm(), value.ymm());
+        expRegs.emplace_back(value.ymm());
+      }
+
+      ExpApprox::applyAVX(a, expRegs, constants[0], constants[1]);
+
+      const x86::Ymm divisor = spares[0].ymm();
+      for(const x86::Xmm& value : values)
+      {
+        a.emit(x86::Inst::kIdVaddps, divisor, value.ymm(), constants[2]);
+        if(tanH)
+          a.emit(x86::Inst::kIdVsubps, value.ymm(), value.ymm(), constants[2]);
+        a.vdivps(value.ymm(), value.ymm(), divisor);
+      }
+    }
+
+    void tanhApproxAVX(x86::Assembler& a, const AVXConstants& constants, const std::vector<x86::Xmm>& spares, const x86::Ymm& value, const size_t dataOffset)
+    {
+      // Approximate tanh(x) as ((((36.f * x^2 + 6930.f) * x^2 + 270270.f) * x^2 + 2027025.f) * x) / ((((x^2 + 630.f) * x^2 + 51975.f) * x^2 + 945945.f) * x^2 + 2027025.f)
+      const x86::Ymm square = spares[0].ymm();
+      const x86::Ymm dividend = spares[1].ymm();
+      const x86::Ymm divisor = spares[2].ymm();
+
+      a.vmulps(square, value, value);
+      a.emit(x86::Inst::kIdVmulps, dividend, square, constants[dataOffset]);
+      a.emit(x86::Inst::kIdVaddps, divisor, square, constants[dataOffset + 1]);
+      a.emit(x86::Inst::kIdVaddps, dividend, dividend, constants[dataOffset + 2]);
+      a.vmulps(divisor, divisor, square);
+      a.vmulps(dividend, dividend, square);
+      a.emit(x86::Inst::kIdVaddps, divisor, divisor, constants[dataOffset + 3]);
+      a.emit(x86::Inst::kIdVaddps, dividend, dividend, constants[dataOffset + 4]);
+      a.vmulps(divisor, divisor, square);
+      a.vmulps(dividend, dividend, square);
+      a.emit(x86::Inst::kIdVaddps, divisor, divisor, constants[dataOffset + 5]);
+      a.emit(x86::Inst::kIdVaddps, dividend, dividend, constants[dataOffset + 6]);
+      a.vmulps(divisor, divisor, square);
+      a.vmulps(value, value, dividend);
+      a.emit(x86::Inst::kIdVaddps, divisor, divisor, constants[dataOffset + 6]);
+      a.vrcpps(divisor, divisor);
+      a.vmulps(value, value, divisor);
+    }
+
+    void tanhInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      AVXConstants(label, spares, 3, 7).load(a);
+    }
+
+    void tanhApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      const AVXConstants constants(label, spares, 3, 7);
+      for(const x86::Xmm& value : values)
+        tanhApproxAVX(a, constants, spares, value.ymm(), 0);
+    }
+
+    void sigmoidInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      AVXConstants(label, spares, 3, 8).load(a);
+    }
+
+    void sigmoidApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      // sigmoid(x) = 0.5f * tanh(x * 0.5f) + 0.5f
+      const AVXConstants constants(label, spares, 3, 8);
+      for(const x86::Xmm& value : values)
+      {
+        a.emit(x86::Inst::kIdVmulps, value.ymm(), value.ymm(), constants[0]);
+        tanhApproxAVX(a, constants, spares, value.ymm(), 1);
+        a.emit(x86::Inst::kIdVmulps, value.ymm(), value.ymm(), constants[0]);
+        a.emit(x86::Inst::kIdVaddps, value.ymm(), value.ymm(), constants[0]);
+      }
+    }
+
+    void hardSigmoidInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      ASSERT(spares.size());
+      a.vxorps(spares[0].ymm(), spares[0].ymm(), spares[0].ymm());
+      AVXConstants(label, spares, 1, 3).load(a);
+    }
+
+    void hardSigmoidApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      const AVXConstants constants(label, spares, 1, 3);
+      for(const x86::Xmm& value : values)
+      {
+        a.emit(x86::Inst::kIdVmulps, value.ymm(), value.ymm(), constants[0]);
+        a.emit(x86::Inst::kIdVaddps, value.ymm(), value.ymm(), constants[1]);
+        a.vmaxps(value.ymm(), value.ymm(), spares[0].ymm());
+        a.emit(x86::Inst::kIdVminps, value.ymm(), value.ymm(), constants[2]);
+      }
+    }
+
+    template<bool scaled>
+    void eluInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      AVXConstants(label, spares, 1, scaled ? 5 : 4).load(a);
+    }
+
+    template<bool scaled>
+    void eluApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const params, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      // elu(x) = sign(x) * max(-alpha * exp(x) + alpha, x), selu(x) = scale * elu(x)
+      const AVXConstants constants(label, spares, 1, scaled ? 5 : 4);
+      const bool negate = !scaled && params->asType<EluParameters>().alpha == 1.f;
+      const x86::Ymm temp = spares[0].ymm();
+
+      for(const x86::Xmm& value : values)
+      {
+        a.vmovaps(temp, value.ymm());
+        ExpApprox::applyAVX(a, { temp }, constants[2], constants[0]);
+        if(negate)
+          a.emit(x86::Inst::kIdVxorps, temp, temp, constants[1]);
+        else
+          a.emit(x86::Inst::kIdVmulps, temp, temp, constants[3]);
+        a.emit(x86::Inst::kIdVsubps, temp, temp, constants[3]);
+        a.vmaxps(temp, temp, value.ymm());
+        a.emit(x86::Inst::kIdVandps, value.ymm(), value.ymm(), constants[1]);
+        a.vxorps(value.ymm(), value.ymm(), temp);
+        if(scaled)
+          a.emit(x86::Inst::kIdVmulps, value.ymm(), value.ymm(), constants[4]);
+      }
+    }
+
+    void exponentialInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      AVXConstants(label, spares, 0, 2).load(a);
+    }
+
+    void exponentialApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      const AVXConstants constants(label, spares, 0, 2);
+      std::vector<x86::Ymm> expRegs;
+      for(const x86::Xmm& value : values)
+        expRegs.emplace_back(value.ymm());
+      ExpApprox::applyAVX(a, expRegs, constants[1], constants[0]);
+    }
+
+    void softsignInitializeAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares)
+    {
+      AVXConstants(label, spares, 1, 2).load(a);
+    }
+
+    void softsignApplyAVX(x86::Assembler& a, const ActivationFunctionParameters* const, const Label& label, const std::vector<x86::Xmm>& spares, const std::vector<x86::Xmm>& values)
+    {
+      // softsign(x) = x / (abs(x) + 1)
+      const AVXConstants constants(label, spares, 1, 2);
+      const x86::Ymm divisor = spares[0].ymm();
+      for(const x86::Xmm& value : values)
+      {
+        a.emit(x86::Inst::kIdVandps, divisor, value.ymm(), constants[0]);
+        a.emit(x86::Inst::kIdVaddps, divisor, divisor, constants[1]);
+        a.vdivps(value.ymm(), value.ymm(), divisor);
+      }
+    }
+
     unsigned int ActivationFunctionHandler::neededSpares(const ActivationFunctionDescriptor& desc)
     {
       switch(desc.id)
@@ -980,23 +1243,88 @@ namespace NeuralNetwork
     }
 
     ActivationFn& ActivationFunctionHandler::prepare(const ActivationFunctionDescriptor& desc, const bool single, x86::Assembler& a, const std::initializer_list<x86::Xmm> spares, const std::initializer_list<x86::Xmm> values)
+    {
+      ActivationFn& fn = getFunction(desc, single, false, a);
+      fn.prepare(spares, values);
+      return fn;
+    }
+
+    ActivationFn& ActivationFunctionHandler::prepareAVX(const ActivationFunctionDescriptor& desc, x86::Assembler& a, const std::initializer_list<x86::Ymm> spares, const std::initializer_list<x86::Ymm> values)
+    {
+      ActivationFn& fn = getFunction(desc, false, true, a);
+      fn.prepare({}, {});
+      for(const x86::Ymm& reg : spares)
+        fn.addSpare(reg);
+      for(const x86::Ymm& reg : values)
+        fn.addValue(reg);
+      return fn;
+    }
+
+    ActivationFn& ActivationFunctionHandler::getFunction(const ActivationFunctionDescriptor& desc, const bool single, const bool avx, x86::Assembler& a)
     {
       // Look up function
       for(ActivationData& fnData : functionData)
       {
-        if(fnData.desc == desc && fnData.single == single)
-        {
-          fnData.fn.prepare(spares, values);
+        if(fnData.desc == desc && fnData.single == single && fnData.avx == avx)
           return fnData.fn;
-        }
       }
 
       // Create entry for function if it does not yet exist
+      if(avx)
+      {
+        switch(desc.id)
+        {
+          case CompiledActivationFunctionId::linear:
+            functionData.emplace_back(
+              desc, false, true,
+            [](std::vector<float>&, const ActivationFunctionParameters* const) {},
+            [](x86::Assembler&, const ActivationFunctionParameters* const, const Label&, const std::vector<x86::Xmm>&) {},
+            [](x86::Assembler&, const ActivationFunctionParameters* const, const Label&, const std::vector<x86::Xmm>&, const std::vector<x86::Xmm>&) {}
+            );
+            break;
+          case CompiledActivationFunctionId::relu:
+            functionData.emplace_back(desc, false, true, avxDefineData<reluDefineData<false>>, reluInitializeAVX, reluApplyAVX);
+            break;
+          case CompiledActivationFunctionId::tanH:
+            if(settings.useExpApproxInTanh)
+              functionData.emplace_back(desc, false, true, avxDefineData<sigmoidExpApproxDefineData<false>>, sigmoidExpApproxInitializeAVX, sigmoidExpApproxApplyAVX<true>);
+            else
+              functionData.emplace_back(desc, false, true, avxDefineData<tanhDefineData<false>>, tanhInitializeAVX, tanhApplyAVX);
+            break;
+          case CompiledActivationFunctionId::sigmoid:
+            if(settings.useExpApproxInSigmoid)
+              functionData.emplace_back(desc, false, true, avxDefineData<sigmoidExpApproxDefineData<false>>, sigmoidExpApproxInitializeAVX, sigmoidExpApproxApplyAVX<false>);
+            else
+              functionData.emplace_back(desc, false, true, avxDefineData<sigmoidDefineData<false>>, sigmoidInitializeAVX, sigmoidApplyAVX);
+            break;
+          case CompiledActivationFunctionId::hardSigmoid:
+            functionData.emplace_back(desc, false, true, avxDefineData<hardSigmoidDefineData<false>>, hardSigmoidInitializeAVX, hardSigmoidApplyAVX);
+            break;
+          case CompiledActivationFunctionId::elu:
+            functionData.emplace_back(desc, false, true, avxDefineData<eluDefineData<false>>, eluInitializeAVX<false>, eluApplyAVX<false>);
+            break;
+          case CompiledActivationFunctionId::selu:
+            functionData.emplace_back(desc, false, true, avxDefineData<seluDefineData<false>>, eluInitializeAVX<true>, eluApplyAVX<true>);
+            break;
+          case CompiledActivationFunctionId::exponential:
+            functionData.emplace_back(desc, false, true, avxDefineData<exponentialDefineData<false>>, exponentialInitializeAVX, exponentialApplyAVX);
+            break;
+          case CompiledActivationFunctionId::softsign:
+            functionData.emplace_back(desc, false, true, avxDefineData<softsignDefineData<false>>, softsignInitializeAVX, softsignApplyAVX);
+            break;
+          default:
+            ASSERT(false);
+        }
+
+        functionData.back().fn.defineData(a);
+        return functionData.back().fn;
+      }
+
       switch(desc.id)
       {
         case CompiledActivationFunctionId::linear:
           functionData.emplace_back(
-            desc, single,
+            desc, single, false,
           [](std::vector<float>&, const ActivationFunctionParameters* const) {},
           [](x86::Assembler&, const ActivationFunctionParameters* const, const Label&, const std::vector<x86::Xmm>&) {},
           [](x86::Assembler&, const ActivationFunctionParameters* const, const Label&, const std::vector<x86::Xmm>&, const std::vector<x86::Xmm>&) {}
@@ -1004,7 +1332,7 @@ namespace NeuralNetwork
           break;
         case CompiledActivationFunctionId::relu:
           functionData.emplace_back(
-            desc, single,
+            desc, single, false,
             single ? reluDefineData<true> : reluDefineData<false>,
             single ? reluInitialize<true> : reluInitialize<false>,
             single ? reluApply<true> : reluApply<false>
@@ -1014,7 +1342,7 @@ namespace NeuralNetwork
           if(settings.useExpApproxInTanh)
           {
             functionData.emplace_back(
-              desc, single,
+              desc, single, false,
               single ? sigmoidExpApproxDefineData<true> : sigmoidExpApproxDefineData<false>,
               single ? sigmoidExpApproxInitialize<true> : sigmoidExpApproxInitialize<false>,
               single ? sigmoidExpApproxApply<true, true> : sigmoidExpApproxApply<true, false>
@@ -1023,7 +1351,7 @@ namespace NeuralNetwork
           else
           {
             functionData.emplace_back(
-              desc, single,
+              desc, single, false,
               single ? tanhDefineData<true> : tanhDefineData<false>,
               single ? tanhInitialize<true> : tanhInitialize<false>,
               single ? tanhApply<true> : tanhApply<false>
@@ -1034,7 +1362,7 @@ namespace NeuralNetwork
           if(settings.useExpApproxInSigmoid)
           {
             functionData.emplace_back(
-              desc, single,
+              desc, single, false,
               single ? sigmoidExpApproxDefineData<true> : sigmoidExpApproxDefineData<false>,
               single ? sigmoidExpApproxInitialize<true> : sigmoidExpApproxInitialize<false>,
               single ? sigmoidExpApproxApply<false, true> : sigmoidExpApproxApply<false, false>
@@ -1043,7 +1371,7 @@ namespace NeuralNetwork
           else
           {
             functionData.emplace_back(
-              desc, single,
+              desc, single, false,
               single ? sigmoidDefineData<true> : sigmoidDefineData<false>,
               single ? sigmoidInitialize<true> : sigmoidInitialize<false>,
               single ? sigmoidApply<true> : sigmoidApply<false>
@@ -1052,7 +1380,7 @@ namespace NeuralNetwork
           break;
         case CompiledActivationFunctionId::hardSigmoid:
           functionData.emplace_back(
-            desc, single,
+            desc, single, false,
             single ? hardSigmoidDefineData<true> : hardSigmoidDefineData<false>,
             single ? hardSigmoidInitialize<true> : hardSigmoidInitialize<false>,
             single ? hardSigmoidApply<true> : hardSigmoidApply<false>
@@ -1060,7 +1388,7 @@ namespace NeuralNetwork
           break;
         case CompiledActivationFunctionId::elu:
           functionData.emplace_back(
-            desc, single,
+            desc, single, false,
             single ? eluDefineData<true> : eluDefineData<false>,
             single ? eluInitialize<true> : eluInitialize<false>,
             single ? eluApply<true> : eluApply<false>
@@ -1068,7 +1396,7 @@ namespace NeuralNetwork
           break;
         case CompiledActivationFunctionId::selu:
           functionData.emplace_back(
-            desc, single,
+            desc, single, false,
             single ? seluDefineData<true> : seluDefineData<false>,
             single ? seluInitialize<true> : seluInitialize<false>,
             single ? seluApply<true> : seluApply<false>
@@ -1076,7 +1404,7 @@ namespace NeuralNetwork
           break;
         case CompiledActivationFunctionId::exponential:
           functionData.emplace_back(
-            desc, single,
+            desc, single, false,
             single ? exponentialDefineData<true> : exponentialDefineData<false>,
             single ? exponentialInitialize<true> : exponentialInitialize<false>,
             single ? exponentialApply<true> : exponentialApply<false>
@@ -1084,7 +1412,7 @@ namespace NeuralNetwork
           break;
         case CompiledActivationFunctionId::softsign:
           functionData.emplace_back(
-            desc, single,
+            desc, single, false,
             single ? softsignDefineData<true> : softsignDefineData<false>,
             single ? softsignInitialize<true> : softsignInitialize<false>,
             single ? softsignApply<true> : softsignApply<false>
@@ -1095,7 +1423,6 @@ namespace NeuralNetwork
       }
 
       functionData.back().fn.defineData(a);
-      functionData.back().fn.prepare(spares, values);
       return functionData.back().fn;
     }
 
@@ -1105,7 +1432,7 @@ namespace NeuralNetwork
       {
         if(fnData.fn.constants.data.size())
         {
-          a.align(AlignMode::kZero, 16);
+          a.align(AlignMode::kZero, 32);
           a.bind(fnData.fn.constants.label);
           for(const float c : fnData.fn.constants.data)
             a.embedFloat(c);
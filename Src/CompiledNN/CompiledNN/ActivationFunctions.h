@@ -185,6 +185,8 @@ namespace NeuralNetwork
     public:
       inline void addSpare(const x86::Xmm reg) { spares.push_back(reg); }
       inline void addValue(const x86::Xmm reg) { values.push_back(reg); }
+      inline void addSpare(const x86::Ymm reg) { spares.push_back(reg.xmm()); }
+      inline void addValue(const x86::Ymm reg) { values.push_back(reg.xmm()); }
 
       inline void initialize(x86::Assembler& a) { initializeFn(a, desc.p, constants.label, spares); }
       inline void apply(x86::Assembler& a) { applyFn(a, desc.p, constants.label, spares, values); }
@@ -201,18 +203,27 @@ namespace NeuralNetwork
       {
         const ActivationFunctionDescriptor desc;
         const bool single;
+        const bool avx;
         ActivationFn fn;
-        ActivationData(const ActivationFunctionDescriptor& desc, const bool single, const DefineDataFnType defineDataFn, const InitializeFnType initializeFn, const ApplyFnType applyFn) : desc(desc), single(single), fn(this->desc, defineDataFn, initializeFn, applyFn) {}
-        ActivationData(const ActivationData& other) : ActivationData(other.desc, other.single, other.fn.defineDataFn, other.fn.initializeFn, other.fn.applyFn) {}
+        ActivationData(const ActivationFunctionDescriptor& desc, const bool single, const bool avx, const DefineDataFnType defineDataFn, const InitializeFnType initializeFn, const ApplyFnType applyFn) : desc(desc), single(single), avx(avx), fn(this->desc, defineDataFn, initializeFn, applyFn) {}
+        ActivationData(const ActivationData& other) : ActivationData(other.desc, other.single, other.avx, other.fn.defineDataFn, other.fn.initializeFn, other.fn.applyFn) {}
         ActivationData(const ActivationData&& other) = delete;
       };
       std::list<ActivationData> functionData;
       const CompilationSettings& settings;
 
+      ActivationFn& getFunction(const ActivationFunctionDescriptor& desc, const bool single, const bool avx, x86::Assembler& a);
+
     public:
       ActivationFunctionHandler(const CompilationSettings& settings) : settings(settings) {}
 
       ActivationFn& prepare(const ActivationFunctionDescriptor& desc, const bool single, x86::Assembler& a, const std::initializer_list<x86::Xmm> spares, const std::initializer_list<x86::Xmm> values);
+
+      /**
+       * Prepares an activation function that operates on all 8 elements of ymm registers (requires AVX2).
+       * The code must not be mixed with legacy SSE instructions without vzeroupper in between.
+       */
+      ActivationFn& prepareAVX(const ActivationFunctionDescriptor& desc, x86::Assembler& a, const std::initializer_list<x86::Ymm> spares, const std::initializer_list<x86::Ymm> values);
       void compileData(x86::Assembler& a) const;
 
       static unsigned int neededSpares(const ActivationFunctionDescriptor& desc);
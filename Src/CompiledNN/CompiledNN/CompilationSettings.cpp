@@ -22,4 +22,20 @@ void NeuralNetwork::CompilationSettings::constrict()
 
   if(useFMA3 && !cpuInfo.features().x86().hasFMA())
     useFMA3 = false;
+
+  if(useHalfPrecisionWeights && (!useAVX2 || !cpuInfo.features().x86().hasF16C()))
+    useHalfPrecisionWeights = false;
+
+  if(threads < 1)
+    threads = 1;
+  else if(threads > 1)
+    stripeCacheSize = 0;
+
+  if(batchSize < 1)
+    batchSize = 1;
+  else if(batchSize > 1)
+  {
+    reentrant = true;
+    bindIO = false;
+  }
 }
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <string>
+
 namespace NeuralNetwork
 {
   struct CompilationSettings final
@@ -15,11 +17,29 @@ namespace NeuralNetwork
     bool useFMA3 = true;   /**< use FMA3 features (not supported by NAOs) */
 
     // Optimizations
-    bool useExpApproxInSigmoid = true;  /**< use a less accurate but faster approximation of sigmoid */
-    bool useExpApproxInTanh = true;     /**< use a less accurate but faster approximation of tanh */
+    bool useExpApproxInSigmoid = true;    /**< use a less accurate but faster approximation of sigmoid */
+    bool useExpApproxInTanh = true;       /**< use a less accurate but faster approximation of tanh */
+    bool useHalfPrecisionWeights = false; /**< store the weights of Dense and Conv2D layers as half precision floats, which halves their size and memory bandwidth but is less accurate (requires AVX2 and F16C) */
+    bool quantize = false;                /**< compute Dense and Conv2D layers with enough inputs per output with 8 bit weights (scaled per output) and 7 bit inputs (scaled per tensor) */
+    std::string quantizationParameters;   /**< file with the calibrated input ranges of quantized layers (see Calibration), the ranges of other layers are determined while the net is applied (empty: no file) */
+    bool useWinograd = true;              /**< compute 3x3 convolutions with stride 1 and enough channels with the Winograd algorithm F(2x2, 3x3), which needs fewer multiplications but is slightly less accurate (x64 only) */
+
+    // Code generation
+    bool reentrant = false;           /**< address all tensors relative to a caller-supplied workspace so that the net can be applied by multiple threads at once */
+    unsigned int batchSize = 1;       /**< number of samples that are processed by each application of the net (nets with more than one sample are always reentrant) */
+    unsigned int threads = 1;         /**< number of threads (including the calling one) among which convolutional, pooling and dense layers are split */
+    bool bindIO = false;              /**< load the addresses of the inputs and outputs from a table so that they can be bound to user memory (only for batches of one sample) */
+    unsigned int stripeCacheSize = 0; /**< execute chains of convolution, pooling, batch normalization and activation layers in horizontal stripes whose rows of all tensors of the chain fit into this number of bytes, e.g. the size of the L2 cache, instead of layer by layer, keeping the tensors between them in line buffers (0: disabled, only with one thread) */
+
+    // Autotuning
+    bool autotune = false;      /**< benchmark the variants of the code of each operation that has them (e.g. register blockings) in isolation on random input and use the fastest one */
+    std::string tuningDatabase; /**< file in which the fastest variants are stored per operation shape and CPU model, such that later compilations reuse them without benchmarking (empty: do not store) */
 
     // Debugging
-    bool debug = false; /**< activate breakpoints */
+    bool debug = false;   /**< activate breakpoints */
+    bool profile = false; /**< count the cycles spent in each operation (see CompiledNN::profile) */
+    bool perfMap = false; /**< append the code of each operation to /tmp/perf-<pid>.map, so that perf attributes samples to layers (Linux only) */
+    bool gdbJIT = false;  /**< register the code of each operation with the JIT interface of GDB (x86-64 Linux only) */
 
     /**
      * Returns the number of XMM regs available on the current processor.
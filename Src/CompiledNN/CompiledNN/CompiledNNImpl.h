@@ -14,12 +14,18 @@
 #include "Operations/Cropping2D.h"
 #include "Operations/DConv2D.h"
 #include "Operations/Dense.h"
+#include "Operations/GEMM.h"
 #include "Operations/GlobalPooling2D.h"
+#include "Operations/Im2Col2D.h"
 #include "Operations/Pooling1D.h"
 #include "Operations/Pooling2D.h"
+#include "Operations/Quantize.h"
+#include "Operations/QuantizedConv2D.h"
 #include "Operations/QuantizedInputConvStrided4x4WithReLU.h"
+#include "Operations/SeparableConv2D.h"
 #include "Operations/Softmax.h"
 #include "Operations/UInt8Input.h"
 #include "Operations/UpSampling2D.h"
+#include "Operations/WinogradConv2D.h"
 #include "Operations/ZeroPadding1D.h"
 #include "Operations/ZeroPadding2D.h"
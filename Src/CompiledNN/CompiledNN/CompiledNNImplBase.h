@@ -8,6 +8,10 @@
 #include "CompilationSettings.h"
 #include "TensorPointer.h"
 #include <asmjit/asmjit.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
 #include <vector>
 
 #ifdef NDEBUG
@@ -30,16 +34,46 @@ namespace NeuralNetwork
 
     class ActivationFunctionHandler;
 
+    /**
+     * Offsets of stack slots (relative to the frame pointer) that are reserved by the prolog of the network:
+     * The workspace pointer of a reentrant network is stored at -32, the counter of loops over the samples of a batch at -16.
+     * The slot at -24 can be used as a pointer-sized variable and the slots from -4 to -12 as 32-bit variables by the operations.
+     */
+    constexpr int workspacePointerOffset = -32;
+    constexpr int scratchPointerOffset = -24;
+    constexpr int sampleCounterOffset = -16;
+
     struct NetworkConstants final
     {
       Label label;
       std::vector<float> data;
     };
 
+    /**
+     * An input or output tensor of a network whose address is loaded from a pointer table at runtime, such that it can be bound to user memory.
+     */
+    struct BoundTensor final
+    {
+      const unsigned char* begin; /**< The address of the tensor during compilation. */
+      const unsigned char* end; /**< The end of the tensor during compilation. */
+      const void* slot; /**< The address of the entry of the pointer table during compilation. */
+    };
+
+    /**
+     * Describes how the output rows of an operation depend on its input rows, which is needed to compute the operation in stripes of rows.
+     */
+    struct RowWindow final
+    {
+      unsigned int height = 0; /**< The number of input rows of a window (including the dilation), 0 if the operation cannot compute ranges of output rows. */
+      unsigned int stride = 1; /**< The vertical stride of the window. */
+      PaddingType padding = PaddingType::valid; /**< The padding type, which determines the number of implicit zero rows above the input. */
+    };
+
     struct OperationCompiler
     {
       const CompilationSettings& settings;
       std::vector<NetworkConstants> constants;
+      unsigned int variant = 0; /**< The variant of the code that is generated (must be set before initialize is called, see variants()). */
 
       OperationCompiler(const CompilationSettings& settings) : settings(settings) {}
       virtual ~OperationCompiler() = default;
@@ -50,7 +84,103 @@ namespace NeuralNetwork
       virtual std::vector<std::vector<unsigned int>> calcOutputDimensions(const std::vector<std::vector<unsigned int>>& inputDimensions) const = 0;
       virtual std::vector<std::size_t> routeIO(const std::vector<std::size_t>& indices, const std::vector<std::vector<unsigned int>>& inputDimensions) const = 0;
 
+      /**
+       * Returns the number of variants of the code of the operation among which the autotuner chooses (see CompilationSettings::autotune).
+       */
+      virtual unsigned int variants() const { return 1; }
+
+      /**
+       * Returns a description of the parameters that determine the speed of the variants (apart from the input dimensions and the settings).
+       * Operations with the same description share their entries in the tuning database.
+       */
+      virtual std::string tuningKey() const { return std::string(); }
+
+      /**
+       * Returns into how many parts the operation can be split, such that each part can be computed by a different thread.
+       */
+      virtual unsigned int maxParts(const std::vector<TensorPointerXf>&, const std::vector<TensorPointerXf>&) const { return 1; }
+
+      /**
+       * Emits code that computes one of the parts into which the operation has been split.
+       */
+      virtual void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const std::vector<TensorPointerXf>& input, const std::vector<TensorPointerXf>& output,
+                               const unsigned int, const unsigned int parts) const
+      {
+        ASSERT(parts == 1);
+        static_cast<void>(parts);
+        compile(a, afHandler, input, output);
+      }
+
+      /**
+       * Checks whether the operation processes all samples of a batch by itself.
+       * Otherwise, the code of the operation is wrapped in a loop over the samples.
+       */
+      virtual bool processesBatch() const { return false; }
+
+      /**
+       * Returns the number of bytes between the tensors of two consecutive samples of a batch.
+       */
+      std::size_t sampleStride() const { return batchStride; }
+
+      /**
+       * Emits the head of a loop over all samples of a batch.
+       */
+      void beginSampleLoop(x86::Assembler& a, Label& loop) const
+      {
+        a.mov(a.ptr_zbp(sampleCounterOffset, 4), imm(settings.batchSize));
+        loop = a.newLabel();
+        a.bind(loop);
+      }
+
+      /**
+       * Emits the tail of a loop over all samples of a batch, which advances the workspace pointer to the next sample in each iteration.
+       */
+      void endSampleLoop(x86::Assembler& a, const Label& loop) const
+      {
+        a.add(a.ptr_zbp(workspacePointerOffset, a.zbp().size()), imm(batchStride));
+        a.dec(a.ptr_zbp(sampleCounterOffset, 4));
+        a.jnz(loop);
+        a.sub(a.ptr_zbp(workspacePointerOffset, a.zbp().size()), imm(batchStride * settings.batchSize));
+      }
+
+      /**
+       * Emits code that loads the address of (an element of) an operand tensor into a general purpose register.
+       * If the network is compiled to be reentrant, the address is computed relative to the workspace pointer in the stack frame.
+       * The addresses of the inputs and outputs of a network with bindable inputs and outputs are loaded from its pointer table.
+       */
+      void loadAddress(x86::Assembler& a, const x86::Gp& reg, const void* address) const
+      {
+        if(boundTensors)
+          for(const BoundTensor& tensor : *boundTensors)
+            if(address >= tensor.begin && address <= tensor.end)
+            {
+              loadAddress(a, reg, tensor.slot);
+              a.mov(reg, x86::ptr(reg, 0, reg.size()));
+              if(address != tensor.begin)
+                a.add(reg, imm(static_cast<const unsigned char*>(address) - tensor.begin));
+              return;
+            }
+        if(!workspaceBase)
+        {
+          a.mov(reg, imm(address));
+          return;
+        }
+        const std::ptrdiff_t offset = static_cast<const unsigned char*>(address) - workspaceBase;
+        a.mov(reg, a.ptr_zbp(workspacePointerOffset, reg.size()));
+        if(offset)
+          a.add(reg, imm(offset));
+      }
+
     private:
+      // The address of the workspace that the tensors have been allocated in during compilation if the network is reentrant (nullptr otherwise).
+      const unsigned char* workspaceBase = nullptr;
+
+      // The inputs and outputs of the network if their addresses are loaded from a pointer table (nullptr otherwise).
+      const std::vector<BoundTensor>* boundTensors = nullptr;
+
+      // The number of bytes between the workspaces of two consecutive samples of a batch.
+      std::size_t batchStride = 0;
+
       // This reference count only means how often its constants are used, i.e. refCount==0 means that the constants do not have to be declared.
       // refCount==0 does not mean that the compiler can be freed since there still may be references from other compilers to the parameters of this compiler.
       mutable std::size_t refCount = 1;
@@ -81,12 +211,159 @@ namespace NeuralNetwork
         return {};
       }
 
+      unsigned int maxParts(const std::vector<TensorPointerXf>& input, const std::vector<TensorPointerXf>& output) const override
+      {
+        ASSERT(input.size() == 1);
+        ASSERT(output.size() == 1);
+        return maxParts(input[0], output[0]);
+      }
+
+      void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const std::vector<TensorPointerXf>& input, const std::vector<TensorPointerXf>& output,
+                       const unsigned int part, const unsigned int parts) const override
+      {
+        ASSERT(input.size() == 1);
+        ASSERT(output.size() == 1);
+        splitIntoParts = parts > 1;
+        compilePart(a, afHandler, input[0], output[0], part, parts);
+        splitIntoParts = false;
+      }
+
       virtual void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const = 0;
       virtual std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>& inputDimensions) const
       {
         return inputDimensions;
       }
       virtual bool canBeInplace() const = 0;
+      virtual unsigned int maxParts(const TensorPointerXf&, const TensorPointerXf&) const { return 1; }
+      virtual void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                               const unsigned int, const unsigned int parts) const
+      {
+        ASSERT(parts == 1);
+        static_cast<void>(parts);
+        compile(a, afHandler, input, output);
+      }
+
+      /**
+       * Returns how the output rows of the operation depend on its input rows if it can compute ranges of its output rows (cf. compileRowRange),
+       * such that it can be executed in stripes together with the operations before and after it (cf. CompilationSettings::stripeCacheSize).
+       */
+      virtual RowWindow rowWindow() const { return RowWindow(); }
+
+      /**
+       * Emits code that computes a range of output rows (only if the operation has a row window). The input must have been computed up to the last row that the range depends on.
+       * The input and output may be line buffers that only hold the rows around the range, whose data pointers point to where their first row would be.
+       * Therefore, the code must only load the addresses of rows that the range reads or writes.
+       * @param rowBegin The first output row (a multiple of rowGranularity unless it is 0).
+       * @param rowEnd The end of the output rows.
+       */
+      virtual void compileRowRange(x86::Assembler&, ActivationFunctionHandler&, const TensorPointerXf&, const TensorPointerXf&, const unsigned int, const unsigned int) const
+      {
+        FAIL("The operation cannot compute ranges of output rows.");
+      }
+
+      /**
+       * Returns the number of output rows by which the ranges of rows of a sliding window operation are aligned, such that each range starts at an address that is aligned to 32 bytes in both tensors.
+       */
+      static unsigned int rowGranularity(const TensorPointerXf& input, const TensorPointerXf& output, const unsigned int stride)
+      {
+        unsigned int rows = 1;
+        while((rows * stride * input.dims(1) * input.dims(2)) % 8 || (rows * output.dims(1) * output.dims(2)) % 8)
+          rows *= 2;
+        return rows;
+      }
+
+    protected:
+      /**
+       * Whether the code that is currently emitted computes one of several parts of the operation (cf. compilePart).
+       * The floats behind the last output of a part belong to the next part, which another thread may already have computed.
+       * Therefore, vectors that are only partially filled with outputs must not be stored as a whole.
+       */
+      mutable bool splitIntoParts = false;
+
+      /**
+       * Emits code that stores the lower elements of a vector register without writing the floats behind them.
+       * @param destination The address of the first element.
+       * @param source The register, which may be overwritten.
+       * @param elements The number of elements to store (at most 4 for an xmm register and at most 8 for a ymm register).
+       * @param useAVX Whether the code uses VEX encoded instructions.
+       */
+      static void storePartialVector(x86::Assembler& a, const x86::Mem& destination, const x86::Vec& source, const unsigned int elements, const bool useAVX)
+      {
+        const x86::Xmm lower = source.as<x86::Xmm>();
+        if(elements >= 4)
+        {
+          a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, destination, lower);
+          if(elements > 4)
+          {
+            a.vextractf128(lower, source.as<x86::Ymm>(), imm(1));
+            storePartialVector(a, destination.cloneAdjusted(4 * sizeof(float)), lower, elements - 4, true);
+          }
+          return;
+        }
+        if(elements == 1)
+        {
+          a.emit(useAVX ? x86::Inst::kIdVmovss : x86::Inst::kIdMovss, destination, lower);
+          return;
+        }
+        a.emit(useAVX ? x86::Inst::kIdVmovlps : x86::Inst::kIdMovlps, destination, lower);
+        if(elements == 3)
+        {
+          if(useAVX)
+          {
+            a.vmovhlps(lower, lower, lower);
+            a.vmovss(destination.cloneAdjusted(2 * sizeof(float)), lower);
+          }
+          else
+          {
+            a.movhlps(lower, lower);
+            a.movss(destination.cloneAdjusted(2 * sizeof(float)), lower);
+          }
+        }
+      }
+
+      /**
+       * Returns into how many parts the output rows of a sliding window operation can be split.
+       * Each part starts at an address that is aligned to 32 bytes in both tensors.
+       */
+      unsigned int rowParts(const TensorPointerXf& input, const TensorPointerXf& output, const unsigned int stride) const
+      {
+        if(input.data() == output.data())
+          return 1;
+        const unsigned int granularity = rowGranularity(input, output, stride);
+        return (output.dims(0) + granularity - 1) / granularity;
+      }
+
+      /**
+       * Emits code that computes a range of output rows of a sliding window operation without implicit padding (by compiling it for the rows of its input and output that are involved).
+       * @param kernelHeight The number of input rows of a window.
+       * @param stride The vertical stride of the window.
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       */
+      void compileRows(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                       const unsigned int kernelHeight, const unsigned int stride, const unsigned int rowBegin, const unsigned int rowEnd) const
+      {
+        if(rowBegin == 0 && rowEnd == output.dims(0))
+        {
+          compile(a, afHandler, input, output);
+          return;
+        }
+        const TensorPointerXf inputRows({(rowEnd - 1) * stride + kernelHeight - rowBegin * stride, input.dims(1), input.dims(2)},
+                                        const_cast<float*>(input.data()) + rowBegin * stride * input.dims(1) * input.dims(2));
+        const TensorPointerXf outputRows({rowEnd - rowBegin, output.dims(1), output.dims(2)},
+                                         const_cast<float*>(output.data()) + rowBegin * output.dims(1) * output.dims(2));
+        compile(a, afHandler, inputRows, outputRows);
+      }
+
+      /**
+       * Returns the first output row and the end of the output rows of one part of a sliding window operation (cf. rowParts).
+       */
+      std::array<unsigned int, 2> partRows(const TensorPointerXf& input, const TensorPointerXf& output, const unsigned int stride, const unsigned int part, const unsigned int parts) const
+      {
+        const unsigned int granularity = rowGranularity(input, output, stride);
+        const unsigned int granules = (output.dims(0) + granularity - 1) / granularity;
+        return {{std::min(output.dims(0), granules * part / parts * granularity), std::min(output.dims(0), granules * (part + 1) / parts * granularity)}};
+      }
     };
   }
 }
@@ -18,20 +18,24 @@ namespace NeuralNetwork
       if(isInplace && p.activationDesc == CompiledActivationFunctionId::linear)
         return;
 
-      a.mov(a.zsi(), imm(input.data()));
+      loadAddress(a, a.zsi(), input.data());
       if(!isInplace)
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
+
+      // With AVX2, 8 channels are processed per (ymm) register
+      const bool useAVX = settings.useAVX2;
+      const unsigned int vectorSize = useAVX ? 8 : 4;
 
       ASSERT(ActivationFunctionHandler::neededSpares(p.activationDesc) < settings.xmmRegs());
       unsigned int remainingChannels = static_cast<unsigned int>(input.size());
       for(unsigned int stepSize = settings.xmmRegs() - ActivationFunctionHandler::neededSpares(p.activationDesc); stepSize; --stepSize)
       {
-        const unsigned int channelsPerStep = stepSize * 4;
+        const unsigned int channelsPerStep = stepSize * vectorSize;
         if(remainingChannels < channelsPerStep)
           continue;
 
         // Initialize activation function
-        ActivationFn& activationFunction = afHandler.prepare(p.activationDesc, false, a, {}, {});
+        ActivationFn& activationFunction = useAVX ? afHandler.prepareAVX(p.activationDesc, a, {}, {}) : afHandler.prepare(p.activationDesc, false, a, {}, {});
         for(unsigned int step = 0; step < stepSize; step++)
           activationFunction.addValue(x86::xmm(step));
         for(unsigned int step = stepSize; step < settings.xmmRegs(); step++)
@@ -47,16 +51,26 @@ namespace NeuralNetwork
         }
 
         for(unsigned int step = 0; step < stepSize; step++)
-          a.movaps(x86::xmm(step), a.ptr_zsi(step * 4 * sizeof(float)));
+        {
+          if(useAVX)
+            a.vmovups(x86::ymm(step), a.ptr_zsi(step * 8 * sizeof(float)));
+          else
+            a.movaps(x86::xmm(step), a.ptr_zsi(step * 4 * sizeof(float)));
+        }
         activationFunction.apply(a);
         for(unsigned int step = 0; step < stepSize; step++)
-          a.movaps(isInplace ? a.ptr_zsi(step * 4 * sizeof(float)) : a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+        {
+          if(useAVX)
+            a.vmovups(isInplace ? a.ptr_zsi(step * 8 * sizeof(float)) : a.ptr_zdi(step * 8 * sizeof(float)), x86::ymm(step));
+          else
+            a.movaps(isInplace ? a.ptr_zsi(step * 4 * sizeof(float)) : a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+        }
 
         if(remainingChannels != channelsPerStep)
         {
-          a.add(a.zsi(), imm(stepSize * 4 * sizeof(float)));
+          a.add(a.zsi(), imm(stepSize * vectorSize * sizeof(float)));
           if(!isInplace)
-            a.add(a.zdi(), imm(stepSize * 4 * sizeof(float)));
+            a.add(a.zdi(), imm(stepSize * vectorSize * sizeof(float)));
         }
 
         if(remainingChannels >= channelsPerStep * 2)
@@ -67,7 +81,28 @@ namespace NeuralNetwork
 
         remainingChannels %= channelsPerStep;
       }
-      if(remainingChannels == 1)
+      if(useAVX)
+      {
+        if(remainingChannels)
+        {
+          // Apply the function to a single register, of which only the lower half is loaded and stored if there are at most 4 remaining channels
+          ActivationFn& activationFunction = afHandler.prepareAVX(p.activationDesc, a, { }, { x86::ymm0 });
+          for(unsigned int i = 1; i < settings.xmmRegs(); i++)
+            activationFunction.addSpare(x86::ymm(i));
+          activationFunction.initialize(a);
+          if(remainingChannels > 4)
+            a.vmovups(x86::ymm0, a.ptr_zsi());
+          else
+            a.vmovups(x86::xmm0, a.ptr_zsi());
+          activationFunction.apply(a);
+          if(remainingChannels > 4)
+            a.vmovups(isInplace ? a.ptr_zsi() : a.ptr_zdi(), x86::ymm0);
+          else
+            a.vmovups(isInplace ? a.ptr_zsi() : a.ptr_zdi(), x86::xmm0);
+        }
+        a.vzeroupper();
+      }
+      else if(remainingChannels == 1)
       {
         ActivationFn& activationFunction = afHandler.prepare(p.activationDesc, true, a, { }, { x86::xmm0 });
         for(unsigned int i = 1; i < settings.xmmRegs(); i++)
@@ -28,6 +28,17 @@ namespace NeuralNetwork
 
       inline bool canBeInplace() const override { return true; }
 
+      inline RowWindow rowWindow() const override
+      {
+        return {1, 1, PaddingType::valid};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        compileRows(a, afHandler, input, output, 1, 1, rowBegin, rowEnd);
+      }
+
       void initialize() override {}
       void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
     };
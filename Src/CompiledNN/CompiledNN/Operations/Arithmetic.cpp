@@ -14,8 +14,7 @@ namespace NeuralNetwork
       {
         constants.emplace_back();
         NetworkConstants& rNumber = constants.back();
-        rNumber.data.resize(4);
-        rNumber.data[0] = rNumber.data[1] = rNumber.data[2] = rNumber.data[3] = 1.f / static_cast<float>(p.inputSize);
+        rNumber.data.assign(settings.useAVX2 ? 8 : 4, 1.f / static_cast<float>(p.inputSize));
       }
     }
 
@@ -31,38 +30,48 @@ namespace NeuralNetwork
           break;
         }
 
-      std::function<void(unsigned int dst, unsigned int src)> doOperation, doOperationSingle;
+      std::function<void(unsigned int dst, unsigned int src)> doOperation, doOperationSingle, doOperationAVX;
       switch(p.op)
       {
         case add:
           doOperation = [&a](unsigned int dst, unsigned int src) { a.addps(x86::xmm(dst), x86::xmm(src)); };
           doOperationSingle = [&a](unsigned int dst, unsigned int src) { a.addss(x86::xmm(dst), x86::xmm(src)); };
+          doOperationAVX = [&a](unsigned int dst, unsigned int src) { a.vaddps(x86::ymm(dst), x86::ymm(dst), x86::ymm(src)); };
           break;
         case sub:
           ASSERT(input.size() == 2);
           doOperation = [&a](unsigned int dst, unsigned int src) { a.subps(x86::xmm(dst), x86::xmm(src)); };
           doOperationSingle = [&a](unsigned int dst, unsigned int src) { a.subss(x86::xmm(dst), x86::xmm(src)); };
+          doOperationAVX = [&a](unsigned int dst, unsigned int src) { a.vsubps(x86::ymm(dst), x86::ymm(dst), x86::ymm(src)); };
           break;
         case mul:
           doOperation = [&a](unsigned int dst, unsigned int src) { a.mulps(x86::xmm(dst), x86::xmm(src)); };
           doOperationSingle = [&a](unsigned int dst, unsigned int src) { a.mulss(x86::xmm(dst), x86::xmm(src)); };
+          doOperationAVX = [&a](unsigned int dst, unsigned int src) { a.vmulps(x86::ymm(dst), x86::ymm(dst), x86::ymm(src)); };
           break;
         case avg:
           doOperation = [&a](unsigned int dst, unsigned int src) { a.addps(x86::xmm(dst), x86::xmm(src)); };
           doOperationSingle = [&a](unsigned int dst, unsigned int src) { a.addss(x86::xmm(dst), x86::xmm(src)); };
+          doOperationAVX = [&a](unsigned int dst, unsigned int src) { a.vaddps(x86::ymm(dst), x86::ymm(dst), x86::ymm(src)); };
           break;
         case max:
           doOperation = [&a](unsigned int dst, unsigned int src) { a.maxps(x86::xmm(dst), x86::xmm(src)); };
           doOperationSingle = [&a](unsigned int dst, unsigned int src) { a.maxss(x86::xmm(dst), x86::xmm(src)); };
+          doOperationAVX = [&a](unsigned int dst, unsigned int src) { a.vmaxps(x86::ymm(dst), x86::ymm(dst), x86::ymm(src)); };
           break;
         case min:
           doOperation = [&a](unsigned int dst, unsigned int src) { a.minps(x86::xmm(dst), x86::xmm(src)); };
           doOperationSingle = [&a](unsigned int dst, unsigned int src) { a.minss(x86::xmm(dst), x86::xmm(src)); };
+          doOperationAVX = [&a](unsigned int dst, unsigned int src) { a.vminps(x86::ymm(dst), x86::ymm(dst), x86::ymm(src)); };
           break;
         default:
           FAIL("Unknown operation.");
       }
 
+      // With AVX2, 8 channels are processed per (ymm) register
+      const bool useAVX = settings.useAVX2;
+      const unsigned int vectorSize = useAVX ? 8 : 4;
+
       std::array<x86::Gp::Id, 4> availablePointerRegs = {{x86::Gp::kIdSi, x86::Gp::kIdAx, x86::Gp::kIdBx, x86::Gp::kIdDx}};
 
       std::size_t remainingInputs = input.size();
@@ -70,7 +79,7 @@ namespace NeuralNetwork
       while(remainingInputs)
       {
         std::vector<x86::Gp::Id> regs;
-        a.mov(a.zdi(), imm(output[0].data()));
+        loadAddress(a, a.zdi(), output[0].data());
         if(!(remainingInputs == input.size() && inplaceIndex == std::numeric_limits<std::size_t>::max()))
         {
           regs.push_back(x86::Gp::kIdDi);
@@ -82,7 +91,7 @@ namespace NeuralNetwork
           regs.push_back(availablePointerRegs[i]);
           if(inputIndex == inplaceIndex)
             ++inputIndex;
-          a.mov(a.gpz(regs.back()), imm(input[inputIndex++].data()));
+          loadAddress(a, a.gpz(regs.back()), input[inputIndex++].data());
         }
 
         remainingInputs -= std::min(availablePointerRegs.size(), remainingInputs);
@@ -91,14 +100,17 @@ namespace NeuralNetwork
         bool rNumberLoaded = false;
         for(unsigned int stepSize = settings.xmmRegs() / 2; stepSize; --stepSize)
         {
-          const unsigned int channelsPerStep = stepSize * 4;
+          const unsigned int channelsPerStep = stepSize * vectorSize;
           if(remainingChannels < channelsPerStep)
             continue;
 
           if(!remainingInputs && p.op == avg && stepSize < settings.xmmRegs() / 2 && !rNumberLoaded)
           {
             rNumberLoaded = true;
-            a.movaps(x86::xmm(settings.xmmRegs() - 1), x86::ptr(constants[0].label));
+            if(useAVX)
+              a.vmovaps(x86::ymm(settings.xmmRegs() - 1), x86::ptr(constants[0].label));
+            else
+              a.movaps(x86::xmm(settings.xmmRegs() - 1), x86::ptr(constants[0].label));
           }
 
           Label loop;
@@ -110,15 +122,25 @@ namespace NeuralNetwork
           }
 
           for(unsigned int step = 0; step < stepSize; step++)
-            a.movaps(x86::xmm(step), a.ptr_base(regs[0], step * 4 * sizeof(float)));
+          {
+            if(useAVX)
+              a.vmovups(x86::ymm(step), a.ptr_base(regs[0], step * 8 * sizeof(float)));
+            else
+              a.movaps(x86::xmm(step), a.ptr_base(regs[0], step * 4 * sizeof(float)));
+          }
 
           for(std::size_t i = 1; i < regs.size(); ++i)
           {
             for(unsigned int step = 0; step < stepSize; step++)
-              a.movaps(x86::xmm(step + stepSize), a.ptr_base(regs[i], step * 4 * sizeof(float)));
+            {
+              if(useAVX)
+                a.vmovups(x86::ymm(step + stepSize), a.ptr_base(regs[i], step * 8 * sizeof(float)));
+              else
+                a.movaps(x86::xmm(step + stepSize), a.ptr_base(regs[i], step * 4 * sizeof(float)));
+            }
 
             for(unsigned int step = 0; step < stepSize; step++)
-              doOperation(step, step + stepSize);
+              useAVX ? doOperationAVX(step, step + stepSize) : doOperation(step, step + stepSize);
           }
 
           if(!remainingInputs && p.op == avg)
@@ -128,21 +150,34 @@ namespace NeuralNetwork
             if(!rNumberLoaded)
             {
               rNumberLoaded = true;
-              a.movaps(x86::xmm(settings.xmmRegs() - 1), x86::ptr(constants[0].label));
+              if(useAVX)
+                a.vmovaps(x86::ymm(settings.xmmRegs() - 1), x86::ptr(constants[0].label));
+              else
+                a.movaps(x86::xmm(settings.xmmRegs() - 1), x86::ptr(constants[0].label));
             }
             for(unsigned int step = 0; step < stepSize; step++)
-              a.mulps(x86::xmm(step), x86::xmm(settings.xmmRegs() - 1));
+            {
+              if(useAVX)
+                a.vmulps(x86::ymm(step), x86::ymm(step), x86::ymm(settings.xmmRegs() - 1));
+              else
+                a.mulps(x86::xmm(step), x86::xmm(settings.xmmRegs() - 1));
+            }
           }
 
           for(unsigned int step = 0; step < stepSize; step++)
-            a.movaps(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+          {
+            if(useAVX)
+              a.vmovups(a.ptr_zdi(step * 8 * sizeof(float)), x86::ymm(step));
+            else
+              a.movaps(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+          }
 
           if(remainingChannels != channelsPerStep)
           {
             for(std::size_t i = 0; i < regs.size(); ++i)
-              a.add(a.gpz(regs[i]), imm(stepSize * 4 * sizeof(float)));
+              a.add(a.gpz(regs[i]), imm(stepSize * vectorSize * sizeof(float)));
             if(regs[0] != x86::Gp::kIdDi)
-              a.add(a.zdi(), imm(stepSize * 4 * sizeof(float)));
+              a.add(a.zdi(), imm(stepSize * vectorSize * sizeof(float)));
           }
 
           if(remainingChannels >= channelsPerStep * 2)
@@ -153,7 +188,33 @@ namespace NeuralNetwork
 
           remainingChannels %= channelsPerStep;
         }
-        if(remainingChannels == 1)
+        if(useAVX)
+        {
+          if(remainingChannels)
+          {
+            // Only the lower half of the registers is loaded and stored if there are at most 4 remaining channels
+            const auto load = [&](const unsigned int reg, const std::size_t i)
+            {
+              if(remainingChannels > 4)
+                a.vmovups(x86::ymm(reg), a.ptr_base(regs[i]));
+              else
+                a.vmovups(x86::xmm(reg), a.ptr_base(regs[i]));
+            };
+            load(0, 0);
+            for(std::size_t i = 1; i < regs.size(); ++i)
+            {
+              load(1, i);
+              doOperationAVX(0, 1);
+            }
+            if(!remainingInputs && p.op == avg)
+              rNumberLoaded ? a.vmulps(x86::ymm0, x86::ymm0, x86::ymm(settings.xmmRegs() - 1)) : a.vmulps(x86::ymm0, x86::ymm0, x86::ptr(constants[0].label));
+            if(remainingChannels > 4)
+              a.vmovups(a.ptr_zdi(), x86::ymm0);
+            else
+              a.vmovups(a.ptr_zdi(), x86::xmm0);
+          }
+        }
+        else if(remainingChannels == 1)
         {
           a.movss(x86::xmm0, a.ptr_base(regs[0]));
           // TODO: Measure whether it would be better to split the loop into two.
@@ -181,6 +242,10 @@ namespace NeuralNetwork
           a.movaps(a.ptr_zdi(), x86::xmm0);
         }
       }
+
+      // Avoid the penalty of mixing AVX and legacy SSE instructions in the following operations
+      if(useAVX)
+        a.vzeroupper();
     }
   }
 }
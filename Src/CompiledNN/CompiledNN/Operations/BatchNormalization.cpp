@@ -15,6 +15,27 @@ namespace NeuralNetwork
       constants.resize(1);
       NetworkConstants& norm = constants.back();
 
+      if(settings.useAVX2)
+      {
+        // The parameters are repeated (or padded for vectors) such that they fill a whole number of ymm registers
+        if(p.dimension == 2)
+        {
+          paramLength = p.inputSize;
+          while(paramLength % 8 != 0)
+            paramLength += p.inputSize;
+        }
+        else
+          paramLength = (p.inputSize + 7) & (~7);
+        norm.data.resize(paramLength * 2);
+        for(unsigned int i = 0; i < paramLength; i++)
+          if(p.dimension == 2 || i < p.inputSize)
+          {
+            norm.data[i] = (*p.factor)[i % p.inputSize];
+            norm.data[paramLength + i] = (*p.offset)[i % p.inputSize];
+          }
+        return;
+      }
+
       if(p.dimension == 2)
       {
         switch(p.inputSize)
@@ -51,8 +72,129 @@ namespace NeuralNetwork
         paramLength = ((p.inputSize + 3) & (~3));
         norm.data.resize(paramLength * 2);
         std::copy(p.factor->begin(), p.factor->end(), norm.data.begin());
-        std::copy(p.offset->begin(), p.offset->end(), norm.data.begin() + p.inputSize);
+        std::copy(p.offset->begin(), p.offset->end(), norm.data.begin() + paramLength);
+      }
+    }
+
+    void BatchNormalizationCompiler::compileAVX(x86::Assembler& a, const TensorPointerXf& input, const bool isInplace) const
+    {
+      const NetworkConstants& norm = constants.back();
+      const unsigned int vectors = static_cast<unsigned int>(input.size() / 8);
+      const unsigned int remainingChannels = static_cast<unsigned int>(input.size() % 8);
+
+      if(vectors && paramLength == 8)    // Normalization vector fits into a single register
+      {
+        a.vmovaps(x86::ymm(settings.xmmRegs() - 2), x86::ptr(norm.label));
+        a.vmovaps(x86::ymm(settings.xmmRegs() - 1), x86::ptr(norm.label, paramLength * sizeof(float)));
+
+        unsigned int batchSize = settings.xmmRegs() - 2;
+        for(; batchSize; batchSize--)
+          if(vectors % batchSize == 0)
+            break;
+
+        Label loop;
+        if(vectors > batchSize)
+        {
+          a.mov(a.zcx(), imm(vectors / batchSize));
+          loop = a.newLabel();
+          a.bind(loop);
+        }
+        for(unsigned int i = 0; i < batchSize; i++)
+          a.vmovups(x86::ymm(i), a.ptr_zsi(i * 8 * sizeof(float)));
+        for(unsigned int i = 0; i < batchSize; i++)
+        {
+          if(settings.useFMA3)
+            a.vfmadd132ps(x86::ymm(i), x86::ymm(settings.xmmRegs() - 1), x86::ymm(settings.xmmRegs() - 2));
+          else
+          {
+            a.vmulps(x86::ymm(i), x86::ymm(i), x86::ymm(settings.xmmRegs() - 2));
+            a.vaddps(x86::ymm(i), x86::ymm(i), x86::ymm(settings.xmmRegs() - 1));
+          }
+        }
+        for(unsigned int i = 0; i < batchSize; i++)
+          a.vmovups(isInplace ? a.ptr_zsi(i * 8 * sizeof(float)) : a.ptr_zdi(i * 8 * sizeof(float)), x86::ymm(i));
+        a.add(a.zsi(), imm(batchSize * 8 * sizeof(float)));
+        if(!isInplace)
+          a.add(a.zdi(), imm(batchSize * 8 * sizeof(float)));
+        if(vectors > batchSize)
+        {
+          a.dec(a.zcx());
+          a.jnz(loop);
+        }
       }
+      else if(vectors && input.rank() == 1)    // Normalize a vector
+      {
+        unsigned int batchSize = settings.xmmRegs();
+        for(; batchSize; batchSize--)
+          if(vectors % batchSize == 0)
+            break;
+
+        a.lea(a.zdx(), x86::ptr(norm.label));
+        Label loop;
+        if(vectors > batchSize)
+        {
+          a.mov(a.zcx(), imm(vectors / batchSize));
+          loop = a.newLabel();
+          a.bind(loop);
+        }
+        for(unsigned int i = 0; i < batchSize; i++)
+          a.vmovups(x86::ymm(i), a.ptr_zsi(i * 8 * sizeof(float)));
+        for(unsigned int i = 0; i < batchSize; i++)
+          a.vmulps(x86::ymm(i), x86::ymm(i), a.ptr_zdx(i * 8 * sizeof(float)));
+        for(unsigned int i = 0; i < batchSize; i++)
+          a.vaddps(x86::ymm(i), x86::ymm(i), a.ptr_zdx((paramLength + i * 8) * sizeof(float)));
+        for(unsigned int i = 0; i < batchSize; i++)
+          a.vmovups(isInplace ? a.ptr_zsi(i * 8 * sizeof(float)) : a.ptr_zdi(i * 8 * sizeof(float)), x86::ymm(i));
+        a.add(a.zsi(), imm(batchSize * 8 * sizeof(float)));
+        if(!isInplace)
+          a.add(a.zdi(), imm(batchSize * 8 * sizeof(float)));
+        if(vectors > batchSize)
+        {
+          a.add(a.zdx(), imm(batchSize * 8 * sizeof(float)));
+          a.dec(a.zcx());
+          a.jnz(loop);
+        }
+      }
+      else if(vectors)    // Iterate over normalization vector offset
+      {
+        a.mov(a.zcx(), imm(vectors + 1));
+        Label resetParamPtr = a.newLabel();
+        Label end = a.newLabel();
+        a.bind(resetParamPtr);
+        a.dec(a.zcx());
+        a.jz(end);
+        a.mov(a.zax(), imm(paramLength / 8));
+        a.lea(a.zdx(), x86::ptr(norm.label));
+        Label loop = a.newLabel();
+        a.bind(loop);
+        a.vmovups(x86::ymm0, a.ptr_zsi());
+        a.vmulps(x86::ymm0, x86::ymm0, a.ptr_zdx());
+        a.vaddps(x86::ymm0, x86::ymm0, a.ptr_zdx(paramLength * sizeof(float)));
+        a.add(a.zdx(), imm(8 * sizeof(float)));
+        a.vmovups(isInplace ? a.ptr_zsi() : a.ptr_zdi(), x86::ymm0);
+        a.add(a.zsi(), imm(8 * sizeof(float)));
+        if(!isInplace)
+          a.add(a.zdi(), imm(8 * sizeof(float)));
+        a.dec(a.zax());
+        a.jz(resetParamPtr);
+        a.dec(a.zcx());
+        a.jnz(loop);
+        a.bind(end);
+      }
+
+      // Normalize the remaining channels in a single register, of which only the lower half is loaded and stored if there are at most 4 channels
+      if(remainingChannels)
+      {
+        const unsigned int paramOffset = vectors * 8 % paramLength;
+        const x86::Vec reg = remainingChannels > 4 ? static_cast<x86::Vec>(x86::ymm0) : static_cast<x86::Vec>(x86::xmm0);
+        a.vmovups(reg, a.ptr_zsi());
+        a.vmulps(reg, reg, x86::ptr(norm.label, paramOffset * sizeof(float)));
+        a.vaddps(reg, reg, x86::ptr(norm.label, (paramLength + paramOffset) * sizeof(float)));
+        a.vmovups(isInplace ? a.ptr_zsi() : a.ptr_zdi(), reg);
+      }
+
+      // Avoid the penalty of mixing AVX and legacy SSE instructions in the following operations
+      a.vzeroupper();
     }
 
     void BatchNormalizationCompiler::compile(x86::Assembler& a, ActivationFunctionHandler&, const TensorPointerXf& input, const TensorPointerXf& output) const
@@ -65,9 +207,17 @@ namespace NeuralNetwork
       const NetworkConstants& norm = constants.back();
 
       const bool isInplace = input.data() == output.data();
-      a.mov(a.zsi(), imm(input.data()));
+      loadAddress(a, a.zsi(), input.data());
       if(!isInplace)
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
+
+      if(settings.useAVX2)
+      {
+        if(input.rank() != 1 && p.dimension != 2)
+          FAIL("BatchNormalization layer supports only axis 2 for 3-dimensional tensors or 0 for vectors.");
+        compileAVX(a, input, isInplace);
+        return;
+      }
 
       // Apply normalization
       if(input.rank() == 1)    // Normalize a vector
@@ -33,11 +33,30 @@ namespace NeuralNetwork
 
       inline bool canBeInplace() const override { return true; }
 
+      inline RowWindow rowWindow() const override
+      {
+        // Only the normalization of the channels is independent of the position of the rows
+        if(p.dimension != 2)
+          return RowWindow();
+        return {1, 1, PaddingType::valid};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        compileRows(a, afHandler, input, output, 1, 1, rowBegin, rowEnd);
+      }
+
       void initialize() override;
       void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
 
     private:
       unsigned int paramLength;
+
+      /**
+       * Compiles the normalization with ymm registers (8 channels per register).
+       */
+      void compileAVX(x86::Assembler& a, const TensorPointerXf& input, const bool isInplace) const;
     };
   }
 }
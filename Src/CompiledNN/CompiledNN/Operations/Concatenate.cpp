@@ -13,7 +13,7 @@ namespace NeuralNetwork
     {
       const bool isInplace = input[0].data() == output.data();
       std::size_t offset = isInplace ? (innerSize * input[0].dims(p.dimension)) : 0;
-      a.mov(a.zdi(), imm(output.data() + offset));
+      loadAddress(a, a.zdi(), output.data() + offset);
       for(std::size_t i = isInplace ? 1 : 0; i < input.size(); ++i)
       {
         std::size_t remainingChannels = innerSize * input[i].dims(p.dimension);
@@ -21,7 +21,7 @@ namespace NeuralNetwork
         const std::size_t alignmentOffset = 4 - (offset % 4);
         offset += remainingChannels;
 
-        a.mov(a.zsi(), imm(input[i].data()));
+        loadAddress(a, a.zsi(), input[i].data());
         if(!aligned)
         {
           a.movaps(x86::xmm0, a.ptr_zsi());
@@ -111,10 +111,10 @@ namespace NeuralNetwork
         for(std::size_t i = 0; i < input.size(); i += regs.size())
         {
           const std::size_t maxInput = std::min(input.size(), i + regs.size());
-          a.mov(a.zdi(), imm(output[0].data() + outputOffset));
+          loadAddress(a, a.zdi(), output[0].data() + outputOffset);
           for(std::size_t j = i; j < maxInput; ++j)
           {
-            a.mov(a.gpz(regs[j - i]), imm(input[j].data()));
+            loadAddress(a, a.gpz(regs[j - i]), input[j].data());
             outputOffset += innerSize * input[j].dims(p.dimension);
             ASSERT((outputOffset % 4) == 0); // TODO -> see below
           }
@@ -19,7 +19,7 @@ namespace NeuralNetwork
       NetworkConstants& weights = constants.back();
       weights.data.clear();
       ASSERT(p.weights->rank() == 3);
-      unsigned int outputBatchSize = 4 * (settings.xmmRegs() - std::max(2u, ActivationFunctionHandler::neededSpares(p.postActivation)));
+      const unsigned int outputBatchSize = this->outputBatchSize();
       for(unsigned int outputOffset = 0; outputOffset < p.weights->dims(2); outputOffset += outputBatchSize)
       {
         const unsigned int outputBatchEnd = std::min(outputOffset + outputBatchSize, p.weights->dims(2));
@@ -47,39 +47,208 @@ namespace NeuralNetwork
             }
           }
         }
+
+        // The weights of each output batch are followed by its biases
+        const unsigned int paddedOutputBatchEnd = outputOffset + (outputBatchEnd - outputOffset + 3) / 4 * 4;
+        for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+        {
+          float b = p.biases && output < outputBatchEnd ? (*p.biases)[output] : 0.f;
+          if(p.batchNormalization && output < outputBatchEnd)
+            b = b * (*p.batchNormalization->factor)[output] + (*p.batchNormalization->offset)[output];
+          weights.data.emplace_back(b);
+        }
       }
+    }
 
-      // Store biases
-      if(p.biases || p.batchNormalization) {
-        constants.emplace_back();
-        NetworkConstants& biases = constants.back();
-        if(p.biases)
-          biases.data = *p.biases;
-        else
-          biases.data.resize(p.weights->dims(2), 0.f);
-        if(p.batchNormalization)
+    void Conv1DCompiler::compileFilter(x86::Assembler& a, const bool inputAligned, const unsigned int remainingOutputs, const unsigned int remainingInput, const bool lastFilter) const
+    {
+      const unsigned int stepSize = (remainingOutputs + 3) / 4;
+
+      // Load input values
+      if(remainingInput == 1)
+        a.movss(x86::xmm(settings.xmmRegs() - 1), a.ptr_zdx());
+      else if(inputAligned)
+        a.movaps(x86::xmm(settings.xmmRegs() - 1), a.ptr_zdx());
+      else
+        a.movups(x86::xmm(settings.xmmRegs() - 1), a.ptr_zdx());
+      if(remainingInput != 4)
+        a.shufps(x86::xmm(settings.xmmRegs() - 1), x86::xmm(settings.xmmRegs() - 1), imm(0u | ((1 % remainingInput) << 2) | ((2 % remainingInput) << 4) | ((3 % remainingInput) << 6)));
+      if(!lastFilter)
+        a.add(a.zdx(), imm(4 * sizeof(float)));
+
+      // Apply filter (the input is rotated after each step, the weights have been arranged accordingly)
+      unsigned int filterOffset = 0;
+      for(unsigned int shuffle = remainingInput; shuffle; --shuffle)
+      {
+        for(unsigned int step = 0; step < stepSize; step++)
+        {
+          if(step == stepSize - 1 && remainingOutputs % 4 == 1)
+          {
+            if(settings.useFMA3)
+              a.vfmadd231ss(x86::xmm(step), x86::xmm(settings.xmmRegs() - 1), a.ptr_zbx(filterOffset));
+            else
+            {
+              a.movss(x86::xmm(settings.xmmRegs() - 2), a.ptr_zbx(filterOffset));
+              a.mulss(x86::xmm(settings.xmmRegs() - 2), x86::xmm(settings.xmmRegs() - 1));
+              a.addss(x86::xmm(step), x86::xmm(settings.xmmRegs() - 2));
+            }
+          }
+          else
+          {
+            if(settings.useFMA3)
+              a.vfmadd231ps(x86::xmm(step), x86::xmm(settings.xmmRegs() - 1), a.ptr_zbx(filterOffset));
+            else
+            {
+              a.movaps(x86::xmm(settings.xmmRegs() - 2), a.ptr_zbx(filterOffset));
+              a.mulps(x86::xmm(settings.xmmRegs() - 2), x86::xmm(settings.xmmRegs() - 1));
+              a.addps(x86::xmm(step), x86::xmm(settings.xmmRegs() - 2));
+            }
+          }
+          filterOffset += 4 * sizeof(float);
+        }
+
+        if(shuffle > 1)
+          a.shufps(x86::xmm(settings.xmmRegs() - 1), x86::xmm(settings.xmmRegs() - 1), imm((1 % remainingInput) | ((2 % remainingInput) << 2) | ((3 % remainingInput) << 4) | ((4 % remainingInput) << 6)));
+      }
+      a.add(a.zbx(), imm(filterOffset));
+    }
+
+    void Conv1DCompiler::compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int remainingOutputs) const
+    {
+      const bool inputAligned = p.weights->dims(1) % 4 == 0;
+      const bool outputAligned = p.weights->dims(2) % 4 == 0;
+      const unsigned int stepSize = (remainingOutputs + 3) / 4;
+      const unsigned int filterSize = p.weights->dims(0) * p.weights->dims(1);
+
+      // Initialize activation function (outside of the filter loop if there are enough spare registers)
+      ActivationFn& activationFn = afHandler.prepare(p.postActivation, remainingOutputs == 1, a, {}, {});
+      for(unsigned int step = 0; step < stepSize; step++)
+        activationFn.addValue(x86::xmm(step));
+      const bool activationFnInitialized = ActivationFunctionHandler::neededSpares(p.postActivation) <= settings.xmmRegs() - 2 - stepSize;
+      for(unsigned int i = stepSize; i < settings.xmmRegs() - (activationFnInitialized ? 2 : 0); i++)
+        activationFn.addSpare(x86::xmm(i));
+      if(activationFnInitialized)
+        activationFn.initialize(a);
+
+      // Load input base address in zdx
+      a.mov(a.zdx(), a.zsi());
+
+      // Initialize filter result
+      for(unsigned int step = 0; step < stepSize; step++)
+        a.xorps(x86::xmm(step), x86::xmm(step));
+
+      // The filter covers consecutive input values, so there is only a loop over blocks of 4 of them
+      if(filterSize > 4)
+      {
+        Label filterLoop;
+        if(filterSize / 4 > 1)
         {
-          for(size_t i = 0; i < biases.data.size(); i++)
-            biases.data[i] = biases.data[i] * (*p.batchNormalization->factor)[i] + (*p.batchNormalization->offset)[i];
+          filterLoop = a.newLabel();
+          a.mov(a.zcx(), imm(filterSize / 4));
+          a.bind(filterLoop);
         }
+
+        compileFilter(a, inputAligned, remainingOutputs, 4);
+
+        if(filterSize / 4 > 1)
+        {
+          a.dec(a.zcx());
+          a.jnz(filterLoop);
+        }
+      }
+
+      const unsigned int remainingInput = filterSize == 4 ? 4 : filterSize % 4;
+      if(remainingInput)
+        compileFilter(a, inputAligned, remainingOutputs, remainingInput, true);
+
+      // Add bias (which follows the weights of this output batch and includes the batch normalization)
+      for(unsigned int step = 0; step < stepSize; step++)
+      {
+        if(step == stepSize - 1 && remainingOutputs % 4 == 1)
+          a.addss(x86::xmm(step), a.ptr_zbx(step * 4 * sizeof(float)));
+        else
+          a.addps(x86::xmm(step), a.ptr_zbx(step * 4 * sizeof(float)));
+      }
+      a.add(a.zbx(), imm(stepSize * 4 * sizeof(float)));
+
+      // Apply activation function
+      if(!activationFnInitialized)
+        activationFn.initialize(a);
+      activationFn.apply(a);
+
+      // Store output
+      for(unsigned int step = 0; step < stepSize; step++)
+      {
+        if(step == stepSize - 1 && remainingOutputs % 4 == 1)
+          a.movss(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+        else if(outputAligned)
+          a.movaps(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+        else
+          a.movups(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
       }
+      a.add(a.zdi(), imm(remainingOutputs * sizeof(float)));
     }
 
-    void Conv1DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler&, const TensorPointerXf& input,
-                                 [[maybe_unused]] const TensorPointerXf& output) const
+    void Conv1DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
     {
       ASSERT(input.rank() == 2);
       ASSERT(output.rank() == 2);
       ASSERT(input.dims(1) == p.weights->dims(1));
       ASSERT(output.dims(1) == p.weights->dims(2));
 
-      //const NetworkConstants& weights = constants[0];
+      const NetworkConstants& weights = constants[0];
+      const unsigned int outputBatchSize = this->outputBatchSize();
+      const unsigned int outputBatches = p.weights->dims(2) / outputBatchSize;
 
       // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
-      a.mov(a.zdi(), a.zsi());
+      loadAddress(a, a.zsi(), input.data());
+      loadAddress(a, a.zdi(), output.data());
+
+      // Begin loop over output positions
+      if(settings.useX64)
+        a.mov(x86::r8d, imm(output.dims(0)));
+      else
+        a.mov(a.ptr_zbp(-4, 4), imm(output.dims(0)));
+      Label positionLoop = a.newLabel();
+      a.bind(positionLoop);
+
+      // Load filter base address
+      a.lea(a.zbx(), x86::ptr(weights.label));
+
+      if(p.weights->dims(2) > outputBatchSize)
+      {
+        // Begin loop over output batches (only construct loop if it has more than one iteration)
+        Label outputBatchLoop;
+        if(outputBatches >= 2)
+        {
+          outputBatchLoop = a.newLabel();
+          a.mov(a.zax(), imm(outputBatches));
+          a.bind(outputBatchLoop);
+        }
+
+        compileOutputBatch(a, afHandler, outputBatchSize);
+
+        // End loop over output batches
+        if(outputBatches >= 2)
+        {
+          a.dec(a.zax());
+          a.jnz(outputBatchLoop);
+        }
+      }
+
+      const unsigned int remainingOutputs = p.weights->dims(2) == outputBatchSize ? outputBatchSize : p.weights->dims(2) % outputBatchSize;
+      if(remainingOutputs)
+        compileOutputBatch(a, afHandler, remainingOutputs);
+
+      // Set input offset to the next position, respecting the stride
+      a.add(a.zsi(), imm(p.stride * p.weights->dims(1) * sizeof(float)));
 
-      FAIL("Not implemented");
+      // End loop over output positions
+      if(settings.useX64)
+        a.dec(x86::r8d);
+      else
+        a.dec(a.ptr_zbp(-4, 4));
+      a.jnz(positionLoop);
     }
   }
 }
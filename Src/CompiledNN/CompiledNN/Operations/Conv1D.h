@@ -48,6 +48,18 @@ namespace NeuralNetwork
         ASSERT(inputDimensions.size() == 2);
         return {{(inputDimensions[0] - p.weights->dims(0) + p.stride) / p.stride, p.weights->dims(2)}};
       }
+
+    private:
+      /**
+       * Returns the number of output channels that are computed at once.
+       */
+      inline unsigned int outputBatchSize() const
+      {
+        return 4 * (settings.xmmRegs() - std::max(2u, ActivationFunctionHandler::neededSpares(p.postActivation)));
+      }
+
+      void compileFilter(x86::Assembler& a, bool inputAligned, unsigned int remainingOutputs, unsigned int remainingInput, bool lastFilter = false) const;
+      void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, unsigned int remainingOutputs) const;
     };
   }
 }
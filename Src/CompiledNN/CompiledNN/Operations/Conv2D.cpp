@@ -3,15 +3,91 @@
  */
 
 #include "Conv2D.h"
+#include "../Util/HalfFloat.h"
 #include "Platform/BHAssert.h"
 
 namespace NeuralNetwork
 {
   namespace CompiledNNImpl
   {
+    bool Conv2DCompiler::usesAVX() const
+    {
+      return settings.useAVX2 && !hasSimpleShape();
+    }
+
+    bool Conv2DCompiler::usesHalfWeights() const
+    {
+      return settings.useHalfPrecisionWeights && usesAVX();
+    }
+
+    bool Conv2DCompiler::hasSimpleShape() const
+    {
+      return p.weights->dims(3) <= 4 && p.weights->dims(1) * p.weights->dims(2) <= 4;
+    }
+
+    bool Conv2DCompiler::usesSimpleConvolution() const
+    {
+      // Small filters can also be computed like large ones
+      return hasSimpleShape() && p.padding == PaddingType::valid && variant == 0;
+    }
+
+    bool Conv2DCompiler::hasInplaceShape() const
+    {
+      // The SSE code writes whole vectors of four outputs, which must not overwrite the input of the next output pixel
+      return p.strides[0] >= p.weights->dims(0) && p.strides[1] >= p.weights->dims(1) && p.weights->dims(2) >= p.weights->dims(3) &&
+             (usesAVX() || p.strides[1] * p.weights->dims(2) >= (p.weights->dims(3) + 3) / 4 * 4);
+    }
+
+    std::vector<unsigned int> Conv2DCompiler::outputBatchSizes() const
+    {
+      const bool useAVX = usesAVX();
+      const unsigned int vectorSize = useAVX ? 8 : 4;
+      const unsigned int maxRegs = settings.xmmRegs() - std::max(std::max(useAVX && settings.useFMA3 && !usesHalfWeights() ? 1u : 2u, ActivationFunctionHandler::neededSpares(p.activationDesc)), ActivationFunctionHandler::neededSpares(p.postActivation));
+      const unsigned int outputRegs = (p.weights->dims(3) + vectorSize - 1) / vectorSize;
+
+      // Halve the number of registers as long as this changes the batches, but try at most three sizes
+      std::vector<unsigned int> sizes;
+      for(unsigned int regs = maxRegs, lastRegs = 0; regs && sizes.size() < 3; regs /= 2)
+        if(std::min(regs, outputRegs) != lastRegs)
+        {
+          sizes.push_back(regs * vectorSize);
+          lastRegs = std::min(regs, outputRegs);
+        }
+      if(hasInplaceShape() && p.weights->dims(3) <= sizes.front())
+        sizes.resize(1);
+      return sizes;
+    }
+
+    unsigned int Conv2DCompiler::variants() const
+    {
+      // Small filters can also be computed like large ones
+      return hasSimpleShape() && p.padding == PaddingType::valid ? 2 : static_cast<unsigned int>(outputBatchSizes().size());
+    }
+
+    std::string Conv2DCompiler::tuningKey() const
+    {
+      return "Conv2D " + std::to_string(p.weights->dims(0)) + "x" + std::to_string(p.weights->dims(1)) + "x" + std::to_string(p.weights->dims(2)) + "x" + std::to_string(p.weights->dims(3)) +
+             " strides " + std::to_string(p.strides[0]) + "x" + std::to_string(p.strides[1]) + (p.padding == PaddingType::same ? " same" : "") +
+             " activations " + std::to_string(static_cast<unsigned int>(p.activationDesc.id)) + "," + std::to_string(static_cast<unsigned int>(p.postActivation.id)) +
+             (p.batchNormalization ? " bn" : "");
+    }
+
     void Conv2DCompiler::initialize()
     {
-      outputBatchSize = 4 * (settings.xmmRegs() - std::max(std::max(2u, ActivationFunctionHandler::neededSpares(p.activationDesc)), ActivationFunctionHandler::neededSpares(p.postActivation)));
+      ASSERT(p.weights->rank() == 4);
+      ASSERT(variant < variants());
+      const bool simpleConvolution = usesSimpleConvolution();
+      const bool implicitBatchNormalization = p.batchNormalization && p.activationDesc == CompiledActivationFunctionId::linear;
+
+      const bool useAVX = usesAVX();
+      const unsigned int vectorSize = useAVX ? 8 : 4;
+      outputBatchSize = outputBatchSizes()[hasSimpleShape() ? 0 : variant];
+
+      const auto bias = [&](const unsigned int output)
+      {
+        const float b = p.biases ? (*p.biases)[output] : 0.f;
+        return implicitBatchNormalization ? b * (*p.batchNormalization->factor)[output] + (*p.batchNormalization->offset)[output] : b;
+      };
 
       // Declare constants
       constants.resize(2);
@@ -19,10 +95,10 @@ namespace NeuralNetwork
       // Store weights
       NetworkConstants& weights = constants[0];
       weights.data.clear();
-      ASSERT(p.weights->rank() == 4);
       for(unsigned int outputOffset = 0; outputOffset < p.weights->dims(3); outputOffset += outputBatchSize)
       {
         const unsigned int outputBatchEnd = std::min(outputOffset + outputBatchSize, p.weights->dims(3));
+        const std::size_t outputBatchBegin = weights.data.size();
 
         for(unsigned int y = 0; y < p.weights->dims(0); y++)
         {
@@ -30,6 +106,24 @@ namespace NeuralNetwork
           {
             const unsigned int remainingInputs = std::min(4u, p.weights->dims(1) * p.weights->dims(2) - input);
 
+            if(useAVX)
+            {
+              // The weights of each input are multiplied with the input broadcasted to all elements of a register
+              for(unsigned int i = 0; i < remainingInputs; i++)
+                for(unsigned int output = outputOffset; output < outputBatchEnd; output += 8)
+                {
+                  const unsigned int remainingOutputs = std::min(8u, outputBatchEnd - output);
+                  for(unsigned int j = 0; j < remainingOutputs; j++)
+                  {
+                    const float w = (*p.weights)[(y * p.weights->dims(1) * p.weights->dims(2) + input + i) * p.weights->dims(3) + output + j];
+                    weights.data.emplace_back(implicitBatchNormalization ? w * (*p.batchNormalization->factor)[output + j] : w);
+                  }
+                  for(unsigned int j = remainingOutputs; j < 8; j++)
+                    weights.data.emplace_back(0.f);
+                }
+              continue;
+            }
+
             for(unsigned int shuffle = remainingInputs; shuffle; --shuffle)
             {
               for(unsigned int output = outputOffset; output < outputBatchEnd; output += 4)
@@ -39,7 +133,7 @@ namespace NeuralNetwork
                 for(unsigned int i = 0; i < remainingOutputs; i++)
                 {
                   const float w = (*p.weights)[(y * p.weights->dims(1) * p.weights->dims(2) + (input + ((remainingInputs - shuffle + i) % remainingInputs))) * p.weights->dims(3) + output + i];
-                  if(p.batchNormalization && p.activationDesc == CompiledActivationFunctionId::linear)
+                  if(implicitBatchNormalization)
                     weights.data.emplace_back(w * (*p.batchNormalization->factor)[output + i]);
                   else
                     weights.data.emplace_back(w);
@@ -50,22 +144,47 @@ namespace NeuralNetwork
             }
           }
         }
+
+        // Only the weights are converted to half precision floats, the biases remain floats
+        if(usesHalfWeights())
+          packHalves(weights.data, outputBatchBegin);
+
+        // The weights of each output batch are followed by its biases (and the batch normalization if it cannot be done implicitly)
+        if(!simpleConvolution)
+        {
+          const unsigned int paddedOutputBatchEnd = outputOffset + (outputBatchEnd - outputOffset + vectorSize - 1) / vectorSize * vectorSize;
+          for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+            weights.data.emplace_back(output < outputBatchEnd ? bias(output) : 0.f);
+          if(p.batchNormalization && !implicitBatchNormalization)
+          {
+            for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+              weights.data.emplace_back(output < outputBatchEnd ? (*p.batchNormalization->factor)[output] : 0.f);
+            for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+              weights.data.emplace_back(output < outputBatchEnd ? (*p.batchNormalization->offset)[output] : 0.f);
+          }
+        }
       }
 
-      // Store biases
-      NetworkConstants& biases = constants[1];
-      if(p.biases)
-        biases.data = *p.biases;
-      else
-        biases.data.resize(p.weights->dims(3), 0.f);
-      if(p.batchNormalization && p.activationDesc == CompiledActivationFunctionId::linear)
+      if(!simpleConvolution)
       {
-        for(size_t i = 0; i < biases.data.size(); i++)
-          biases.data[i] = biases.data[i] * (*p.batchNormalization->factor)[i] + (*p.batchNormalization->offset)[i];
+        // The mask to store the outputs of the last (partial) register
+        if(useAVX && p.weights->dims(3) % 8)
+        {
+          constants[1].data.assign(8, 0.f);
+          for(unsigned int i = 0; i < p.weights->dims(3) % 8; i++)
+            constants[1].data[i] = -0.f;
+        }
+        return;
       }
 
+      // Store biases
+      NetworkConstants& biases = constants[1];
+      biases.data.assign(p.weights->dims(3), 0.f);
+      for(unsigned int output = 0; output < p.weights->dims(3); output++)
+        biases.data[output] = bias(output);
+
       // If implicit Batch Normalization is not possible, store the normalization constants
-      if(p.batchNormalization && p.activationDesc != CompiledActivationFunctionId::linear)
+      if(p.batchNormalization && !implicitBatchNormalization)
       {
         constants.resize(4);
         constants[2].data = *p.batchNormalization->factor;
@@ -126,9 +245,8 @@ namespace NeuralNetwork
       a.add(a.zbx(), imm(filterOffset));
     }
 
-    void Conv2DCompiler::compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int inputWidth, const unsigned int remainingOutputs) const
+    void Conv2DCompiler::compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const x86::Gp& window, const unsigned int inputWidth, const unsigned int remainingOutputs) const
     {
-      const NetworkConstants& biases = constants[1];
       const bool inputAligned = p.weights->dims(2) % 4 == 0;
       const bool outputAligned = p.weights->dims(3) % 4 == 0;
       const unsigned int stepSize = (remainingOutputs + 3) / 4;
@@ -170,7 +288,7 @@ namespace NeuralNetwork
           postActivationFn->addSpare(x86::xmm(i));
 
       // Load input base address in zdx
-      a.mov(a.zdx(), a.zsi());
+      a.mov(a.zdx(), window);
 
       // Initialize filter result
       for(unsigned int step = 0; step < stepSize; step++)
@@ -223,14 +341,15 @@ namespace NeuralNetwork
         a.jnz(filterRowLoop);
       }
 
-      // Add bias
+      // Add bias (which follows the weights of this output batch)
       for(unsigned int step = 0; step < stepSize; step++)
       {
         if(step == stepSize - 1 && remainingOutputs % 4 == 1)
-          a.addss(x86::xmm(step), x86::ptr(biases.label, biasOffset + step * 4 * sizeof(float)));
+          a.addss(x86::xmm(step), a.ptr_zbx(step * 4 * sizeof(float)));
         else
-          a.addps(x86::xmm(step), x86::ptr(biases.label, biasOffset + step * 4 * sizeof(float)));
+          a.addps(x86::xmm(step), a.ptr_zbx(step * 4 * sizeof(float)));
       }
+      unsigned int constantsSize = stepSize * 4 * sizeof(float);
 
       // Apply activation function
       if(!activationFnInitialized)
@@ -240,38 +359,40 @@ namespace NeuralNetwork
       // Apply Batch Normalization if it could not be done implicitly
       if(p.activationDesc != CompiledActivationFunctionId::linear && p.batchNormalization)
       {
-        ASSERT(constants.size() == 4);
-
         // Multiply with factors
         for(unsigned int step = 0; step < stepSize; step++)
         {
           if(step == stepSize - 1 && remainingOutputs % 4 == 1)
-            a.mulss(x86::xmm(step), x86::ptr(constants[2].label, biasOffset + step * 4 * sizeof(float)));
+            a.mulss(x86::xmm(step), a.ptr_zbx(constantsSize + step * 4 * sizeof(float)));
           else
-            a.mulps(x86::xmm(step), x86::ptr(constants[2].label, biasOffset + step * 4 * sizeof(float)));
+            a.mulps(x86::xmm(step), a.ptr_zbx(constantsSize + step * 4 * sizeof(float)));
         }
+        constantsSize += stepSize * 4 * sizeof(float);
 
         // Add offsets
         for(unsigned int step = 0; step < stepSize; step++)
         {
           if(step == stepSize - 1 && remainingOutputs % 4 == 1)
-            a.addss(x86::xmm(step), x86::ptr(constants[3].label, biasOffset + step * 4 * sizeof(float)));
+            a.addss(x86::xmm(step), a.ptr_zbx(constantsSize + step * 4 * sizeof(float)));
           else
-            a.addps(x86::xmm(step), x86::ptr(constants[3].label, biasOffset + step * 4 * sizeof(float)));
+            a.addps(x86::xmm(step), a.ptr_zbx(constantsSize + step * 4 * sizeof(float)));
         }
+        constantsSize += stepSize * 4 * sizeof(float);
       }
-      biasOffset += stepSize * 4 * sizeof(float);
+      a.add(a.zbx(), imm(constantsSize));
 
       // Apply post activation function
       if(!postActivationFnInitialized)
         postActivationFn->initialize(a);
       postActivationFn->apply(a);
 
-      // Store output
+      // Store output (the last register is stored exactly if the outputs behind it may belong to another part)
       for(unsigned int step = 0; step < stepSize; step++)
       {
         if(step == stepSize - 1 && remainingOutputs % 4 == 1)
           a.movss(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+        else if(step == stepSize - 1 && remainingOutputs % 4 && splitIntoParts)
+          storePartialVector(a, a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step), remainingOutputs % 4, false);
         else if(outputAligned)
           a.movaps(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
         else
@@ -280,6 +401,168 @@ namespace NeuralNetwork
       a.add(a.zdi(), imm(remainingOutputs * sizeof(float)));
     }
 
+    void Conv2DCompiler::compileFilterAVX(x86::Assembler& a, const unsigned int stepSize, const unsigned int accumulatorSets, const unsigned int inputs, const bool lastFilter) const
+    {
+      const x86::Ymm input = x86::ymm(settings.xmmRegs() - 1);
+      const x86::Ymm product = x86::ymm(settings.xmmRegs() - 2);
+      const bool halfWeights = usesHalfWeights();
+
+      // Multiply each input with the weights of all outputs, alternating between the sets of accumulators
+      unsigned int filterOffset = 0;
+      for(unsigned int i = 0; i < inputs; i++)
+      {
+        a.vbroadcastss(input, a.ptr_zdx(i * sizeof(float), 4));
+        for(unsigned int step = 0; step < stepSize; step++)
+        {
+          const x86::Ymm accumulator = x86::ymm((i % accumulatorSets) * stepSize + step);
+          if(halfWeights)
+          {
+            a.vcvtph2ps(product, a.ptr_zbx(filterOffset));
+            if(settings.useFMA3)
+              a.vfmadd231ps(accumulator, input, product);
+            else
+            {
+              a.vmulps(product, product, input);
+              a.vaddps(accumulator, accumulator, product);
+            }
+          }
+          else if(settings.useFMA3)
+            a.vfmadd231ps(accumulator, input, a.ptr_zbx(filterOffset));
+          else
+          {
+            a.vmulps(product, input, a.ptr_zbx(filterOffset));
+            a.vaddps(accumulator, accumulator, product);
+          }
+          filterOffset += 8 * (halfWeights ? sizeof(std::uint16_t) : sizeof(float));
+        }
+      }
+      if(!lastFilter)
+        a.add(a.zdx(), imm(4 * sizeof(float)));
+      a.add(a.zbx(), imm(filterOffset));
+    }
+
+    void Conv2DCompiler::compileOutputBatchAVX(x86::Assembler& a, ActivationFunctionHandler& afHandler, const x86::Gp& window, const unsigned int inputWidth, const unsigned int remainingOutputs) const
+    {
+      const unsigned int stepSize = (remainingOutputs + 7) / 8;
+      const x86::Ymm spare = x86::ymm(settings.xmmRegs() - 1);
+
+      // Use independent sets of accumulators for consecutive inputs if there are enough registers, such that the latency of the additions is hidden
+      const unsigned int accumulatorSets = std::max(1u, std::min(4u, (settings.xmmRegs() - (settings.useFMA3 && !usesHalfWeights() ? 1 : 2)) / stepSize));
+
+      // Load input base address in zdx
+      a.mov(a.zdx(), window);
+
+      // Initialize filter result
+      for(unsigned int i = 0; i < accumulatorSets * stepSize; i++)
+        a.vxorps(x86::ymm(i), x86::ymm(i), x86::ymm(i));
+
+      const bool filterRowLoopNeeded = p.weights->dims(0) > 1;
+      const bool filterColLoopNeeded = (p.weights->dims(1) * p.weights->dims(2) / 4) > 1;
+
+      // Begin loop over weight rows
+      Label filterRowLoop;
+      if(filterRowLoopNeeded)
+      {
+        filterRowLoop = a.newLabel();
+        a.mov(filterColLoopNeeded ? a.zax() : a.zcx(), imm(p.weights->dims(0)));
+        a.bind(filterRowLoop);
+      }
+
+      if(p.weights->dims(1) * p.weights->dims(2) > 4)
+      {
+        // Begin loop over weight cols
+        Label filterColLoop;
+        if(filterColLoopNeeded)
+        {
+          filterColLoop = a.newLabel();
+          a.mov(a.zcx(), imm(p.weights->dims(1) * p.weights->dims(2) / 4));
+          a.bind(filterColLoop);
+        }
+
+        compileFilterAVX(a, stepSize, accumulatorSets, 4, false);
+
+        // End loop over weight cols
+        if(filterColLoopNeeded)
+        {
+          a.dec(a.zcx());
+          a.jnz(filterColLoop);
+        }
+      }
+
+      const unsigned int remainingInput = p.weights->dims(1) * p.weights->dims(2) == 4 ? 4 : ((p.weights->dims(1) * p.weights->dims(2)) % 4);
+      if(remainingInput)
+        compileFilterAVX(a, stepSize, accumulatorSets, remainingInput, true);
+
+      // End loop over weight rows
+      if(filterRowLoopNeeded)
+      {
+        // Set input pointer to next row
+        a.add(a.zdx(), imm(((inputWidth - p.weights->dims(1)) * p.weights->dims(2) + remainingInput) * sizeof(float)));
+
+        a.dec(filterColLoopNeeded ? a.zax() : a.zcx());
+        a.jnz(filterRowLoop);
+      }
+
+      // Sum up the sets of accumulators
+      for(unsigned int set = 1; set < accumulatorSets; set++)
+        for(unsigned int step = 0; step < stepSize; step++)
+          a.vaddps(x86::ymm(step), x86::ymm(step), x86::ymm(set * stepSize + step));
+
+      // Add bias (which follows the weights of this output batch)
+      for(unsigned int step = 0; step < stepSize; step++)
+        a.vaddps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(step * 8 * sizeof(float)));
+      unsigned int constantsSize = stepSize * 8 * sizeof(float);
+
+      // Apply activation function
+      if(p.activationDesc != CompiledActivationFunctionId::linear)
+      {
+        ActivationFn& activationFunction = afHandler.prepareAVX(p.activationDesc, a, {}, {});
+        for(unsigned int step = 0; step < stepSize; step++)
+          activationFunction.addValue(x86::ymm(step));
+        for(unsigned int step = stepSize; step < settings.xmmRegs(); step++)
+          activationFunction.addSpare(x86::ymm(step));
+        activationFunction.initialize(a);
+        activationFunction.apply(a);
+      }
+
+      // Apply Batch Normalization if it could not be done implicitly
+      if(p.activationDesc != CompiledActivationFunctionId::linear && p.batchNormalization)
+      {
+        for(unsigned int step = 0; step < stepSize; step++)
+          a.vmulps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(constantsSize + step * 8 * sizeof(float)));
+        constantsSize += stepSize * 8 * sizeof(float);
+        for(unsigned int step = 0; step < stepSize; step++)
+          a.vaddps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(constantsSize + step * 8 * sizeof(float)));
+        constantsSize += stepSize * 8 * sizeof(float);
+      }
+      a.add(a.zbx(), imm(constantsSize));
+
+      // Apply post activation function
+      if(p.postActivation != CompiledActivationFunctionId::linear)
+      {
+        ActivationFn& activationFunction = afHandler.prepareAVX(p.postActivation, a, {}, {});
+        for(unsigned int step = 0; step < stepSize; step++)
+          activationFunction.addValue(x86::ymm(step));
+        for(unsigned int step = stepSize; step < settings.xmmRegs(); step++)
+          activationFunction.addSpare(x86::ymm(step));
+        activationFunction.initialize(a);
+        activationFunction.apply(a);
+      }
+
+      // Store output (the last register is stored with a mask, such that no memory after the output is written)
+      for(unsigned int step = 0; step < stepSize; step++)
+      {
+        if(step == stepSize - 1 && remainingOutputs % 8)
+        {
+          a.vmovups(spare, x86::ptr(constants[1].label));
+          a.vmaskmovps(a.ptr_zdi(step * 8 * sizeof(float)), spare, x86::ymm(step));
+        }
+        else
+          a.vmovups(a.ptr_zdi(step * 8 * sizeof(float)), x86::ymm(step));
+      }
+      a.add(a.zdi(), imm(remainingOutputs * sizeof(float)));
+    }
+
     void Conv2DCompiler::compileSimpleConvolution(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int inputWidth, const unsigned int outputHeight, const unsigned int outputWidth) const
     {
       const unsigned int inputSize = p.weights->dims(1) * p.weights->dims(2);
@@ -459,6 +742,8 @@ namespace NeuralNetwork
       // Store result
       if(p.weights->dims(3) == 1)
         a.movss(a.ptr_zdi(), x86::xmm0);
+      else if(p.weights->dims(3) < 4 && splitIntoParts)
+        storePartialVector(a, a.ptr_zdi(), x86::xmm0, p.weights->dims(3), false);
       else if(p.weights->dims(3) == 4)
         a.movaps(a.ptr_zdi(), x86::xmm0);
       else
@@ -483,50 +768,53 @@ namespace NeuralNetwork
       }
     }
 
-    void Conv2DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    void Conv2DCompiler::compileWindows(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                        const unsigned int rowBegin, const unsigned int rowEnd) const
     {
-      ASSERT(input.rank() == 3);
-      ASSERT(output.rank() == 3);
-      ASSERT(input.dims(2) == p.weights->dims(2));
-      ASSERT(output.dims(2) == p.weights->dims(3));
+      const SlidingWindow window({{p.weights->dims(0), p.weights->dims(1)}}, {{1, 1}}, p.strides, p.padding, input, output);
 
-      const NetworkConstants& weights = constants[0];
-      unsigned int inputWidth = input.dims(1);
-
-      // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
+      // Load input/output base addresses (the window of the first pixel may begin before the first input row that the range covers)
+      const unsigned int inputRow = window.firstInputRow(rowBegin);
+      loadAddress(a, a.zsi(), input.data() + inputRow * input.dims(1) * input.dims(2));
       if(input.data() == output.data())
         a.mov(a.zdi(), a.zsi());
       else
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data() + rowBegin * output.dims(1) * output.dims(2));
+      const long long inputOffset = window.inputOffset(rowBegin) - static_cast<long long>(inputRow * input.dims(1) * input.dims(2) * sizeof(float));
+      if(inputOffset)
+        a.add(a.zsi(), imm(inputOffset));
 
-      if(p.weights->dims(3) <= 4 && p.weights->dims(1) * p.weights->dims(2) <= 4)
-        compileSimpleConvolution(a, afHandler, inputWidth, output.dims(0), output.dims(1));
-      else
+      if(window.isPadded())
+        window.reserveBuffer(a);
+
+      compileWindowLoops(a, afHandler, window, input.dims(1), rowBegin, rowEnd);
+
+      if(window.isPadded())
+        window.releaseBuffer(a);
+
+      // Avoid the penalty of mixing the upper halves of the ymm registers with SSE instructions
+      if(usesAVX())
+        a.vzeroupper();
+    }
+
+    void Conv2DCompiler::compileWindowLoops(x86::Assembler& a, ActivationFunctionHandler& afHandler, const SlidingWindow& window, const unsigned int inputWidth,
+                                            const unsigned int rowBegin, const unsigned int rowEnd) const
+    {
+      const NetworkConstants& weights = constants[0];
+      const bool useAVX = usesAVX();
+
+      window.compileLoops(a, settings.useX64, rowBegin, rowEnd, [&](const SlidingWindow::Borders& borders)
       {
-        // Begin loop over output image rows
-        if(settings.useX64)
-          a.mov(x86::r8d, imm(output.dims(0)));
-        else
-          a.mov(a.ptr_zbp(-4, 4), imm(output.dims(0)));
-        Label inputRowLoop = a.newLabel();
-        a.bind(inputRowLoop);
-
-        // Begin loop over output image cols
-        if(p.weights->dims(3) / outputBatchSize < 2 && p.weights->dims(1) * p.weights->dims(2) <= 4)
-          a.mov(a.zax(), imm(output.dims(1)));
-        else if(settings.useX64)
-          a.mov(x86::r9d, imm(output.dims(1)));
-        else
-          a.mov(a.ptr_zbp(-8, 4), imm(output.dims(1)));
-        Label inputColLoop = a.newLabel();
-        a.bind(inputColLoop);
+        // Windows that lie partially outside of the input are computed from a padded copy
+        const bool padded = borders != SlidingWindow::Borders();
+        if(padded)
+          window.compileGather(a, borders, useAVX);
+        const x86::Gp inputWindow = padded ? a.zsp() : a.zsi();
+        const unsigned int windowWidth = padded ? window.bufferWidth() : inputWidth;
 
         // Load filter base address
         a.lea(a.zbx(), x86::ptr(weights.label));
 
-        biasOffset = 0;
-
         if(p.weights->dims(3) > outputBatchSize)
         {
           // Begin loop over output batches (only construct loop if it has more than one iteration)
@@ -546,7 +834,10 @@ namespace NeuralNetwork
             a.bind(outputBatchLoop);
           }
 
-          compileOutputBatch(a, afHandler, inputWidth, outputBatchSize);
+          if(useAVX)
+            compileOutputBatchAVX(a, afHandler, inputWindow, windowWidth, outputBatchSize);
+          else
+            compileOutputBatch(a, afHandler, inputWindow, windowWidth, outputBatchSize);
 
           // End loop over output batches
           if(p.weights->dims(3) / outputBatchSize >= 2)
@@ -566,31 +857,36 @@ namespace NeuralNetwork
 
         const unsigned int remainingOutputs = p.weights->dims(3) == outputBatchSize ? outputBatchSize : p.weights->dims(3) % outputBatchSize;
         if(remainingOutputs)
-          compileOutputBatch(a, afHandler, inputWidth, remainingOutputs);
+        {
+          if(useAVX)
+            compileOutputBatchAVX(a, afHandler, inputWindow, windowWidth, remainingOutputs);
+          else
+            compileOutputBatch(a, afHandler, inputWindow, windowWidth, remainingOutputs);
+        }
+      });
+    }
 
-        // Set input offset to next column, respecting the stride
-        a.add(a.zsi(), imm(p.strides[1] * p.weights->dims(2) * sizeof(float)));
+    void Conv2DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    {
+      ASSERT(input.rank() == 3);
+      ASSERT(output.rank() == 3);
+      ASSERT(input.dims(2) == p.weights->dims(2));
+      ASSERT(output.dims(2) == p.weights->dims(3));
 
-        // End loop over output image cols
-        if(p.weights->dims(3) / outputBatchSize < 2 && p.weights->dims(1) * p.weights->dims(2) <= 4)
-          a.dec(a.zax());
-        else if(settings.useX64)
-          a.dec(x86::r9d);
-        else
-          a.dec(a.ptr_zbp(-8, 4));
-        a.jnz(inputColLoop);
+      if(!usesSimpleConvolution())
+      {
+        compileWindows(a, afHandler, input, output, 0, output.dims(0));
+        return;
+      }
 
-        // Set input offset to next row, respecting the stride
-        if(p.strides[0] * inputWidth != output.dims(1) * p.strides[1])
-          a.add(a.zsi(), imm((p.strides[0] * inputWidth - output.dims(1) * p.strides[1]) * p.weights->dims(2) * sizeof(float)));
+      // Load input/output base addresses
+      loadAddress(a, a.zsi(), input.data());
+      if(input.data() == output.data())
+        a.mov(a.zdi(), a.zsi());
+      else
+        loadAddress(a, a.zdi(), output.data());
 
-        // End loop over output image rows
-        if(settings.useX64)
-          a.dec(x86::r8d);
-        else
-          a.dec(a.ptr_zbp(-4, 4));
-        a.jnz(inputRowLoop);
-      }
+      compileSimpleConvolution(a, afHandler, input.dims(1), output.dims(0), output.dims(1));
     }
   }
 }
@@ -6,6 +6,7 @@
 
 #include "../ActivationFunctions.h"
 #include "../CompiledNNImplBase.h"
+#include "../Util/SlidingWindow.h"
 #include "BatchNormalization.h"
 
 namespace NeuralNetwork
@@ -20,6 +21,7 @@ namespace NeuralNetwork
         const Tensor<float, 1>* weights;
         const std::vector<float>* biases;
         std::array<unsigned int, 2> strides;
+        PaddingType padding = PaddingType::valid; /**< The same padding is added implicitly to the windows at the borders of the input. */
         ActivationFunctionDescriptor activationDesc;
         ActivationFunctionDescriptor postActivation;
 
@@ -29,6 +31,7 @@ namespace NeuralNetwork
                  weights == other.weights &&
                  biases == other.biases &&
                  strides == other.strides &&
+                 padding == other.padding &&
                  activationDesc == other.activationDesc &&
                  postActivation == other.postActivation;
         }
@@ -39,25 +42,115 @@ namespace NeuralNetwork
 
       inline bool canBeInplace() const override
       {
-        return p.strides[0] >= p.weights->dims(0) && p.strides[1] >= p.weights->dims(1) && p.weights->dims(2) >= p.weights->dims(3);
+        // Each batch of outputs reads the whole input pixel, so the outputs must not be split into multiple batches
+        return p.padding == PaddingType::valid && hasInplaceShape() && p.weights->dims(3) <= outputBatchSizes().front();
       }
 
+      inline unsigned int maxParts(const TensorPointerXf& input, const TensorPointerXf& output) const override
+      {
+        return rowParts(input, output, p.strides[0]);
+      }
+
+      inline void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                              const unsigned int part, const unsigned int parts) const override
+      {
+        if(parts == 1)
+        {
+          compile(a, afHandler, input, output);
+          return;
+        }
+        const std::array<unsigned int, 2> rows = partRows(input, output, p.strides[0], part, parts);
+        if(rows[0] < rows[1])
+          compileRowRange(a, afHandler, input, output, rows[0], rows[1]);
+      }
+
+      inline RowWindow rowWindow() const override
+      {
+        return {p.weights->dims(0), p.strides[0], p.padding};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        // With implicit padding, the whole input is needed to determine which of the windows lie outside of it
+        if(p.padding == PaddingType::valid)
+          compileRows(a, afHandler, input, output, p.weights->dims(0), p.strides[0], rowBegin, rowEnd);
+        else
+          compileWindows(a, afHandler, input, output, rowBegin, rowEnd);
+      }
+
+      unsigned int variants() const override;
+      std::string tuningKey() const override;
+
       void initialize() override;
       void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
 
       inline std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>& inputDimensions) const override
       {
-        ASSERT(inputDimensions.size() == 3);
-        return {{(inputDimensions[0] - p.weights->dims(0) + p.strides[0]) / p.strides[0], (inputDimensions[1] - p.weights->dims(1) + p.strides[1]) / p.strides[1], p.weights->dims(3)}};
+        return SlidingWindow::outputDimensions({{p.weights->dims(0), p.weights->dims(1)}}, p.strides, p.padding, inputDimensions, p.weights->dims(3));
       }
 
     private:
-      mutable unsigned int biasOffset = 0;
       unsigned int outputBatchSize = 0;
 
+      /**
+       * Checks whether the outputs are computed in ymm registers (8 floats per register instead of 4).
+       * Small convolutions remain in xmm registers.
+       */
+      bool usesAVX() const;
+
+      /**
+       * Checks whether the weights are stored as half precision floats (only in the AVX code).
+       */
+      bool usesHalfWeights() const;
+
+      /**
+       * Checks whether the filter is so small that all outputs can be computed at once (in which case the outputs are not split into batches).
+       */
+      bool hasSimpleShape() const;
+
+      /**
+       * Checks whether the filter is small and the outputs are computed with the code that keeps the inputs of a whole filter in registers (which needs the input to be padded).
+       */
+      bool usesSimpleConvolution() const;
+
+      /**
+       * Checks whether the outputs of a pixel can overwrite its inputs without overwriting the inputs of other pixels.
+       */
+      bool hasInplaceShape() const;
+
+      /**
+       * Returns the sizes of the output batches among which the autotuner can choose (the default size that uses all available registers first).
+       * Smaller batches leave registers for independent sets of accumulators.
+       * If the operation can be computed in place, only the size that computes all outputs at once is allowed.
+       */
+      std::vector<unsigned int> outputBatchSizes() const;
+
       void compileFilter(x86::Assembler& a, const bool inputAligned, const unsigned int remainingOutputs, const unsigned int remainingInput, const bool lastFilter = false) const;
-      void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int inputWidth, const unsigned int remainingOutputs) const;
+      void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const x86::Gp& window, const unsigned int inputWidth, const unsigned int remainingOutputs) const;
+      void compileFilterAVX(x86::Assembler& a, const unsigned int stepSize, const unsigned int accumulatorSets, const unsigned int inputs, const bool lastFilter) const;
+      void compileOutputBatchAVX(x86::Assembler& a, ActivationFunctionHandler& afHandler, const x86::Gp& window, const unsigned int inputWidth, const unsigned int remainingOutputs) const;
       void compileSimpleConvolution(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int inputWidth, const unsigned int outputHeight, const unsigned int outputWidth) const;
+
+      /**
+       * Emits the code that computes a range of output rows with the output batches (the windows at the borders are copied to a padded buffer).
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       */
+      void compileWindows(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                          const unsigned int rowBegin, const unsigned int rowEnd) const;
+
+      /**
+       * Emits the loops of compileWindows. zsi must point to the window of the first pixel and zdi to its output.
+       * The buffer of the window must have been reserved if it is padded.
+       * @param inputWidth The number of columns of the input.
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       */
+      void compileWindowLoops(x86::Assembler& a, ActivationFunctionHandler& afHandler, const SlidingWindow& window, const unsigned int inputWidth,
+                              const unsigned int rowBegin, const unsigned int rowEnd) const;
+
+      friend struct SeparableConv2DCompiler;
     };
   }
 }
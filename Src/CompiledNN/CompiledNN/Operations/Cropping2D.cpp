@@ -21,8 +21,8 @@ namespace NeuralNetwork
       const bool outputAligned = output.dims(1) * output.dims(2) % 4 == 0;
 
       // Crop image
-      a.mov(a.zsi(), imm(input.data() + (p.cropping[Cropping2DLayer::TOP] * output.dims(1) + p.cropping[Cropping2DLayer::LEFT]) * output.dims(2)));
-      a.mov(a.zdi(), imm(output.data()));
+      loadAddress(a, a.zsi(), input.data() + (p.cropping[Cropping2DLayer::TOP] * output.dims(1) + p.cropping[Cropping2DLayer::LEFT]) * output.dims(2));
+      loadAddress(a, a.zdi(), output.data());
 
       a.mov(a.zax(), imm(output.dims(0)));
       Label copyLoop = a.newLabel();
@@ -127,9 +127,9 @@ namespace NeuralNetwork
       a.add(a.zbx(), imm(filterOffset));
     }
 
-    void DConv2DCompiler::compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int inputWidth, const unsigned int remainingOutputs) const
+    void DConv2DCompiler::compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const x86::Gp& window, const unsigned int inputWidth, const unsigned int outputOffset, const unsigned int remainingOutputs) const
     {
-      const bool inputAligned = (p.strides[1] * p.weights->dims(2)) % 4 == 0;
+      const bool inputAligned = p.weights->dims(2) % 4 == 0;
       const bool outputAligned = p.weights->dims(2) % 4 == 0;
       const unsigned int stepSize = (remainingOutputs + 3) / 4;
 
@@ -151,8 +151,11 @@ namespace NeuralNetwork
         for(unsigned int i = stepSize; i < settings.xmmRegs(); i++)
           activationFn.addSpare(x86::xmm(i));
 
-      // Load input base address in zdx
-      a.mov(a.zdx(), a.zsi());
+      // Load input base address of this output batch in zdx
+      if(outputOffset)
+        a.lea(a.zdx(), x86::ptr(window, outputOffset * sizeof(float)));
+      else
+        a.mov(a.zdx(), window);
 
       // Initialize filter result
       for(unsigned int step = 0; step < stepSize; step++)
@@ -169,12 +172,17 @@ namespace NeuralNetwork
       a.bind(filterColLoop);
       compileFilter(a, inputAligned, remainingOutputs, remainingOutputs, false);
 
+      // Set input pointer to next col (compileFilter advanced it by the registers of this batch)
+      const int colOffset = static_cast<int>(p.dilation[1] * p.weights->dims(2)) - static_cast<int>(stepSize * 4);
+      if(colOffset)
+        a.add(a.zdx(), imm(colOffset * static_cast<int>(sizeof(float))));
+
       // End loop over weight cols
       a.dec(a.zcx());
       a.jnz(filterColLoop);
 
       // Set input pointer to next row
-      a.add(a.zdx(), imm(((inputWidth - p.weights->dims(1)) * p.weights->dims(2) + 0) * sizeof(float)));
+      a.add(a.zdx(), imm((p.dilation[0] * inputWidth - p.weights->dims(1) * p.dilation[1]) * p.weights->dims(2) * sizeof(float)));
 
       // End loop over weight rows
       a.dec(a.zax());
@@ -187,11 +195,10 @@ namespace NeuralNetwork
         for(unsigned int step = 0; step < stepSize; step++)
         {
           if(step == stepSize - 1 && remainingOutputs % 4 == 1)
-            a.addss(x86::xmm(step), x86::ptr(biases.label, biasOffset + step * 4 * sizeof(float)));
+            a.addss(x86::xmm(step), x86::ptr(biases.label, (outputOffset + step * 4) * sizeof(float)));
           else
-            a.addps(x86::xmm(step), x86::ptr(biases.label, biasOffset + step * 4 * sizeof(float)));
+            a.addps(x86::xmm(step), x86::ptr(biases.label, (outputOffset + step * 4) * sizeof(float)));
         }
-        biasOffset += stepSize * 4 * sizeof(float);
       }
 
       // Apply activation function
@@ -199,11 +206,13 @@ namespace NeuralNetwork
         activationFn.initialize(a);
       activationFn.apply(a);
 
-      // Store output
+      // Store output (the last register is stored exactly if the outputs behind it may belong to another part)
       for(unsigned int step = 0; step < stepSize; step++)
       {
         if(step == stepSize - 1 && remainingOutputs % 4 == 1)
           a.movss(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+        else if(step == stepSize - 1 && remainingOutputs % 4 && splitIntoParts)
+          storePartialVector(a, a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step), remainingOutputs % 4, false);
         else if(outputAligned)
           a.movaps(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
         else
@@ -299,7 +308,7 @@ namespace NeuralNetwork
             if(inputSize < 4)
               a.pshufd(x86::xmm(regOffset + filterRow * inputSize), x86::xmm(regOffset + filterRow * inputSize), imm(0u | ((1 % inputSize) << 2) | ((2 % inputSize) << 4) | ((3 % inputSize) << 6)));
           }
-          sourceOffset += (inputWidth * p.weights->dims(2)) * sizeof(float);
+          sourceOffset += (p.dilation[0] * inputWidth * p.weights->dims(2)) * sizeof(float);
         }
         for(unsigned int i = 1; i < inputSize; i++)
         {
@@ -363,6 +372,8 @@ namespace NeuralNetwork
       // Store result
       if(p.weights->dims(2) == 1)
         a.movss(a.ptr_zdi(), x86::xmm0);
+      else if(p.weights->dims(2) < 4 && splitIntoParts)
+        storePartialVector(a, a.ptr_zdi(), x86::xmm0, p.weights->dims(2), false);
       else if(p.weights->dims(2) == 4)
         a.movaps(a.ptr_zdi(), x86::xmm0);
       else
@@ -386,113 +397,75 @@ namespace NeuralNetwork
       }
     }
 
-    void DConv2DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    void DConv2DCompiler::compileWindows(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                         const unsigned int rowBegin, const unsigned int rowEnd) const
     {
-      ASSERT(input.rank() == 3);
-      ASSERT(output.rank() == 3);
-      ASSERT(input.dims(2) == p.weights->dims(2));
-      ASSERT(output.dims(2) == p.weights->dims(2) * p.weights->dims(3));
+      const SlidingWindow window({{p.weights->dims(0), p.weights->dims(1)}}, p.dilation, p.strides, p.padding, input, output);
 
-      const NetworkConstants& weights = constants[0];
-      unsigned int inputWidth = input.dims(1);
-
-      // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
+      // Load input/output base addresses (the window of the first pixel may begin before the first input row that the range covers)
+      const unsigned int inputRow = window.firstInputRow(rowBegin);
+      loadAddress(a, a.zsi(), input.data() + inputRow * input.dims(1) * input.dims(2));
       if(input.data() == output.data())
         a.mov(a.zdi(), a.zsi());
       else
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data() + rowBegin * output.dims(1) * output.dims(2));
+      const long long inputOffset = window.inputOffset(rowBegin) - static_cast<long long>(inputRow * input.dims(1) * input.dims(2) * sizeof(float));
+      if(inputOffset)
+        a.add(a.zsi(), imm(inputOffset));
 
-      if(p.weights->dims(2) <= 4 && p.weights->dims(1) * p.weights->dims(2) <= 4)
-        compileSimpleConvolution(a, afHandler, inputWidth, output.dims(0), output.dims(1));
-      else
-      {
-        // Begin loop over output image rows
-        if(settings.useX64)
-          a.mov(x86::r8d, imm(output.dims(0)));
-        else
-          a.mov(a.ptr_zbp(-4, 4), imm(output.dims(0)));
-        Label inputRowLoop = a.newLabel();
-        a.bind(inputRowLoop);
-
-        // Begin loop over output image cols
-        if(p.weights->dims(2) / outputBatchSize < 2 && p.weights->dims(1) * p.weights->dims(2) <= 4)
-          a.mov(a.zax(), imm(output.dims(1)));
-        else if(settings.useX64)
-          a.mov(x86::r9d, imm(output.dims(1)));
-        else
-          a.mov(a.ptr_zbp(-8, 4), imm(output.dims(1)));
-        Label inputColLoop = a.newLabel();
-        a.bind(inputColLoop);
+      if(window.isPadded())
+        window.reserveBuffer(a);
 
-        // Load filter base address
-        a.lea(a.zbx(), x86::ptr(weights.label));
+      compileWindowLoops(a, afHandler, window, input.dims(1), rowBegin, rowEnd);
 
-        biasOffset = 0;
+      if(window.isPadded())
+        window.releaseBuffer(a);
+    }
 
-        if(p.weights->dims(2) > outputBatchSize)
-        {
-          // Begin loop over output batches (only construct loop if it has more than one iteration)
-          Label outputBatchLoop;
-          if(p.weights->dims(2) / outputBatchSize >= 2)
-          {
-            outputBatchLoop = a.newLabel();
-            if(p.weights->dims(1) * p.weights->dims(2) > 4)
-            {
-              if(settings.useX64)
-                a.mov(x86::r10d, imm(p.weights->dims(2) / outputBatchSize));
-              else
-                a.mov(a.ptr_zbp(-12, 4), imm(p.weights->dims(2) / outputBatchSize));
-            }
-            else
-              a.mov(a.zax(), imm(p.weights->dims(2) / outputBatchSize));
-            a.bind(outputBatchLoop);
-          }
+    void DConv2DCompiler::compileWindowLoops(x86::Assembler& a, ActivationFunctionHandler& afHandler, const SlidingWindow& window, const unsigned int inputWidth,
+                                             const unsigned int rowBegin, const unsigned int rowEnd) const
+    {
+      const NetworkConstants& weights = constants[0];
 
-          compileOutputBatch(a, afHandler, inputWidth, outputBatchSize);
+      window.compileLoops(a, settings.useX64, rowBegin, rowEnd, [&](const SlidingWindow::Borders& borders)
+      {
+        // Windows that lie partially outside of the input are computed from a padded copy
+        const bool padded = borders != SlidingWindow::Borders();
+        if(padded)
+          window.compileGather(a, borders, false);
 
-          // End loop over output batches
-          if(p.weights->dims(2) / outputBatchSize >= 2)
-          {
-            if(p.weights->dims(1) * p.weights->dims(2) > 4)
-            {
-              if(settings.useX64)
-                a.dec(x86::r10d);
-              else
-                a.dec(a.ptr_zbp(-12, 4));
-            }
-            else
-              a.dec(a.zax());
-            a.jnz(outputBatchLoop);
-          }
-        }
+        // Load filter base address
+        a.lea(a.zbx(), x86::ptr(weights.label));
 
-        const unsigned int remainingOutputs = p.weights->dims(2) == outputBatchSize ? outputBatchSize : p.weights->dims(2) % outputBatchSize;
-        if(remainingOutputs)
-          compileOutputBatch(a, afHandler, inputWidth, remainingOutputs);
+        // The output batches are unrolled, such that their offsets in the input and the biases are constant
+        for(unsigned int outputOffset = 0; outputOffset < p.weights->dims(2); outputOffset += outputBatchSize)
+          compileOutputBatch(a, afHandler, padded ? a.zsp() : a.zsi(), padded ? window.bufferWidth() : inputWidth, outputOffset,
+                             std::min(outputBatchSize, p.weights->dims(2) - outputOffset));
+      });
+    }
 
-        // Set input offset to next column, respecting the stride
-        a.add(a.zsi(), imm(p.strides[1] * p.weights->dims(2) * sizeof(float)));
+    void DConv2DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    {
+      ASSERT(input.rank() == 3);
+      ASSERT(output.rank() == 3);
+      ASSERT(input.dims(2) == p.weights->dims(2));
+      ASSERT(output.dims(2) == p.weights->dims(2) * p.weights->dims(3));
 
-        // End loop over output image cols
-        if(output.dims(2) / outputBatchSize < 2 && p.weights->dims(1) * p.weights->dims(2) <= 4)
-          a.dec(a.zax());
-        else if(settings.useX64)
-          a.dec(x86::r9d);
-        else
-          a.dec(a.ptr_zbp(-8, 4));
-        a.jnz(inputColLoop);
+      // A row of the filter of a single channel fits into one register (unless the columns are dilated or the input has to be padded)
+      if(p.weights->dims(2) != 1 || p.weights->dims(1) > 4 || p.dilation[1] != 1 || p.padding != PaddingType::valid)
+      {
+        compileWindows(a, afHandler, input, output, 0, output.dims(0));
+        return;
+      }
 
-        // Set input offset to next row, respecting the stride
-        a.add(a.zsi(), imm((p.strides[0] * inputWidth - output.dims(1) * p.strides[1]) * p.weights->dims(2) * sizeof(float)));
+      // Load input/output base addresses
+      loadAddress(a, a.zsi(), input.data());
+      if(input.data() == output.data())
+        a.mov(a.zdi(), a.zsi());
+      else
+        loadAddress(a, a.zdi(), output.data());
 
-        // End loop over output image rows
-        if(settings.useX64)
-          a.dec(x86::r8d);
-        else
-          a.dec(a.ptr_zbp(-4, 4));
-        a.jnz(inputRowLoop);
-      }
+      compileSimpleConvolution(a, afHandler, input.dims(1), output.dims(0), output.dims(1));
     }
   }
 }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../CompiledNNImplBase.h"
+#include "../Util/SlidingWindow.h"
 #include "BatchNormalization.h"
 
 namespace NeuralNetwork
@@ -20,6 +21,8 @@ namespace NeuralNetwork
         const std::vector<float>* biases = nullptr;
         ActivationFunctionDescriptor postActivation;
         std::array<unsigned int, 2> strides;
+        std::array<unsigned int, 2> dilation = {{1, 1}}; /**< The distance between the inputs of neighboring filter cells. */
+        PaddingType padding = PaddingType::valid; /**< The same padding is added implicitly to the windows at the borders of the input. */
 
         bool operator==(const Parameters& other) const
         {
@@ -27,6 +30,8 @@ namespace NeuralNetwork
             weights == other.weights &&
             biases == other.biases &&
             strides == other.strides &&
+            dilation == other.dilation &&
+            padding == other.padding &&
             postActivation == other.postActivation;
         }
       };
@@ -36,7 +41,40 @@ namespace NeuralNetwork
 
       inline bool canBeInplace() const override
       {
-        return p.strides[0] >= p.weights->dims(0) && p.strides[1] >= p.weights->dims(1) && p.weights->dims(3) <= 1;
+        return p.padding == PaddingType::valid && p.strides[0] >= kernelHeight() && p.strides[1] >= kernelWidth() && p.weights->dims(3) <= 1;
+      }
+
+      inline unsigned int maxParts(const TensorPointerXf& input, const TensorPointerXf& output) const override
+      {
+        return rowParts(input, output, p.strides[0]);
+      }
+
+      inline void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                              const unsigned int part, const unsigned int parts) const override
+      {
+        if(parts == 1)
+        {
+          compile(a, afHandler, input, output);
+          return;
+        }
+        const std::array<unsigned int, 2> rows = partRows(input, output, p.strides[0], part, parts);
+        if(rows[0] < rows[1])
+          compileRowRange(a, afHandler, input, output, rows[0], rows[1]);
+      }
+
+      inline RowWindow rowWindow() const override
+      {
+        return {kernelHeight(), p.strides[0], p.padding};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        // With implicit padding, the whole input is needed to determine which of the windows lie outside of it
+        if(p.padding == PaddingType::valid)
+          compileRows(a, afHandler, input, output, kernelHeight(), p.strides[0], rowBegin, rowEnd);
+        else
+          compileWindows(a, afHandler, input, output, rowBegin, rowEnd);
       }
 
       void initialize() override;
@@ -45,16 +83,41 @@ namespace NeuralNetwork
       inline std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>& inputDimensions) const override
       {
         ASSERT(inputDimensions.size() == 3);
-        return {{(inputDimensions[0] - p.weights->dims(0) + p.strides[0]) / p.strides[0], (inputDimensions[1] - p.weights->dims(1) + p.strides[1]) / p.strides[1], inputDimensions[2] * p.weights->dims(3)}};
+        return SlidingWindow::outputDimensions({{kernelHeight(), kernelWidth()}}, p.strides, p.padding, inputDimensions, inputDimensions[2] * p.weights->dims(3));
       }
 
     private:
-      mutable unsigned int biasOffset = 0;
       unsigned int outputBatchSize = 0;
 
+      /** Returns the number of input rows that the (dilated) filter covers. */
+      inline unsigned int kernelHeight() const { return (p.weights->dims(0) - 1) * p.dilation[0] + 1; }
+
+      /** Returns the number of input columns that the (dilated) filter covers. */
+      inline unsigned int kernelWidth() const { return (p.weights->dims(1) - 1) * p.dilation[1] + 1; }
+
       void compileFilter(x86::Assembler& a, const bool inputAligned, const unsigned int remainingOutputs, const unsigned int remainingInput, const bool lastFilter = false) const;
-      void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int inputWidth, const unsigned int remainingOutputs) const;
+      void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const x86::Gp& window, const unsigned int inputWidth, const unsigned int outputOffset, const unsigned int remainingOutputs) const;
       void compileSimpleConvolution(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int inputWidth, const unsigned int outputHeight, const unsigned int outputWidth) const;
+
+      /**
+       * Emits the code that computes a range of output rows with the output batches (the windows at the borders are copied to a padded buffer).
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       */
+      void compileWindows(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                          const unsigned int rowBegin, const unsigned int rowEnd) const;
+
+      /**
+       * Emits the loops of compileWindows. zsi must point to the window of the first pixel and zdi to its output.
+       * The buffer of the window must have been reserved if it is padded.
+       * @param inputWidth The number of columns of the input.
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       */
+      void compileWindowLoops(x86::Assembler& a, ActivationFunctionHandler& afHandler, const SlidingWindow& window, const unsigned int inputWidth,
+                              const unsigned int rowBegin, const unsigned int rowEnd) const;
+
+      friend struct SeparableConv2DCompiler;
     };
   }
 }
@@ -4,6 +4,7 @@
 
 #include "Dense.h"
 #include "../ActivationFunctions.h"
+#include "../Util/HalfFloat.h"
 #include "MathBase/NeumaierSum.h"
 #include "Platform/BHAssert.h"
 
@@ -11,8 +12,53 @@ namespace NeuralNetwork
 {
   namespace CompiledNNImpl
   {
+    bool DenseCompiler::usesAVX() const
+    {
+      return settings.useAVX2 && p.weights->dims(1) > 1;
+    }
+
+    bool DenseCompiler::usesHalfWeights() const
+    {
+      return settings.useHalfPrecisionWeights && usesAVX();
+    }
+
+    std::vector<unsigned int> DenseCompiler::outputBatchSizes() const
+    {
+      if(p.weights->dims(1) == 1)
+        return {1};
+
+      const bool useAVX = usesAVX();
+      const unsigned int vectorSize = useAVX ? 8 : 4;
+      const unsigned int maxRegs = settings.xmmRegs() - std::max(std::max(useAVX && settings.useFMA3 && !usesHalfWeights() ? 1u : 2u, ActivationFunctionHandler::neededSpares(p.activationDesc)), ActivationFunctionHandler::neededSpares(p.postActivation));
+      const unsigned int outputRegs = (p.weights->dims(1) + vectorSize - 1) / vectorSize;
+
+      // Halve the number of registers as long as this changes the batches, but try at most three sizes
+      std::vector<unsigned int> sizes;
+      for(unsigned int regs = maxRegs, lastRegs = 0; regs && sizes.size() < 3; regs /= 2)
+        if(std::min(regs, outputRegs) != lastRegs)
+        {
+          sizes.push_back(regs * vectorSize);
+          lastRegs = std::min(regs, outputRegs);
+        }
+      return sizes;
+    }
+
+    unsigned int DenseCompiler::variants() const
+    {
+      return static_cast<unsigned int>(outputBatchSizes().size());
+    }
+
+    std::string DenseCompiler::tuningKey() const
+    {
+      return "Dense " + std::to_string(p.weights->dims(0)) + "x" + std::to_string(p.weights->dims(1)) +
+             " activations " + std::to_string(static_cast<unsigned int>(p.activationDesc.id)) + "," + std::to_string(static_cast<unsigned int>(p.postActivation.id)) +
+             (p.preBatchNormalization ? " prebn" : "") + (p.postBatchNormalization ? " postbn" : "");
+    }
+
     void DenseCompiler::initialize()
     {
+      ASSERT(variant < variants());
+
       // Declare constants
       constants.resize(2);
 
@@ -37,12 +83,38 @@ namespace NeuralNetwork
       {
         weights.data.clear();
 
-        outputBatchSize = 4 * (settings.xmmRegs() - std::max(std::max(2u, ActivationFunctionHandler::neededSpares(p.activationDesc)), ActivationFunctionHandler::neededSpares(p.postActivation)));
+        const bool useAVX = usesAVX();
+        outputBatchSize = outputBatchSizes()[variant];
+
+        const auto weight = [&](const size_t input, const size_t output)
+        {
+          float w = (*p.weights)[input * p.weights->dims(1) + output];
+          if(p.preBatchNormalization)
+            w *= (*p.preBatchNormalization->factor)[input];
+          if(p.postBatchNormalization && p.activationDesc == CompiledActivationFunctionId::linear)
+            w *= (*p.postBatchNormalization->factor)[output];
+          return w;
+        };
 
         for(unsigned int outputOffset = 0; outputOffset < p.weights->dims(1); outputOffset += outputBatchSize)
         {
           const unsigned int outputBatchEnd = std::min(outputOffset + outputBatchSize, p.weights->dims(1));
 
+          if(useAVX)
+          {
+            // Each input is broadcasted to all elements of a register and multiplied with the weights of 8 outputs at once
+            for(unsigned int input = 0; input < p.weights->dims(0); input++)
+              for(unsigned int output = outputOffset; output < outputBatchEnd; output += 8)
+              {
+                const unsigned int remainingOutputs = std::min(8u, outputBatchEnd - output);
+                for(unsigned int i = 0; i < remainingOutputs; i++)
+                  weights.data.emplace_back(weight(input, output + i));
+                for(unsigned int i = remainingOutputs; i < 8; i++)
+                  weights.data.emplace_back(0.f);
+              }
+            continue;
+          }
+
           for(unsigned int input = 0; input < p.weights->dims(0); input += 4)
           {
             const unsigned int remainingInputs = std::min(4u, p.weights->dims(0) - input);
@@ -54,24 +126,17 @@ namespace NeuralNetwork
                 const unsigned int remainingOutputs = std::min(4u, outputBatchEnd - output);
 
                 for(unsigned int i = 0; i < remainingOutputs; i++)
-                {
-                  const size_t effInputIndex = input + ((remainingInputs - shuffle + i) % remainingInputs);
-                  const size_t effOutputIndex = output + i;
-
-                  float w = (*p.weights)[effInputIndex * p.weights->dims(1) + effOutputIndex];
-                  if(p.preBatchNormalization)
-                    w *= (*p.preBatchNormalization->factor)[effInputIndex];
-                  if(p.postBatchNormalization && p.activationDesc == CompiledActivationFunctionId::linear)
-                    w *= (*p.postBatchNormalization->factor)[effOutputIndex];
-
-                  weights.data.emplace_back(w);
-                }
+                  weights.data.emplace_back(weight(input + ((remainingInputs - shuffle + i) % remainingInputs), output + i));
                 for(unsigned int i = remainingOutputs; i < 4; i++)
                   weights.data.emplace_back(0.f);
               }
             }
           }
         }
+
+        // The AVX code converts the weights back while it multiplies them
+        if(usesHalfWeights())
+          packHalves(weights.data);
       }
 
       // Store biases
@@ -103,6 +168,11 @@ namespace NeuralNetwork
         constants[2].data = *p.postBatchNormalization->factor;
         constants[3].data = *p.postBatchNormalization->offset;
       }
+
+      // The last ymm register of each vector of constants is read completely
+      if(p.weights->dims(1) > 1 && usesAVX())
+        for(size_t i = 1; i < constants.size(); i++)
+          constants[i].data.resize((p.weights->dims(1) + 7) / 8 * 8, 0.f);
     }
 
     void DenseCompiler::compileInputBatch(x86::Assembler& a, const unsigned int remainingOutputs, const unsigned int stepSize, const unsigned int remainingInputs, const bool lastOutputBatch, const bool lastInputBatch) const
@@ -161,12 +231,21 @@ namespace NeuralNetwork
     {
       const unsigned int stepSize = (remainingOutputs + 3) / 4;
 
+      // Begin loop over the samples of a batch, so that the weights of this output batch are reused while they are cached
+      Label sampleLoop;
+      if(settings.batchSize > 1)
+      {
+        a.mov(a.ptr_zbp(scratchPointerOffset, a.zdx().size()), a.zdx());
+        beginSampleLoop(a, sampleLoop);
+        a.mov(a.zdx(), a.ptr_zbp(scratchPointerOffset, a.zdx().size()));
+      }
+
       // Initialize results with zero
       for(unsigned int step = 0; step < stepSize; step++)
         a.xorps(x86::xmm(step), x86::xmm(step));
 
       // Initialize input pointer
-      a.mov(a.zsi(), imm(input));
+      loadAddress(a, a.zsi(), input);
 
       if(p.weights->dims(0) > 4)
       {
@@ -252,31 +331,282 @@ namespace NeuralNetwork
         activationFunction.apply(a);
       }
 
-      // Advance bias pointer
-      if(!last)
-        a.add(a.zbx(), imm(stepSize * 4 * sizeof(float)));
-
       // Store results
       for(unsigned int step = 0; step < stepSize; step++)
         a.movaps(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
 
+      // End loop over the samples of a batch
+      if(settings.batchSize > 1)
+      {
+        a.add(a.zdi(), imm(sampleStride()));
+        endSampleLoop(a, sampleLoop);
+        a.sub(a.zdi(), imm(sampleStride() * settings.batchSize));
+      }
+
+      // Advance bias pointer
+      if(!last)
+        a.add(a.zbx(), imm(stepSize * 4 * sizeof(float)));
+
       // Advance destination pointer if necessary
       if(!last && (p.weights->dims(1) / outputBatchSize >= 2 || p.weights->dims(1) % outputBatchSize != 0))
         a.add(a.zdi(), imm(stepSize * 4 * sizeof(float)));
     }
 
+    void DenseCompiler::compileInputBatchAVX(x86::Assembler& a, const unsigned int stepSize, const unsigned int accumulatorSets, const unsigned int inputs, const bool lastInputBatch) const
+    {
+      const x86::Ymm input = x86::ymm(settings.xmmRegs() - 1);
+      const x86::Ymm product = x86::ymm(settings.xmmRegs() - 2);
+      const bool halfWeights = usesHalfWeights();
+
+      // Multiply each input with the weights of all outputs, alternating between the sets of accumulators
+      unsigned int weightOffset = 0;
+      for(unsigned int i = 0; i < inputs; i++)
+      {
+        a.vbroadcastss(input, a.ptr_zsi(i * sizeof(float), 4));
+        for(unsigned int step = 0; step < stepSize; step++)
+        {
+          const x86::Ymm accumulator = x86::ymm((i % accumulatorSets) * stepSize + step);
+          if(halfWeights)
+          {
+            a.vcvtph2ps(product, a.ptr_zdx(weightOffset));
+            if(settings.useFMA3)
+              a.vfmadd231ps(accumulator, input, product);
+            else
+            {
+              a.vmulps(product, product, input);
+              a.vaddps(accumulator, accumulator, product);
+            }
+          }
+          else if(settings.useFMA3)
+            a.vfmadd231ps(accumulator, input, a.ptr_zdx(weightOffset));
+          else
+          {
+            a.vmulps(product, input, a.ptr_zdx(weightOffset));
+            a.vaddps(accumulator, accumulator, product);
+          }
+          weightOffset += 8 * (halfWeights ? sizeof(std::uint16_t) : sizeof(float));
+        }
+      }
+      if(!lastInputBatch)
+        a.add(a.zsi(), imm(4 * sizeof(float)));
+      a.add(a.zdx(), imm(weightOffset));
+    }
+
+    void DenseCompiler::compileOutputBatchAVX(x86::Assembler& a, ActivationFunctionHandler& afHandler, const float* const input, const unsigned int remainingOutputs, const bool last) const
+    {
+      const unsigned int stepSize = (remainingOutputs + 7) / 8;
+
+      // Use independent sets of accumulators for consecutive inputs if there are enough registers, such that the latency of the additions is hidden
+      const unsigned int accumulatorSets = std::max(1u, std::min(4u, (settings.xmmRegs() - (settings.useFMA3 && !usesHalfWeights() ? 1 : 2)) / stepSize));
+
+      // Begin loop over the samples of a batch, so that the weights of this output batch are reused while they are cached
+      Label sampleLoop;
+      if(settings.batchSize > 1)
+      {
+        a.mov(a.ptr_zbp(scratchPointerOffset, a.zdx().size()), a.zdx());
+        beginSampleLoop(a, sampleLoop);
+        a.mov(a.zdx(), a.ptr_zbp(scratchPointerOffset, a.zdx().size()));
+      }
+
+      // Initialize results with zero
+      for(unsigned int i = 0; i < accumulatorSets * stepSize; i++)
+        a.vxorps(x86::ymm(i), x86::ymm(i), x86::ymm(i));
+
+      // Initialize input pointer
+      loadAddress(a, a.zsi(), input);
+
+      if(p.weights->dims(0) > 4)
+      {
+        // Begin loop over input (only construct loop if it has more than one iteration)
+        Label inputLoop;
+        if(p.weights->dims(0) / 4 >= 2)
+        {
+          inputLoop = a.newLabel();
+          a.mov(a.zcx(), imm(p.weights->dims(0) / 4));
+          a.bind(inputLoop);
+        }
+
+        compileInputBatchAVX(a, stepSize, accumulatorSets, 4, false);
+
+        // End loop over input
+        if(p.weights->dims(0) / 4 >= 2)
+        {
+          a.dec(a.zcx());
+          a.jnz(inputLoop);
+        }
+      }
+
+      const unsigned int remainingInputs = p.weights->dims(0) == 4 ? 4 : (p.weights->dims(0) % 4);
+      if(remainingInputs)
+        compileInputBatchAVX(a, stepSize, accumulatorSets, remainingInputs, true);
+
+      // Sum up the sets of accumulators
+      for(unsigned int set = 1; set < accumulatorSets; set++)
+        for(unsigned int step = 0; step < stepSize; step++)
+          a.vaddps(x86::ymm(step), x86::ymm(step), x86::ymm(set * stepSize + step));
+
+      // Add biases
+      for(unsigned int step = 0; step < stepSize; step++)
+        a.vaddps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(step * 8 * sizeof(float)));
+
+      if(p.activationDesc != CompiledActivationFunctionId::linear)
+      {
+        // Apply activation function
+        ActivationFn& activationFunction = afHandler.prepareAVX(p.activationDesc, a, {}, {});
+        for(unsigned int step = 0; step < stepSize; step++)
+          activationFunction.addValue(x86::ymm(step));
+        for(unsigned int step = stepSize; step < settings.xmmRegs(); step++)
+          activationFunction.addSpare(x86::ymm(step));
+        activationFunction.initialize(a);
+        activationFunction.apply(a);
+
+        // In this case, Batch Normalization was not done implicitly, so we have to do it manually
+        if(p.postBatchNormalization)
+        {
+          // Multiply with factors
+          if(settings.useX64)
+            a.add(a.zbx(), x86::r8);
+          else
+            a.add(a.zbx(), a.ptr_zbp(-8, 4));
+          for(unsigned int step = 0; step < stepSize; step++)
+            a.vmulps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(step * 8 * sizeof(float)));
+
+          // Add offsets
+          if(settings.useX64)
+            a.add(a.zbx(), x86::r9);
+          else
+            a.add(a.zbx(), a.ptr_zbp(-4, 4));
+          for(unsigned int step = 0; step < stepSize; step++)
+            a.vaddps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(step * 8 * sizeof(float)));
+
+          // Reset bias pointer
+          if(settings.useX64)
+          {
+            a.sub(a.zbx(), x86::r9);
+            a.sub(a.zbx(), x86::r8);
+          }
+          else
+          {
+            a.sub(a.zbx(), a.ptr_zbp(-4, 4));
+            a.sub(a.zbx(), a.ptr_zbp(-8, 4));
+          }
+        }
+      }
+
+      if(p.postActivation != CompiledActivationFunctionId::linear)
+      {
+        // Apply activation function
+        ActivationFn& activationFunction = afHandler.prepareAVX(p.postActivation, a, {}, {});
+        for(unsigned int step = 0; step < stepSize; step++)
+          activationFunction.addValue(x86::ymm(step));
+        for(unsigned int step = stepSize; step < settings.xmmRegs(); step++)
+          activationFunction.addSpare(x86::ymm(step));
+        activationFunction.initialize(a);
+        activationFunction.apply(a);
+      }
+
+      // Store results (a last register with at most 4 outputs is stored as xmm register, so that at most 3 floats behind the outputs are overwritten)
+      for(unsigned int step = 0; step < stepSize; step++)
+      {
+        if(step == stepSize - 1 && (remainingOutputs - 1) % 8 < 4)
+          a.vmovups(a.ptr_zdi(step * 8 * sizeof(float)), x86::xmm(step));
+        else
+          a.vmovups(a.ptr_zdi(step * 8 * sizeof(float)), x86::ymm(step));
+      }
+
+      // End loop over the samples of a batch
+      if(settings.batchSize > 1)
+      {
+        a.add(a.zdi(), imm(sampleStride()));
+        endSampleLoop(a, sampleLoop);
+        a.sub(a.zdi(), imm(sampleStride() * settings.batchSize));
+      }
+
+      // Advance bias and destination pointers
+      if(!last)
+      {
+        a.add(a.zbx(), imm(stepSize * 8 * sizeof(float)));
+        a.add(a.zdi(), imm(stepSize * 8 * sizeof(float)));
+      }
+    }
+
+    void DenseCompiler::compileDotProductAVX(x86::Assembler& a) const
+    {
+      // Use independent accumulators for consecutive vectors of inputs, such that the latency of the additions is hidden
+      const unsigned int accumulators = std::min(std::min(8u, settings.xmmRegs() - (settings.useFMA3 ? 1 : 2)), p.weights->dims(0) / 8);
+      const x86::Ymm input = x86::ymm(settings.xmmRegs() - 1);
+      const x86::Ymm product = x86::ymm(settings.xmmRegs() - 2);
+
+      // Initialise results
+      for(unsigned int i = 0; i < accumulators; i++)
+        a.vxorps(x86::ymm(i), x86::ymm(i), x86::ymm(i));
+
+      const auto multiplyAccumulate = [&](const unsigned int vectors)
+      {
+        for(unsigned int i = 0; i < vectors; i++)
+        {
+          a.vmovups(input, a.ptr_zsi(i * 8 * sizeof(float)));
+          if(settings.useFMA3)
+            a.vfmadd231ps(x86::ymm(i), input, a.ptr_zdx(i * 8 * sizeof(float)));
+          else
+          {
+            a.vmulps(product, input, a.ptr_zdx(i * 8 * sizeof(float)));
+            a.vaddps(x86::ymm(i), x86::ymm(i), product);
+          }
+        }
+        a.add(a.zsi(), imm(vectors * 8 * sizeof(float)));
+        a.add(a.zdx(), imm(vectors * 8 * sizeof(float)));
+      };
+
+      // Loop over the inputs in blocks of one vector per accumulator
+      const unsigned int blocks = p.weights->dims(0) / (accumulators * 8);
+      Label loop;
+      if(blocks >= 2)
+      {
+        a.mov(a.zcx(), imm(blocks));
+        loop = a.newLabel();
+        a.bind(loop);
+      }
+      multiplyAccumulate(accumulators);
+      if(blocks >= 2)
+      {
+        a.dec(a.zcx());
+        a.jnz(loop);
+      }
+      if(const unsigned int remainingVectors = p.weights->dims(0) / 8 % accumulators)
+        multiplyAccumulate(remainingVectors);
+
+      // Horizontally sum up the accumulators into xmm0
+      for(unsigned int count = accumulators; count > 1; count = (count + 1) / 2)
+        for(unsigned int i = 0; i < count / 2; i++)
+          a.vaddps(x86::ymm(i), x86::ymm(i), x86::ymm(i + (count + 1) / 2));
+      a.vextractf128(x86::xmm1, x86::ymm0, imm(1));
+      a.vaddps(x86::xmm0, x86::xmm0, x86::xmm1);
+      a.vzeroupper();
+
+      // Add the remaining inputs
+      for(unsigned int i = 0; i < p.weights->dims(0) % 8; ++i)
+      {
+        a.movss(x86::xmm1, a.ptr_zsi(i * sizeof(float)));
+        a.mulss(x86::xmm1, a.ptr_zdx(i * sizeof(float)));
+        a.addss(x86::xmm0, x86::xmm1);
+      }
+      a.haddps(x86::xmm0, x86::xmm0);
+      a.haddps(x86::xmm0, x86::xmm0);
+    }
+
     void DenseCompiler::compileSimple(x86::Assembler& a, ActivationFunctionHandler& afHandler, const float* const input, const float* const output) const
     {
       // Declare labels
       const NetworkConstants& weights = constants[0];
       const NetworkConstants& biases = constants[1];
 
-      a.mov(a.zsi(), imm(input));
+      loadAddress(a, a.zsi(), input);
 
       bool destInZSI = input == output;
 
       if(!destInZSI)
-        a.mov(a.zdi(), imm(output));
+        loadAddress(a, a.zdi(), output);
 
       if(p.weights->dims(0) == 1)
       {
@@ -337,6 +667,20 @@ namespace NeuralNetwork
         a.haddps(x86::xmm0, x86::xmm0);
         a.haddps(x86::xmm0, x86::xmm0);
       }
+      else if(settings.useAVX2 && p.weights->dims(0) >= 16)
+      {
+        // Copy dest pointer to zdi
+        if(destInZSI)
+        {
+          a.mov(a.zdi(), a.zsi());
+          destInZSI = false;
+        }
+
+        // Load weights address
+        a.lea(a.zdx(), x86::ptr(weights.label));
+
+        compileDotProductAVX(a);
+      }
       else
       {
         // Default case
@@ -472,21 +816,42 @@ namespace NeuralNetwork
         return;
       }
 
+      compileOutputs(a, afHandler, input.data(), output.data(), 0, p.weights->dims(1));
+    }
+
+    void DenseCompiler::compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output, const unsigned int part, const unsigned int parts) const
+    {
+      if(parts == 1)
+      {
+        compile(a, afHandler, input, output);
+        return;
+      }
+
+      // Split the output batches among the parts
+      const unsigned int outputBatches = maxParts(input, output);
+      const unsigned int firstOutput = outputBatches * part / parts * outputBatchSize;
+      const unsigned int endOutput = std::min(outputBatches * (part + 1) / parts * outputBatchSize, p.weights->dims(1));
+      if(firstOutput < endOutput)
+        compileOutputs(a, afHandler, input.data(), output.data(), firstOutput, endOutput - firstOutput);
+    }
+
+    void DenseCompiler::compileOutputs(x86::Assembler& a, ActivationFunctionHandler& afHandler, const float* const input, const float* const output, const unsigned int firstOutput, const unsigned int outputs) const
+    {
       // Declare labels
       const NetworkConstants& weights = constants[0];
       const NetworkConstants& biases = constants[1];
 
       // Load offsets
-      a.lea(a.zdx(), x86::ptr(weights.label));
-      a.mov(a.zdi(), imm(output.data()));
-      a.lea(a.zbx(), x86::ptr(biases.label));
+      a.lea(a.zdx(), x86::ptr(weights.label, firstOutput * p.weights->dims(0) * (usesHalfWeights() ? sizeof(std::uint16_t) : sizeof(float))));
+      loadAddress(a, a.zdi(), output + firstOutput);
+      a.lea(a.zbx(), x86::ptr(biases.label, firstOutput * sizeof(float)));
 
       if(p.activationDesc != CompiledActivationFunctionId::linear && p.postBatchNormalization)
       {
         // Store coefficient offsets
         ASSERT(constants.size() == 4);
-        a.lea(a.zax(), x86::ptr(constants[2].label));
-        a.lea(a.zcx(), x86::ptr(constants[3].label));
+        a.lea(a.zax(), x86::ptr(constants[2].label, firstOutput * sizeof(float)));
+        a.lea(a.zcx(), x86::ptr(constants[3].label, firstOutput * sizeof(float)));
         a.sub(a.zcx(), a.zax());
         a.sub(a.zax(), a.zbx());
         if(settings.useX64)
@@ -501,30 +866,43 @@ namespace NeuralNetwork
         }
       }
 
-      if(p.weights->dims(1) > outputBatchSize)
+      const bool useAVX = usesAVX();
+      if(outputs > outputBatchSize)
       {
         // Begin loop over output batches (only construct loop if it has more than one iteration)
         Label outputBatchLoop;
-        if(p.weights->dims(1) / outputBatchSize >= 2)
+        if(outputs / outputBatchSize >= 2)
         {
           outputBatchLoop = a.newLabel();
-          a.mov(a.zax(), imm(p.weights->dims(1) / outputBatchSize));
+          a.mov(a.zax(), imm(outputs / outputBatchSize));
           a.bind(outputBatchLoop);
         }
 
-        compileOutputBatch(a, afHandler, input.data(), outputBatchSize);
+        if(useAVX)
+          compileOutputBatchAVX(a, afHandler, input, outputBatchSize);
+        else
+          compileOutputBatch(a, afHandler, input, outputBatchSize);
 
         // End loop over output batches
-        if(p.weights->dims(1) / outputBatchSize >= 2)
+        if(outputs / outputBatchSize >= 2)
         {
           a.dec(a.zax());
           a.jnz(outputBatchLoop);
         }
       }
 
-      const unsigned int remainingOutputs = p.weights->dims(1) == outputBatchSize ? outputBatchSize : (p.weights->dims(1) % outputBatchSize);
+      const unsigned int remainingOutputs = outputs == outputBatchSize ? outputBatchSize : (outputs % outputBatchSize);
       if(remainingOutputs)
-        compileOutputBatch(a, afHandler, input.data(), remainingOutputs, true);
+      {
+        if(useAVX)
+          compileOutputBatchAVX(a, afHandler, input, remainingOutputs, true);
+        else
+          compileOutputBatch(a, afHandler, input, remainingOutputs, true);
+      }
+
+      // Avoid the penalty of mixing AVX and legacy SSE instructions in the following operations
+      if(useAVX)
+        a.vzeroupper();
     }
   }
 }
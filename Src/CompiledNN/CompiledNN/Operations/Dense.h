@@ -45,6 +45,21 @@ namespace NeuralNetwork
         return p.weights->dims(1) == 1;
       }
 
+      inline bool processesBatch() const override
+      {
+        return p.weights->dims(1) > 1;
+      }
+
+      inline unsigned int maxParts(const TensorPointerXf&, const TensorPointerXf&) const override
+      {
+        return p.weights->dims(1) == 1 ? 1 : (p.weights->dims(1) + outputBatchSize - 1) / outputBatchSize;
+      }
+
+      void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output, const unsigned int part, const unsigned int parts) const override;
+
+      unsigned int variants() const override;
+      std::string tuningKey() const override;
+
       void initialize() override;
       void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
 
@@ -56,8 +71,28 @@ namespace NeuralNetwork
     private:
       unsigned int outputBatchSize = 0;
 
+      /**
+       * Checks whether the outputs are computed in ymm registers (8 floats per register instead of 4).
+       */
+      bool usesAVX() const;
+
+      /**
+       * Checks whether the weights are stored as half precision floats (only in the AVX code).
+       */
+      bool usesHalfWeights() const;
+
+      /**
+       * Returns the sizes of the output batches among which the autotuner can choose (the default size that uses all available registers first).
+       * Smaller batches leave registers for independent sets of accumulators.
+       */
+      std::vector<unsigned int> outputBatchSizes() const;
+
       void compileInputBatch(x86::Assembler& a, const unsigned int remainingOutputs, const unsigned int stepSize, const unsigned int remainingInputs, const bool lastOutputBatch, const bool lastInputBatch = false) const;
       void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const float* const input, const unsigned int remainingOutputs, const bool last = false) const;
+      void compileInputBatchAVX(x86::Assembler& a, const unsigned int stepSize, const unsigned int accumulatorSets, const unsigned int inputs, const bool lastInputBatch) const;
+      void compileOutputBatchAVX(x86::Assembler& a, ActivationFunctionHandler& afHandler, const float* const input, const unsigned int remainingOutputs, const bool last = false) const;
+      void compileDotProductAVX(x86::Assembler& a) const;
+      void compileOutputs(x86::Assembler& a, ActivationFunctionHandler& afHandler, const float* const input, const float* const output, const unsigned int firstOutput, const unsigned int outputs) const;
       void compileSimple(x86::Assembler& a, ActivationFunctionHandler& afHandler, const float* const input, const float* const output) const;
     };
   }
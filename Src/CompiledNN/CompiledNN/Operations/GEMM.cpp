@@ -0,0 +1,326 @@
+/**
+ * Implements the product of the pixels of a tensor with a weight matrix.
+ *
+ * For each input channel, the weights of a batch of output channels are
+ * loaded into registers once and multiplied with the input of each pixel of
+ * a batch of pixels, which is broadcasted to another register.
+ */
+
+#include "GEMM.h"
+#include "Platform/BHAssert.h"
+#include <algorithm>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    bool GEMMCompiler::isFasterThanDirectConvolution(const CompilationSettings& settings, const Tensor<float, 1>& weights, const std::vector<unsigned int>& outputDimensions)
+    {
+      // With the few registers of x86, the pixel batches are too small
+      if(!settings.useX64 || settings.useHalfPrecisionWeights || weights.rank() != 4 || outputDimensions.size() != 3)
+        return false;
+
+      // Each weight that is loaded is multiplied with the inputs of several pixels, which only pays off if there are enough of them.
+      // The im2col copies each input value once per filter cell, which is slower than the direct convolution for very few input channels.
+      return outputDimensions[0] * outputDimensions[1] >= 16 && weights.dims(2) >= 4;
+    }
+
+    unsigned int GEMMCompiler::outputBatchRegs() const
+    {
+      const unsigned int outputRegs = (outputs() + vectorSize() - 1) / vectorSize();
+      const unsigned int maxRegs = settings.useFMA3 ? 3 : 2;
+      const unsigned int batches = (outputRegs + maxRegs - 1) / maxRegs;
+      return (outputRegs + batches - 1) / batches;
+    }
+
+    unsigned int GEMMCompiler::pixelBatchSize() const
+    {
+      // Apart from the accumulators, there are registers for the weights, the broadcasted input and (without FMA3) the products
+      const unsigned int regs = outputBatchRegs();
+      const unsigned int spares = std::max(regs + (settings.useFMA3 ? 1 : 2), ActivationFunctionHandler::neededSpares(p.activationDesc));
+      return std::max(1u, std::min(8u, settings.xmmRegs() > spares ? (settings.xmmRegs() - spares) / regs : 0u));
+    }
+
+    unsigned int GEMMCompiler::maxParts(const TensorPointerXf& input, const TensorPointerXf&) const
+    {
+      const unsigned int pixels = static_cast<unsigned int>(input.size() / inputs());
+      return (pixels + pixelBatchSize() - 1) / pixelBatchSize();
+    }
+
+    void GEMMCompiler::compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                   const unsigned int part, const unsigned int parts) const
+    {
+      if(parts == 1)
+      {
+        compile(a, afHandler, input, output);
+        return;
+      }
+      const unsigned int pixels = static_cast<unsigned int>(input.size() / inputs());
+      const unsigned int pixelBatchSize = this->pixelBatchSize();
+      const unsigned int pixelBatches = (pixels + pixelBatchSize - 1) / pixelBatchSize;
+      const unsigned int begin = std::min(pixels, pixelBatches * part / parts * pixelBatchSize);
+      const unsigned int end = std::min(pixels, pixelBatches * (part + 1) / parts * pixelBatchSize);
+      if(begin == end)
+        return;
+      const TensorPointerXf inputPixels({end - begin, inputs()}, const_cast<float*>(input.data()) + begin * inputs());
+      const TensorPointerXf outputPixels({end - begin, outputs()}, const_cast<float*>(output.data()) + begin * outputs());
+      compile(a, afHandler, inputPixels, outputPixels);
+    }
+
+    void GEMMCompiler::initialize()
+    {
+      const unsigned int inputs = this->inputs();
+      const unsigned int outputs = this->outputs();
+      const unsigned int outputBatchSize = outputBatchRegs() * vectorSize();
+
+      // The weights of each output batch (padded to whole registers) are followed by its biases
+      constants.resize(2);
+      std::vector<float>& weights = constants[0].data;
+      weights.clear();
+      for(unsigned int outputOffset = 0; outputOffset < outputs; outputOffset += outputBatchSize)
+      {
+        const unsigned int outputBatchEnd = std::min(outputOffset + outputBatchSize, outputs);
+        const unsigned int paddedOutputBatchEnd = outputOffset + (outputBatchEnd - outputOffset + vectorSize() - 1) / vectorSize() * vectorSize();
+        for(unsigned int input = 0; input < inputs; input++)
+          for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+          {
+            if(output >= outputBatchEnd)
+              weights.emplace_back(0.f);
+            else if(p.batchNormalization)
+              weights.emplace_back((*p.weights)[input * outputs + output] * (*p.batchNormalization->factor)[output]);
+            else
+              weights.emplace_back((*p.weights)[input * outputs + output]);
+          }
+        for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+        {
+          float b = p.biases && output < outputBatchEnd ? (*p.biases)[output] : 0.f;
+          if(p.batchNormalization && output < outputBatchEnd)
+            b = b * (*p.batchNormalization->factor)[output] + (*p.batchNormalization->offset)[output];
+          weights.emplace_back(b);
+        }
+      }
+
+      // The mask to store the outputs of the last (partial) register with AVX
+      constants[1].data.assign(8, 0.f);
+      for(unsigned int i = 0; i < outputs % 8; i++)
+        constants[1].data[i] = -0.f;
+    }
+
+    void GEMMCompiler::compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int pixels, const unsigned int regs, const unsigned int lastRegOutputs) const
+    {
+      const bool useAVX = usesAVX();
+      const unsigned int vectorSize = this->vectorSize();
+      const unsigned int inputs = this->inputs();
+      const unsigned int outputs = this->outputs();
+
+      auto reg = [&](const unsigned int i) -> x86::Vec
+      {
+        return useAVX ? x86::Vec(x86::ymm(i)) : x86::Vec(x86::xmm(i));
+      };
+      auto accumulator = [&](const unsigned int pixel, const unsigned int i) { return reg(pixel * regs + i); };
+      auto weight = [&](const unsigned int i) { return reg(pixels * regs + i); };
+      const x86::Vec broadcast = reg(pixels * regs + regs);
+      const x86::Vec product = reg(pixels * regs + regs + 1);
+
+      for(unsigned int i = 0; i < pixels * regs; i++)
+      {
+        if(useAVX)
+          a.vxorps(x86::ymm(i), x86::ymm(i), x86::ymm(i));
+        else
+          a.xorps(x86::xmm(i), x86::xmm(i));
+      }
+
+      // Begin loop over the inputs
+      a.mov(a.zdx(), a.zsi());
+      Label inputLoop;
+      if(inputs > 1)
+      {
+        inputLoop = a.newLabel();
+        a.mov(a.zcx(), imm(inputs));
+        a.bind(inputLoop);
+      }
+
+      for(unsigned int i = 0; i < regs; i++)
+        a.emit(useAVX ? x86::Inst::kIdVmovaps : x86::Inst::kIdMovaps, weight(i), a.ptr_zbx(i * vectorSize * sizeof(float)));
+      for(unsigned int pixel = 0; pixel < pixels; pixel++)
+      {
+        if(useAVX)
+          a.vbroadcastss(broadcast.as<x86::Ymm>(), a.ptr_zdx(pixel * inputs * sizeof(float)));
+        else
+        {
+          a.movss(broadcast.as<x86::Xmm>(), a.ptr_zdx(pixel * inputs * sizeof(float)));
+          a.shufps(broadcast.as<x86::Xmm>(), broadcast.as<x86::Xmm>(), imm(0));
+        }
+        for(unsigned int i = 0; i < regs; i++)
+        {
+          if(settings.useFMA3)
+            a.emit(x86::Inst::kIdVfmadd231ps, accumulator(pixel, i), broadcast, weight(i));
+          else if(useAVX)
+          {
+            a.vmulps(product.as<x86::Ymm>(), broadcast.as<x86::Ymm>(), weight(i).as<x86::Ymm>());
+            a.vaddps(accumulator(pixel, i).as<x86::Ymm>(), accumulator(pixel, i).as<x86::Ymm>(), product.as<x86::Ymm>());
+          }
+          else
+          {
+            a.movaps(product.as<x86::Xmm>(), weight(i).as<x86::Xmm>());
+            a.mulps(product.as<x86::Xmm>(), broadcast.as<x86::Xmm>());
+            a.addps(accumulator(pixel, i).as<x86::Xmm>(), product.as<x86::Xmm>());
+          }
+        }
+      }
+      a.add(a.zbx(), imm(regs * vectorSize * sizeof(float)));
+
+      // End loop over the inputs
+      if(inputs > 1)
+      {
+        a.add(a.zdx(), imm(sizeof(float)));
+        a.dec(a.zcx());
+        a.jnz(inputLoop);
+      }
+
+      // Add biases (which follow the weights of this output batch and include the batch normalization)
+      for(unsigned int i = 0; i < regs; i++)
+      {
+        a.emit(useAVX ? x86::Inst::kIdVmovaps : x86::Inst::kIdMovaps, weight(i), a.ptr_zbx(i * vectorSize * sizeof(float)));
+        for(unsigned int pixel = 0; pixel < pixels; pixel++)
+        {
+          if(useAVX)
+            a.vaddps(accumulator(pixel, i).as<x86::Ymm>(), accumulator(pixel, i).as<x86::Ymm>(), weight(i).as<x86::Ymm>());
+          else
+            a.addps(accumulator(pixel, i).as<x86::Xmm>(), weight(i).as<x86::Xmm>());
+        }
+      }
+      a.add(a.zbx(), imm(regs * vectorSize * sizeof(float)));
+
+      // Apply activation function
+      if(p.activationDesc != CompiledActivationFunctionId::linear)
+      {
+        ActivationFn& activationFn = useAVX ? afHandler.prepareAVX(p.activationDesc, a, {}, {}) : afHandler.prepare(p.activationDesc, false, a, {}, {});
+        for(unsigned int i = 0; i < pixels * regs; i++)
+          activationFn.addValue(x86::xmm(i));
+        for(unsigned int i = pixels * regs; i < settings.xmmRegs(); i++)
+          activationFn.addSpare(x86::xmm(i));
+        activationFn.initialize(a);
+        activationFn.apply(a);
+      }
+
+      // Store outputs (the last register may only be partially stored, because the outputs of the next pixel follow it)
+      for(unsigned int pixel = 0; pixel < pixels; pixel++)
+        for(unsigned int i = 0; i < regs; i++)
+        {
+          const x86::Mem destination = a.ptr_zdi((pixel * outputs + i * vectorSize) * sizeof(float));
+          if(i < regs - 1 || lastRegOutputs == vectorSize)
+            a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, destination, accumulator(pixel, i));
+          else if(useAVX)
+          {
+            a.vmovaps(broadcast.as<x86::Ymm>(), x86::ptr(constants[1].label));
+            a.vmaskmovps(destination, broadcast.as<x86::Ymm>(), accumulator(pixel, i).as<x86::Ymm>());
+          }
+          else if(lastRegOutputs == 1)
+            a.movss(destination, accumulator(pixel, i).as<x86::Xmm>());
+          else
+          {
+            a.movlps(destination, accumulator(pixel, i).as<x86::Xmm>());
+            if(lastRegOutputs == 3)
+            {
+              a.movhlps(broadcast.as<x86::Xmm>(), accumulator(pixel, i).as<x86::Xmm>());
+              a.movss(a.ptr_zdi((pixel * outputs + i * vectorSize + 2) * sizeof(float)), broadcast.as<x86::Xmm>());
+            }
+          }
+        }
+      a.add(a.zdi(), imm(regs * vectorSize * sizeof(float)));
+    }
+
+    void GEMMCompiler::compilePixelBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int pixels) const
+    {
+      const unsigned int vectorSize = this->vectorSize();
+      const unsigned int outputRegs = (outputs() + vectorSize - 1) / vectorSize;
+      const unsigned int outputBatchRegs = this->outputBatchRegs();
+      const unsigned int lastRegOutputs = outputs() - (outputRegs - 1) * vectorSize;
+
+      // The batch that contains the partial register is compiled separately
+      const unsigned int remainingRegs = outputRegs % outputBatchRegs ? outputRegs % outputBatchRegs : outputBatchRegs;
+      const unsigned int outputBatches = (outputRegs - remainingRegs) / outputBatchRegs;
+
+      a.lea(a.zbx(), x86::ptr(constants[0].label));
+
+      if(outputBatches)
+      {
+        Label outputBatchLoop;
+        if(outputBatches > 1)
+        {
+          outputBatchLoop = a.newLabel();
+          a.mov(a.zax(), imm(outputBatches));
+          a.bind(outputBatchLoop);
+        }
+
+        compileOutputBatch(a, afHandler, pixels, outputBatchRegs, vectorSize);
+
+        if(outputBatches > 1)
+        {
+          a.dec(a.zax());
+          a.jnz(outputBatchLoop);
+        }
+      }
+      compileOutputBatch(a, afHandler, pixels, remainingRegs, lastRegOutputs);
+
+      // Set the output pointer back to the first pixel of the batch
+      a.sub(a.zdi(), imm(outputRegs * vectorSize * sizeof(float)));
+    }
+
+    void GEMMCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    {
+      ASSERT(input.rank() >= 1);
+      ASSERT(input.dims(input.rank() - 1) == inputs());
+      ASSERT(output.dims(output.rank() - 1) == outputs());
+      ASSERT(input.data() != output.data());
+
+      const unsigned int pixels = static_cast<unsigned int>(input.size() / inputs());
+      const unsigned int pixelBatchSize = this->pixelBatchSize();
+      const unsigned int pixelBatches = pixels / pixelBatchSize;
+      const unsigned int remainingPixels = pixels % pixelBatchSize;
+
+      // Load input/output base addresses
+      loadAddress(a, a.zsi(), input.data());
+      loadAddress(a, a.zdi(), output.data());
+
+      if(pixelBatches)
+      {
+        // Begin loop over pixel batches
+        Label pixelBatchLoop;
+        if(pixelBatches > 1)
+        {
+          pixelBatchLoop = a.newLabel();
+          if(settings.useX64)
+            a.mov(x86::r8d, imm(pixelBatches));
+          else
+            a.mov(a.ptr_zbp(-4, 4), imm(pixelBatches));
+          a.bind(pixelBatchLoop);
+        }
+
+        compilePixelBatch(a, afHandler, pixelBatchSize);
+
+        // End loop over pixel batches
+        if(pixelBatches > 1 || remainingPixels)
+        {
+          a.add(a.zsi(), imm(pixelBatchSize * inputs() * sizeof(float)));
+          a.add(a.zdi(), imm(pixelBatchSize * outputs() * sizeof(float)));
+        }
+        if(pixelBatches > 1)
+        {
+          if(settings.useX64)
+            a.dec(x86::r8d);
+          else
+            a.dec(a.ptr_zbp(-4, 4));
+          a.jnz(pixelBatchLoop);
+        }
+      }
+      if(remainingPixels)
+        compilePixelBatch(a, afHandler, remainingPixels);
+
+      // Avoid the penalty of mixing the upper halves of the ymm registers with SSE instructions
+      if(usesAVX())
+        a.vzeroupper();
+    }
+  }
+}
@@ -0,0 +1,109 @@
+/**
+ * Declares a compiler for the product of the pixels of a tensor (as rows of
+ * a matrix) with a weight matrix, i.e. a 1x1 convolution with stride 1 or a
+ * convolution of the output of the Im2Col2DCompiler. The outputs of a block
+ * of pixels and output channels are accumulated in registers, such that each
+ * weight that is loaded is multiplied with the inputs of several pixels.
+ */
+
+#pragma once
+
+#include "../ActivationFunctions.h"
+#include "../CompiledNNImplBase.h"
+#include "BatchNormalization.h"
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    struct GEMMCompiler : public SISOOperationCompiler
+    {
+      struct Parameters final
+      {
+        const BatchNormalizationCompiler::Parameters* batchNormalization = nullptr; /**< Is applied before the activation function (which must have been linear in the layer). */
+        const Tensor<float, 1>* weights; /**< The last dimension are the outputs, all others are flattened to the inputs (in the order of the Im2Col2DCompiler). */
+        const std::vector<float>* biases;
+        ActivationFunctionDescriptor activationDesc;
+
+        bool operator==(const Parameters& other) const
+        {
+          return batchNormalization == other.batchNormalization &&
+                 weights == other.weights &&
+                 biases == other.biases &&
+                 activationDesc == other.activationDesc;
+        }
+      };
+      const Parameters p;
+
+      GEMMCompiler(const CompilationSettings& settings, const Parameters& p) : SISOOperationCompiler(settings), p(p) {}
+
+      inline bool canBeInplace() const override { return false; }
+
+      unsigned int maxParts(const TensorPointerXf& input, const TensorPointerXf& output) const override;
+      void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                       const unsigned int part, const unsigned int parts) const override;
+
+      inline RowWindow rowWindow() const override
+      {
+        // The outputs of each pixel only depend on its own inputs
+        return {1, 1, PaddingType::valid};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        compileRows(a, afHandler, input, output, 1, 1, rowBegin, rowEnd);
+      }
+
+      void initialize() override;
+      void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
+
+      inline std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>& inputDimensions) const override
+      {
+        ASSERT(!inputDimensions.empty());
+        ASSERT(inputDimensions.back() == inputs());
+        std::vector<unsigned int> outputDimensions = inputDimensions;
+        outputDimensions.back() = outputs();
+        return outputDimensions;
+      }
+
+      /**
+       * Checks whether a convolution is faster as a GEMM (after an im2col of its input unless it is a 1x1 convolution with stride 1) than with the Conv2DCompiler.
+       * @param settings The compilation settings.
+       * @param weights The weights of the convolution.
+       * @param outputDimensions The dimensions of the output of the convolution.
+       */
+      static bool isFasterThanDirectConvolution(const CompilationSettings& settings, const Tensor<float, 1>& weights, const std::vector<unsigned int>& outputDimensions);
+
+    private:
+      inline unsigned int outputs() const { return p.weights->dims(p.weights->rank() - 1); }
+      inline unsigned int inputs() const { return static_cast<unsigned int>(p.weights->size()) / outputs(); }
+
+      /** Returns whether the code uses ymm registers. */
+      inline bool usesAVX() const { return settings.useAVX2; }
+
+      /** Returns the number of floats per register. */
+      inline unsigned int vectorSize() const { return usesAVX() ? 8 : 4; }
+
+      /** Returns the number of registers of output channels that are computed at once. */
+      unsigned int outputBatchRegs() const;
+
+      /** Returns the number of pixels that are computed at once. */
+      unsigned int pixelBatchSize() const;
+
+      /**
+       * Emits the code that computes a batch of pixels for all output channels. zsi points to the inputs of the first pixel and zdi to its outputs.
+       * @param pixels The number of pixels.
+       */
+      void compilePixelBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int pixels) const;
+
+      /**
+       * Emits the code that computes a batch of output channels for a batch of pixels. zbx points to the weights of the batch and zdi to the outputs of the first pixel (both are advanced to the next batch).
+       * @param pixels The number of pixels.
+       * @param regs The number of registers per pixel.
+       * @param lastRegOutputs The number of outputs in the last register.
+       */
+      void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int pixels, const unsigned int regs, const unsigned int lastRegOutputs) const;
+    };
+  }
+}
@@ -15,8 +15,120 @@ namespace NeuralNetwork
       {
         constants.emplace_back();
         NetworkConstants& rImageSize = constants.back();
-        rImageSize.data.resize(4);
-        rImageSize.data[0] = rImageSize.data[1] = rImageSize.data[2] = rImageSize.data[3] = 1.f / static_cast<float>(p.imageSize);
+        rImageSize.data.assign(settings.useAVX2 ? 8 : 4, 1.f / static_cast<float>(p.imageSize));
+      }
+    }
+
+    void GlobalPooling2DCompiler::poolBlock(x86::Assembler& a, const unsigned int channels, const unsigned int blockChannels, const unsigned int imageSize, const unsigned int sets) const
+    {
+      const bool useAVX = settings.useAVX2;
+      const unsigned int vectorSize = useAVX ? 8 : 4;
+      const bool aligned = !useAVX && channels % 4 == 0;
+      const unsigned int blockRegs = (blockChannels + vectorSize - 1) / vectorSize;
+      const unsigned int stride = channels * sizeof(float);
+      const x86::Xmm loadReg = x86::xmm(settings.xmmRegs() - 1);
+      ASSERT(sets * blockRegs <= settings.xmmRegs() - (useAVX || aligned ? 0 : 1));
+
+      // Only the lower half of the last register is used if at most 4 channels remain in it
+      const bool lastIsXmm = useAVX && blockChannels - (blockRegs - 1) * vectorSize <= 4;
+      auto reg = [&](const unsigned int set, const unsigned int i) -> x86::Vec
+      {
+        const x86::Xmm xmm = x86::xmm(set * blockRegs + i);
+        return useAVX && !(lastIsXmm && i == blockRegs - 1) ? x86::Vec(xmm.ymm()) : x86::Vec(xmm);
+      };
+      auto pool = [&](const x86::Vec& dst, const Operand& src)
+      {
+        if(useAVX)
+          a.emit(p.method == PoolingMethod::average ? x86::Inst::kIdVaddps : x86::Inst::kIdVmaxps, dst, dst, src);
+        else
+          a.emit(p.method == PoolingMethod::average ? x86::Inst::kIdAddps : x86::Inst::kIdMaxps, dst, src);
+      };
+      auto poolPixel = [&](const unsigned int set, const unsigned int offset)
+      {
+        for(unsigned int i = 0; i < blockRegs; i++)
+        {
+          const x86::Mem src = a.ptr_zdx(offset + i * vectorSize * sizeof(float));
+          if(useAVX || aligned)
+            pool(reg(set, i), src);
+          else
+          {
+            a.movups(loadReg, src);
+            pool(reg(set, i), loadReg);
+          }
+        }
+      };
+
+      // Load the first pixel into each set of accumulators
+      a.mov(a.zdx(), a.zsi());
+      for(unsigned int set = 0; set < sets; set++)
+      {
+        for(unsigned int i = 0; i < blockRegs; i++)
+        {
+          const x86::Mem src = a.ptr_zdx(set * stride + i * vectorSize * sizeof(float));
+          if(useAVX)
+            a.emit(x86::Inst::kIdVmovups, reg(set, i), src);
+          else if(aligned)
+            a.movaps(reg(set, i).as<x86::Xmm>(), src);
+          else
+            a.movups(reg(set, i).as<x86::Xmm>(), src);
+        }
+      }
+
+      // Pool the remaining pixels, distributing them round-robin to the accumulator sets
+      const unsigned int iterations = (imageSize - sets) / sets;
+      const unsigned int remainingPixels = (imageSize - sets) % sets;
+      if(iterations || remainingPixels)
+        a.add(a.zdx(), imm(sets * stride));
+      if(iterations)
+      {
+        Label loop;
+        if(iterations > 1)
+        {
+          a.mov(a.zcx(), imm(iterations));
+          loop = a.newLabel();
+          a.bind(loop);
+        }
+
+        for(unsigned int set = 0; set < sets; set++)
+          poolPixel(set, set * stride);
+
+        if(iterations > 1 || remainingPixels)
+          a.add(a.zdx(), imm(sets * stride));
+        if(iterations > 1)
+        {
+          a.dec(a.zcx());
+          a.jnz(loop);
+        }
+      }
+      for(unsigned int set = 0; set < remainingPixels; set++)
+        poolPixel(set, set * stride);
+
+      // Combine the accumulator sets
+      for(unsigned int set = 1; set < sets; set++)
+      {
+        for(unsigned int i = 0; i < blockRegs; i++)
+          pool(reg(0, i), reg(set, i));
+      }
+
+      // Calculate the average
+      if(p.method == PoolingMethod::average)
+      {
+        for(unsigned int i = 0; i < blockRegs; i++)
+        {
+          if(useAVX)
+            a.emit(x86::Inst::kIdVmulps, reg(0, i), reg(0, i), x86::ptr(constants[0].label));
+          else
+            a.mulps(reg(0, i).as<x86::Xmm>(), x86::ptr(constants[0].label));
+        }
+      }
+
+      // Write results
+      for(unsigned int i = 0; i < blockRegs; i++)
+      {
+        if(useAVX)
+          a.emit(x86::Inst::kIdVmovups, a.ptr_zdi(i * vectorSize * sizeof(float)), reg(0, i));
+        else
+          a.movaps(a.ptr_zdi(i * vectorSize * sizeof(float)), reg(0, i).as<x86::Xmm>());
       }
     }
 
@@ -30,7 +142,6 @@ namespace NeuralNetwork
       const unsigned int imageSize = input.dims(0) * input.dims(1);
       ASSERT(imageSize > 0);
       ASSERT(p.method != PoolingMethod::average || imageSize == p.imageSize);
-      const bool aligned = channels % 4 == 0;
 
       // Special case: no pooling is necessary
       if(imageSize == 1)
@@ -40,128 +151,57 @@ namespace NeuralNetwork
       }
 
       // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
+      loadAddress(a, a.zsi(), input.data());
       if(input.data() == output.data())
         a.mov(a.zdi(), a.zsi());
       else
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
 
-      if(channels <= 2) // Pooling on the sub-register level
+      // Unaligned SSE inputs need an additional register to load the values into
+      const unsigned int vectorSize = settings.useAVX2 ? 8 : 4;
+      const unsigned int accumulatorRegs = settings.xmmRegs() - (settings.useAVX2 || channels % 4 == 0 ? 0 : 1);
+      const unsigned int channelRegs = (channels + vectorSize - 1) / vectorSize;
+
+      if(channelRegs <= accumulatorRegs)
       {
-        // TODO
-        ASSERT(false);
+        // All channels fit into registers -> use the spare registers for independent accumulators to hide the latency of the operation
+        poolBlock(a, channels, channels, imageSize, std::min(std::min(4u, accumulatorRegs / channelRegs), imageSize));
       }
-      else if(channels <= (settings.xmmRegs() - (aligned ? 1 : 0)) * 4) // Enough registers to keep the current results in registers at all times
+      else
       {
-        const unsigned int channelRegs = (channels + 3) / 4;
-
-        // Load initial values
-        for(unsigned int i = 0; i < channelRegs; i++)
-          a.movaps(x86::xmm(i), a.ptr_zsi(i * 4 * sizeof(float)));
-        a.add(a.zsi(), imm(channels * sizeof(float)));
+        // Pool blocks of channels that fit into the registers one after another
+        // Writing the results of a block is safe even if the operation is inplace because following blocks only read behind it
+        const unsigned int blockChannels = accumulatorRegs * vectorSize;
+        const unsigned int blocks = channels / blockChannels;
+        const unsigned int remainingChannels = channels % blockChannels;
 
-        // Begin loop
         Label loop;
-        if(imageSize > 2)
+        if(blocks > 1)
         {
-          a.mov(a.zcx(), imm(imageSize));
+          a.mov(a.zax(), imm(blocks));
           loop = a.newLabel();
           a.bind(loop);
         }
 
-        if(!aligned)
-        {
-          // Inputs are not aligned -> we need additional registers to load the values into
-          unsigned int curChannelRegOffset = 0;
-          for(unsigned int stepSize = std::min(channelRegs, settings.xmmRegs() - channelRegs); curChannelRegOffset != channelRegs; stepSize = std::min(channelRegs - curChannelRegOffset, settings.xmmRegs() - channelRegs))
-          {
-            while(curChannelRegOffset + stepSize <= channelRegs)
-            {
-              if(curChannelRegOffset == channelRegs - 1 && channels % 4 == 1)
-              {
-                // Exactly one value remains
-                if(p.method == PoolingMethod::average)
-                  a.addss(x86::xmm(curChannelRegOffset), a.ptr_zsi(curChannelRegOffset * 4 * sizeof(float)));
-                else
-                  a.maxss(x86::xmm(curChannelRegOffset), a.ptr_zsi(curChannelRegOffset * 4 * sizeof(float)));
-              }
-              else
-              {
-                // Read values from memory
-                for(unsigned int i = 0; i < stepSize; stepSize++)
-                  a.movups(x86::xmm(channelRegs + i), a.ptr_zsi((curChannelRegOffset + i) * 4 * sizeof(float)));
-
-                // Pool values
-                if(p.method == PoolingMethod::average)
-                {
-                  for(unsigned int i = 0; i < stepSize; stepSize++)
-                    a.addps(x86::xmm(curChannelRegOffset + i), x86::xmm(channelRegs + i));
-                }
-                else
-                {
-                  for(unsigned int i = 0; i < stepSize; stepSize++)
-                    a.maxps(x86::xmm(curChannelRegOffset + i), x86::xmm(channelRegs + i));
-                }
-              }
-
-              curChannelRegOffset += stepSize;
-            }
-          }
-        }
-        else
-        {
-          // Inputs are aligned -> nothing special to worry about
-          if(p.method == PoolingMethod::average)
-          {
-            for(unsigned int i = 0; i < channelRegs; i++)
-              a.addps(x86::xmm(i), a.ptr_zsi(i * 4 * sizeof(float)));
-          }
-          else
-          {
-            for(unsigned int i = 0; i < channelRegs; i++)
-              a.maxps(x86::xmm(i), a.ptr_zsi(i * 4 * sizeof(float)));
-          }
-        }
+        poolBlock(a, channels, blockChannels, imageSize, 1);
 
-        // End loop
-        if(imageSize > 2)
+        if(blocks > 1 || remainingChannels)
         {
-          a.add(a.zsi(), imm(channels * sizeof(float)));
-          a.dec(a.zcx());
-          a.jnz(loop);
+          a.add(a.zsi(), imm(blockChannels * sizeof(float)));
+          a.add(a.zdi(), imm(blockChannels * sizeof(float)));
         }
-
-        // Calculate the average (if a register is available)
-        if(p.method == PoolingMethod::average && settings.xmmRegs() > channelRegs)
+        if(blocks > 1)
         {
-          a.movaps(x86::xmm(settings.xmmRegs() - 1), x86::ptr(constants[0].label));
-
-          for(unsigned int i = 0; i < channelRegs; i++)
-            a.mulps(x86::xmm(i), x86::xmm(settings.xmmRegs() - 1));
+          a.dec(a.zax());
+          a.jnz(loop);
         }
 
-        // Write results
-        for(unsigned int i = 0; i < channelRegs; i++)
-          a.movaps(a.ptr_zdi(i * 4 * sizeof(float)), x86::xmm(i));
-
-        // Calculate the average (if no registers were available)
-        if(p.method == PoolingMethod::average && settings.xmmRegs() == channelRegs)
-        {
-          a.movaps(x86::xmm0, x86::ptr(constants[0].label));
-
-          for(unsigned int i = 1; i < channelRegs; i++)
-            a.movaps(x86::xmm(i), x86::xmm0);
-          for(unsigned int i = 0; i < channelRegs; i++)
-            a.mulps(x86::xmm(i), a.ptr_zdi(i * 4 * sizeof(float)));
-          for(unsigned int i = 0; i < channelRegs; i++)
-            a.movaps(a.ptr_zdi(i * 4 * sizeof(float)), x86::xmm(i));
-        }
-      }
-      else
-      {
-        // TODO
-        ASSERT(false);
+        if(remainingChannels)
+          poolBlock(a, channels, remainingChannels, imageSize, 1);
       }
+
+      if(settings.useAVX2)
+        a.vzeroupper();
     }
   }
 }
@@ -40,6 +40,17 @@ namespace NeuralNetwork
         ASSERT(inputDimensions.size() == 3);
         return {inputDimensions[2]};
       }
+
+    private:
+      /**
+       * Pools a block of channels over the whole image, keeping the results in registers.
+       * zsi and zdi must point to the first channel of the block in the input and output, respectively.
+       * @param channels The number of channels of the input.
+       * @param blockChannels The number of channels in this block.
+       * @param imageSize The number of pixels of the input.
+       * @param sets The number of independent sets of accumulators which are combined at the end.
+       */
+      void poolBlock(x86::Assembler& a, const unsigned int channels, const unsigned int blockChannels, const unsigned int imageSize, const unsigned int sets) const;
     };
   }
 }
@@ -4,6 +4,7 @@
 
 #include "Im2Col2D.h"
 #include "Platform/BHAssert.h"
+#include <algorithm>
 
 namespace NeuralNetwork
 {
@@ -15,13 +16,13 @@ namespace NeuralNetwork
       ASSERT(output.rank() == 3);
       ASSERT(p.paddingType == PaddingType::valid || p.paddingType == PaddingType::same);
       ASSERT(p.kernelSize[0] >= 1 && p.kernelSize[1] >= 1);
-      ASSERT(p.kernelSize[0] > 1 || p.kernelSize[1] > 1); // Im2Col for 1x1-kernels would be a no-op
+      ASSERT(p.kernelSize[0] > 1 || p.kernelSize[1] > 1 || p.strides[0] > 1 || p.strides[1] > 1); // Im2Col for 1x1-kernels with stride 1 would be a no-op
       ASSERT(p.strides[0] >= 1 && p.strides[1] >= 1);
       ASSERT(p.dilation[0] >= 1 && p.dilation[1] >= 1);
 
-      // Calculate padding
-      const unsigned int verticalPadding = p.paddingType == PaddingType::same ? (output.dims(0) - 1) * p.strides[0] + p.kernelSize[0] + (p.kernelSize[0] - 1) * (p.dilation[0] - 1) - input.dims(0) : 0;
-      const unsigned int horizontalPadding = p.paddingType == PaddingType::same ? (output.dims(1) - 1) * p.strides[1] + p.kernelSize[1] + (p.kernelSize[1] - 1) * (p.dilation[1] - 1) - input.dims(1) : 0;
+      // Calculate padding (which can be negative, i.e. zero, if the stride is larger than the kernel)
+      const unsigned int verticalPadding = p.paddingType == PaddingType::same ? std::max(static_cast<int>((output.dims(0) - 1) * p.strides[0] + p.kernelSize[0] + (p.kernelSize[0] - 1) * (p.dilation[0] - 1)) - static_cast<int>(input.dims(0)), 0) : 0;
+      const unsigned int horizontalPadding = p.paddingType == PaddingType::same ? std::max(static_cast<int>((output.dims(1) - 1) * p.strides[1] + p.kernelSize[1] + (p.kernelSize[1] - 1) * (p.dilation[1] - 1)) - static_cast<int>(input.dims(1)), 0) : 0;
       const std::array<unsigned int, 4> padding
       {
         {
@@ -38,13 +39,17 @@ namespace NeuralNetwork
         a.xorps(x86::xmm0, x86::xmm0);
 
       // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
-      a.mov(a.zdi(), imm(output.data()));
+      loadAddress(a, a.zsi(), input.data());
+      loadAddress(a, a.zdi(), output.data());
 
       // Top padding
       int inputY = -static_cast<int>(padding[Side::TOP]);
       for(; inputY < 0; inputY += p.strides[0])
-        compileIm2ColRow(a, {{static_cast<unsigned int>(-inputY), 0}}, padding, input);
+      {
+        // The kernel can also exceed the bottom of small inputs
+        const unsigned int inputYEnd = inputY + (p.kernelSize[0] - 1) * p.dilation[0];
+        compileIm2ColRow(a, {{static_cast<unsigned int>(-inputY), inputYEnd < input.dims(0) ? 0 : inputYEnd + 1 - input.dims(0)}}, padding, input);
+      }
       if(inputY > 0)
         a.add(a.zsi(), imm(static_cast<unsigned long long>(inputY) * input.dims(1) * input.dims(2) * sizeof(float)));
 
@@ -80,7 +85,11 @@ namespace NeuralNetwork
 
       // Left padding
       for(; inputX < 0; inputX += p.strides[1])
-        compileIm2ColKernel(a, { {rowPadding[Side::TOP], rowPadding[Side::BOTTOM], static_cast<unsigned int>(-inputX), 0}}, input, 0);
+      {
+        // The kernel can also exceed the right of small inputs
+        const unsigned int inputXEnd = inputX + (p.kernelSize[1] - 1) * p.dilation[1];
+        compileIm2ColKernel(a, {{rowPadding[Side::TOP], rowPadding[Side::BOTTOM], static_cast<unsigned int>(-inputX), inputXEnd < input.dims(1) ? 0 : inputXEnd + 1 - input.dims(1)}}, input, 0);
+      }
       if(inputX > 0)
         a.add(a.zsi(), imm(static_cast<unsigned long long>(inputX) * input.dims(2) * sizeof(float)));
 
@@ -219,7 +228,7 @@ namespace NeuralNetwork
         for(unsigned int kernelYCount = verticalKernelCells; kernelYCount; kernelYCount--)
         {
           // Read channels for all cells in kernel
-          for(unsigned int kernelCell = 0; kernelCell < input.dims(2) * horizontalKernelCells + 3; curReg++, kernelCell += 4)
+          for(unsigned int kernelCell = 0; kernelCell < input.dims(2) * horizontalKernelCells; curReg++, kernelCell += 4)
           {
             if(cellsAligned)
               a.movaps(x86::xmm(curReg), a.ptr_zbx(static_cast<int>((inputOffset + kernelCell) * sizeof(float))));
@@ -232,7 +241,7 @@ namespace NeuralNetwork
         }
 
         // Write values
-        curReg = 0;
+        curReg = regOffset;
         for(size_t kernelYCount = verticalKernelCells; kernelYCount; kernelYCount--)
         {
           // Pad output for left part of kernel
@@ -247,7 +256,7 @@ namespace NeuralNetwork
               a.movups(a.ptr_zdi(static_cast<int>(outputOffset)), x86::xmm(curReg));
           }
           if((input.dims(2) * horizontalKernelCells) % 4 != 0)
-            outputOffset -= 4 - ((input.dims(2) * horizontalKernelCells) % 4);
+            outputOffset -= (4 - ((input.dims(2) * horizontalKernelCells) % 4)) * sizeof(float);
 
           // Pad output for right part of kernel
           outputOffset = pad(rightPaddingCells * input.dims(2), outputOffset);
@@ -284,7 +293,7 @@ namespace NeuralNetwork
         }
 
         // Write values
-        curReg = 0;
+        curReg = regOffset;
         for(size_t kernelYCount = verticalKernelCells; kernelYCount; kernelYCount--)
         {
           // Pad output for left part of kernel
@@ -300,32 +309,51 @@ namespace NeuralNetwork
                 a.movups(a.ptr_zdi(static_cast<int>(outputOffset)), x86::xmm(curReg));
             }
             if(input.dims(2) % 4 != 0)
-              outputOffset -= 4 - (input.dims(2) % 4);
+              outputOffset -= (4 - (input.dims(2) % 4)) * sizeof(float);
           }
 
           // Pad output for right part of kernel
           outputOffset = pad(rightPaddingCells * input.dims(2), outputOffset);
         }
       }
-      else if(p.dilation[1] == 1 && availableRegisters >= (input.dims(2) * horizontalKernelCells + 3) / 4)
-      {
-        // No horizontal dilation and one row of the kernel fits in the registers
-        FAIL("not implemented");
-      }
-      else if(availableRegisters >= regsPerCol * horizontalKernelCells)
-      {
-        // Horizontal dilation and one row of the kernel fits in the registers
-        FAIL("not implemented");
-      }
-      else if(availableRegisters >= regsPerCol)
-      {
-        // One cell of the kernel fits in the registers
-        FAIL("not implemented");
-      }
       else
       {
-        // Less than a cell fits in the registers
-        FAIL("not implemented");
+        // The kernel does not fit in the registers, so each contiguous run of input values (a row of the kernel without horizontal dilation, a cell otherwise) is copied in chunks
+        const unsigned int runs = p.dilation[1] == 1 ? 1 : horizontalKernelCells;
+        const unsigned int runLength = p.dilation[1] == 1 ? input.dims(2) * horizontalKernelCells : input.dims(2);
+        const unsigned int regsPerRun = (runLength + 3) / 4;
+        for(unsigned int kernelY = 0; kernelY < verticalKernelCells; kernelY++)
+        {
+          // Pad output for left part of kernel
+          outputOffset = pad(leftPaddingCells * input.dims(2), outputOffset);
+
+          for(unsigned int run = 0; run < runs; run++)
+          {
+            const unsigned long long inputOffset = (kernelY * p.dilation[0] * input.dims(1) + run * p.dilation[1]) * input.dims(2);
+            for(unsigned int chunk = 0; chunk < regsPerRun; chunk += availableRegisters)
+            {
+              const unsigned int chunkRegs = std::min(availableRegisters, regsPerRun - chunk);
+              for(unsigned int i = 0; i < chunkRegs; i++)
+              {
+                if(cellsAligned)
+                  a.movaps(x86::xmm(regOffset + i), a.ptr_zbx(static_cast<int>((inputOffset + (chunk + i) * 4) * sizeof(float))));
+                else
+                  a.movups(x86::xmm(regOffset + i), a.ptr_zbx(static_cast<int>((inputOffset + (chunk + i) * 4) * sizeof(float))));
+              }
+              for(unsigned int i = 0; i < chunkRegs; i++)
+              {
+                if(cellsAligned)
+                  a.movaps(a.ptr_zdi(static_cast<int>(outputOffset + (chunk + i) * 4 * sizeof(float))), x86::xmm(regOffset + i));
+                else
+                  a.movups(a.ptr_zdi(static_cast<int>(outputOffset + (chunk + i) * 4 * sizeof(float))), x86::xmm(regOffset + i));
+              }
+            }
+            outputOffset += runLength * sizeof(float);
+          }
+
+          // Pad output for right part of kernel
+          outputOffset = pad(rightPaddingCells * input.dims(2), outputOffset);
+        }
       }
 
       // Pad output for bottom part of kernel
@@ -23,6 +23,14 @@ namespace NeuralNetwork
         std::array<unsigned int, 2> strides;
         std::array<unsigned int, 2> dilation;
         PaddingType paddingType;
+
+        bool operator==(const Parameters& other) const
+        {
+          return kernelSize == other.kernelSize &&
+                 strides == other.strides &&
+                 dilation == other.dilation &&
+                 paddingType == other.paddingType;
+        }
       };
       const Parameters p;
 
@@ -33,6 +41,20 @@ namespace NeuralNetwork
         return false;
       }
 
+      inline RowWindow rowWindow() const override
+      {
+        // The padding of the windows at the bottom of the input depends on its height
+        if(p.paddingType != PaddingType::valid)
+          return RowWindow();
+        return {p.kernelSize[0] + (p.kernelSize[0] - 1) * (p.dilation[0] - 1), p.strides[0], p.paddingType};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        compileRows(a, afHandler, input, output, rowWindow().height, p.strides[0], rowBegin, rowEnd);
+      }
+
       void initialize() override {}
       void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
 
@@ -26,7 +26,7 @@ namespace NeuralNetwork
       const bool aligned = channels % 4 == 0;
       const bool isPadded = padding > 0;
       const unsigned int regsPerStep = aligned && !(isPadded && p.method == PoolingMethod::max) ? settings.xmmRegs() : settings.xmmRegs() - 1;
-      const x86::Xmm helperReg = aligned ? x86::xmm(settings.xmmRegs() - 1) : x86::xmm(settings.xmmRegs() - 2);
+      const x86::Xmm helperReg = x86::xmm(settings.xmmRegs() - 1);
 
       if(!helperRegInitialized && (channels + 3) / 4 < (aligned ? settings.xmmRegs() : settings.xmmRegs() - 1))
       {
@@ -77,7 +77,7 @@ namespace NeuralNetwork
             else
             {
               const unsigned int helperOffset = stepSize;
-              const unsigned int helperCount = settings.xmmRegs() - stepSize;
+              const unsigned int helperCount = settings.xmmRegs() - stepSize - (helperRegInitialized ? 1 : 0);
               unsigned int helper = 0;
               for(unsigned int step = 0; step < stepSize;)
               {
@@ -146,7 +146,12 @@ namespace NeuralNetwork
         // Store results
         for(unsigned int step = 0; step < stepSize; step++)
         {
-          if(aligned)
+          // Inplace pooling of less than 3 channels must not overwrite the inputs of the next output behind the stored values
+          if(channels == 1)
+            a.movss(a.ptr_zdi(), x86::xmm(step));
+          else if(channels == 2)
+            a.movlps(a.ptr_zdi(), x86::xmm(step));
+          else if(aligned)
             a.movaps(a.ptr_zdi((channelOffset + step * 4) * sizeof(float)), x86::xmm(step));
           else
             a.movups(a.ptr_zdi((channelOffset + step * 4) * sizeof(float)), x86::xmm(step));
@@ -176,11 +181,11 @@ namespace NeuralNetwork
         ASSERT(outputWidth == (inputWidth + p.stride - 1) / p.stride);
 
       // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
+      loadAddress(a, a.zsi(), input.data());
       if(input.data() == output.data())
         a.mov(a.zdi(), a.zsi());
       else
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
 
       bool helperRegInitialized = false;
 
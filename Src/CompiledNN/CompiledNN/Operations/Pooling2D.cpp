@@ -16,17 +16,98 @@ namespace NeuralNetwork
         constants.resize(1);
         constants.back().data.clear();
         const float factor = 1.f / static_cast<float>(p.kernelSize[0] * p.kernelSize[1]);
-        for(unsigned int i = 4; i; --i)
+        for(unsigned int i = settings.useAVX2 ? 8 : 4; i; --i)
           constants.back().data.emplace_back(factor);
       }
     }
 
+    bool Pooling2DCompiler::needsHelperRegAVX() const
+    {
+      return (p.method == PoolingMethod::max && p.padding != PaddingType::valid) || (p.method == PoolingMethod::average && p.kernelSize[0] * p.kernelSize[1] > 1);
+    }
+
+    void Pooling2DCompiler::poolAVX(x86::Assembler& a, const unsigned int paddingHorizontal, const unsigned int paddingVertical, const unsigned int inputWidth, const unsigned int channels) const
+    {
+      const bool isPadded = paddingHorizontal + paddingVertical > 0;
+      const unsigned int regsPerStep = settings.xmmRegs() - (needsHelperRegAVX() ? 1 : 0);
+      const x86::Ymm helperReg = x86::ymm(settings.xmmRegs() - 1);
+
+      for(unsigned int channelOffset = 0; channelOffset < channels; channelOffset += 8 * regsPerStep)
+      {
+        const unsigned int processedChannels = std::min(regsPerStep * 8, channels - channelOffset);
+        const unsigned int stepSize = (processedChannels + 7) / 8;
+
+        // Only the lower half of the last register is used if at most 4 channels remain in it
+        const bool lastIsXmm = processedChannels - (stepSize - 1) * 8 <= 4;
+        auto reg = [&](const unsigned int step) -> x86::Vec
+        {
+          return lastIsXmm && step == stepSize - 1 ? x86::Vec(x86::xmm(step)) : x86::Vec(x86::ymm(step));
+        };
+
+        // Apply filter
+        bool first = true;
+        for(unsigned int filterY = 0; filterY < p.kernelSize[0] - paddingVertical; filterY++)
+        {
+          for(unsigned int filterX = 0; filterX < p.kernelSize[1] - paddingHorizontal; filterX++)
+          {
+            const unsigned int offset = ((filterY * inputWidth + filterX) * channels + channelOffset) * sizeof(float);
+            for(unsigned int step = 0; step < stepSize; step++)
+            {
+              const x86::Mem src = a.ptr_zsi(offset + step * 8 * sizeof(float));
+              if(first)
+                a.emit(x86::Inst::kIdVmovups, reg(step), src);
+              else
+                a.emit(p.method == PoolingMethod::average ? x86::Inst::kIdVaddps : x86::Inst::kIdVmaxps, reg(step), reg(step), src);
+            }
+            first = false;
+          }
+        }
+
+        if(isPadded && p.method == PoolingMethod::max)
+        {
+          for(unsigned int step = 0; step < stepSize; step++)
+            a.emit(x86::Inst::kIdVmaxps, reg(step), reg(step), helperReg);
+        }
+        if(p.method == PoolingMethod::average && p.kernelSize[0] * p.kernelSize[1] > 1)
+        {
+          for(unsigned int step = 0; step < stepSize; step++)
+            a.emit(x86::Inst::kIdVmulps, reg(step), reg(step), helperReg);
+        }
+
+        // Store results
+        if(channels == 1)
+          a.vmovss(a.ptr_zdi(), x86::xmm0);
+        else if(channels == 2)
+          a.vmovlps(a.ptr_zdi(), x86::xmm0);
+        else
+        {
+          // The last register is stored exactly if the outputs behind it may belong to another part
+          const unsigned int lastChannels = processedChannels - (stepSize - 1) * 8;
+          for(unsigned int step = 0; step < stepSize; step++)
+          {
+            if(step == stepSize - 1 && lastChannels % 4 && splitIntoParts)
+              storePartialVector(a, a.ptr_zdi((channelOffset + step * 8) * sizeof(float)), reg(step), lastChannels, true);
+            else
+              a.emit(x86::Inst::kIdVmovups, a.ptr_zdi((channelOffset + step * 8) * sizeof(float)), reg(step));
+          }
+        }
+      }
+
+      a.add(a.zdi(), imm(channels * sizeof(float)));
+    }
+
     void Pooling2DCompiler::pool(x86::Assembler& a, ActivationFunctionHandler&, const unsigned int paddingHorizontal, const unsigned int paddingVertical, const unsigned int inputWidth, const unsigned int channels) const
     {
+      if(settings.useAVX2)
+      {
+        poolAVX(a, paddingHorizontal, paddingVertical, inputWidth, channels);
+        return;
+      }
+
       const bool aligned = channels % 4 == 0;
       const bool isPadded = paddingHorizontal + paddingVertical > 0;
       const unsigned int regsPerStep = aligned && !(isPadded && p.method == PoolingMethod::max) ? settings.xmmRegs() : settings.xmmRegs() - 1;
-      const x86::Xmm helperReg = aligned ? x86::xmm(settings.xmmRegs() - 1) : x86::xmm(settings.xmmRegs() - 2);
+      const x86::Xmm helperReg = x86::xmm(settings.xmmRegs() - 1);
 
       if(!helperRegInitialized && (channels + 3) / 4 < (aligned ? settings.xmmRegs() : settings.xmmRegs() - 1))
       {
@@ -79,7 +160,7 @@ namespace NeuralNetwork
               else
               {
                 const unsigned int helperOffset = stepSize;
-                const unsigned int helperCount = settings.xmmRegs() - stepSize;
+                const unsigned int helperCount = settings.xmmRegs() - stepSize - (helperRegInitialized ? 1 : 0);
                 unsigned int helper = 0;
                 for(unsigned int step = 0; step < stepSize;)
                 {
@@ -149,7 +230,14 @@ namespace NeuralNetwork
         // Store results
         for(unsigned int step = 0; step < stepSize; step++)
         {
-          if(aligned)
+          // Inplace pooling of less than 3 channels must not overwrite the inputs of the next output behind the stored values
+          if(channels == 1)
+            a.movss(a.ptr_zdi(), x86::xmm(step));
+          else if(channels == 2)
+            a.movlps(a.ptr_zdi(), x86::xmm(step));
+          else if(step == stepSize - 1 && processedChannels % 4 && splitIntoParts)
+            storePartialVector(a, a.ptr_zdi((channelOffset + step * 4) * sizeof(float)), x86::xmm(step), processedChannels % 4, false);
+          else if(aligned)
             a.movaps(a.ptr_zdi((channelOffset + step * 4) * sizeof(float)), x86::xmm(step));
           else
             a.movups(a.ptr_zdi((channelOffset + step * 4) * sizeof(float)), x86::xmm(step));
@@ -219,13 +307,15 @@ namespace NeuralNetwork
       ASSERT(input.rank() == 3);
       ASSERT(output.rank() == 3);
 
+      helperRegInitialized = false;
+
       if(p.kernelSize[0] <= 1 && p.kernelSize[1] <= 1 && p.strides[0] <= 1 && p.strides[1] <= 1)
         return;
 
       // Calculate padding (cf. https://github.com/eigenteam/eigen-git-mirror/blob/master/unsupported/Eigen/CXX11/src/Tensor/TensorImagePatch.h#L262)
       const bool validPadding = p.padding == PaddingType::valid;
-      const unsigned int paddingTop = validPadding ? 0 : ((output.dims(0) - 1) * p.strides[0] + p.kernelSize[0] - input.dims(0)) / 2;
-      const unsigned int paddingLeft = validPadding ? 0 : ((output.dims(1) - 1) * p.strides[1] + p.kernelSize[1] - input.dims(1)) / 2;
+      const unsigned int paddingTop = validPadding ? 0 : std::max(static_cast<int>((output.dims(0) - 1) * p.strides[0] + p.kernelSize[0]) - static_cast<int>(input.dims(0)), 0) / 2;
+      const unsigned int paddingLeft = validPadding ? 0 : std::max(static_cast<int>((output.dims(1) - 1) * p.strides[1] + p.kernelSize[1]) - static_cast<int>(input.dims(1)), 0) / 2;
       if(validPadding)
       {
         ASSERT(output.dims(0) == (input.dims(0) - p.kernelSize[0] + p.strides[0]) / p.strides[0]);
@@ -238,11 +328,20 @@ namespace NeuralNetwork
       }
 
       // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
+      loadAddress(a, a.zsi(), input.data());
       if(input.data() == output.data())
         a.mov(a.zdi(), a.zsi());
       else
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
+
+      // With AVX, the zeros for padded max pooling or the factor for average pooling are kept in the last register
+      if(settings.useAVX2 && needsHelperRegAVX())
+      {
+        if(p.method == PoolingMethod::max)
+          a.vxorps(x86::ymm(settings.xmmRegs() - 1), x86::ymm(settings.xmmRegs() - 1), x86::ymm(settings.xmmRegs() - 1));
+        else
+          a.vmovaps(x86::ymm(settings.xmmRegs() - 1), x86::ptr(constants.back().label));
+      }
 
       // Pool top-padded rows
       unsigned int inputRow = 0;
@@ -286,6 +385,9 @@ namespace NeuralNetwork
         if(outputRow < output.dims(0) - 1)
           a.add(a.zsi(), imm(p.strides[0] * input.dims(1) * input.dims(2) * sizeof(float) - offset));
       }
+
+      if(settings.useAVX2)
+        a.vzeroupper();
     }
   }
 }
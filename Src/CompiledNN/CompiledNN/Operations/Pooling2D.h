@@ -36,6 +36,38 @@ namespace NeuralNetwork
         return p.strides[0] >= p.kernelSize[0] && p.strides[1] >= p.kernelSize[1];
       }
 
+      inline unsigned int maxParts(const TensorPointerXf& input, const TensorPointerXf& output) const override
+      {
+        return p.padding == PaddingType::valid ? rowParts(input, output, p.strides[0]) : 1;
+      }
+
+      inline void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                              const unsigned int part, const unsigned int parts) const override
+      {
+        if(parts == 1)
+        {
+          compile(a, afHandler, input, output);
+          return;
+        }
+        const std::array<unsigned int, 2> rows = partRows(input, output, p.strides[0], part, parts);
+        if(rows[0] < rows[1])
+          compileRowRange(a, afHandler, input, output, rows[0], rows[1]);
+      }
+
+      inline RowWindow rowWindow() const override
+      {
+        // The padding of the windows at the bottom of the input depends on its height
+        if(p.padding != PaddingType::valid)
+          return RowWindow();
+        return {p.kernelSize[0], p.strides[0], p.padding};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        compileRows(a, afHandler, input, output, p.kernelSize[0], p.strides[0], rowBegin, rowEnd);
+      }
+
       void initialize() override;
       void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
 
@@ -50,6 +82,8 @@ namespace NeuralNetwork
     private:
       mutable bool helperRegInitialized = false;
 
+      bool needsHelperRegAVX() const;
+      void poolAVX(x86::Assembler& a, const unsigned int paddingHorizontal, const unsigned int paddingVertical, const unsigned int inputWidth, const unsigned int channels) const;
       void pool(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int paddingHorizontal, const unsigned int paddingVertical, const unsigned int inputWidth, const unsigned int channels) const;
       unsigned int poolRow(x86::Assembler& a, ActivationFunctionHandler& afHandler, const unsigned int paddingLeft, const unsigned int paddingVertical, const unsigned int inputWidth, const unsigned int outputWidth, const unsigned int channels) const;
     };
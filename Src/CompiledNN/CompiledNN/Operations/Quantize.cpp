@@ -0,0 +1,199 @@
+/**
+ * Implements an operation that converts a float tensor to 7 bit unsigned
+ * integers.
+ */
+
+#include "Quantize.h"
+#include "Platform/BHAssert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    bool QuantizeCompiler::canQuantize(const std::vector<unsigned int>& dimensions)
+    {
+      return !dimensions.empty() && (dimensions.back() % 4 == 0 || std::accumulate(dimensions.begin(), dimensions.end() - 1, 1u, std::multiplies<unsigned int>()) == 1);
+    }
+
+    unsigned int QuantizeCompiler::quantizedSize(const std::vector<unsigned int>& dimensions)
+    {
+      ASSERT(canQuantize(dimensions));
+      const unsigned int size = std::accumulate(dimensions.begin(), dimensions.end(), 1u, std::multiplies<unsigned int>());
+      return (size + 3) / 4 * 4;
+    }
+
+    void QuantizeCompiler::initialize()
+    {
+      // The reciprocal of the largest value, the smallest scale and 1, followed by 16 bytes that contain the largest value
+      constants.resize(1);
+      std::vector<float>& data = constants[0].data;
+      data = {1.f / 127.f, std::numeric_limits<float>::min(), 1.f, 0.f};
+      data.resize(8);
+      std::memset(data.data() + 4, 127, 16);
+      if(!isCalibrated())
+        return;
+
+      // With a calibrated range, the header is followed by 1 / s, z, the minimum and the maximum (4 times each), in the same way as they would be computed by the code
+      const float scale = std::max((p.max - p.min) * (1.f / 127.f), std::numeric_limits<float>::min());
+      const float inverseScale = 1.f / scale;
+      const int zeroPoint = -static_cast<int>(std::nearbyint(p.min * inverseScale));
+      data[0] = scale;
+      data[1] = static_cast<float>(zeroPoint) * scale;
+      data.resize(24);
+      std::fill(data.begin() + 8, data.begin() + 12, inverseScale);
+      for(unsigned int i = 12; i < 16; ++i)
+        std::memcpy(&data[i], &zeroPoint, sizeof(float));
+      std::fill(data.begin() + 16, data.begin() + 20, p.min);
+      std::fill(data.begin() + 20, data.end(), p.max);
+    }
+
+    void QuantizeCompiler::compile(x86::Assembler& a, ActivationFunctionHandler&, const TensorPointerXf& input, const TensorPointerXf& output) const
+    {
+      ASSERT(output.size() * sizeof(float) == headerSize * sizeof(float) + quantizedSize(input.dims()));
+      const unsigned int size = static_cast<unsigned int>(input.size());
+      const Label& c = constants[0].label;
+
+      if(isCalibrated())
+      {
+        // Copy the header and load 1 / s (xmm2), z (xmm3) and the largest value (xmm4)
+        loadAddress(a, a.zdi(), output.data());
+        a.movq(x86::xmm1, x86::ptr(c));
+        a.movq(a.ptr_zdi(), x86::xmm1);
+        a.add(a.zdi(), imm(headerSize * sizeof(float)));
+        a.movaps(x86::xmm2, x86::ptr(c, 8 * sizeof(float)));
+        a.movdqa(x86::xmm3, x86::ptr(c, 12 * sizeof(float)));
+        a.movdqa(x86::xmm4, x86::ptr(c, 4 * sizeof(float)));
+        compileConversion(a, input, true);
+        return;
+      }
+
+      // Determine the minimum (xmm0) and maximum (xmm1) including 0
+      loadAddress(a, a.zsi(), input.data());
+      a.xorps(x86::xmm0, x86::xmm0);
+      a.xorps(x86::xmm1, x86::xmm1);
+      if(size / 4)
+      {
+        Label loop;
+        if(size / 4 > 1)
+        {
+          a.mov(a.zcx(), imm(size / 4));
+          loop = a.newLabel();
+          a.bind(loop);
+        }
+        a.movups(x86::xmm2, a.ptr_zsi());
+        a.minps(x86::xmm0, x86::xmm2);
+        a.maxps(x86::xmm1, x86::xmm2);
+        a.add(a.zsi(), imm(4 * sizeof(float)));
+        if(size / 4 > 1)
+        {
+          a.dec(a.zcx());
+          a.jnz(loop);
+        }
+      }
+      for(unsigned int i = 0; i < size % 4; ++i)
+      {
+        a.movss(x86::xmm2, a.ptr_zsi(i * sizeof(float)));
+        a.minss(x86::xmm0, x86::xmm2);
+        a.maxss(x86::xmm1, x86::xmm2);
+      }
+      for(const unsigned int shuffle : {0x4eu, 0xb1u})
+      {
+        a.movaps(x86::xmm2, x86::xmm0);
+        a.shufps(x86::xmm2, x86::xmm2, imm(shuffle));
+        a.minps(x86::xmm0, x86::xmm2);
+        a.movaps(x86::xmm2, x86::xmm1);
+        a.shufps(x86::xmm2, x86::xmm2, imm(shuffle));
+        a.maxps(x86::xmm1, x86::xmm2);
+      }
+
+      // s = (max - min) / 127 (but never 0), z = round(-min / s)
+      a.subss(x86::xmm1, x86::xmm0);
+      a.mulss(x86::xmm1, x86::ptr(c));
+      a.maxss(x86::xmm1, x86::ptr(c, sizeof(float)));
+      a.movss(x86::xmm2, x86::ptr(c, 2 * sizeof(float)));
+      a.divss(x86::xmm2, x86::xmm1);
+      a.mulss(x86::xmm0, x86::xmm2);
+      a.cvtss2si(x86::eax, x86::xmm0);
+      a.neg(x86::eax);
+
+      // Write the header
+      loadAddress(a, a.zdi(), output.data());
+      a.movss(a.ptr_zdi(), x86::xmm1);
+      a.cvtsi2ss(x86::xmm3, x86::eax);
+      a.mulss(x86::xmm3, x86::xmm1);
+      a.movss(a.ptr_zdi(sizeof(float)), x86::xmm3);
+      a.add(a.zdi(), imm(headerSize * sizeof(float)));
+
+      // Broadcast 1 / s (xmm2) and z (xmm3)
+      a.shufps(x86::xmm2, x86::xmm2, imm(0));
+      a.movd(x86::xmm3, x86::eax);
+      a.pshufd(x86::xmm3, x86::xmm3, imm(0));
+      a.movdqa(x86::xmm4, x86::ptr(c, 4 * sizeof(float)));
+      compileConversion(a, input, false);
+    }
+
+    void QuantizeCompiler::compileConversion(x86::Assembler& a, const TensorPointerXf& input, const bool clip) const
+    {
+      const unsigned int size = static_cast<unsigned int>(input.size());
+      const Label& c = constants[0].label;
+
+      // Convert blocks of 16 values
+      const auto convert = [&](const x86::Xmm& reg, const unsigned int offset)
+      {
+        a.movups(reg, a.ptr_zsi(offset));
+        if(clip)
+        {
+          // Values outside of the calibrated range could overflow the conversion to integers
+          a.maxps(reg, x86::ptr(c, 16 * sizeof(float)));
+          a.minps(reg, x86::ptr(c, 20 * sizeof(float)));
+        }
+        a.mulps(reg, x86::xmm2);
+        a.cvtps2dq(reg, reg);
+        a.paddd(reg, x86::xmm3);
+      };
+      loadAddress(a, a.zsi(), input.data());
+      if(size / 16)
+      {
+        Label loop;
+        if(size / 16 > 1)
+        {
+          a.mov(a.zcx(), imm(size / 16));
+          loop = a.newLabel();
+          a.bind(loop);
+        }
+        convert(x86::xmm0, 0);
+        convert(x86::xmm1, 4 * sizeof(float));
+        convert(x86::xmm5, 8 * sizeof(float));
+        convert(x86::xmm6, 12 * sizeof(float));
+        a.packssdw(x86::xmm0, x86::xmm1);
+        a.packssdw(x86::xmm5, x86::xmm6);
+        a.packuswb(x86::xmm0, x86::xmm5);
+        a.pminub(x86::xmm0, x86::xmm4);
+        a.movdqu(a.ptr_zdi(), x86::xmm0);
+        a.add(a.zsi(), imm(16 * sizeof(float)));
+        a.add(a.zdi(), imm(16));
+        if(size / 16 > 1)
+        {
+          a.dec(a.zcx());
+          a.jnz(loop);
+        }
+      }
+
+      // Convert the remaining values in blocks of 4 (the last block may contain up to 3 values of the padding, whose weights are 0)
+      for(unsigned int i = 0; i < (size % 16 + 3) / 4; ++i)
+      {
+        convert(x86::xmm0, i * 4 * sizeof(float));
+        a.packssdw(x86::xmm0, x86::xmm0);
+        a.packuswb(x86::xmm0, x86::xmm0);
+        a.pminub(x86::xmm0, x86::xmm4);
+        a.movd(a.ptr_zdi(i * 4), x86::xmm0);
+      }
+    }
+  }
+}
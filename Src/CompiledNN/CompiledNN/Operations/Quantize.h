@@ -0,0 +1,69 @@
+/**
+ * Converts a float tensor to 7 bit unsigned integers for the quantized
+ * convolutions. The output starts with a header of 32 bytes that contains
+ * the scale s and the product of s and the zero point z, such that a value
+ * x is represented by round(x / s) + z. The range of the values (which
+ * always contains 0) is either calibrated in advance or determined while
+ * the network is applied.
+ */
+
+#pragma once
+
+#include "../CompiledNNImplBase.h"
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    struct QuantizeCompiler : public SISOOperationCompiler
+    {
+      struct Parameters final
+      {
+        float min = 0.f; /**< The calibrated minimum of the input (if min and max are 0, the range is determined for each input). */
+        float max = 0.f; /**< The calibrated maximum of the input. */
+
+        bool operator==(const Parameters& other) const
+        {
+          return min == other.min && max == other.max;
+        }
+      };
+      const Parameters p;
+
+      /** The number of floats in front of the quantized values. */
+      static constexpr unsigned int headerSize = 8;
+
+      QuantizeCompiler(const CompilationSettings& settings, const Parameters& p) : SISOOperationCompiler(settings), p(p) {}
+
+      inline bool canBeInplace() const override { return false; }
+
+      void initialize() override;
+      void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
+
+      inline std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>& inputDimensions) const override
+      {
+        return {headerSize + quantizedSize(inputDimensions) / 4};
+      }
+
+      /**
+       * Checks whether a tensor can be quantized, i.e. whether the padding of its channels to multiples of 4 does not change its layout.
+       */
+      static bool canQuantize(const std::vector<unsigned int>& dimensions);
+
+      /**
+       * Returns the number of bytes of the quantized values of a tensor (the channels of each pixel are padded to a multiple of 4).
+       */
+      static unsigned int quantizedSize(const std::vector<unsigned int>& dimensions);
+
+    private:
+      /** Whether the range of the input is calibrated. */
+      inline bool isCalibrated() const { return p.min != 0.f || p.max != 0.f; }
+
+      /**
+       * Converts the input to the quantized values at zdi.
+       * Expects 1 / s in xmm2, z in xmm3 and 16 times the largest quantized value in xmm4.
+       * @param clip Whether the input has to be clipped to the calibrated range first.
+       */
+      void compileConversion(x86::Assembler& a, const TensorPointerXf& input, bool clip) const;
+    };
+  }
+}
@@ -0,0 +1,379 @@
+/**
+ * Implements a convolution of a quantized tensor with 8 bit weights.
+ *
+ * Four consecutive input channels are broadcasted to all 32 bit elements of
+ * a register and multiplied with the weights of these channels for 4 (or 8
+ * with AVX2) outputs by pmaddubsw. The pairs of 16 bit products are summed
+ * up by pmaddwd. As the inputs have only 7 bits, the sums of two products
+ * cannot saturate.
+ *
+ * A sum of products q * w is converted back to floats with the scale s and
+ * the zero point z of the input and the scale f of the weights of the output:
+ * f * s * (sum(q * w) - z * sum(w)) + bias.
+ */
+
+#include "QuantizedConv2D.h"
+#include "Quantize.h"
+#include "Platform/BHAssert.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    void QuantizedConv2DCompiler::initialize()
+    {
+      ASSERT(p.weights->rank() == 2 || p.weights->rank() == 4);
+      const unsigned int vectorSize = settings.useAVX2 ? 8 : 4;
+      const unsigned int kernelSize = kernelHeight() * kernelWidth();
+      outputBatchSize = (settings.xmmRegs() - std::max(3u, ActivationFunctionHandler::neededSpares(p.activationDesc))) * vectorSize;
+
+      // Quantize the weights of each output channel, such that the largest absolute value becomes 127
+      const auto weight = [&](const unsigned int kernelIndex, const unsigned int input, const unsigned int output)
+      {
+        return (*p.weights)[(kernelIndex * inputChannels() + input) * outputChannels() + output];
+      };
+      std::vector<float> factors(outputChannels());
+      std::vector<int> sums(outputChannels(), 0);
+      std::vector<std::int8_t> quantizedWeights(p.weights->size());
+      for(unsigned int output = 0; output < outputChannels(); output++)
+      {
+        float maxWeight = 0.f;
+        for(unsigned int i = 0; i < kernelSize; i++)
+          for(unsigned int input = 0; input < inputChannels(); input++)
+            maxWeight = std::max(maxWeight, std::abs(weight(i, input, output)));
+        factors[output] = maxWeight > 0.f ? maxWeight / 127.f : 1.f;
+        for(unsigned int i = 0; i < kernelSize; i++)
+          for(unsigned int input = 0; input < inputChannels(); input++)
+          {
+            const int w = static_cast<int>(std::round(weight(i, input, output) / factors[output]));
+            quantizedWeights[(i * inputChannels() + input) * outputChannels() + output] = static_cast<std::int8_t>(w);
+            sums[output] += w;
+          }
+      }
+
+      // Declare constants
+      constants.resize(settings.useAVX2 && outputChannels() % 8 ? 3 : 2);
+
+      // Store the weights of each output batch, followed by the factors, the factors multiplied with the sums of the weights and the biases
+      NetworkConstants& weights = constants[0];
+      weights.data.clear();
+      std::vector<std::int8_t> bytes;
+      for(unsigned int outputOffset = 0; outputOffset < outputChannels(); outputOffset += outputBatchSize)
+      {
+        const unsigned int outputBatchEnd = std::min(outputOffset + outputBatchSize, outputChannels());
+        const unsigned int paddedOutputBatchEnd = outputOffset + (outputBatchEnd - outputOffset + vectorSize - 1) / vectorSize * vectorSize;
+
+        bytes.clear();
+        for(unsigned int i = 0; i < kernelSize; i++)
+          for(unsigned int input = 0; input < paddedInputChannels(); input += 4)
+            for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+              for(unsigned int j = input; j < input + 4; j++)
+                bytes.emplace_back(output < outputBatchEnd && j < inputChannels() ? quantizedWeights[(i * inputChannels() + j) * outputChannels() + output] : 0);
+        const std::size_t begin = weights.data.size();
+        weights.data.resize(begin + bytes.size() / sizeof(float));
+        std::memcpy(weights.data.data() + begin, bytes.data(), bytes.size());
+
+        for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+          weights.data.emplace_back(output < outputBatchEnd ? factors[output] : 0.f);
+        for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+          weights.data.emplace_back(output < outputBatchEnd ? factors[output] * static_cast<float>(sums[output]) : 0.f);
+        for(unsigned int output = outputOffset; output < paddedOutputBatchEnd; output++)
+          weights.data.emplace_back(output < outputBatchEnd && p.biases ? (*p.biases)[output] : 0.f);
+      }
+
+      // 16 bit ones to sum up pairs of products
+      const std::vector<std::int16_t> ones(2 * vectorSize, 1);
+      constants[1].data.resize(vectorSize);
+      std::memcpy(constants[1].data.data(), ones.data(), ones.size() * sizeof(std::int16_t));
+
+      // The mask to store the outputs of the last (partial) ymm register
+      if(constants.size() > 2)
+      {
+        constants[2].data.assign(8, 0.f);
+        for(unsigned int i = 0; i < outputChannels() % 8; i++)
+          constants[2].data[i] = -0.f;
+      }
+    }
+
+    void QuantizedConv2DCompiler::compileQuads(x86::Assembler& a, const unsigned int stepSize, const unsigned int quads) const
+    {
+      const x86::Ymm ones = x86::ymm(settings.xmmRegs() - 1);
+      const x86::Ymm input = x86::ymm(settings.xmmRegs() - 2);
+      const x86::Ymm product = x86::ymm(settings.xmmRegs() - 3);
+      const unsigned int vectorSize = settings.useAVX2 ? 8 : 4;
+
+      unsigned int weightOffset = 0;
+      for(unsigned int i = 0; i < quads; i++)
+      {
+        // Broadcast four input channels
+        if(settings.useAVX2)
+          a.vpbroadcastd(input, a.ptr_zdx(i * 4, 4));
+        else
+        {
+          a.movd(input.xmm(), a.ptr_zdx(i * 4, 4));
+          a.pshufd(input.xmm(), input.xmm(), imm(0));
+        }
+
+        // Multiply them with their weights for all outputs and sum up each four products
+        for(unsigned int step = 0; step < stepSize; step++)
+        {
+          if(settings.useAVX2)
+          {
+            a.vpmaddubsw(product, input, a.ptr_zbx(weightOffset));
+            a.vpmaddwd(product, product, ones);
+            a.vpaddd(x86::ymm(step), x86::ymm(step), product);
+          }
+          else
+          {
+            a.movdqa(product.xmm(), input.xmm());
+            a.pmaddubsw(product.xmm(), a.ptr_zbx(weightOffset));
+            a.pmaddwd(product.xmm(), ones.xmm());
+            a.paddd(x86::xmm(step), product.xmm());
+          }
+          weightOffset += vectorSize * 4;
+        }
+      }
+      a.add(a.zdx(), imm(quads * 4));
+      a.add(a.zbx(), imm(weightOffset));
+    }
+
+    void QuantizedConv2DCompiler::compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const void* header, const unsigned int remainingOutputs) const
+    {
+      const bool useAVX = settings.useAVX2;
+      const unsigned int vectorSize = useAVX ? 8 : 4;
+      const unsigned int stepSize = (remainingOutputs + vectorSize - 1) / vectorSize;
+      const x86::Ymm ones = x86::ymm(settings.xmmRegs() - 1);
+      const x86::Ymm scale = x86::ymm(settings.xmmRegs() - 2);
+      const x86::Ymm offset = x86::ymm(settings.xmmRegs() - 3);
+
+      // Initialize the sums
+      if(useAVX)
+        a.vmovdqa(ones, x86::ptr(constants[1].label));
+      else
+        a.movdqa(ones.xmm(), x86::ptr(constants[1].label));
+      for(unsigned int step = 0; step < stepSize; step++)
+      {
+        if(useAVX)
+          a.vpxor(x86::ymm(step), x86::ymm(step), x86::ymm(step));
+        else
+          a.pxor(x86::xmm(step), x86::xmm(step));
+      }
+
+      // Loop over the rows of the filter, each of which covers consecutive bytes of the input
+      a.mov(a.zdx(), a.zsi());
+      Label filterRowLoop;
+      if(kernelHeight() > 1)
+      {
+        a.mov(a.zax(), imm(kernelHeight()));
+        filterRowLoop = a.newLabel();
+        a.bind(filterRowLoop);
+      }
+
+      const unsigned int quads = kernelWidth() * paddedInputChannels() / 4;
+      if(quads / 4)
+      {
+        Label quadLoop;
+        if(quads / 4 > 1)
+        {
+          a.mov(a.zcx(), imm(quads / 4));
+          quadLoop = a.newLabel();
+          a.bind(quadLoop);
+        }
+        compileQuads(a, stepSize, 4);
+        if(quads / 4 > 1)
+        {
+          a.dec(a.zcx());
+          a.jnz(quadLoop);
+        }
+      }
+      if(quads % 4)
+        compileQuads(a, stepSize, quads % 4);
+
+      if(kernelHeight() > 1)
+      {
+        a.add(a.zdx(), imm((p.inputDimensions[1] - kernelWidth()) * paddedInputChannels()));
+        a.dec(a.zax());
+        a.jnz(filterRowLoop);
+      }
+
+      // Load the scale of the input and its product with the zero point
+      loadAddress(a, a.zdx(), header);
+      if(useAVX)
+      {
+        a.vbroadcastss(scale, a.ptr_zdx(0, 4));
+        a.vbroadcastss(offset, a.ptr_zdx(sizeof(float), 4));
+      }
+      else
+      {
+        a.movss(scale.xmm(), a.ptr_zdx());
+        a.shufps(scale.xmm(), scale.xmm(), imm(0));
+        a.movss(offset.xmm(), a.ptr_zdx(sizeof(float)));
+        a.shufps(offset.xmm(), offset.xmm(), imm(0));
+      }
+
+      // Convert the sums to floats
+      const unsigned int constantsSize = stepSize * vectorSize * sizeof(float);
+      for(unsigned int step = 0; step < stepSize; step++)
+      {
+        const unsigned int constantOffset = step * vectorSize * sizeof(float);
+        if(useAVX)
+        {
+          a.vcvtdq2ps(x86::ymm(step), x86::ymm(step));
+          a.vmulps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(constantOffset));
+          a.vmulps(x86::ymm(step), x86::ymm(step), scale);
+          if(settings.useFMA3)
+            a.vfnmadd231ps(x86::ymm(step), offset, a.ptr_zbx(constantsSize + constantOffset));
+          else
+          {
+            a.vmulps(ones, offset, a.ptr_zbx(constantsSize + constantOffset));
+            a.vsubps(x86::ymm(step), x86::ymm(step), ones);
+          }
+          a.vaddps(x86::ymm(step), x86::ymm(step), a.ptr_zbx(2 * constantsSize + constantOffset));
+        }
+        else
+        {
+          a.cvtdq2ps(x86::xmm(step), x86::xmm(step));
+          a.mulps(x86::xmm(step), a.ptr_zbx(constantOffset));
+          a.mulps(x86::xmm(step), scale.xmm());
+          if(settings.useFMA3)
+            a.vfnmadd231ps(x86::xmm(step), offset.xmm(), a.ptr_zbx(constantsSize + constantOffset));
+          else
+          {
+            a.movaps(ones.xmm(), a.ptr_zbx(constantsSize + constantOffset));
+            a.mulps(ones.xmm(), offset.xmm());
+            a.subps(x86::xmm(step), ones.xmm());
+          }
+          a.addps(x86::xmm(step), a.ptr_zbx(2 * constantsSize + constantOffset));
+        }
+      }
+      a.add(a.zbx(), imm(3 * constantsSize));
+
+      // Apply activation function
+      if(p.activationDesc != CompiledActivationFunctionId::linear)
+      {
+        if(useAVX)
+        {
+          ActivationFn& activationFunction = afHandler.prepareAVX(p.activationDesc, a, {}, {});
+          for(unsigned int step = 0; step < stepSize; step++)
+            activationFunction.addValue(x86::ymm(step));
+          for(unsigned int step = stepSize; step < settings.xmmRegs(); step++)
+            activationFunction.addSpare(x86::ymm(step));
+          activationFunction.initialize(a);
+          activationFunction.apply(a);
+        }
+        else
+        {
+          ActivationFn& activationFunction = afHandler.prepare(p.activationDesc, false, a, {}, {});
+          for(unsigned int step = 0; step < stepSize; step++)
+            activationFunction.addValue(x86::xmm(step));
+          for(unsigned int step = stepSize; step < settings.xmmRegs(); step++)
+            activationFunction.addSpare(x86::xmm(step));
+          activationFunction.initialize(a);
+          activationFunction.apply(a);
+        }
+      }
+
+      // Store the outputs (without AVX, up to 3 floats behind them are overwritten, which are either padding or computed later)
+      for(unsigned int step = 0; step < stepSize; step++)
+      {
+        if(!useAVX)
+          a.movups(a.ptr_zdi(step * 4 * sizeof(float)), x86::xmm(step));
+        else if(step == stepSize - 1 && remainingOutputs % 8)
+        {
+          a.vmovups(ones, x86::ptr(constants[2].label));
+          a.vmaskmovps(a.ptr_zdi(step * 8 * sizeof(float)), ones, x86::ymm(step));
+        }
+        else
+          a.vmovups(a.ptr_zdi(step * 8 * sizeof(float)), x86::ymm(step));
+      }
+      a.add(a.zdi(), imm(remainingOutputs * sizeof(float)));
+    }
+
+    void QuantizedConv2DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    {
+      ASSERT(input.rank() == 1);
+      ASSERT(input.size() * sizeof(float) == QuantizeCompiler::headerSize * sizeof(float) + p.inputDimensions[0] * p.inputDimensions[1] * paddedInputChannels());
+      ASSERT(output.size() % outputChannels() == 0);
+      const unsigned int outputHeight = (p.inputDimensions[0] - kernelHeight()) / p.strides[0] + 1;
+      const unsigned int outputWidth = (p.inputDimensions[1] - kernelWidth()) / p.strides[1] + 1;
+
+      // Load input/output base addresses
+      loadAddress(a, a.zsi(), input.data() + QuantizeCompiler::headerSize);
+      loadAddress(a, a.zdi(), output.data());
+
+      // Begin loop over output rows
+      if(settings.useX64)
+        a.mov(x86::r8d, imm(outputHeight));
+      else
+        a.mov(a.ptr_zbp(-4, 4), imm(outputHeight));
+      Label rowLoop = a.newLabel();
+      a.bind(rowLoop);
+
+      // Begin loop over output cols
+      if(settings.useX64)
+        a.mov(x86::r9d, imm(outputWidth));
+      else
+        a.mov(a.ptr_zbp(-8, 4), imm(outputWidth));
+      Label colLoop = a.newLabel();
+      a.bind(colLoop);
+
+      // Loop over output batches
+      a.lea(a.zbx(), x86::ptr(constants[0].label));
+      if(outputChannels() > outputBatchSize)
+      {
+        Label outputBatchLoop;
+        if(outputChannels() / outputBatchSize >= 2)
+        {
+          if(settings.useX64)
+            a.mov(x86::r10d, imm(outputChannels() / outputBatchSize));
+          else
+            a.mov(a.ptr_zbp(-12, 4), imm(outputChannels() / outputBatchSize));
+          outputBatchLoop = a.newLabel();
+          a.bind(outputBatchLoop);
+        }
+
+        compileOutputBatch(a, afHandler, input.data(), outputBatchSize);
+
+        if(outputChannels() / outputBatchSize >= 2)
+        {
+          if(settings.useX64)
+            a.dec(x86::r10d);
+          else
+            a.dec(a.ptr_zbp(-12, 4));
+          a.jnz(outputBatchLoop);
+        }
+      }
+      const unsigned int remainingOutputs = outputChannels() == outputBatchSize ? outputBatchSize : outputChannels() % outputBatchSize;
+      if(remainingOutputs)
+        compileOutputBatch(a, afHandler, input.data(), remainingOutputs);
+
+      // Set input offset to next column, respecting the stride
+      a.add(a.zsi(), imm(p.strides[1] * paddedInputChannels()));
+
+      // End loop over output cols
+      if(settings.useX64)
+        a.dec(x86::r9d);
+      else
+        a.dec(a.ptr_zbp(-8, 4));
+      a.jnz(colLoop);
+
+      // Set input offset to next row, respecting the stride
+      if(p.strides[0] * p.inputDimensions[1] != outputWidth * p.strides[1])
+        a.add(a.zsi(), imm((p.strides[0] * p.inputDimensions[1] - outputWidth * p.strides[1]) * paddedInputChannels()));
+
+      // End loop over output rows
+      if(settings.useX64)
+        a.dec(x86::r8d);
+      else
+        a.dec(a.ptr_zbp(-4, 4));
+      a.jnz(rowLoop);
+
+      // Avoid the penalty of mixing the upper halves of the ymm registers with SSE instructions
+      if(settings.useAVX2)
+        a.vzeroupper();
+    }
+  }
+}
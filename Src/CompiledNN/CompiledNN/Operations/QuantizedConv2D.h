@@ -0,0 +1,70 @@
+/**
+ * A convolution (or a dense layer, which is a 1x1 convolution of a single
+ * pixel) of a tensor that has been quantized by the QuantizeCompiler. The
+ * weights are quantized to 8 bits per output channel, the products are
+ * accumulated as 32 bit integers and the outputs are floats.
+ */
+
+#pragma once
+
+#include "../ActivationFunctions.h"
+#include "../CompiledNNImplBase.h"
+#include <array>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    struct QuantizedConv2DCompiler : public SISOOperationCompiler
+    {
+      struct Parameters final
+      {
+        const Tensor<float, 1>* weights; /**< The weights of a Conv2D layer (height x width x input channels x output channels) or of a Dense layer (inputs x outputs). */
+        const std::vector<float>* biases;
+        std::array<unsigned int, 2> strides = {{1, 1}};
+        std::array<unsigned int, 3> inputDimensions; /**< The dimensions of the tensor before it has been quantized (1 x 1 x inputs for Dense layers). */
+        ActivationFunctionDescriptor activationDesc;
+
+        bool operator==(const Parameters& other) const
+        {
+          return weights == other.weights &&
+                 biases == other.biases &&
+                 strides == other.strides &&
+                 inputDimensions == other.inputDimensions &&
+                 activationDesc == other.activationDesc;
+        }
+      };
+      const Parameters p;
+
+      QuantizedConv2DCompiler(const CompilationSettings& settings, const Parameters& p) : SISOOperationCompiler(settings), p(p) {}
+
+      inline bool canBeInplace() const override { return false; }
+
+      void initialize() override;
+      void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
+
+      inline std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>&) const override
+      {
+        if(p.weights->rank() == 2)
+          return {p.weights->dims(1)};
+        return {{(p.inputDimensions[0] - kernelHeight()) / p.strides[0] + 1, (p.inputDimensions[1] - kernelWidth()) / p.strides[1] + 1, outputChannels()}};
+      }
+
+    private:
+      unsigned int outputBatchSize = 0;
+
+      unsigned int kernelHeight() const { return p.weights->rank() == 2 ? 1 : p.weights->dims(0); }
+      unsigned int kernelWidth() const { return p.weights->rank() == 2 ? 1 : p.weights->dims(1); }
+      unsigned int inputChannels() const { return p.weights->dims(p.weights->rank() - 2); }
+      unsigned int outputChannels() const { return p.weights->dims(p.weights->rank() - 1); }
+
+      /**
+       * Returns the number of bytes per pixel of the quantized input (the input channels padded to a multiple of 4).
+       */
+      unsigned int paddedInputChannels() const { return (inputChannels() + 3) / 4 * 4; }
+
+      void compileQuads(x86::Assembler& a, const unsigned int stepSize, const unsigned int quads) const;
+      void compileOutputBatch(x86::Assembler& a, ActivationFunctionHandler& afHandler, const void* header, const unsigned int remainingOutputs) const;
+    };
+  }
+}
@@ -103,8 +103,8 @@ namespace NeuralNetwork
         a.pxor(x86::xmm14, x86::xmm14);
 
       // Load input/output base addresses
-      a.mov(a.zsi(), imm(input.data()));
-      a.mov(a.zdi(), imm(output.data()));
+      loadAddress(a, a.zsi(), input.data());
+      loadAddress(a, a.zdi(), output.data());
 
       // Load weights address
       a.lea(a.zbx(), x86::ptr(constants[0].label));
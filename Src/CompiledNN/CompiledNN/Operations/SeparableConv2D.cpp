@@ -0,0 +1,158 @@
+/**
+ * Implements a depthwise convolution that is followed by a pointwise
+ * convolution. The code of both convolutions is emitted by their own
+ * compilers, this compiler only arranges their loops in bands of rows.
+ *
+ * The stack buffer contains the padded window of the depthwise convolution
+ * (if needed), the depthwise outputs of a band and the pointers to the input
+ * of the next band and to the output of the next band.
+ */
+
+#include "SeparableConv2D.h"
+#include "Platform/BHAssert.h"
+#include <algorithm>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    SeparableConv2DCompiler::SeparableConv2DCompiler(const CompilationSettings& settings, const Parameters& p) :
+      SISOOperationCompiler(settings), p(p),
+      depthwiseCompiler(std::make_unique<DConv2DCompiler>(settings, p.depthwise)),
+      pointwiseCompiler(std::make_unique<Conv2DCompiler>(settings, p.pointwise))
+    {
+      ASSERT(isPointwise(p.pointwise));
+    }
+
+    bool SeparableConv2DCompiler::isPointwise(const Conv2DCompiler::Parameters& pointwise)
+    {
+      return pointwise.weights->dims(0) == 1 && pointwise.weights->dims(1) == 1 && pointwise.strides[0] == 1 && pointwise.strides[1] == 1;
+    }
+
+    unsigned int SeparableConv2DCompiler::variants() const
+    {
+      // The pointwise convolution is always computed like a large one, because the bands are computed by the loops over the windows
+      return pointwiseCompiler->hasSimpleShape() ? 1 : pointwiseCompiler->variants();
+    }
+
+    std::string SeparableConv2DCompiler::tuningKey() const
+    {
+      const Tensor<float, 1>& weights = *p.depthwise.weights;
+      return "SeparableConv2D " + std::to_string(weights.dims(0)) + "x" + std::to_string(weights.dims(1)) + "x" + std::to_string(weights.dims(2)) +
+             " strides " + std::to_string(p.depthwise.strides[0]) + "x" + std::to_string(p.depthwise.strides[1]) +
+             " dilation " + std::to_string(p.depthwise.dilation[0]) + "x" + std::to_string(p.depthwise.dilation[1]) + (p.depthwise.padding == PaddingType::same ? " same" : "") +
+             " activation " + std::to_string(static_cast<unsigned int>(p.depthwise.postActivation.id)) + (p.depthwise.batchNormalization ? " bn" : "") +
+             ", " + pointwiseCompiler->tuningKey();
+    }
+
+    void SeparableConv2DCompiler::initialize()
+    {
+      ASSERT(variant < variants());
+      depthwiseCompiler->initialize();
+      pointwiseCompiler->variant = pointwiseCompiler->hasSimpleShape() ? 1 : variant;
+      pointwiseCompiler->initialize();
+
+      constants = depthwiseCompiler->constants;
+      constants.insert(constants.end(), pointwiseCompiler->constants.begin(), pointwiseCompiler->constants.end());
+    }
+
+    unsigned int SeparableConv2DCompiler::bandRows(const TensorPointerXf& output) const
+    {
+      const unsigned int rowSize = output.dims(1) * p.depthwise.weights->dims(2) * sizeof(float);
+      return std::max(1u, std::min(output.dims(0), bandSize / rowSize));
+    }
+
+    void SeparableConv2DCompiler::compileBands(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                               const unsigned int rowBegin, const unsigned int rowEnd) const
+    {
+      // The labels of the constants have been declared for this operation, but the code of its parts refers to their own constants
+      for(std::size_t i = 0; i < depthwiseCompiler->constants.size(); ++i)
+        depthwiseCompiler->constants[i].label = constants[i].label;
+      for(std::size_t i = 0; i < pointwiseCompiler->constants.size(); ++i)
+        pointwiseCompiler->constants[i].label = constants[depthwiseCompiler->constants.size() + i].label;
+
+      const unsigned int channels = p.depthwise.weights->dims(2);
+      const TensorPointerXf depthwiseOutput({output.dims(0), output.dims(1), channels}, nullptr);
+      const SlidingWindow window({{p.depthwise.weights->dims(0), p.depthwise.weights->dims(1)}}, p.depthwise.dilation, p.depthwise.strides, p.depthwise.padding,
+                                 input, depthwiseOutput);
+
+      // Layout of the stack buffer behind the padded window (the convolutions may access a register of floats beyond the outputs of the band)
+      const unsigned int rowsPerBand = bandRows(output);
+      const int bandOffset = static_cast<int>(window.bufferSize());
+      const int inputPointerOffset = bandOffset + static_cast<int>((rowsPerBand * output.dims(1) * channels + 8) * sizeof(float) + 31) / 32 * 32;
+      const int outputPointerOffset = inputPointerOffset + 8;
+      const int counterOffset = outputPointerOffset + 8;
+      window.reserveBuffer(a, counterOffset + 32 - bandOffset);
+
+      // Store the pointers to the first window and to the first output (the window may begin before the first input row that the range covers)
+      const unsigned int inputRow = window.firstInputRow(rowBegin);
+      loadAddress(a, a.zsi(), input.data() + inputRow * input.dims(1) * input.dims(2));
+      const long long inputOffset = window.inputOffset(rowBegin) - static_cast<long long>(inputRow * input.dims(1) * input.dims(2) * sizeof(float));
+      if(inputOffset)
+        a.add(a.zsi(), imm(inputOffset));
+      a.mov(x86::ptr(a.zsp(), inputPointerOffset, a.zsi().size()), a.zsi());
+      loadAddress(a, a.zdi(), output.data() + rowBegin * output.dims(1) * output.dims(2));
+      a.mov(x86::ptr(a.zsp(), outputPointerOffset, a.zdi().size()), a.zdi());
+
+      for(unsigned int row = rowBegin; row < rowEnd;)
+      {
+        // Consecutive bands whose windows lie inside of the input vertically have the same code, so they are computed in a loop
+        const unsigned int rows = std::min(rowsPerBand, rowEnd - row);
+        unsigned int bands = 1;
+        if(window.rowsInside(row, row + rows))
+          while(row + (bands + 1) * rows <= rowEnd && window.rowsInside(row + bands * rows, row + (bands + 1) * rows))
+            ++bands;
+
+        // Begin loop over bands
+        Label bandLoop;
+        if(bands > 1)
+        {
+          bandLoop = a.newLabel();
+          a.mov(x86::dword_ptr(a.zsp(), counterOffset), imm(bands));
+          a.bind(bandLoop);
+        }
+
+        // Compute the depthwise outputs of the band
+        a.mov(a.zsi(), x86::ptr(a.zsp(), inputPointerOffset, a.zsi().size()));
+        a.lea(a.zdi(), x86::ptr(a.zsp(), bandOffset));
+        depthwiseCompiler->compileWindowLoops(a, afHandler, window, input.dims(1), row, row + rows);
+        a.mov(x86::ptr(a.zsp(), inputPointerOffset, a.zsi().size()), a.zsi());
+
+        // Compute the pointwise outputs of the band, whose pixels are contiguous
+        const TensorPointerXf bandInput({1, rows * output.dims(1), channels}, nullptr);
+        const TensorPointerXf bandOutput({1, rows * output.dims(1), output.dims(2)}, nullptr);
+        const SlidingWindow pixels({{1, 1}}, {{1, 1}}, {{1, 1}}, PaddingType::valid, bandInput, bandOutput);
+        a.lea(a.zsi(), x86::ptr(a.zsp(), bandOffset));
+        a.mov(a.zdi(), x86::ptr(a.zsp(), outputPointerOffset, a.zdi().size()));
+        pointwiseCompiler->compileWindowLoops(a, afHandler, pixels, bandInput.dims(1), 0, 1);
+        a.mov(x86::ptr(a.zsp(), outputPointerOffset, a.zdi().size()), a.zdi());
+
+        // Avoid the penalty of mixing the upper halves of the ymm registers with the SSE instructions of the depthwise convolution
+        if(pointwiseCompiler->usesAVX())
+          a.vzeroupper();
+
+        // End loop over bands
+        if(bands > 1)
+        {
+          a.dec(x86::dword_ptr(a.zsp(), counterOffset));
+          a.jnz(bandLoop);
+        }
+        row += bands * rows;
+      }
+
+      window.releaseBuffer(a);
+    }
+
+    void SeparableConv2DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    {
+      ASSERT(input.rank() == 3);
+      ASSERT(output.rank() == 3);
+      ASSERT(input.dims(2) == p.depthwise.weights->dims(2));
+      ASSERT(p.depthwise.weights->dims(3) == 1);
+      ASSERT(p.depthwise.weights->dims(2) == p.pointwise.weights->dims(2));
+      ASSERT(output.dims(2) == p.pointwise.weights->dims(3));
+
+      compileBands(a, afHandler, input, output, 0, output.dims(0));
+    }
+  }
+}
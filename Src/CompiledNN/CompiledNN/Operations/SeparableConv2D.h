@@ -0,0 +1,111 @@
+/**
+ * Declares a compiler for a depthwise convolution that is followed by a
+ * pointwise (1x1) convolution, i.e. a SeparableConv2D layer or a
+ * DepthwiseConv2D layer that is followed by a 1x1 Conv2D layer.
+ *
+ * Instead of writing the whole output of the depthwise convolution to memory
+ * and reading it back, the output rows are computed in bands. The depthwise
+ * outputs of a band are stored in a small buffer on the stack, from which the
+ * pointwise convolution reads them while they are still in the L1 cache.
+ */
+
+#pragma once
+
+#include "../CompiledNNImplBase.h"
+#include "../Util/SlidingWindow.h"
+#include "Conv2D.h"
+#include "DConv2D.h"
+#include <memory>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    struct SeparableConv2DCompiler : public SISOOperationCompiler
+    {
+      struct Parameters final
+      {
+        DConv2DCompiler::Parameters depthwise;
+        Conv2DCompiler::Parameters pointwise; /**< Must be a 1x1 convolution with stride 1. */
+
+        bool operator==(const Parameters& other) const
+        {
+          return depthwise == other.depthwise &&
+                 pointwise == other.pointwise;
+        }
+      };
+      const Parameters p;
+
+      SeparableConv2DCompiler(const CompilationSettings& settings, const Parameters& p);
+
+      inline bool canBeInplace() const override { return false; }
+
+      inline unsigned int maxParts(const TensorPointerXf& input, const TensorPointerXf& output) const override
+      {
+        return rowParts(input, output, p.depthwise.strides[0]);
+      }
+
+      inline void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                              const unsigned int part, const unsigned int parts) const override
+      {
+        // Only the pointwise convolution writes to the output (the depthwise outputs of a band are on the stack)
+        const std::array<unsigned int, 2> rows = partRows(input, output, p.depthwise.strides[0], part, parts);
+        pointwiseCompiler->splitIntoParts = splitIntoParts;
+        if(rows[0] < rows[1])
+          compileRowRange(a, afHandler, input, output, rows[0], rows[1]);
+        pointwiseCompiler->splitIntoParts = false;
+      }
+
+      inline RowWindow rowWindow() const override
+      {
+        return {depthwiseCompiler->kernelHeight(), p.depthwise.strides[0], p.depthwise.padding};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        // Each range needs the whole input to determine which of its windows lie outside of it
+        compileBands(a, afHandler, input, output, rowBegin, rowEnd);
+      }
+
+      unsigned int variants() const override;
+      std::string tuningKey() const override;
+
+      void initialize() override;
+      void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
+
+      inline std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>& inputDimensions) const override
+      {
+        return pointwiseCompiler->calcOutputDimensions(depthwiseCompiler->calcOutputDimensions(inputDimensions));
+      }
+
+      /**
+       * Checks whether a pointwise convolution can be fused into the depthwise convolution that computes its input.
+       * @param pointwise The parameters of the pointwise convolution.
+       */
+      static bool isPointwise(const Conv2DCompiler::Parameters& pointwise);
+
+    private:
+      /** The maximum number of bytes of the depthwise outputs of a band (about half of the L1 data cache). */
+      static constexpr unsigned int bandSize = 16 * 1024;
+
+      // The parts of the operation (their constants are declared as the constants of this operation)
+      std::unique_ptr<DConv2DCompiler> depthwiseCompiler;
+      std::unique_ptr<Conv2DCompiler> pointwiseCompiler;
+
+      /**
+       * Returns the number of output rows in a band.
+       * @param output The output of the operation.
+       */
+      unsigned int bandRows(const TensorPointerXf& output) const;
+
+      /**
+       * Emits the code that computes a range of output rows band by band.
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       */
+      void compileBands(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                        const unsigned int rowBegin, const unsigned int rowEnd) const;
+    };
+  }
+}
@@ -40,10 +40,10 @@ namespace NeuralNetwork
       }
 
       const bool isInplace = input.data() == output.data();
-      a.mov(a.zsi(), imm(input.data()));
+      loadAddress(a, a.zsi(), input.data());
 
       if(!isInplace)
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
       else if(input.dims(p.dimension) >= 4 && (input.dims(p.dimension) % 4 != 0 || (input.dims(p.dimension) + 3) / 4 > settings.xmmRegs() - 3))
         a.mov(a.zdi(), a.zsi());
 
@@ -152,7 +152,7 @@ namespace NeuralNetwork
         a.rcpss(x86::xmm0, x86::xmm0);
 
       if(!isInplace && input.dims(p.dimension) >= 4 && (input.dims(p.dimension) % 4 != 0 || (input.dims(p.dimension) + 3) / 4 > settings.xmmRegs() - 3))
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
 
       // Calculate softmax by dividing the exponentiated values by the computed sum
       remainingChannels = input.dims(p.dimension);
@@ -51,8 +51,8 @@ namespace NeuralNetwork
 
     void UInt8InputCompiler::compile(x86::Assembler& a, ActivationFunctionHandler&, const TensorPointerXf& input, const TensorPointerXf& output) const
     {
-      a.mov(a.zsi(), imm(input.data()));
-      a.mov(a.zdi(), imm(output.data()));
+      loadAddress(a, a.zsi(), input.data());
+      loadAddress(a, a.zdi(), output.data());
 
       if(!p.batchNormalization || paramLength == 4)
       {
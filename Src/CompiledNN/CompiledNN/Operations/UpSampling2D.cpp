@@ -24,8 +24,8 @@ namespace NeuralNetwork
       ASSERT((input.dims(2) % 4) == 0); // TODO
       ASSERT(input.dims(2) <= settings.xmmRegs() * 4); // TODO
 
-      a.mov(a.zsi(), imm(input.data()));
-      a.mov(a.zdi(), imm(output.data()));
+      loadAddress(a, a.zsi(), input.data());
+      loadAddress(a, a.zdi(), output.data());
 
       Label rowLoop;
       if(input.dims(0) > 1)
@@ -0,0 +1,473 @@
+/**
+ * Implements a 3x3 convolution with stride 1 with the Winograd algorithm
+ * F(2x2, 3x3).
+ *
+ * For each tile of 2x2 output pixels, the 4x4 input pixels d are transformed
+ * to V = B^T d B for every input channel. The filters g have been transformed
+ * to U = G g G^T once. Each of the 16 elements of the tiles is then the
+ * product of a vector of input channels with a matrix of input x output
+ * channels, M = sum_c V_c * U_c, and the outputs are Y = A^T M A.
+ *
+ *         [1  0 -1  0]       [ 1    0   0 ]
+ * B^T  =  [0  1  1  0]   G = [1/2  1/2 1/2]   A^T = [1 1  1  0]
+ *         [0 -1  1  0]       [1/2 -1/2 1/2]         [0 1 -1 -1]
+ *         [0  1  0 -1]       [ 0    0   1 ]
+ *
+ * The transformed inputs V and the products M of the current tile are stored
+ * in a buffer on the stack, so that the code remains reentrant.
+ */
+
+#include "WinogradConv2D.h"
+#include "Platform/BHAssert.h"
+#include <algorithm>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    bool WinogradConv2DCompiler::isSuitable(const CompilationSettings& settings, const Tensor<float, 1>& weights, const std::array<unsigned int, 2>& strides, const std::vector<unsigned int>& outputDimensions)
+    {
+      // The code needs 16 registers. The half precision weights are meant to save memory, which the transformed filters would not.
+      if(!settings.useWinograd || !settings.useX64 || settings.useHalfPrecisionWeights)
+        return false;
+      if(weights.rank() != 4 || weights.dims(0) != 3 || weights.dims(1) != 3 || strides[0] != 1 || strides[1] != 1)
+        return false;
+      if(outputDimensions.size() != 3 || outputDimensions[0] < 2 || outputDimensions[1] < 2)
+        return false;
+
+      // All channels are processed in whole registers. With few channels, the transformations cost more than the multiplications they save.
+      const unsigned int vectorSize = settings.useAVX2 ? 8 : 4;
+      return weights.dims(2) % vectorSize == 0 && weights.dims(3) % vectorSize == 0 && weights.dims(2) >= 16 && weights.dims(3) >= 16;
+    }
+
+    unsigned int WinogradConv2DCompiler::outputBatchSize() const
+    {
+      // One register holds the broadcasted input and (without FMA3) another one the products
+      const unsigned int maxRegs = settings.xmmRegs() - (settings.useFMA3 ? 1 : 2);
+      const unsigned int regs = p.weights->dims(3) / vectorSize();
+      const unsigned int batches = (regs + maxRegs - 1) / maxRegs;
+      return (regs + batches - 1) / batches * vectorSize();
+    }
+
+    void WinogradConv2DCompiler::initialize()
+    {
+      ASSERT(p.weights->rank() == 4);
+      ASSERT(p.weights->dims(0) == 3 && p.weights->dims(1) == 3);
+      const unsigned int inputChannels = p.weights->dims(2);
+      const unsigned int outputChannels = p.weights->dims(3);
+
+      // Transform the filters (the batch normalization is applied to them and the biases)
+      std::vector<float> transformed(16 * inputChannels * outputChannels);
+      for(unsigned int c = 0; c < inputChannels; c++)
+      {
+        for(unsigned int k = 0; k < outputChannels; k++)
+        {
+          const double factor = p.batchNormalization ? (*p.batchNormalization->factor)[k] : 1.0;
+          double g[3][3];
+          for(unsigned int i = 0; i < 3; i++)
+            for(unsigned int j = 0; j < 3; j++)
+              g[i][j] = (*p.weights)[((i * 3 + j) * inputChannels + c) * outputChannels + k] * factor;
+
+          double gG[3][4];
+          for(unsigned int i = 0; i < 3; i++)
+          {
+            gG[i][0] = g[i][0];
+            gG[i][1] = (g[i][0] + g[i][1] + g[i][2]) * 0.5;
+            gG[i][2] = (g[i][0] - g[i][1] + g[i][2]) * 0.5;
+            gG[i][3] = g[i][2];
+          }
+          for(unsigned int j = 0; j < 4; j++)
+          {
+            const double u[4] = {gG[0][j], (gG[0][j] + gG[1][j] + gG[2][j]) * 0.5, (gG[0][j] - gG[1][j] + gG[2][j]) * 0.5, gG[2][j]};
+            for(unsigned int i = 0; i < 4; i++)
+              transformed[((i * 4 + j) * inputChannels + c) * outputChannels + k] = static_cast<float>(u[i]);
+          }
+        }
+      }
+
+      constants.resize(2);
+
+      // For each element of the tiles and each output batch, the weights of all input channels follow each other
+      std::vector<float>& weights = constants[0].data;
+      weights.clear();
+      weights.reserve(transformed.size());
+      const unsigned int outputBatchSize = this->outputBatchSize();
+      for(unsigned int element = 0; element < 16; element++)
+        for(unsigned int outputOffset = 0; outputOffset < outputChannels; outputOffset += outputBatchSize)
+        {
+          const unsigned int outputBatchEnd = std::min(outputOffset + outputBatchSize, outputChannels);
+          for(unsigned int c = 0; c < inputChannels; c++)
+            weights.insert(weights.end(), transformed.begin() + (element * inputChannels + c) * outputChannels + outputOffset,
+                           transformed.begin() + (element * inputChannels + c) * outputChannels + outputBatchEnd);
+        }
+
+      std::vector<float>& biases = constants[1].data;
+      biases.resize(outputChannels);
+      for(unsigned int k = 0; k < outputChannels; k++)
+      {
+        biases[k] = p.biases ? (*p.biases)[k] : 0.f;
+        if(p.batchNormalization)
+          biases[k] = biases[k] * (*p.batchNormalization->factor)[k] + (*p.batchNormalization->offset)[k];
+      }
+    }
+
+    void WinogradConv2DCompiler::compileTile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                             const unsigned int rows, const unsigned int cols) const
+    {
+      const bool useAVX = usesAVX();
+      const unsigned int vectorSize = this->vectorSize();
+      const unsigned int inputChannels = p.weights->dims(2);
+      const unsigned int outputChannels = p.weights->dims(3);
+      const unsigned int inputWidth = input.dims(1);
+      const unsigned int outputWidth = output.dims(1);
+      const unsigned int productsOffset = 16 * inputChannels * sizeof(float);
+
+      auto reg = [&](const unsigned int i) -> x86::Vec
+      {
+        return useAVX ? x86::Vec(x86::ymm(i)) : x86::Vec(x86::xmm(i));
+      };
+      // dst = src1 op src2 (dst must not be src2 unless it is src1)
+      auto op = [&](const x86::Inst::Id avxId, const x86::Inst::Id sseId, const x86::Vec& dst, const x86::Vec& src1, const Operand& src2)
+      {
+        if(useAVX)
+          a.emit(avxId, dst, src1, src2);
+        else
+        {
+          if(dst.id() != src1.id())
+            a.movaps(dst.as<x86::Xmm>(), src1.as<x86::Xmm>());
+          a.emit(sseId, dst, src2);
+        }
+      };
+      auto add = [&](const x86::Vec& dst, const x86::Vec& src1, const Operand& src2) { op(x86::Inst::kIdVaddps, x86::Inst::kIdAddps, dst, src1, src2); };
+      auto sub = [&](const x86::Vec& dst, const x86::Vec& src1, const Operand& src2) { op(x86::Inst::kIdVsubps, x86::Inst::kIdSubps, dst, src1, src2); };
+      // All addresses are aligned to 16 bytes, because all channel counts are multiples of 4
+      auto load = [&](const x86::Vec& dst, const x86::Mem& src) { a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovaps, dst, src); };
+      auto store = [&](const x86::Mem& dst, const x86::Vec& src) { a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovaps, dst, src); };
+
+      // Transform the input tile (pixels outside of a partial tile are replaced by the last valid ones, their results are not stored)
+      {
+        auto pixel = [&](const unsigned int i, const unsigned int j)
+        {
+          return a.ptr_zdx((std::min(i, rows + 1) * inputWidth + std::min(j, cols + 1)) * inputChannels * sizeof(float));
+        };
+        static const unsigned int minuendRows[4] = {0, 1, 2, 1};
+        static const unsigned int subtrahendRows[4] = {2, 2, 1, 3};
+
+        a.mov(a.zdx(), a.zsi());
+        a.mov(x86::r11, a.zsp());
+        Label channelLoop;
+        if(inputChannels > vectorSize)
+        {
+          channelLoop = a.newLabel();
+          a.mov(a.zcx(), imm(inputChannels / vectorSize));
+          a.bind(channelLoop);
+        }
+
+        for(unsigned int i = 0; i < 4; i++)
+        {
+          // Row i of B^T d (the second row is a sum, the others are differences)
+          for(unsigned int j = 0; j < 4; j++)
+          {
+            load(reg(j), pixel(minuendRows[i], j));
+            if(i == 1)
+              add(reg(j), reg(j), pixel(subtrahendRows[i], j));
+            else
+              sub(reg(j), reg(j), pixel(subtrahendRows[i], j));
+          }
+
+          // Multiply it with B
+          add(reg(4), reg(1), reg(2));
+          sub(reg(0), reg(0), reg(2));
+          sub(reg(2), reg(2), reg(1));
+          sub(reg(1), reg(1), reg(3));
+          const unsigned int results[4] = {0, 4, 2, 1};
+          for(unsigned int j = 0; j < 4; j++)
+            store(x86::ptr(x86::r11, (i * 4 + j) * inputChannels * sizeof(float)), reg(results[j]));
+        }
+
+        if(inputChannels > vectorSize)
+        {
+          a.add(a.zdx(), imm(vectorSize * sizeof(float)));
+          a.add(x86::r11, imm(vectorSize * sizeof(float)));
+          a.dec(a.zcx());
+          a.jnz(channelLoop);
+        }
+      }
+
+      // Multiply the transformed inputs of each element with the transformed filters
+      {
+        const unsigned int outputBatchRegs = outputBatchSize() / vectorSize;
+        const unsigned int outputBatches = outputChannels / vectorSize / outputBatchRegs;
+        const unsigned int remainingRegs = outputChannels / vectorSize % outputBatchRegs;
+        const x86::Vec broadcast = reg(settings.xmmRegs() - 1);
+        const x86::Vec product = reg(settings.xmmRegs() - 2);
+
+        auto compileOutputBatch = [&](const unsigned int regs)
+        {
+          for(unsigned int i = 0; i < regs; i++)
+          {
+            if(useAVX)
+              a.vxorps(x86::ymm(i), x86::ymm(i), x86::ymm(i));
+            else
+              a.xorps(x86::xmm(i), x86::xmm(i));
+          }
+
+          // Unroll the loop over the input channels so that each iteration contains at least 8 multiplications
+          unsigned int unroll = 1;
+          while(unroll * regs < 8 && inputChannels % (unroll * 2) == 0)
+            unroll *= 2;
+          Label channelLoop;
+          if(inputChannels > unroll)
+          {
+            channelLoop = a.newLabel();
+            a.mov(a.zcx(), imm(inputChannels / unroll));
+            a.bind(channelLoop);
+          }
+
+          for(unsigned int channel = 0; channel < unroll; channel++)
+          {
+            if(useAVX)
+              a.vbroadcastss(broadcast.as<x86::Ymm>(), a.ptr_zdx(channel * sizeof(float)));
+            else
+            {
+              a.movss(broadcast.as<x86::Xmm>(), a.ptr_zdx(channel * sizeof(float)));
+              a.shufps(broadcast.as<x86::Xmm>(), broadcast.as<x86::Xmm>(), imm(0));
+            }
+            for(unsigned int i = 0; i < regs; i++)
+            {
+              const x86::Mem weights = a.ptr_zbx((channel * regs + i) * vectorSize * sizeof(float));
+              if(settings.useFMA3)
+                a.emit(x86::Inst::kIdVfmadd231ps, reg(i), broadcast, weights);
+              else if(useAVX)
+              {
+                a.vmulps(product.as<x86::Ymm>(), broadcast.as<x86::Ymm>(), weights);
+                a.vaddps(x86::ymm(i), x86::ymm(i), product.as<x86::Ymm>());
+              }
+              else
+              {
+                a.movaps(product.as<x86::Xmm>(), weights);
+                a.mulps(product.as<x86::Xmm>(), broadcast.as<x86::Xmm>());
+                a.addps(x86::xmm(i), product.as<x86::Xmm>());
+              }
+            }
+          }
+          a.add(a.zbx(), imm(unroll * regs * vectorSize * sizeof(float)));
+          a.add(a.zdx(), imm(unroll * sizeof(float)));
+
+          if(inputChannels > unroll)
+          {
+            a.dec(a.zcx());
+            a.jnz(channelLoop);
+          }
+          a.sub(a.zdx(), imm(inputChannels * sizeof(float)));
+
+          for(unsigned int i = 0; i < regs; i++)
+            store(x86::ptr(x86::r11, i * vectorSize * sizeof(float)), reg(i));
+          a.add(x86::r11, imm(regs * vectorSize * sizeof(float)));
+        };
+
+        a.lea(a.zbx(), x86::ptr(constants[0].label));
+        a.mov(a.zdx(), a.zsp());
+        a.lea(x86::r11, x86::ptr(a.zsp(), productsOffset));
+        a.mov(x86::r10d, imm(16));
+        Label elementLoop = a.newLabel();
+        a.bind(elementLoop);
+
+        if(outputBatches)
+        {
+          Label outputBatchLoop;
+          if(outputBatches > 1)
+          {
+            outputBatchLoop = a.newLabel();
+            a.mov(a.zax(), imm(outputBatches));
+            a.bind(outputBatchLoop);
+          }
+
+          compileOutputBatch(outputBatchRegs);
+
+          if(outputBatches > 1)
+          {
+            a.dec(a.zax());
+            a.jnz(outputBatchLoop);
+          }
+        }
+        if(remainingRegs)
+          compileOutputBatch(remainingRegs);
+
+        a.add(a.zdx(), imm(inputChannels * sizeof(float)));
+        a.dec(x86::r10d);
+        a.jnz(elementLoop);
+      }
+
+      // Transform the products to the output tile
+      {
+        auto products = [&](const unsigned int i, const unsigned int j)
+        {
+          return a.ptr_zdx((i * 4 + j) * outputChannels * sizeof(float));
+        };
+
+        a.lea(a.zdx(), x86::ptr(a.zsp(), productsOffset));
+        a.lea(a.zbx(), x86::ptr(constants[1].label));
+        a.mov(x86::r11, a.zdi());
+        Label channelLoop;
+        if(outputChannels > vectorSize)
+        {
+          channelLoop = a.newLabel();
+          a.mov(a.zax(), imm(outputChannels / vectorSize));
+          a.bind(channelLoop);
+        }
+
+        // Column j of A^T M in the registers j (first row) and 4 + j (second row)
+        const x86::Vec temp = reg(8);
+        for(unsigned int j = 0; j < cols + 2; j++)
+        {
+          load(temp, products(1, j));
+          add(reg(j), temp, products(2, j));
+          add(reg(j), reg(j), products(0, j));
+          if(rows == 2)
+          {
+            sub(reg(4 + j), temp, products(2, j));
+            sub(reg(4 + j), reg(4 + j), products(3, j));
+          }
+        }
+
+        // Multiply it with A and add the biases, such that the output pixel (i, j) of the tile is in the register 4 * i + j
+        for(unsigned int i = 0; i < rows; i++)
+        {
+          const unsigned int s = i * 4;
+          add(reg(s), reg(s), reg(s + 1));
+          add(reg(s), reg(s), reg(s + 2));
+          add(reg(s), reg(s), a.ptr_zbx());
+          if(cols == 2)
+          {
+            add(reg(s + 3), reg(s + 3), reg(s + 2));
+            sub(reg(s + 1), reg(s + 1), reg(s + 3));
+            add(reg(s + 1), reg(s + 1), a.ptr_zbx());
+          }
+        }
+
+        if(p.activationDesc != CompiledActivationFunctionId::linear)
+        {
+          ActivationFn& activationFn = useAVX ? afHandler.prepareAVX(p.activationDesc, a, {}, {}) : afHandler.prepare(p.activationDesc, false, a, {}, {});
+          for(unsigned int i = 0; i < settings.xmmRegs(); i++)
+          {
+            if(i / 4 < rows && i % 4 < cols)
+              activationFn.addValue(x86::xmm(i));
+            else
+              activationFn.addSpare(x86::xmm(i));
+          }
+          activationFn.initialize(a);
+          activationFn.apply(a);
+        }
+        for(unsigned int i = 0; i < rows; i++)
+          for(unsigned int j = 0; j < cols; j++)
+            store(x86::ptr(x86::r11, (i * outputWidth + j) * outputChannels * sizeof(float)), reg(i * 4 + j));
+
+        if(outputChannels > vectorSize)
+        {
+          a.add(a.zdx(), imm(vectorSize * sizeof(float)));
+          a.add(a.zbx(), imm(vectorSize * sizeof(float)));
+          a.add(x86::r11, imm(vectorSize * sizeof(float)));
+          a.dec(a.zax());
+          a.jnz(channelLoop);
+        }
+      }
+    }
+
+    void WinogradConv2DCompiler::compileTileRow(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output, const unsigned int rows) const
+    {
+      const unsigned int tiles = output.dims(1) / 2;
+      if(tiles)
+      {
+        Label tileLoop;
+        if(tiles > 1)
+        {
+          tileLoop = a.newLabel();
+          a.mov(x86::r9d, imm(tiles));
+          a.bind(tileLoop);
+        }
+
+        compileTile(a, afHandler, input, output, rows, 2);
+        a.add(a.zsi(), imm(2 * input.dims(2) * sizeof(float)));
+        a.add(a.zdi(), imm(2 * output.dims(2) * sizeof(float)));
+
+        if(tiles > 1)
+        {
+          a.dec(x86::r9d);
+          a.jnz(tileLoop);
+        }
+      }
+
+      // The last tile of an odd number of columns contains only one column
+      if(output.dims(1) % 2)
+      {
+        compileTile(a, afHandler, input, output, rows, 1);
+        a.add(a.zsi(), imm(2 * input.dims(2) * sizeof(float)));
+        a.add(a.zdi(), imm(2 * output.dims(2) * sizeof(float)));
+      }
+    }
+
+    void WinogradConv2DCompiler::compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const
+    {
+      ASSERT(settings.useX64);
+      ASSERT(input.rank() == 3);
+      ASSERT(output.rank() == 3);
+      ASSERT(input.dims(2) == p.weights->dims(2));
+      ASSERT(output.dims(2) == p.weights->dims(3));
+      ASSERT(input.data() != output.data());
+
+      // Load input/output base addresses
+      loadAddress(a, a.zsi(), input.data());
+      loadAddress(a, a.zdi(), output.data());
+
+      // Reserve the buffers for the transformed inputs and the products of a tile on the stack
+      const unsigned int bufferSize = 16 * (p.weights->dims(2) + p.weights->dims(3)) * sizeof(float);
+      a.mov(a.ptr_zbp(scratchPointerOffset, a.zsp().size()), a.zsp());
+#ifdef _WIN32
+      // Windows commits the stack through a guard page, so the pages have to be touched in order
+      for(unsigned int offset = 4096; offset < bufferSize + 32; offset += 4096)
+        a.or_(x86::dword_ptr(a.zsp(), -static_cast<int>(offset)), imm(0));
+#endif
+      a.sub(a.zsp(), imm(bufferSize));
+      a.and_(a.zsp(), imm(-32));
+
+      // Each tile row moves the pointers by one tile per column, so they have to be moved to the beginning of the next tile row
+      const unsigned int tileCols = (output.dims(1) + 1) / 2;
+      const unsigned int inputRowOffset = (2 * input.dims(1) - 2 * tileCols) * input.dims(2) * sizeof(float);
+      const unsigned int outputRowOffset = (2 * output.dims(1) - 2 * tileCols) * output.dims(2) * sizeof(float);
+
+      const unsigned int tileRows = output.dims(0) / 2;
+      if(tileRows)
+      {
+        Label tileRowLoop;
+        if(tileRows > 1)
+        {
+          tileRowLoop = a.newLabel();
+          a.mov(x86::r8d, imm(tileRows));
+          a.bind(tileRowLoop);
+        }
+
+        compileTileRow(a, afHandler, input, output, 2);
+        a.add(a.zsi(), imm(inputRowOffset));
+        if(outputRowOffset)
+          a.add(a.zdi(), imm(outputRowOffset));
+
+        if(tileRows > 1)
+        {
+          a.dec(x86::r8d);
+          a.jnz(tileRowLoop);
+        }
+      }
+
+      // The last tile row of an odd number of rows contains only one row
+      if(output.dims(0) % 2)
+        compileTileRow(a, afHandler, input, output, 1);
+
+      a.mov(a.zsp(), a.ptr_zbp(scratchPointerOffset, a.zsp().size()));
+
+      // Avoid the penalty of mixing the upper halves of the ymm registers with SSE instructions
+      if(usesAVX())
+        a.vzeroupper();
+    }
+  }
+}
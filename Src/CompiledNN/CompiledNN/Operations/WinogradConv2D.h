@@ -0,0 +1,111 @@
+/**
+ * Declares a compiler for 3x3 convolutions with stride 1 that uses the
+ * Winograd algorithm F(2x2, 3x3). Each tile of 2x2 output pixels is computed
+ * from a tile of 4x4 input pixels, which is transformed such that the
+ * convolution becomes 16 independent matrix-vector products over the input
+ * channels. This needs 16 instead of 36 multiplications per input and output
+ * channel for every 4 output pixels.
+ */
+
+#pragma once
+
+#include "../ActivationFunctions.h"
+#include "../CompiledNNImplBase.h"
+#include "BatchNormalization.h"
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    struct WinogradConv2DCompiler : public SISOOperationCompiler
+    {
+      struct Parameters final
+      {
+        const BatchNormalizationCompiler::Parameters* batchNormalization = nullptr; /**< Is applied before the activation function (which must have been linear in the layer). */
+        const Tensor<float, 1>* weights;
+        const std::vector<float>* biases;
+        ActivationFunctionDescriptor activationDesc;
+
+        bool operator==(const Parameters& other) const
+        {
+          return batchNormalization == other.batchNormalization &&
+                 weights == other.weights &&
+                 biases == other.biases &&
+                 activationDesc == other.activationDesc;
+        }
+      };
+      const Parameters p;
+
+      WinogradConv2DCompiler(const CompilationSettings& settings, const Parameters& p) : SISOOperationCompiler(settings), p(p) {}
+
+      inline bool canBeInplace() const override { return false; }
+
+      inline unsigned int maxParts(const TensorPointerXf& input, const TensorPointerXf& output) const override
+      {
+        return rowParts(input, output, 1);
+      }
+
+      inline void compilePart(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                              const unsigned int part, const unsigned int parts) const override
+      {
+        if(parts == 1)
+        {
+          compile(a, afHandler, input, output);
+          return;
+        }
+        const std::array<unsigned int, 2> rows = partRows(input, output, 1, part, parts);
+        if(rows[0] < rows[1])
+          compileRowRange(a, afHandler, input, output, rows[0], rows[1]);
+      }
+
+      inline RowWindow rowWindow() const override
+      {
+        return {3, 1, PaddingType::valid};
+      }
+
+      inline void compileRowRange(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output,
+                                  const unsigned int rowBegin, const unsigned int rowEnd) const override
+      {
+        compileRows(a, afHandler, input, output, 3, 1, rowBegin, rowEnd);
+      }
+
+      void initialize() override;
+      void compile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output) const override;
+
+      inline std::vector<unsigned int> calcOutputDimensions(const std::vector<unsigned int>& inputDimensions) const override
+      {
+        ASSERT(inputDimensions.size() == 3);
+        return {{inputDimensions[0] - 2, inputDimensions[1] - 2, p.weights->dims(3)}};
+      }
+
+      /**
+       * Checks whether a convolution can be computed by this compiler and has enough channels to be faster than the direct convolution.
+       * @param settings The compilation settings.
+       * @param weights The weights of the convolution.
+       * @param strides The strides of the convolution.
+       * @param outputDimensions The dimensions of the output of the convolution.
+       */
+      static bool isSuitable(const CompilationSettings& settings, const Tensor<float, 1>& weights, const std::array<unsigned int, 2>& strides, const std::vector<unsigned int>& outputDimensions);
+
+    private:
+      /** Returns whether the code uses ymm registers. */
+      inline bool usesAVX() const { return settings.useAVX2; }
+
+      /** Returns the number of floats per register. */
+      inline unsigned int vectorSize() const { return usesAVX() ? 8 : 4; }
+
+      /** Returns the number of output channels whose products are accumulated at once. */
+      unsigned int outputBatchSize() const;
+
+      /**
+       * Emits the code for one tile of output pixels. zsi points to the top left input pixel of the tile and zdi to the top left output pixel.
+       * @param rows The number of valid output rows of the tile (1 or 2).
+       * @param cols The number of valid output columns of the tile (1 or 2).
+       */
+      void compileTile(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output, unsigned int rows, unsigned int cols) const;
+
+      /** Emits the loop over the tiles of one row of tiles. */
+      void compileTileRow(x86::Assembler& a, ActivationFunctionHandler& afHandler, const TensorPointerXf& input, const TensorPointerXf& output, unsigned int rows) const;
+    };
+  }
+}
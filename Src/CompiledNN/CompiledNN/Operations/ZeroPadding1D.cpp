@@ -133,8 +133,8 @@ namespace NeuralNetwork
       if(p.padding[ZeroPadding1DLayer::LEFT] > 0)
       {
         // Copy data
-        a.mov(a.zsi(), imm(input.data() + input.size()));
-        a.mov(a.zdi(), imm(output.data() + (input.size() + p.padding[ZeroPadding1DLayer::LEFT] * input.dims(1))));
+        loadAddress(a, a.zsi(), input.data() + input.size());
+        loadAddress(a, a.zdi(), output.data() + (input.size() + p.padding[ZeroPadding1DLayer::LEFT] * input.dims(1)));
 
         const bool inputAligned = (input.size() % 4) == 0;
         const bool outputAligned = ((input.size() + p.padding[ZeroPadding1DLayer::LEFT] * input.dims(1)) % 4) == 0;
@@ -147,7 +147,7 @@ namespace NeuralNetwork
         }
 
         // Set left border to zero
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
         remainingSize = zeroLoopPacked(a, p.padding[ZeroPadding1DLayer::LEFT] * input.dims(1), settings.xmmRegs(), true, xmmIsZero);
         if(remainingSize > 0)
         {
@@ -160,7 +160,7 @@ namespace NeuralNetwork
       if(p.padding[ZeroPadding1DLayer::RIGHT] > 0)
       {
         // Set right border to zero
-        a.mov(a.zdi(), imm(output.data() + (input.size() + p.padding[ZeroPadding1DLayer::LEFT] * input.dims(1))));
+        loadAddress(a, a.zdi(), output.data() + (input.size() + p.padding[ZeroPadding1DLayer::LEFT] * input.dims(1)));
         const bool aligned = ((input.size() + p.padding[ZeroPadding1DLayer::LEFT] * input.dims(1)) % 4) == 0;
         int remainingSize = zeroLoopPacked(a, p.padding[ZeroPadding1DLayer::RIGHT] * input.dims(1), settings.xmmRegs(), aligned, xmmIsZero);
         if(remainingSize > 0)
@@ -21,8 +21,8 @@ namespace NeuralNetwork
       // Copy image
       if(input.data() != output.data())
       {
-        a.mov(a.zsi(), imm(input.data()));
-        a.mov(a.zdi(), imm(output.data() + ((output.dims(1) * p.padding[ZeroPadding2DLayer::TOP] + p.padding[ZeroPadding2DLayer::LEFT]) * output.dims(2))));
+        loadAddress(a, a.zsi(), input.data());
+        loadAddress(a, a.zdi(), output.data() + ((output.dims(1) * p.padding[ZeroPadding2DLayer::TOP] + p.padding[ZeroPadding2DLayer::LEFT]) * output.dims(2)));
 
         const bool aligned = input.dims(1) * input.dims(2) % 4 == 0;
         Label copyLoop;
@@ -104,7 +104,7 @@ namespace NeuralNetwork
       unsigned int remainingElements = p.padding[ZeroPadding2DLayer::TOP] * output.dims(1) * output.dims(2);
       if(remainingElements)
       {
-        a.mov(a.zdi(), imm(output.data()));
+        loadAddress(a, a.zdi(), output.data());
         for(unsigned int stepSize = settings.xmmRegs(); stepSize; --stepSize)
         {
           const unsigned int elementsPerStep = stepSize * 4;
@@ -158,7 +158,7 @@ namespace NeuralNetwork
         if(p.padding[ZeroPadding2DLayer::TOP])
           a.add(a.zdi(), imm((input.dims(0) * output.dims(1) * output.dims(2) + remainingElements) * sizeof(float)));
         else
-          a.mov(a.zdi(), imm(output.data() + input.dims(0) * output.dims(1) * output.dims(2)));
+          loadAddress(a, a.zdi(), output.data() + input.dims(0) * output.dims(1) * output.dims(2));
         remainingElements = p.padding[ZeroPadding2DLayer::BOTTOM] * output.dims(1) * output.dims(2);
         for(unsigned int stepSize = settings.xmmRegs(); stepSize; --stepSize)
         {
@@ -214,7 +214,7 @@ namespace NeuralNetwork
       // Clear left and right borders to zero
       if(p.padding[ZeroPadding2DLayer::LEFT] || p.padding[ZeroPadding2DLayer::RIGHT])
       {
-        a.mov(a.zdi(), imm(output.data() + p.padding[ZeroPadding2DLayer::TOP] * output.dims(1) * output.dims(2)));
+        loadAddress(a, a.zdi(), output.data() + p.padding[ZeroPadding2DLayer::TOP] * output.dims(1) * output.dims(2));
         if(clearRegisters == 0)
           a.xorps(x86::xmm0, x86::xmm0);
         Label clearLeftAndRightLoop;
@@ -34,6 +34,11 @@ namespace NeuralNetwork
       dataPointer(other.data())
     {}
 
+    TensorPointer(const std::vector<unsigned int>& dimensions, T* data) :
+      dimensions(dimensions),
+      dataPointer(data)
+    {}
+
     inline const T* data() const { return dataPointer; }
     inline T* data() { return dataPointer; }
 
@@ -0,0 +1,57 @@
+/**
+ * Implements a function that packs blocks of memory with known lifetimes into
+ * a single arena.
+ */
+
+#include "ArenaPlanner.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    std::size_t planArena(std::vector<ArenaBlock>& blocks)
+    {
+      std::vector<std::size_t> order(blocks.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&blocks](const std::size_t a, const std::size_t b)
+      {
+        return blocks[a].size > blocks[b].size;
+      });
+
+      std::size_t arenaSize = 0;
+      std::vector<const ArenaBlock*> placed, conflicts;
+      for(const std::size_t index : order)
+      {
+        ArenaBlock& block = blocks[index];
+
+        // Collect the placed blocks that are alive at the same time
+        conflicts.clear();
+        for(const ArenaBlock* other : placed)
+          if(other->firstUse <= block.lastUse && block.firstUse <= other->lastUse)
+            conflicts.push_back(other);
+        std::sort(conflicts.begin(), conflicts.end(), [](const ArenaBlock* a, const ArenaBlock* b) { return a->offset < b->offset; });
+
+        // Find the smallest gap that is large enough (or the end of the conflicting blocks)
+        std::size_t bestOffset = 0, bestGap = std::numeric_limits<std::size_t>::max(), end = 0;
+        bool found = false;
+        for(const ArenaBlock* other : conflicts)
+        {
+          if(other->offset >= end + block.size && other->offset - end < bestGap)
+          {
+            bestOffset = end;
+            bestGap = other->offset - end;
+            found = true;
+          }
+          end = std::max(end, other->offset + other->size);
+        }
+        block.offset = found ? bestOffset : end;
+        arenaSize = std::max(arenaSize, block.offset + block.size);
+        placed.push_back(&block);
+      }
+      return arenaSize;
+    }
+  }
+}
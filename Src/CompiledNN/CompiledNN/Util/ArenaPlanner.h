@@ -0,0 +1,31 @@
+/**
+ * Declares a function that packs blocks of memory with known lifetimes into a
+ * single arena, such that blocks whose lifetimes overlap never share memory.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    struct ArenaBlock final
+    {
+      std::size_t size; /**< The number of bytes of the block (a multiple of the alignment). */
+      std::size_t firstUse; /**< The first step in which the block is used. */
+      std::size_t lastUse; /**< The last step in which the block is used. */
+      std::size_t offset = 0; /**< The offset of the block in the arena (set by planArena). */
+    };
+
+    /**
+     * Assigns offsets to blocks, such that blocks whose lifetimes overlap do not overlap in memory.
+     * Larger blocks are placed first, each into the smallest gap between the blocks that are already placed and alive at the same time.
+     * @param blocks The blocks.
+     * @return The size of the arena.
+     */
+    std::size_t planArena(std::vector<ArenaBlock>& blocks);
+  }
+}
@@ -0,0 +1,276 @@
+/**
+ * Implements functions that write generated code to a relocatable ELF object
+ * file for x86-64 and that describe code in memory by an ELF symbol file.
+ */
+
+#include "ElfObject.h"
+#include <algorithm>
+#include <fstream>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    namespace
+    {
+      // Section indices of object files
+      enum : std::uint16_t { nullSection, textSection, rodataSection, relaTextSection, symtabSection, strtabSection, noteSection, shstrtabSection, numOfSections };
+
+      // Section indices of symbol files
+      enum : std::uint16_t { symbolFileNullSection, symbolFileTextSection, symbolFileSymtabSection, symbolFileStrtabSection, symbolFileShstrtabSection, numOfSymbolFileSections };
+
+      constexpr std::size_t headerSize = 64;
+      constexpr std::size_t sectionHeaderSize = 64;
+      constexpr std::size_t symbolSize = 24;
+      constexpr std::size_t relocationSize = 24;
+      constexpr std::uint32_t relocationPC32 = 2; // R_X86_64_PC32
+
+      /**
+       * A buffer to which little endian values are appended.
+       */
+      class Buffer final
+      {
+      public:
+        std::vector<unsigned char> bytes;
+
+        template<typename T>
+        void put(T value)
+        {
+          for(std::size_t i = 0; i < sizeof(T); ++i)
+            bytes.push_back(static_cast<unsigned char>(static_cast<std::uint64_t>(value) >> (8 * i)));
+        }
+
+        void put(const void* data, std::size_t size)
+        {
+          bytes.insert(bytes.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+        }
+
+        void align(std::size_t alignment)
+        {
+          bytes.resize((bytes.size() + alignment - 1) / alignment * alignment);
+        }
+      };
+
+      struct SectionHeader final
+      {
+        std::uint32_t name = 0;
+        std::uint32_t type = 0;
+        std::uint64_t flags = 0;
+        std::uint64_t address = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+        std::uint32_t link = 0;
+        std::uint32_t info = 0;
+        std::uint64_t alignment = 0;
+        std::uint64_t entrySize = 0;
+      };
+
+      void putSymbol(Buffer& buffer, std::uint32_t name, std::uint8_t info, std::uint16_t section, std::uint64_t value, std::uint64_t size)
+      {
+        buffer.put(name);
+        buffer.put(info);
+        buffer.put(std::uint8_t(0));
+        buffer.put(section);
+        buffer.put(value);
+        buffer.put(size);
+      }
+
+      /**
+       * Creates the section name string table and sets the names of the section headers.
+       */
+      std::string createSectionNames(SectionHeader* sections, const char* const* names, std::size_t count)
+      {
+        std::string shstrtab;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+          sections[i].name = static_cast<std::uint32_t>(shstrtab.size());
+          shstrtab += names[i];
+          shstrtab += '\0';
+        }
+        return shstrtab;
+      }
+
+      /**
+       * Appends the section headers to a file and fills in the ELF header at its start.
+       */
+      void finishFile(Buffer& file, std::uint16_t type, const SectionHeader* sections, std::uint16_t count, std::uint16_t shstrtabIndex)
+      {
+        file.align(8);
+        const std::uint64_t sectionHeaderOffset = file.bytes.size();
+        for(std::size_t i = 0; i < count; ++i)
+        {
+          const SectionHeader& section = sections[i];
+          file.put(section.name);
+          file.put(section.type);
+          file.put(section.flags);
+          file.put(section.address);
+          file.put(section.offset);
+          file.put(section.size);
+          file.put(section.link);
+          file.put(section.info);
+          file.put(section.alignment);
+          file.put(section.entrySize);
+        }
+
+        Buffer header;
+        const unsigned char identification[16] = {0x7f, 'E', 'L', 'F', 2 /* 64 bit */, 1 /* little endian */, 1 /* version */};
+        header.put(identification, sizeof(identification));
+        header.put(type);
+        header.put(std::uint16_t(62)); // EM_X86_64
+        header.put(std::uint32_t(1)); // Version
+        header.put(std::uint64_t(0)); // Entry point
+        header.put(std::uint64_t(0)); // Program header offset
+        header.put(sectionHeaderOffset);
+        header.put(std::uint32_t(0)); // Flags
+        header.put(std::uint16_t(headerSize));
+        header.put(std::uint16_t(0)); // Program header entry size
+        header.put(std::uint16_t(0)); // Number of program header entries
+        header.put(std::uint16_t(sectionHeaderSize));
+        header.put(count);
+        header.put(shstrtabIndex);
+        std::copy(header.bytes.begin(), header.bytes.end(), file.bytes.begin());
+      }
+    }
+
+    bool writeElfObject(const std::string& filename, const std::string& symbol, const void* code, std::size_t codeSize,
+                        const void* data, std::size_t dataSize, const std::vector<ElfDataReference>& references,
+                        const std::vector<ElfSymbol>& functions)
+    {
+      // Create the string tables
+      std::string strtab = std::string(1, '\0') + symbol + '\0';
+      const char* const sectionNames[numOfSections] = {"", ".text", ".rodata", ".rela.text", ".symtab", ".strtab", ".note.GNU-stack", ".shstrtab"};
+      SectionHeader sections[numOfSections];
+      const std::string shstrtab = createSectionNames(sections, sectionNames, numOfSections);
+
+      // Lay out the contents of all sections after the ELF header
+      Buffer file;
+      file.bytes.resize(headerSize);
+
+      file.align(64);
+      sections[textSection].type = 1; // SHT_PROGBITS
+      sections[textSection].flags = 0x2 | 0x4; // SHF_ALLOC | SHF_EXECINSTR
+      sections[textSection].offset = file.bytes.size();
+      sections[textSection].size = codeSize;
+      sections[textSection].alignment = 64;
+      file.put(code, codeSize);
+
+      file.align(64);
+      sections[rodataSection].type = 1; // SHT_PROGBITS
+      sections[rodataSection].flags = 0x2; // SHF_ALLOC
+      sections[rodataSection].offset = file.bytes.size();
+      sections[rodataSection].size = dataSize;
+      sections[rodataSection].alignment = 64;
+      file.put(data, dataSize);
+
+      // The data is referred to through the symbol of its section
+      constexpr std::uint32_t rodataSymbol = 2;
+      file.align(8);
+      sections[relaTextSection].type = 4; // SHT_RELA
+      sections[relaTextSection].flags = 0x40; // SHF_INFO_LINK
+      sections[relaTextSection].offset = file.bytes.size();
+      sections[relaTextSection].size = references.size() * relocationSize;
+      sections[relaTextSection].link = symtabSection;
+      sections[relaTextSection].info = textSection;
+      sections[relaTextSection].alignment = 8;
+      sections[relaTextSection].entrySize = relocationSize;
+      for(const ElfDataReference& reference : references)
+      {
+        file.put(reference.offset);
+        file.put((static_cast<std::uint64_t>(rodataSymbol) << 32) | relocationPC32);
+        file.put(reference.addend);
+      }
+
+      sections[symtabSection].type = 2; // SHT_SYMTAB
+      sections[symtabSection].offset = file.bytes.size();
+      sections[symtabSection].size = (4 + functions.size()) * symbolSize;
+      sections[symtabSection].link = strtabSection;
+      sections[symtabSection].info = static_cast<std::uint32_t>(3 + functions.size()); // Index of the first global symbol
+      sections[symtabSection].alignment = 8;
+      sections[symtabSection].entrySize = symbolSize;
+      putSymbol(file, 0, 0, 0, 0, 0);
+      putSymbol(file, 0, 0x03, textSection, 0, 0); // STB_LOCAL, STT_SECTION
+      putSymbol(file, 0, 0x03, rodataSection, 0, 0); // STB_LOCAL, STT_SECTION
+      for(const ElfSymbol& function : functions)
+      {
+        putSymbol(file, static_cast<std::uint32_t>(strtab.size()), 0x02, textSection, function.offset, function.size); // STB_LOCAL, STT_FUNC
+        strtab += function.name;
+        strtab += '\0';
+      }
+      putSymbol(file, 1, 0x12, textSection, 0, codeSize); // STB_GLOBAL, STT_FUNC
+
+      sections[strtabSection].type = 3; // SHT_STRTAB
+      sections[strtabSection].offset = file.bytes.size();
+      sections[strtabSection].size = strtab.size();
+      sections[strtabSection].alignment = 1;
+      file.put(strtab.data(), strtab.size());
+
+      // An empty note that marks the stack as not executable
+      sections[noteSection].type = 1; // SHT_PROGBITS
+      sections[noteSection].offset = file.bytes.size();
+      sections[noteSection].alignment = 1;
+
+      sections[shstrtabSection].type = 3; // SHT_STRTAB
+      sections[shstrtabSection].offset = file.bytes.size();
+      sections[shstrtabSection].size = shstrtab.size();
+      sections[shstrtabSection].alignment = 1;
+      file.put(shstrtab.data(), shstrtab.size());
+
+      finishFile(file, 1 /* ET_REL */, sections, numOfSections, shstrtabSection);
+
+      std::ofstream stream(filename, std::ios::binary);
+      stream.write(reinterpret_cast<const char*>(file.bytes.data()), file.bytes.size());
+      return static_cast<bool>(stream);
+    }
+
+    std::vector<unsigned char> createElfSymbolFile(std::uint64_t address, std::size_t codeSize, const std::vector<ElfSymbol>& functions)
+    {
+      std::string strtab(1, '\0');
+      const char* const sectionNames[numOfSymbolFileSections] = {"", ".text", ".symtab", ".strtab", ".shstrtab"};
+      SectionHeader sections[numOfSymbolFileSections];
+      const std::string shstrtab = createSectionNames(sections, sectionNames, numOfSymbolFileSections);
+
+      Buffer file;
+      file.bytes.resize(headerSize);
+
+      // The code itself is not part of the file
+      sections[symbolFileTextSection].type = 8; // SHT_NOBITS
+      sections[symbolFileTextSection].flags = 0x2 | 0x4; // SHF_ALLOC | SHF_EXECINSTR
+      sections[symbolFileTextSection].address = address;
+      sections[symbolFileTextSection].offset = file.bytes.size();
+      sections[symbolFileTextSection].size = codeSize;
+      sections[symbolFileTextSection].alignment = 1;
+
+      file.align(8);
+      sections[symbolFileSymtabSection].type = 2; // SHT_SYMTAB
+      sections[symbolFileSymtabSection].offset = file.bytes.size();
+      sections[symbolFileSymtabSection].size = (2 + functions.size()) * symbolSize;
+      sections[symbolFileSymtabSection].link = symbolFileStrtabSection;
+      sections[symbolFileSymtabSection].info = 2; // Index of the first global symbol
+      sections[symbolFileSymtabSection].alignment = 8;
+      sections[symbolFileSymtabSection].entrySize = symbolSize;
+      putSymbol(file, 0, 0, 0, 0, 0);
+      putSymbol(file, 0, 0x03, symbolFileTextSection, 0, 0); // STB_LOCAL, STT_SECTION
+      for(const ElfSymbol& function : functions)
+      {
+        putSymbol(file, static_cast<std::uint32_t>(strtab.size()), 0x12, symbolFileTextSection, function.offset, function.size); // STB_GLOBAL, STT_FUNC
+        strtab += function.name;
+        strtab += '\0';
+      }
+
+      sections[symbolFileStrtabSection].type = 3; // SHT_STRTAB
+      sections[symbolFileStrtabSection].offset = file.bytes.size();
+      sections[symbolFileStrtabSection].size = strtab.size();
+      sections[symbolFileStrtabSection].alignment = 1;
+      file.put(strtab.data(), strtab.size());
+
+      sections[symbolFileShstrtabSection].type = 3; // SHT_STRTAB
+      sections[symbolFileShstrtabSection].offset = file.bytes.size();
+      sections[symbolFileShstrtabSection].size = shstrtab.size();
+      sections[symbolFileShstrtabSection].alignment = 1;
+      file.put(shstrtab.data(), shstrtab.size());
+
+      finishFile(file, 1 /* ET_REL */, sections, numOfSymbolFileSections, symbolFileShstrtabSection);
+      return std::move(file.bytes);
+    }
+  }
+}
@@ -0,0 +1,64 @@
+/**
+ * Declares functions that write generated code to a relocatable ELF object
+ * file for x86-64, such that a compiled net can be linked into a program
+ * ahead of time, and that describe code in memory by an ELF symbol file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    /**
+     * A 32 bit displacement in the code that is relative to the instruction pointer and refers to the read-only data.
+     */
+    struct ElfDataReference final
+    {
+      std::uint64_t offset; /**< The offset of the displacement in the code. */
+      std::int64_t addend; /**< The offset of the target in the data, minus the distance from the displacement to the end of its instruction. */
+    };
+
+    /**
+     * A function in the code.
+     */
+    struct ElfSymbol final
+    {
+      std::uint64_t offset; /**< The offset of the function in the code. */
+      std::uint64_t size; /**< The number of bytes of the function. */
+      std::string name; /**< The name of the function. */
+    };
+
+    /**
+     * Writes an object file that contains the given code in its .text section and the given data in its .rodata section.
+     * The code is exported as a global function symbol that starts at the beginning of the code.
+     * @param filename The name of the object file.
+     * @param symbol The name of the function symbol.
+     * @param code The code.
+     * @param codeSize The number of bytes of the code.
+     * @param data The read-only data.
+     * @param dataSize The number of bytes of the data.
+     * @param references The places where the code refers to the data.
+     * @param functions Parts of the code that are exported as local function symbols (e.g. for profilers).
+     * @return Whether the file has been written.
+     */
+    bool writeElfObject(const std::string& filename, const std::string& symbol, const void* code, std::size_t codeSize,
+                        const void* data, std::size_t dataSize, const std::vector<ElfDataReference>& references,
+                        const std::vector<ElfSymbol>& functions);
+
+    /**
+     * Creates an ELF file for x86-64 that only describes the functions in code that has already been loaded (as needed by the JIT interface of GDB).
+     * Its .text section occupies no space in the file but has the address of the code.
+     * @param address The address of the code.
+     * @param codeSize The number of bytes of the code.
+     * @param functions The functions in the code.
+     * @return The contents of the file.
+     */
+    std::vector<unsigned char> createElfSymbolFile(std::uint64_t address, std::size_t codeSize, const std::vector<ElfSymbol>& functions);
+  }
+}
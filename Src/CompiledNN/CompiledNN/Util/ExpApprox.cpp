@@ -41,6 +41,16 @@ namespace NeuralNetwork
       template void apply<true>(x86::Assembler& a, const std::vector<x86::Xmm>& values, const x86::Xmm factor, const x86::Mem offset);
       template void apply<false>(x86::Assembler& a, const std::vector<x86::Xmm>& values, const x86::Mem factor, const x86::Mem offset);
       template void apply<true>(x86::Assembler& a, const std::vector<x86::Xmm>& values, const x86::Mem factor, const x86::Mem offset);
+
+      void applyAVX(x86::Assembler& a, const std::vector<x86::Ymm>& values, const Operand& factor, const Operand& offset)
+      {
+        for(const x86::Ymm& value : values)
+          a.emit(x86::Inst::kIdVmulps, value, value, factor);
+        for(const x86::Ymm& value : values)
+          a.vcvtps2dq(value, value);
+        for(const x86::Ymm& value : values)
+          a.emit(x86::Inst::kIdVpaddd, value, value, offset);
+      }
     }
   }
 }
@@ -34,6 +34,15 @@ namespace NeuralNetwork
 
       template<bool single = false, typename FactorType, typename OffsetType>
       void apply(x86::Assembler& a, const std::vector<x86::Xmm>& values, const FactorType factor, const OffsetType offset);
+
+      /**
+       * Applies the approximation to ymm registers (requires AVX2).
+       * @param a The assembler.
+       * @param values The registers containing the arguments, which are replaced by the results.
+       * @param factor A register or memory operand containing the factor in all elements.
+       * @param offset A register or memory operand containing the offset in all elements.
+       */
+      void applyAVX(x86::Assembler& a, const std::vector<x86::Ymm>& values, const Operand& factor, const Operand& offset);
     }
   }
 }
@@ -0,0 +1,60 @@
+/**
+ * Implements functions that convert single precision floats to IEEE half
+ * precision floats.
+ */
+
+#include "HalfFloat.h"
+#include <cstring>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    std::uint16_t floatToHalf(const float value)
+    {
+      std::uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      const std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+      const std::uint32_t magnitude = bits & 0x7fffffff;
+
+      // Infinity and NaN (which stays quiet)
+      if(magnitude >= 0x7f800000)
+        return sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00);
+
+      // Everything from 65520 on is rounded to infinity
+      if(magnitude >= 0x477ff000)
+        return sign | 0x7c00;
+
+      // Normal numbers: rebias the exponent and round the mantissa (a carry correctly increments the exponent)
+      if(magnitude >= 0x38800000)
+      {
+        const std::uint32_t rebiased = magnitude - ((127 - 15) << 23);
+        return sign | static_cast<std::uint16_t>((rebiased + 0xfff + ((rebiased >> 13) & 1)) >> 13);
+      }
+
+      // Everything up to 2^-25 is rounded to zero
+      if(magnitude <= 0x33000000)
+        return sign;
+
+      // Subnormal numbers are multiples of 2^-24
+      const unsigned int shift = 126 - (magnitude >> 23);
+      const std::uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+      const std::uint32_t remainder = mantissa & ((1u << shift) - 1);
+      const std::uint32_t half = 1u << (shift - 1);
+      std::uint32_t result = mantissa >> shift;
+      if(remainder > half || (remainder == half && (result & 1)))
+        ++result;
+      return sign | static_cast<std::uint16_t>(result);
+    }
+
+    void packHalves(std::vector<float>& data, const std::size_t begin)
+    {
+      const std::size_t count = data.size() - begin;
+      std::vector<std::uint16_t> halves((count + 1) / 2 * 2, 0);
+      for(std::size_t i = 0; i < count; ++i)
+        halves[i] = floatToHalf(data[begin + i]);
+      data.resize(begin + halves.size() / 2);
+      std::memcpy(data.data() + begin, halves.data(), halves.size() * sizeof(std::uint16_t));
+    }
+  }
+}
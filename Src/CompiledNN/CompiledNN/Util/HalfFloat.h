@@ -0,0 +1,31 @@
+/**
+ * Declares functions that convert single precision floats to IEEE half
+ * precision floats, in which the weights of some operations can be stored.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    /**
+     * Converts a float to the nearest half precision float (ties are rounded to even, values beyond the range become infinite).
+     * @param value The float.
+     * @return The bits of the half precision float.
+     */
+    std::uint16_t floatToHalf(float value);
+
+    /**
+     * Converts the floats from an index to the end of a vector to half precision floats, which are packed two per float into the same place.
+     * The vector is shortened accordingly (an odd number of floats is padded with a zero).
+     * @param data The vector.
+     * @param begin The index of the first float that is converted.
+     */
+    void packHalves(std::vector<float>& data, std::size_t begin = 0);
+  }
+}
@@ -0,0 +1,118 @@
+/**
+ * Implements functions that make generated code known to profilers and
+ * debuggers.
+ *
+ * GDB sets a breakpoint in __jit_debug_register_code and reads the list of
+ * symbol files from __jit_debug_descriptor whenever it is called.
+ */
+
+#include "JitRegistry.h"
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__x86_64__)
+extern "C"
+{
+  struct jit_code_entry
+  {
+    jit_code_entry* next_entry;
+    jit_code_entry* prev_entry;
+    const char* symfile_addr;
+    std::uint64_t symfile_size;
+  };
+
+  struct jit_descriptor
+  {
+    std::uint32_t version;
+    std::uint32_t action_flag; // 0: no action, 1: register, 2: unregister
+    jit_code_entry* relevant_entry;
+    jit_code_entry* first_entry;
+  };
+
+  // Weak, such that other JIT compilers in the same process can provide the same symbols
+  __attribute__((weak, noinline)) void __jit_debug_register_code()
+  {
+    __asm__ __volatile__("");
+  }
+
+  __attribute__((weak)) jit_descriptor __jit_debug_descriptor = {1, 0, nullptr, nullptr};
+}
+#endif
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    void writePerfMap(const void* code, const std::vector<ElfSymbol>& functions)
+    {
+#ifdef __linux__
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      char filename[32];
+      std::snprintf(filename, sizeof(filename), "/tmp/perf-%d.map", static_cast<int>(getpid()));
+      std::FILE* file = std::fopen(filename, "a");
+      if(!file)
+        return;
+      for(const ElfSymbol& function : functions)
+        std::fprintf(file, "%llx %llx %s\n", static_cast<unsigned long long>(reinterpret_cast<std::uintptr_t>(code) + function.offset),
+                     static_cast<unsigned long long>(function.size), function.name.c_str());
+      std::fclose(file);
+#else
+      static_cast<void>(code);
+      static_cast<void>(functions);
+#endif
+    }
+
+#if defined(__linux__) && defined(__x86_64__)
+    struct GdbJitRegistration::Entry
+    {
+      jit_code_entry entry;
+      std::vector<unsigned char> symbolFile;
+    };
+
+    static std::mutex gdbJitMutex;
+
+    GdbJitRegistration::GdbJitRegistration(const void* code, std::size_t codeSize, const std::vector<ElfSymbol>& functions) :
+      entry(std::make_unique<Entry>())
+    {
+      entry->symbolFile = createElfSymbolFile(reinterpret_cast<std::uintptr_t>(code), codeSize, functions);
+      entry->entry.symfile_addr = reinterpret_cast<const char*>(entry->symbolFile.data());
+      entry->entry.symfile_size = entry->symbolFile.size();
+
+      std::lock_guard<std::mutex> lock(gdbJitMutex);
+      entry->entry.prev_entry = nullptr;
+      entry->entry.next_entry = __jit_debug_descriptor.first_entry;
+      if(entry->entry.next_entry)
+        entry->entry.next_entry->prev_entry = &entry->entry;
+      __jit_debug_descriptor.first_entry = &entry->entry;
+      __jit_debug_descriptor.relevant_entry = &entry->entry;
+      __jit_debug_descriptor.action_flag = 1;
+      __jit_debug_register_code();
+    }
+
+    GdbJitRegistration::~GdbJitRegistration()
+    {
+      std::lock_guard<std::mutex> lock(gdbJitMutex);
+      if(entry->entry.prev_entry)
+        entry->entry.prev_entry->next_entry = entry->entry.next_entry;
+      else
+        __jit_debug_descriptor.first_entry = entry->entry.next_entry;
+      if(entry->entry.next_entry)
+        entry->entry.next_entry->prev_entry = entry->entry.prev_entry;
+      __jit_debug_descriptor.relevant_entry = &entry->entry;
+      __jit_debug_descriptor.action_flag = 2;
+      __jit_debug_register_code();
+    }
+#else
+    struct GdbJitRegistration::Entry {};
+
+    GdbJitRegistration::GdbJitRegistration(const void*, std::size_t, const std::vector<ElfSymbol>&) {}
+
+    GdbJitRegistration::~GdbJitRegistration() = default;
+#endif
+  }
+}
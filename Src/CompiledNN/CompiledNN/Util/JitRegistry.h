@@ -0,0 +1,49 @@
+/**
+ * Declares functions that make generated code known to profilers and
+ * debuggers: entries in the perf map of the process (/tmp/perf-<pid>.map)
+ * and registrations with the JIT interface of GDB.
+ */
+
+#pragma once
+
+#include "ElfObject.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    /**
+     * Appends the functions in the given code to the perf map of the process (only on Linux).
+     * @param code The address of the code.
+     * @param functions The functions in the code.
+     */
+    void writePerfMap(const void* code, const std::vector<ElfSymbol>& functions);
+
+    /**
+     * A registration of code with the JIT interface of GDB, which lasts as long as the object exists.
+     * Only x86-64 Linux is supported; on other platforms, nothing is registered.
+     */
+    class GdbJitRegistration final
+    {
+    public:
+      /**
+       * Registers the given code.
+       * @param code The address of the code.
+       * @param codeSize The number of bytes of the code.
+       * @param functions The functions in the code.
+       */
+      GdbJitRegistration(const void* code, std::size_t codeSize, const std::vector<ElfSymbol>& functions);
+      ~GdbJitRegistration();
+
+      GdbJitRegistration(const GdbJitRegistration&) = delete;
+      GdbJitRegistration& operator=(const GdbJitRegistration&) = delete;
+
+    private:
+      struct Entry;
+      std::unique_ptr<Entry> entry;
+    };
+  }
+}
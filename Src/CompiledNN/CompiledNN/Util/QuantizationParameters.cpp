@@ -0,0 +1,60 @@
+/**
+ * Implements a class that stores the calibrated input ranges of quantized
+ * layers in a text file.
+ */
+
+#include "QuantizationParameters.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    QuantizationParameters::QuantizationParameters(const std::string& filename)
+    {
+      if(filename.empty())
+        return;
+      std::ifstream stream(filename);
+      std::string line;
+      while(std::getline(stream, line))
+      {
+        if(line.empty() || line[0] == '#')
+          continue;
+        const std::size_t minBegin = line.find('\t');
+        const std::size_t maxBegin = minBegin == std::string::npos ? std::string::npos : line.find('\t', minBegin + 1);
+        if(maxBegin == std::string::npos)
+          continue;
+        set(line.substr(0, minBegin), std::strtof(line.c_str() + minBegin + 1, nullptr), std::strtof(line.c_str() + maxBegin + 1, nullptr));
+      }
+    }
+
+    bool QuantizationParameters::find(const std::string& layer, float& min, float& max) const
+    {
+      const auto entry = entries.find(layer);
+      if(entry == entries.end())
+        return false;
+      min = entry->second.first;
+      max = entry->second.second;
+      return true;
+    }
+
+    void QuantizationParameters::set(const std::string& layer, float min, float max)
+    {
+      // The quantized values must be able to represent 0 exactly, because it is used for padding
+      entries[layer] = std::make_pair(std::min(min, 0.f), std::max(max, 0.f));
+    }
+
+    bool QuantizationParameters::save(const std::string& filename) const
+    {
+      std::ofstream stream(filename);
+      stream << "# layer\tmin\tmax\n" << std::setprecision(std::numeric_limits<float>::max_digits10);
+      for(const auto& entry : entries)
+        stream << entry.first << '\t' << entry.second.first << '\t' << entry.second.second << '\n';
+      return static_cast<bool>(stream);
+    }
+  }
+}
@@ -0,0 +1,56 @@
+/**
+ * Declares a class that stores the calibrated input ranges of quantized
+ * layers in a text file.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    class QuantizationParameters final
+    {
+    public:
+      QuantizationParameters() = default;
+
+      /**
+       * Reads the entries of a parameter file (a missing file is treated as empty).
+       * Each line of the file consists of the name of a layer and the minimum and maximum of its input, separated by tabs.
+       * Lines that start with '#' are comments.
+       * @param filename The name of the file (empty for no ranges).
+       */
+      explicit QuantizationParameters(const std::string& filename);
+
+      /**
+       * Looks up the input range of a layer.
+       * @param layer The name of the layer.
+       * @param min Is set to the minimum (at most 0) if there is an entry.
+       * @param max Is set to the maximum (at least 0) if there is an entry.
+       * @return Whether there is an entry.
+       */
+      bool find(const std::string& layer, float& min, float& max) const;
+
+      /**
+       * Sets the input range of a layer.
+       */
+      void set(const std::string& layer, float min, float max);
+
+      /**
+       * Writes the entries to a file.
+       * @return Whether the file could be written.
+       */
+      bool save(const std::string& filename) const;
+
+      /** Returns the number of layers that have a range. */
+      inline std::size_t size() const { return entries.size(); }
+
+    private:
+      std::map<std::string, std::pair<float, float>> entries;
+    };
+  }
+}
@@ -0,0 +1,269 @@
+/**
+ * Implements a helper for operations that slide a (dilated) filter over the
+ * rows and columns of an image with implicit padding.
+ */
+
+#include "SlidingWindow.h"
+#include "../CompiledNNImplBase.h"
+#include "Platform/BHAssert.h"
+#include <algorithm>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    SlidingWindow::SlidingWindow(const std::array<unsigned int, 2>& kernelSize, const std::array<unsigned int, 2>& dilation, const std::array<unsigned int, 2>& strides,
+                                 PaddingType padding, const TensorPointerXf& input, const TensorPointerXf& output) :
+      kernelSize(kernelSize), dilation(dilation), strides(strides)
+    {
+      ASSERT(input.rank() == 3);
+      ASSERT(output.rank() == 3);
+      ASSERT(padding == PaddingType::valid || padding == PaddingType::same);
+      inputDimensions = {{input.dims(0), input.dims(1), input.dims(2)}};
+      outputSize = {{output.dims(0), output.dims(1)}};
+      for(std::size_t i = 0; i < 2; i++)
+      {
+        effectiveKernelSize[i] = (kernelSize[i] - 1) * dilation[i] + 1;
+
+        // The same padding is distributed evenly with the additional row or column at the end (cf. SimpleNN)
+        const int totalPadding = static_cast<int>((outputSize[i] - 1) * strides[i] + effectiveKernelSize[i]) - static_cast<int>(inputDimensions[i]);
+        this->padding[i] = padding == PaddingType::same ? std::max(totalPadding, 0) / 2 : 0;
+        padded |= padding == PaddingType::same && totalPadding > 0;
+      }
+    }
+
+    std::vector<unsigned int> SlidingWindow::outputDimensions(const std::array<unsigned int, 2>& kernelSize, const std::array<unsigned int, 2>& strides, PaddingType padding,
+                                                              const std::vector<unsigned int>& inputDimensions, unsigned int channels)
+    {
+      ASSERT(inputDimensions.size() == 3);
+      ASSERT(padding == PaddingType::valid || padding == PaddingType::same);
+      std::vector<unsigned int> outputDimensions(3, channels);
+      for(std::size_t i = 0; i < 2; i++)
+      {
+        if(padding == PaddingType::same)
+          outputDimensions[i] = (inputDimensions[i] + strides[i] - 1) / strides[i];
+        else
+        {
+          ASSERT(inputDimensions[i] >= kernelSize[i]);
+          outputDimensions[i] = (inputDimensions[i] - kernelSize[i]) / strides[i] + 1;
+        }
+      }
+      return outputDimensions;
+    }
+
+    long long SlidingWindow::inputOffset(unsigned int outputRow) const
+    {
+      const long long row = static_cast<long long>(outputRow * strides[0]) - padding[0];
+      return (row * inputDimensions[1] - padding[1]) * inputDimensions[2] * static_cast<long long>(sizeof(float));
+    }
+
+    unsigned int SlidingWindow::firstInputRow(unsigned int outputRow) const
+    {
+      return outputRow * strides[0] > padding[0] ? outputRow * strides[0] - padding[0] : 0;
+    }
+
+    unsigned int SlidingWindow::bufferSize() const
+    {
+      // The operations may read a register of floats beyond the last filter cell
+      return padded ? ((effectiveKernelSize[0] * effectiveKernelSize[1] * inputDimensions[2] + 8) * sizeof(float) + 31) / 32 * 32 : 0;
+    }
+
+    bool SlidingWindow::rowsInside(unsigned int rowBegin, unsigned int rowEnd) const
+    {
+      for(const Run& run : runs(0, rowBegin, rowEnd))
+        if(run.borders[0] || run.borders[1])
+          return false;
+      return true;
+    }
+
+    void SlidingWindow::reserveBuffer(x86::Assembler& a, unsigned int additionalSize) const
+    {
+      const unsigned int size = bufferSize() + additionalSize;
+      a.mov(a.ptr_zbp(scratchPointerOffset, a.zsp().size()), a.zsp());
+#ifdef _WIN32
+      // Windows commits the stack through a guard page, so the pages have to be touched in order
+      for(unsigned int offset = 4096; offset < size + 32; offset += 4096)
+        a.or_(x86::dword_ptr(a.zsp(), -static_cast<int>(offset)), imm(0));
+#endif
+      a.sub(a.zsp(), imm(size));
+      a.and_(a.zsp(), imm(-32));
+    }
+
+    void SlidingWindow::releaseBuffer(x86::Assembler& a) const
+    {
+      a.mov(a.zsp(), a.ptr_zbp(scratchPointerOffset, a.zsp().size()));
+    }
+
+    std::vector<SlidingWindow::Run> SlidingWindow::runs(unsigned int dimension, unsigned int begin, unsigned int end) const
+    {
+      std::vector<Run> runs;
+      for(unsigned int i = begin; i < end; i++)
+      {
+        // Count the filter cells before the input and the ones up to the last input, the remaining ones are after the input
+        const int first = static_cast<int>(i * strides[dimension]) - static_cast<int>(padding[dimension]);
+        const int last = static_cast<int>(inputDimensions[dimension]) - 1 - first;
+        const unsigned int before = first >= 0 ? 0 : std::min(kernelSize[dimension], static_cast<unsigned int>(-first + static_cast<int>(dilation[dimension]) - 1) / dilation[dimension]);
+        const unsigned int upToLast = last < 0 ? 0 : std::min(kernelSize[dimension], static_cast<unsigned int>(last) / dilation[dimension] + 1);
+        const std::array<unsigned int, 2> borders = {{before, kernelSize[dimension] - std::max(before, upToLast)}};
+        if(!runs.empty() && runs.back().borders == borders)
+          runs.back().count++;
+        else
+          runs.push_back({borders, 1});
+      }
+      return runs;
+    }
+
+    void SlidingWindow::compileLoops(x86::Assembler& a, bool useX64, unsigned int rowBegin, unsigned int rowEnd, const std::function<void(const Borders&)>& compileWindow) const
+    {
+      const std::vector<Run> rowRuns = runs(0, rowBegin, rowEnd);
+      const std::vector<Run> colRuns = runs(1, 0, outputSize[1]);
+      const int rowOffset = (static_cast<int>(strides[0] * inputDimensions[1]) - static_cast<int>(outputSize[1] * strides[1])) * static_cast<int>(inputDimensions[2] * sizeof(float));
+
+      for(const Run& rowRun : rowRuns)
+      {
+        // Begin loop over output rows
+        Label rowLoop;
+        if(rowRun.count > 1)
+        {
+          rowLoop = a.newLabel();
+          if(useX64)
+            a.mov(x86::r8d, imm(rowRun.count));
+          else
+            a.mov(a.ptr_zbp(-4, 4), imm(rowRun.count));
+          a.bind(rowLoop);
+        }
+
+        for(const Run& colRun : colRuns)
+        {
+          // Begin loop over output columns
+          Label colLoop;
+          if(colRun.count > 1)
+          {
+            colLoop = a.newLabel();
+            if(useX64)
+              a.mov(x86::r9d, imm(colRun.count));
+            else
+              a.mov(a.ptr_zbp(-8, 4), imm(colRun.count));
+            a.bind(colLoop);
+          }
+
+          compileWindow({{rowRun.borders[0], rowRun.borders[1], colRun.borders[0], colRun.borders[1]}});
+
+          // Set input offset to next column, respecting the stride
+          a.add(a.zsi(), imm(strides[1] * inputDimensions[2] * sizeof(float)));
+
+          // End loop over output columns
+          if(colRun.count > 1)
+          {
+            if(useX64)
+              a.dec(x86::r9d);
+            else
+              a.dec(a.ptr_zbp(-8, 4));
+            a.jnz(colLoop);
+          }
+        }
+
+        // Set input offset to next row, respecting the stride
+        if(rowOffset)
+          a.add(a.zsi(), imm(rowOffset));
+
+        // End loop over output rows
+        if(rowRun.count > 1)
+        {
+          if(useX64)
+            a.dec(x86::r8d);
+          else
+            a.dec(a.ptr_zbp(-4, 4));
+          a.jnz(rowLoop);
+        }
+      }
+    }
+
+    void SlidingWindow::compileGather(x86::Assembler& a, const Borders& borders, bool useAVX) const
+    {
+      ASSERT(borders[0] + borders[1] <= kernelSize[0]);
+      ASSERT(borders[2] + borders[3] <= kernelSize[1]);
+      const unsigned int channels = inputDimensions[2];
+
+      // Collect the contiguous runs of floats that are copied or set to zero (the source is negative for zeros)
+      struct Segment
+      {
+        unsigned int destination;
+        long long source;
+        unsigned int size;
+      };
+      std::vector<Segment> segments;
+      for(unsigned int y = 0; y < kernelSize[0]; y++)
+        for(unsigned int x = 0; x < kernelSize[1]; x++)
+        {
+          const bool outside = y < borders[0] || y >= kernelSize[0] - borders[1] || x < borders[2] || x >= kernelSize[1] - borders[3];
+          const unsigned int destination = (y * dilation[0] * effectiveKernelSize[1] + x * dilation[1]) * channels;
+          const long long source = outside ? -1 : (static_cast<long long>(y * dilation[0]) * inputDimensions[1] + x * dilation[1]) * channels;
+          if(!segments.empty() && segments.back().destination + segments.back().size == destination &&
+             (outside ? segments.back().source < 0 : segments.back().source >= 0 && segments.back().source + segments.back().size == source))
+            segments.back().size += channels;
+          else
+            segments.push_back({destination, source, channels});
+        }
+
+      const unsigned int vectorSize = useAVX ? 8 : 4;
+      const x86::Vec zero = useAVX ? x86::Vec(x86::ymm0) : x86::Vec(x86::xmm0);
+      const x86::Vec value = useAVX ? x86::Vec(x86::ymm1) : x86::Vec(x86::xmm1);
+      if(borders != Borders())
+      {
+        if(useAVX)
+          a.vxorps(x86::ymm0, x86::ymm0, x86::ymm0);
+        else
+          a.xorps(x86::xmm0, x86::xmm0);
+      }
+
+      for(const Segment& segment : segments)
+      {
+        const bool copy = segment.source >= 0;
+        const int sourceOffset = static_cast<int>(segment.source * sizeof(float));
+        const int destinationOffset = static_cast<int>(segment.destination * sizeof(float));
+        const unsigned int vectors = segment.size / vectorSize;
+
+        // Long segments are copied in a loop
+        unsigned int offset = 0;
+        if(vectors > 8)
+        {
+          if(copy)
+            a.lea(a.zdx(), a.ptr_zsi(sourceOffset));
+          a.lea(a.zax(), x86::ptr(a.zsp(), destinationOffset));
+          a.mov(a.zcx(), imm(vectors));
+          Label loop = a.newLabel();
+          a.bind(loop);
+          if(copy)
+          {
+            a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, value, a.ptr_zdx());
+            a.add(a.zdx(), imm(vectorSize * sizeof(float)));
+          }
+          a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, a.ptr_zax(), copy ? value : zero);
+          a.add(a.zax(), imm(vectorSize * sizeof(float)));
+          a.dec(a.zcx());
+          a.jnz(loop);
+          offset = vectors * vectorSize;
+        }
+        for(; offset + vectorSize <= segment.size; offset += vectorSize)
+        {
+          if(copy)
+            a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, value, a.ptr_zsi(sourceOffset + offset * sizeof(float)));
+          a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, x86::ptr(a.zsp(), destinationOffset + offset * sizeof(float)), copy ? value : zero);
+        }
+        for(; offset + 4 <= segment.size; offset += 4)
+        {
+          if(copy)
+            a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, x86::xmm1, a.ptr_zsi(sourceOffset + offset * sizeof(float)));
+          a.emit(useAVX ? x86::Inst::kIdVmovups : x86::Inst::kIdMovups, x86::ptr(a.zsp(), destinationOffset + offset * sizeof(float)), copy ? x86::xmm1 : x86::xmm0);
+        }
+        for(; offset < segment.size; offset++)
+        {
+          if(copy)
+            a.emit(useAVX ? x86::Inst::kIdVmovss : x86::Inst::kIdMovss, x86::xmm1, a.ptr_zsi(sourceOffset + offset * sizeof(float)));
+          a.emit(useAVX ? x86::Inst::kIdVmovss : x86::Inst::kIdMovss, x86::ptr(a.zsp(), destinationOffset + offset * sizeof(float)), copy ? x86::xmm1 : x86::xmm0);
+        }
+      }
+    }
+  }
+}
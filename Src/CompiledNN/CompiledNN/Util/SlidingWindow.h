@@ -0,0 +1,144 @@
+/**
+ * Declares a helper for operations that slide a (dilated) filter over the
+ * rows and columns of an image with implicit padding.
+ *
+ * The output pixels are grouped into runs of consecutive rows and columns
+ * whose windows lie outside of the input by the same number of filter rows
+ * and columns, such that each run is compiled once as a loop. The windows
+ * that lie partially outside of the input are copied to a buffer on the
+ * stack, in which the filter cells outside of the input are zero, so that
+ * the operation can compute them with the same code as the other windows
+ * instead of needing a padded copy of the whole input.
+ */
+
+#pragma once
+
+#include "../../Model.h"
+#include "../TensorPointer.h"
+#include <asmjit/asmjit.h>
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    using namespace asmjit;
+
+    class SlidingWindow final
+    {
+    public:
+      /** The numbers of filter rows and columns of a window that lie outside of the input (top, bottom, left, right). */
+      using Borders = std::array<unsigned int, 4>;
+
+      /**
+       * Constructor.
+       * @param kernelSize The number of filter rows and columns.
+       * @param dilation The distances between the inputs of neighboring filter rows and columns.
+       * @param strides The strides of the window.
+       * @param padding The padding type of the operation.
+       * @param input The input of the operation.
+       * @param output The output of the operation.
+       */
+      SlidingWindow(const std::array<unsigned int, 2>& kernelSize, const std::array<unsigned int, 2>& dilation, const std::array<unsigned int, 2>& strides,
+                    PaddingType padding, const TensorPointerXf& input, const TensorPointerXf& output);
+
+      /**
+       * Calculates the dimensions of the output of an operation.
+       * @param kernelSize The number of filter rows and columns (including the dilation).
+       * @param strides The strides of the window.
+       * @param padding The padding type of the operation.
+       * @param inputDimensions The dimensions of the input.
+       * @param channels The number of output channels.
+       */
+      static std::vector<unsigned int> outputDimensions(const std::array<unsigned int, 2>& kernelSize, const std::array<unsigned int, 2>& strides, PaddingType padding,
+                                                        const std::vector<unsigned int>& inputDimensions, unsigned int channels);
+
+      /** Returns whether any window lies partially outside of the input. */
+      bool isPadded() const { return padded; }
+
+      /** Returns the number of input columns between the rows of the buffer. */
+      unsigned int bufferWidth() const { return effectiveKernelSize[1]; }
+
+      /** Returns the number of bytes that the buffer occupies on the stack (a multiple of 32, zero if no window lies outside of the input). */
+      unsigned int bufferSize() const;
+
+      /**
+       * Checks whether the windows of a range of output rows lie inside of the input vertically, i.e. whether the code of these rows does not depend on their position.
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       */
+      bool rowsInside(unsigned int rowBegin, unsigned int rowEnd) const;
+
+      /**
+       * Returns the offset (in bytes) of the first input of the window of the first pixel in an output row relative to the beginning of the input.
+       * The offset is negative if the window begins before the input.
+       */
+      long long inputOffset(unsigned int outputRow) const;
+
+      /**
+       * Returns the first input row that the window of an output row covers (0 if the window begins above the input).
+       * The operations load the address of this row instead of the beginning of the input, since the input may only hold the rows from there on.
+       */
+      unsigned int firstInputRow(unsigned int outputRow) const;
+
+      /**
+       * Emits code that reserves the buffer on the stack (at zsp). The stack pointer is saved in the scratch slot of the frame.
+       * @param a The assembler.
+       * @param additionalSize The number of bytes that are reserved behind the buffer for the operation.
+       */
+      void reserveBuffer(x86::Assembler& a, unsigned int additionalSize = 0) const;
+
+      /**
+       * Emits code that releases the buffer.
+       */
+      void releaseBuffer(x86::Assembler& a) const;
+
+      /**
+       * Emits the loops over a range of output rows. zsi must point to the first input of the window of the first pixel (cf. inputOffset) and is moved to the next window.
+       * The loop counters are r8d and r9d on x64 and the 32-bit variables at -4 and -8 in the frame otherwise.
+       * @param a The assembler.
+       * @param useX64 Whether the loop counters can be kept in the additional registers of x64.
+       * @param rowBegin The first output row.
+       * @param rowEnd The end of the output rows.
+       * @param compileWindow Emits the code that computes an output pixel from the window at zsi, which lies outside of the input by the given borders.
+       */
+      void compileLoops(x86::Assembler& a, bool useX64, unsigned int rowBegin, unsigned int rowEnd, const std::function<void(const Borders&)>& compileWindow) const;
+
+      /**
+       * Emits code that copies the cells of the window at zsi that lie inside of the input to the buffer and sets the other cells to zero.
+       * The buffer contains the dilated window with bufferWidth() columns. Only zax, zcx, zdx, xmm0 and xmm1 are changed.
+       * @param a The assembler.
+       * @param borders The numbers of filter rows and columns that lie outside of the input.
+       * @param useAVX Whether the code can use AVX instructions.
+       */
+      void compileGather(x86::Assembler& a, const Borders& borders, bool useAVX) const;
+
+    private:
+      /** A run of consecutive output rows or columns whose windows have the same numbers of filter rows or columns before and after the input. */
+      struct Run
+      {
+        std::array<unsigned int, 2> borders;
+        unsigned int count;
+      };
+
+      std::array<unsigned int, 2> kernelSize;
+      std::array<unsigned int, 2> dilation;
+      std::array<unsigned int, 2> strides;
+      std::array<unsigned int, 2> effectiveKernelSize;
+      std::array<unsigned int, 2> padding; /**< The numbers of implicit zero rows before the input and columns left of it. */
+      std::array<unsigned int, 3> inputDimensions;
+      std::array<unsigned int, 2> outputSize;
+      bool padded = false;
+
+      /**
+       * Groups a range of output rows or columns into runs.
+       * @param dimension 0 for rows, 1 for columns.
+       * @param begin The first output row or column.
+       * @param end The end of the output rows or columns.
+       */
+      std::vector<Run> runs(unsigned int dimension, unsigned int begin, unsigned int end) const;
+    };
+  }
+}
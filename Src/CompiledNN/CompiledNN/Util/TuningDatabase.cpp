@@ -0,0 +1,70 @@
+/**
+ * Implements a class that stores the fastest code variant of operations per
+ * CPU model in a text file.
+ */
+
+#include "TuningDatabase.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    TuningDatabase::TuningDatabase(const std::string& filename) :
+      filename(filename)
+    {
+      if(filename.empty())
+        return;
+      std::ifstream stream(filename);
+      std::string line;
+      while(std::getline(stream, line))
+      {
+        const std::size_t keyBegin = line.find('\t');
+        const std::size_t variantBegin = keyBegin == std::string::npos ? std::string::npos : line.find('\t', keyBegin + 1);
+        if(variantBegin == std::string::npos)
+          continue;
+        entries[std::make_pair(line.substr(0, keyBegin), line.substr(keyBegin + 1, variantBegin - keyBegin - 1))] =
+          static_cast<unsigned int>(std::strtoul(line.c_str() + variantBegin + 1, nullptr, 10));
+      }
+    }
+
+    bool TuningDatabase::find(const std::string& cpu, const std::string& key, unsigned int& variant) const
+    {
+      const auto entry = entries.find(std::make_pair(cpu, key));
+      if(entry == entries.end())
+        return false;
+      variant = entry->second;
+      return true;
+    }
+
+    void TuningDatabase::set(const std::string& cpu, const std::string& key, unsigned int variant)
+    {
+      entries[std::make_pair(cpu, key)] = variant;
+      modified = true;
+    }
+
+    bool TuningDatabase::save() const
+    {
+      if(!modified || filename.empty())
+        return true;
+
+      // Write to a temporary file first, such that other processes never read a partially written database
+      const std::string tempFilename = filename + ".tmp";
+      {
+        std::ofstream stream(tempFilename);
+        for(const auto& entry : entries)
+          stream << entry.first.first << '\t' << entry.first.second << '\t' << entry.second << '\n';
+        if(!stream)
+        {
+          stream.close();
+          std::remove(tempFilename.c_str());
+          return false;
+        }
+      }
+      std::remove(filename.c_str());
+      return std::rename(tempFilename.c_str(), filename.c_str()) == 0;
+    }
+  }
+}
@@ -0,0 +1,53 @@
+/**
+ * Declares a class that stores the fastest code variant of operations per
+ * CPU model in a text file, such that the autotuner has to benchmark each
+ * operation only once.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    class TuningDatabase final
+    {
+    public:
+      /**
+       * Reads the entries of a database file (a missing file is treated as empty).
+       * Each line of the file consists of the CPU model, the key of the operation and the chosen variant, separated by tabs.
+       * @param filename The name of the file (empty for a database that is not stored).
+       */
+      explicit TuningDatabase(const std::string& filename);
+
+      /**
+       * Looks up the variant of an operation.
+       * @param cpu The brand string of the CPU.
+       * @param key The key that describes the operation.
+       * @param variant Is set to the stored variant if there is an entry.
+       * @return Whether there is an entry.
+       */
+      bool find(const std::string& cpu, const std::string& key, unsigned int& variant) const;
+
+      /**
+       * Sets the variant of an operation.
+       */
+      void set(const std::string& cpu, const std::string& key, unsigned int variant);
+
+      /**
+       * Writes the database back to its file if entries have been added.
+       * @return Whether the file is up to date.
+       */
+      bool save() const;
+
+    private:
+      std::string filename;
+      std::map<std::pair<std::string, std::string>, unsigned int> entries;
+      bool modified = false;
+    };
+  }
+}
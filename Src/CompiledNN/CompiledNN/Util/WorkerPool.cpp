@@ -0,0 +1,98 @@
+/**
+ * Implements a pool of worker threads that execute the parts of an operation
+ * that has been split among multiple threads or independent branches of a
+ * network.
+ */
+
+#include "WorkerPool.h"
+#include <immintrin.h>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    // The number of iterations that a thread busy-waits before it yields or goes to sleep (roughly some tens of microseconds).
+    constexpr unsigned int spinIterations = 4096;
+
+    WorkerPool::WorkerPool(unsigned int workers)
+    {
+      threads.reserve(workers);
+      for(unsigned int i = 0; i < workers; ++i)
+        threads.emplace_back(&WorkerPool::work, this);
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+      stop = true;
+      generation.fetch_add(1);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeUp.notify_all();
+      }
+      for(std::thread& thread : threads)
+        thread.join();
+    }
+
+    void WorkerPool::run(const Job* jobs, std::size_t count, void* workspace)
+    {
+      std::lock_guard<std::mutex> runLock(runMutex);
+
+      // Publish the jobs and wake up the workers
+      this->jobs = jobs;
+      this->count = count;
+      this->workspace = workspace;
+      nextJob = 1;
+      pending = static_cast<unsigned int>(threads.size());
+      generation.fetch_add(1);
+      if(sleepers.load())
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeUp.notify_all();
+      }
+
+      // Do the first job and possibly further ones on this thread
+      jobs[0](workspace);
+      takeJobs();
+
+      // Wait for the workers
+      for(unsigned int i = 0; pending.load(std::memory_order_acquire); ++i)
+      {
+        if(i < spinIterations)
+          _mm_pause();
+        else
+          std::this_thread::yield();
+      }
+    }
+
+    void WorkerPool::takeJobs()
+    {
+      for(std::size_t i = nextJob.fetch_add(1); i < count; i = nextJob.fetch_add(1))
+        jobs[i](workspace);
+    }
+
+    void WorkerPool::work()
+    {
+      unsigned int seenGeneration = 0;
+      while(true)
+      {
+        // Wait for the next batch of jobs
+        unsigned int i = 0;
+        for(; i < spinIterations && generation.load(std::memory_order_acquire) == seenGeneration; ++i)
+          _mm_pause();
+        if(i == spinIterations)
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          ++sleepers;
+          wakeUp.wait(lock, [&] { return generation.load() != seenGeneration; });
+          --sleepers;
+        }
+        seenGeneration = generation.load(std::memory_order_acquire);
+        if(stop)
+          return;
+
+        takeJobs();
+        pending.fetch_sub(1, std::memory_order_release);
+      }
+    }
+  }
+}
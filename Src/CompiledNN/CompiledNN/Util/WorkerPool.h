@@ -0,0 +1,67 @@
+/**
+ * Declares a pool of worker threads that execute the parts of an operation
+ * that has been split among multiple threads or independent branches of a
+ * network.
+ *
+ * Idle workers spin for a short time before they go to sleep, so that the
+ * synchronization between consecutive operations of one application of a
+ * network does not require the operating system.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NeuralNetwork
+{
+  namespace CompiledNNImpl
+  {
+    class WorkerPool final
+    {
+    public:
+      using Job = void (*)(void* workspace);
+
+      /**
+       * Starts the given number of worker threads (in addition to the calling thread).
+       */
+      explicit WorkerPool(unsigned int workers);
+      ~WorkerPool();
+
+      /**
+       * Executes the jobs on the calling thread and the workers and returns after all of them have finished.
+       * Each thread takes the next job that has not been taken yet as soon as it is idle, and the calling thread starts with jobs[0].
+       * Calls from multiple threads are serialized.
+       * @param jobs The jobs.
+       * @param count The number of jobs.
+       * @param workspace The argument that is passed to each job.
+       */
+      void run(const Job* jobs, std::size_t count, void* workspace);
+
+    private:
+      void work();
+
+      /**
+       * Executes jobs until there are none left.
+       */
+      void takeJobs();
+
+      std::vector<std::thread> threads;
+      std::atomic<unsigned int> generation{0}; /**< Incremented for each batch of jobs. */
+      std::atomic<unsigned int> pending{0}; /**< The number of workers that have not finished the current batch of jobs. */
+      std::atomic<std::size_t> nextJob{0}; /**< The index of the next job that has not been taken yet. */
+      std::atomic<unsigned int> sleepers{0}; /**< The number of workers that wait on the condition variable. */
+      std::atomic<bool> stop{false};
+      const Job* jobs = nullptr;
+      std::size_t count = 0;
+      void* workspace = nullptr;
+      std::mutex mutex;
+      std::condition_variable wakeUp;
+      std::mutex runMutex;
+    };
+  }
+}
@@ -288,23 +288,26 @@ namespace NeuralNetwork
     ASSERT(dilationRate->size() == 2);
     if(dataFormat != "channels_last")
       FAIL("Data formats other than channels last are not supported.");
-    if(getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 0)) != 1 ||
-       getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 1)) != 1)
-      FAIL("Conv2D layers with a dilation rate other than (1, 1) are currently not supported.");
 #ifndef NDEBUG
     const unsigned int kernelHeight = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(kernelSize, 0));
     const unsigned int kernelWidth = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(kernelSize, 1));
 #endif
     const unsigned int strideVertical = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(strides, 0));
     const unsigned int strideHorizontal = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(strides, 1));
+    const unsigned int dilationVertical = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 0));
+    const unsigned int dilationHorizontal = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 1));
     ASSERT(kernelHeight > 0);
     ASSERT(kernelWidth > 0);
     ASSERT(strideVertical > 0);
     ASSERT(strideHorizontal > 0);
+    ASSERT(dilationVertical > 0);
+    ASSERT(dilationHorizontal > 0);
 
     std::unique_ptr<Conv2DLayer> layer = std::make_unique<Conv2DLayer>();
     layer->strides[0] = strideVertical;
     layer->strides[1] = strideHorizontal;
+    layer->dilation[0] = dilationVertical;
+    layer->dilation[1] = dilationHorizontal;
     layer->activationId = parseActivation(activation);
     layer->padding = parsePadding(padding);
     layer->hasBiases = useBias;
@@ -352,23 +355,26 @@ namespace NeuralNetwork
     ASSERT(depthMultiplier > 0);
     if(dataFormat != "channels_last")
       FAIL("Data formats other than channels last are not supported.");
-    if(getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 0)) != 1 ||
-       getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 1)) != 1)
-      FAIL("SeparableConv2D layers with a dilation rate other than (1, 1) are currently not supported.");
 #ifndef NDEBUG
     const unsigned int kernelHeight = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(kernelSize, 0));
     const unsigned int kernelWidth = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(kernelSize, 1));
 #endif
     const unsigned int strideVertical = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(strides, 0));
     const unsigned int strideHorizontal = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(strides, 1));
+    const unsigned int dilationVertical = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 0));
+    const unsigned int dilationHorizontal = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 1));
     ASSERT(kernelHeight > 0);
     ASSERT(kernelWidth > 0);
     ASSERT(strideVertical > 0);
     ASSERT(strideHorizontal > 0);
+    ASSERT(dilationVertical > 0);
+    ASSERT(dilationHorizontal > 0);
 
     std::unique_ptr<SeparableConv2DLayer> layer = std::make_unique<SeparableConv2DLayer>();
     layer->strides[0] = strideVertical;
     layer->strides[1] = strideHorizontal;
+    layer->dilation[0] = dilationVertical;
+    layer->dilation[1] = dilationHorizontal;
     layer->activationId = parseActivation(activation);
     layer->padding = parsePadding(padding);
     layer->hasBiases = useBias;
@@ -422,23 +428,26 @@ namespace NeuralNetwork
     ASSERT(depthMultiplier > 0);
     if(dataFormat != "channels_last")
       FAIL("Data formats other than channels last are not supported.");
-    if(getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 0)) != 1 ||
-       getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 1)) != 1)
-      FAIL("DepthwiseConv2D layers with a dilation rate other than (1, 1) are currently not supported.");
 #ifndef NDEBUG
     const unsigned int kernelHeight = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(kernelSize, 0));
     const unsigned int kernelWidth = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(kernelSize, 1));
 #endif
     const unsigned int strideVertical = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(strides, 0));
     const unsigned int strideHorizontal = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(strides, 1));
+    const unsigned int dilationVertical = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 0));
+    const unsigned int dilationHorizontal = getLiteral<unsigned int>(getArrayEntry<SimpleMap::Literal>(dilationRate, 1));
     ASSERT(kernelHeight > 0);
     ASSERT(kernelWidth > 0);
     ASSERT(strideVertical > 0);
     ASSERT(strideHorizontal > 0);
+    ASSERT(dilationVertical > 0);
+    ASSERT(dilationHorizontal > 0);
 
     std::unique_ptr<DepthwiseConv2DLayer> layer = std::make_unique<DepthwiseConv2DLayer>();
     layer->strides[0] = strideVertical;
     layer->strides[1] = strideHorizontal;
+    layer->dilation[0] = dilationVertical;
+    layer->dilation[1] = dilationHorizontal;
     layer->activationId = parseActivation(activation);
     layer->padding = parsePadding(padding);
     layer->hasBiases = useBias;
@@ -914,6 +923,7 @@ namespace NeuralNetwork
           }
           ASSERT(outputSize > 0);
 
+          inputLayer->name = "input";
           inputLayer->nodes.emplace_back(inputLayer.get());
           inputLayer->nodes.back().outputDimensions.push_back(inputLayer->dimensions);
           inputLayer->nodes.back().outputs.emplace_back(inputLayer.get(), 0, 0);
@@ -935,6 +945,7 @@ namespace NeuralNetwork
           node.outputs.emplace_back(newLayer.get(), 0, 0);
         }
 
+        newLayer->name = name;
         layers.push_back(std::move(newLayer));
       }
 
@@ -982,6 +993,7 @@ namespace NeuralNetwork
       // Thus, they should not have any additional nodes.
       if(newLayer->type == LayerType::input && !getRecordEntry<SimpleMap::Array>(layer, "inbound_nodes")->empty())
         FAIL("Input layers that are called directly (i.e. `InputLayer(...)()` instead of `Input(...)`) are not supported.");
+      newLayer->name = name;
       createdLayers[name] = std::move(newLayer);
 
       // Add all inbound nodes of this layer to its unprocessed nodes array.
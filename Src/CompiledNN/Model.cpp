@@ -62,11 +62,11 @@ namespace NeuralNetwork
   {
     ASSERT(node.inputDimensions.size() == 1);
     ASSERT(node.inputDimensions[0].size() == 3);
-    ASSERT(padding == PaddingType::same || node.inputDimensions[0][0] >= weights.dims(0));
-    ASSERT(padding == PaddingType::same || node.inputDimensions[0][1] >= weights.dims(1));
+    ASSERT(padding == PaddingType::same || node.inputDimensions[0][0] >= (weights.dims(0) - 1) * dilation[0] + 1);
+    ASSERT(padding == PaddingType::same || node.inputDimensions[0][1] >= (weights.dims(1) - 1) * dilation[1] + 1);
     ASSERT(node.inputDimensions[0][2] == weights.dims(2));
-    node.outputDimensions.push_back({{(node.inputDimensions[0][0] - (padding == PaddingType::valid ? weights.dims(0) - 1 : 0) + strides[0] - 1) / strides[0],
-                                      (node.inputDimensions[0][1] - (padding == PaddingType::valid ? weights.dims(1) - 1 : 0) + strides[1] - 1) / strides[1],
+    node.outputDimensions.push_back({{(node.inputDimensions[0][0] - (padding == PaddingType::valid ? (weights.dims(0) - 1) * dilation[0] : 0) + strides[0] - 1) / strides[0],
+                                      (node.inputDimensions[0][1] - (padding == PaddingType::valid ? (weights.dims(1) - 1) * dilation[1] : 0) + strides[1] - 1) / strides[1],
                                       weights.dims(3)}});
   }
 
@@ -74,12 +74,12 @@ namespace NeuralNetwork
   {
     ASSERT(node.inputDimensions.size() == 1);
     ASSERT(node.inputDimensions[0].size() == 3);
-    ASSERT(padding == PaddingType::same || node.inputDimensions[0][0] >= depthwiseWeights.dims(0));
-    ASSERT(padding == PaddingType::same || node.inputDimensions[0][1] >= depthwiseWeights.dims(1));
+    ASSERT(padding == PaddingType::same || node.inputDimensions[0][0] >= (depthwiseWeights.dims(0) - 1) * dilation[0] + 1);
+    ASSERT(padding == PaddingType::same || node.inputDimensions[0][1] >= (depthwiseWeights.dims(1) - 1) * dilation[1] + 1);
     ASSERT(node.inputDimensions[0][2] == depthwiseWeights.dims(2));
     ASSERT(node.inputDimensions[0][2] * depthwiseWeights.dims(3) == pointwiseWeights.dims(2));
-    node.outputDimensions.push_back({{(node.inputDimensions[0][0] - (padding == PaddingType::valid ? depthwiseWeights.dims(0) - 1 : 0) + strides[0] - 1) / strides[0],
-                                      (node.inputDimensions[0][1] - (padding == PaddingType::valid ? depthwiseWeights.dims(1) - 1 : 0) + strides[1] - 1) / strides[1],
+    node.outputDimensions.push_back({{(node.inputDimensions[0][0] - (padding == PaddingType::valid ? (depthwiseWeights.dims(0) - 1) * dilation[0] : 0) + strides[0] - 1) / strides[0],
+                                      (node.inputDimensions[0][1] - (padding == PaddingType::valid ? (depthwiseWeights.dims(1) - 1) * dilation[1] : 0) + strides[1] - 1) / strides[1],
                                       pointwiseWeights.dims(3)}});
   }
 
@@ -87,11 +87,11 @@ namespace NeuralNetwork
   {
     ASSERT(node.inputDimensions.size() == 1);
     ASSERT(node.inputDimensions[0].size() == 3);
-    ASSERT(padding == PaddingType::same || node.inputDimensions[0][0] >= weights.dims(0));
-    ASSERT(padding == PaddingType::same || node.inputDimensions[0][1] >= weights.dims(1));
+    ASSERT(padding == PaddingType::same || node.inputDimensions[0][0] >= (weights.dims(0) - 1) * dilation[0] + 1);
+    ASSERT(padding == PaddingType::same || node.inputDimensions[0][1] >= (weights.dims(1) - 1) * dilation[1] + 1);
     ASSERT(node.inputDimensions[0][2] == weights.dims(2));
-    node.outputDimensions.push_back({{(node.inputDimensions[0][0] - (padding == PaddingType::valid ? weights.dims(0) - 1 : 0) + strides[0] - 1) / strides[0],
-                                      (node.inputDimensions[0][1] - (padding == PaddingType::valid ? weights.dims(1) - 1 : 0) + strides[1] - 1) / strides[1],
+    node.outputDimensions.push_back({{(node.inputDimensions[0][0] - (padding == PaddingType::valid ? (weights.dims(0) - 1) * dilation[0] : 0) + strides[0] - 1) / strides[0],
+                                      (node.inputDimensions[0][1] - (padding == PaddingType::valid ? (weights.dims(1) - 1) * dilation[1] : 0) + strides[1] - 1) / strides[1],
                                       node.inputDimensions[0][2] * weights.dims(3)}});
   }
 
@@ -93,6 +93,7 @@ namespace NeuralNetwork
   {
     const LayerType type;
     std::vector<Node> nodes;
+    std::string name; /**< The name of the layer in the model file (may be empty). */
 
     Layer() = delete;
     virtual ~Layer() = default;
@@ -236,6 +237,7 @@ namespace NeuralNetwork
   struct Conv2DLayer : Layer
   {
     std::array<unsigned int, 2> strides;
+    std::array<unsigned int, 2> dilation = {{1, 1}};
     Tensor<float, 1> weights;
     std::vector<float> biases;
     bool hasBiases;
@@ -250,6 +252,7 @@ namespace NeuralNetwork
   struct SeparableConv2DLayer : Layer
   {
     std::array<unsigned int, 2> strides;
+    std::array<unsigned int, 2> dilation = {{1, 1}};
     Tensor<float, 1> depthwiseWeights;
     Tensor<float, 1> pointwiseWeights;
     std::vector<float> biases;
@@ -265,6 +268,7 @@ namespace NeuralNetwork
   struct DepthwiseConv2DLayer : Layer
   {
     std::array<unsigned int, 2> strides;
+    std::array<unsigned int, 2> dilation = {{1, 1}};
     Tensor<float, 1> weights;
     std::vector<float> biases;
     bool hasBiases;
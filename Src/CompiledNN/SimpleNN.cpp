@@ -163,8 +163,8 @@ namespace NeuralNetwork
         ASSERT(input.rank() == 3);
         ASSERT(output.rank() == 3);
 
-        const unsigned int paddingTop = layer.padding == PaddingType::valid ? 0 : ((output.dims(0) - 1) * layer.strides[0] + layer.weights.dims(0) - input.dims(0)) / 2;
-        const unsigned int paddingLeft = layer.padding == PaddingType::valid ? 0 : ((output.dims(1) - 1) * layer.strides[1] + layer.weights.dims(1) - input.dims(1)) / 2;
+        const unsigned int paddingTop = layer.padding == PaddingType::valid ? 0 : std::max(0, static_cast<int>((output.dims(0) - 1) * layer.strides[0] + (layer.weights.dims(0) - 1) * layer.dilation[0] + 1) - static_cast<int>(input.dims(0))) / 2;
+        const unsigned int paddingLeft = layer.padding == PaddingType::valid ? 0 : std::max(0, static_cast<int>((output.dims(1) - 1) * layer.strides[1] + (layer.weights.dims(1) - 1) * layer.dilation[1] + 1) - static_cast<int>(input.dims(1))) / 2;
 
         unsigned int outputY = 0;
         for(int y = -static_cast<int>(paddingTop); outputY < output.dims(0); y += layer.strides[0], outputY++)
@@ -178,8 +178,8 @@ namespace NeuralNetwork
             {
               for(unsigned int filterX = 0; filterX < layer.weights.dims(1); filterX++)
               {
-                const int yIndex = y + filterY;
-                const int xIndex = x + filterX;
+                const int yIndex = y + filterY * layer.dilation[0];
+                const int xIndex = x + filterX * layer.dilation[1];
 
                 if(yIndex >= 0 && static_cast<unsigned int>(yIndex) < input.dims(0) && xIndex >= 0 && static_cast<unsigned int>(xIndex) < input.dims(1))
                 {
@@ -213,12 +213,12 @@ namespace NeuralNetwork
         ASSERT(input.rank() == 3);
         ASSERT(output.rank() == 3);
 
-        TensorXf depthwiseOutput({(input.dims(0) - (layer.padding == PaddingType::valid ? layer.depthwiseWeights.dims(0) - 1 : 0) + layer.strides[0] - 1) / layer.strides[0],
-                                  (input.dims(1) - (layer.padding == PaddingType::valid ? layer.depthwiseWeights.dims(1) - 1 : 0) + layer.strides[1] - 1) / layer.strides[1],
+        TensorXf depthwiseOutput({(input.dims(0) - (layer.padding == PaddingType::valid ? (layer.depthwiseWeights.dims(0) - 1) * layer.dilation[0] : 0) + layer.strides[0] - 1) / layer.strides[0],
+                                  (input.dims(1) - (layer.padding == PaddingType::valid ? (layer.depthwiseWeights.dims(1) - 1) * layer.dilation[1] : 0) + layer.strides[1] - 1) / layer.strides[1],
                                   input.dims(2) * layer.depthwiseWeights.dims(3)});
 
-        const unsigned int paddingTop = layer.padding == PaddingType::valid ? 0 : ((depthwiseOutput.dims(0) - 1) * layer.strides[0] + layer.depthwiseWeights.dims(0) - input.dims(0)) / 2;
-        const unsigned int paddingLeft = layer.padding == PaddingType::valid ? 0 : ((depthwiseOutput.dims(1) - 1) * layer.strides[1] + layer.depthwiseWeights.dims(1) - input.dims(1)) / 2;
+        const unsigned int paddingTop = layer.padding == PaddingType::valid ? 0 : std::max(0, static_cast<int>((depthwiseOutput.dims(0) - 1) * layer.strides[0] + (layer.depthwiseWeights.dims(0) - 1) * layer.dilation[0] + 1) - static_cast<int>(input.dims(0))) / 2;
+        const unsigned int paddingLeft = layer.padding == PaddingType::valid ? 0 : std::max(0, static_cast<int>((depthwiseOutput.dims(1) - 1) * layer.strides[1] + (layer.depthwiseWeights.dims(1) - 1) * layer.dilation[1] + 1) - static_cast<int>(input.dims(1))) / 2;
 
         unsigned int outputY = 0;
         for(int y = -static_cast<int>(paddingTop); outputY < depthwiseOutput.dims(0); y += layer.strides[0], outputY++)
@@ -232,8 +232,8 @@ namespace NeuralNetwork
             {
               for(unsigned int filterX = 0; filterX < layer.depthwiseWeights.dims(1); filterX++)
               {
-                const int yIndex = y + filterY;
-                const int xIndex = x + filterX;
+                const int yIndex = y + filterY * layer.dilation[0];
+                const int xIndex = x + filterX * layer.dilation[1];
 
                 if(yIndex >= 0 && static_cast<unsigned int>(yIndex) < input.dims(0) && xIndex >= 0 && static_cast<unsigned int>(xIndex) < input.dims(1))
                 {
@@ -285,8 +285,8 @@ namespace NeuralNetwork
         ASSERT(input.rank() == 3);
         ASSERT(output.rank() == 3);
 
-        const unsigned int paddingTop = layer.padding == PaddingType::valid ? 0 : ((output.dims(0) - 1) * layer.strides[0] + layer.weights.dims(0) - input.dims(0)) / 2;
-        const unsigned int paddingLeft = layer.padding == PaddingType::valid ? 0 : ((output.dims(1) - 1) * layer.strides[1] + layer.weights.dims(1) - input.dims(1)) / 2;
+        const unsigned int paddingTop = layer.padding == PaddingType::valid ? 0 : std::max(0, static_cast<int>((output.dims(0) - 1) * layer.strides[0] + (layer.weights.dims(0) - 1) * layer.dilation[0] + 1) - static_cast<int>(input.dims(0))) / 2;
+        const unsigned int paddingLeft = layer.padding == PaddingType::valid ? 0 : std::max(0, static_cast<int>((output.dims(1) - 1) * layer.strides[1] + (layer.weights.dims(1) - 1) * layer.dilation[1] + 1) - static_cast<int>(input.dims(1))) / 2;
 
         unsigned int outputY = 0;
         for(int y = -static_cast<int>(paddingTop); outputY < output.dims(0); y += layer.strides[0], outputY++)
@@ -300,8 +300,8 @@ namespace NeuralNetwork
             {
               for(unsigned int filterX = 0; filterX < layer.weights.dims(1); filterX++)
               {
-                const int yIndex = y + filterY;
-                const int xIndex = x + filterX;
+                const int yIndex = y + filterY * layer.dilation[0];
+                const int xIndex = x + filterX * layer.dilation[1];
 
                 if(yIndex >= 0 && static_cast<unsigned int>(yIndex) < input.dims(0) && xIndex >= 0 && static_cast<unsigned int>(xIndex) < input.dims(1))
                 {
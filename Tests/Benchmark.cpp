@@ -10,6 +10,8 @@
 #include "CompiledNN/CompiledNN.h"
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 
 #ifdef __linux__
@@ -28,9 +30,9 @@
 
 int main(int argc, char* argv[])
 {
-  if(argc != 3)
+  if(argc != 3 && !(argc == 4 && !std::strcmp(argv[3], "profile")))
   {
-    std::cerr << "Usage: " << (argc > 0 ? argv[0] : "Benchmark") << " <path to model> <number of iterations>\n";
+    std::cerr << "Usage: " << (argc > 0 ? argv[0] : "Benchmark") << " <path to model> <number of iterations> [profile]\n";
     return EXIT_FAILURE;
   }
 
@@ -44,6 +46,7 @@ int main(int argc, char* argv[])
   TIMESTAMP_GET(t2);
 
   std::cout << "Loading and compilation time: " << TIMESTAMP_DIFF(t1, t2) << "ns\n";
+  std::cout << "Tensor memory: " << nn.tensorMemory() << " bytes (" << nn.unsharedTensorMemory() << " bytes without sharing)\n";
 
   const unsigned int iterations = std::atoi(argv[2]);
 
@@ -62,5 +65,26 @@ int main(int argc, char* argv[])
 
   std::cout << "Average execution time over " << iterations << " runs: " << TIMESTAMP_DIFF(t1, t2) / iterations << "ns\n";
 
+  if(argc == 4)
+  {
+    // Measure the cycles of each operation with a separately compiled net (the counters slightly increase the overall execution time)
+    NeuralNetwork::CompilationSettings settings;
+    settings.profile = true;
+    nn.compile(model, settings);
+    nn.apply();
+    nn.resetProfile();
+    for(unsigned int i = 0; i < iterations; ++i)
+      nn.apply();
+
+    const std::vector<NeuralNetwork::CompiledNN::OperationProfile> profile = nn.profile();
+    std::uint64_t totalCycles = 0;
+    for(const NeuralNetwork::CompiledNN::OperationProfile& op : profile)
+      totalCycles += op.cycles;
+    std::cout << "Average cycles per operation:\n";
+    for(const NeuralNetwork::CompiledNN::OperationProfile& op : profile)
+      std::cout << std::setw(12) << (op.calls ? op.cycles / op.calls : 0) << std::setw(7) << std::fixed << std::setprecision(1)
+                << (totalCycles ? 100.0 * static_cast<double>(op.cycles) / static_cast<double>(totalCycles) : 0.0) << "%  " << op.layer << "\n";
+  }
+
   return EXIT_SUCCESS;
 }
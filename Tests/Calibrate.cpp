@@ -0,0 +1,78 @@
+/**
+ * @file Calibrate.cpp
+ *
+ * This file contains a program that determines the input ranges of the layers that can be quantized from sample inputs.
+ * Each sample file contains the values of all input tensors of the model as raw 32 bit floats (one tensor after the other).
+ */
+
+#include "CompiledNN/Calibration.h"
+#include "CompiledNN/Model.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+  if(argc < 4)
+  {
+    std::cerr << "Usage: " << (argc > 0 ? argv[0] : "Calibrate") << " <path to model> <parameter file> [minmax | percentile <percentage> | entropy] <sample files>...\n";
+    return EXIT_FAILURE;
+  }
+
+  NeuralNetwork::Calibration::Method method = NeuralNetwork::Calibration::Method::percentile;
+  float percentile = 99.99f;
+  int firstSample = 3;
+  if(std::strcmp(argv[3], "minmax") == 0)
+  {
+    method = NeuralNetwork::Calibration::Method::minMax;
+    ++firstSample;
+  }
+  else if(std::strcmp(argv[3], "percentile") == 0 && argc > 4)
+  {
+    method = NeuralNetwork::Calibration::Method::percentile;
+    percentile = std::strtof(argv[4], nullptr);
+    firstSample += 2;
+  }
+  else if(std::strcmp(argv[3], "entropy") == 0)
+  {
+    method = NeuralNetwork::Calibration::Method::entropy;
+    ++firstSample;
+  }
+
+  NeuralNetwork::Model model(argv[1]);
+  NeuralNetwork::Calibration calibration(model);
+
+  std::vector<NeuralNetwork::TensorXf> inputs(model.getInputs().size());
+  for(std::size_t i = 0; i < inputs.size(); ++i)
+  {
+    const NeuralNetwork::TensorLocation& input = model.getInputs()[i];
+    inputs[i].reshape(input.layer->nodes[input.nodeIndex].outputDimensions[input.tensorIndex]);
+  }
+
+  for(int i = firstSample; i < argc; ++i)
+  {
+    std::ifstream stream(argv[i], std::ios::binary);
+    for(NeuralNetwork::TensorXf& input : inputs)
+      stream.read(reinterpret_cast<char*>(input.data()), input.size() * sizeof(float));
+    if(!stream || stream.peek() != std::ifstream::traits_type::eof())
+    {
+      std::cerr << "Skipping " << argv[i] << ", because its size does not match the inputs of the model.\n";
+      continue;
+    }
+    calibration.add(inputs);
+  }
+
+  if(!calibration.samples())
+  {
+    std::cerr << "There are no samples.\n";
+    return EXIT_FAILURE;
+  }
+  if(!calibration.save(argv[2], method, percentile))
+  {
+    std::cerr << "The parameter file could not be written.\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "Calibrated with " << calibration.samples() << " samples.\n";
+  return EXIT_SUCCESS;
+}
@@ -13,15 +13,26 @@
 #include "CompiledNN/Tensor.h"
 #include "Platform/BHAssert.h"
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <random>
 #include <vector>
 
 int main(int argc, char* argv[])
 {
+  // The weights of Dense and Conv2D layers can be stored as half precision floats or the layers can be quantized to see how this affects the accuracy
+  bool halfPrecisionWeights = false, quantize = false;
+  for(; argc > 2; --argc)
+    if(std::strcmp(argv[argc - 1], "f16") == 0)
+      halfPrecisionWeights = true;
+    else if(std::strcmp(argv[argc - 1], "quant") == 0)
+      quantize = true;
+    else
+      break;
+
   if(argc < 2 || argc > 4)
   {
-    std::cerr << "Usage: " << (argc > 0 ? argv[0] : "Check") << " <path to model> [<min input> [<max input>]]\n";
+    std::cerr << "Usage: " << (argc > 0 ? argv[0] : "Check") << " <path to model> [<min input> [<max input>]] [f16] [quant]\n";
     return EXIT_FAILURE;
   }
 
@@ -54,6 +65,10 @@ int main(int argc, char* argv[])
   settings.useExpApproxInSigmoid = false;
   settings.useExpApproxInTanh = false;
   settings.debug = true;
+  settings.useHalfPrecisionWeights = halfPrecisionWeights;
+  if(halfPrecisionWeights && !settings.constricted().useHalfPrecisionWeights)
+    std::cerr << "Half precision weights are not supported by this CPU, so all weights are floats.\n";
+  settings.quantize = quantize;
 
   // Apply the simple NN and compare the output of each node to what the compiled NN calculates.
   std::vector<NeuralNetwork::TensorXf> testInputsCopied(testInputs);
@@ -0,0 +1,34 @@
+/**
+ * @file Export.cpp
+ *
+ * This file contains a program to compile a model ahead of time into an ELF object file and a C header.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/Model.h"
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+  if(argc < 4 || argc > 6)
+  {
+    std::cerr << "Usage: " << (argc > 0 ? argv[0] : "Export") << " <path to model> <object file> <header file> [<name> [<batch size>]]\n";
+    return EXIT_FAILURE;
+  }
+
+  NeuralNetwork::CompilationSettings settings;
+  settings.reentrant = true;
+  settings.bindIO = true;
+  if(argc > 5)
+    settings.batchSize = static_cast<unsigned int>(std::atoi(argv[5]));
+
+  NeuralNetwork::CompiledNN nn;
+  nn.compile(NeuralNetwork::Model(argv[1]), settings);
+  if(!nn.exportObject(argv[2], argv[3], argc > 4 ? argv[4] : "model"))
+  {
+    std::cerr << "The net could not be exported.\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file KerasModel.cpp
+ *
+ * This file implements a class that writes Keras HDF5 models with random weights.
+ */
+
+#include "KerasModel.h"
+#include <gtest/gtest.h>
+#include <hdf5.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * Returns the number of output rows or columns of a sliding window.
+ * @param size The number of input rows or columns.
+ * @param kernelSize The size of the window.
+ * @param stride The stride of the window.
+ * @param padding "valid" or "same".
+ */
+static unsigned int slidingWindowSize(const unsigned int size, const unsigned int kernelSize, const unsigned int stride, const std::string& padding)
+{
+  return padding == "same" ? (size + stride - 1) / stride : (size - kernelSize) / stride + 1;
+}
+
+/**
+ * Returns the configuration entries of a sliding window as JSON.
+ * @param kernelName The name of the entry that contains the size of the window.
+ * @param kernelSize The height and width of the window.
+ * @param stride The vertical and horizontal stride.
+ * @param padding "valid" or "same".
+ */
+static std::string slidingWindowConfig(const std::string& kernelName, const unsigned int kernelSize, const unsigned int stride, const std::string& padding)
+{
+  std::ostringstream config;
+  config << "\"" << kernelName << "\": [" << kernelSize << ", " << kernelSize << "], \"strides\": [" << stride << ", " << stride
+         << "], \"padding\": \"" << padding << "\", \"data_format\": \"channels_last\"";
+  return config.str();
+}
+
+/**
+ * Writes a string attribute.
+ * @param location The object to which the attribute is attached.
+ * @param name The name of the attribute.
+ * @param value The value of the attribute.
+ */
+static void writeStringAttribute(const hid_t location, const char* name, const std::string& value)
+{
+  const hid_t type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(type, H5T_VARIABLE);
+  const hid_t space = H5Screate(H5S_SCALAR);
+  const hid_t attribute = H5Acreate2(location, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+  const char* data = value.c_str();
+  H5Awrite(attribute, type, &data);
+  H5Aclose(attribute);
+  H5Sclose(space);
+  H5Tclose(type);
+}
+
+void KerasModel::addInput(const std::string& name, const std::vector<unsigned int>& dimensions)
+{
+  std::ostringstream config;
+  config << "\"batch_input_shape\": [null";
+  for(const unsigned int dimension : dimensions)
+    config << ", " << dimension;
+  config << "], \"dtype\": \"float32\", \"sparse\": false";
+  add(name, "InputLayer", config.str(), {}, dimensions);
+  inputs.push_back(name);
+}
+
+void KerasModel::addConv2D(const std::string& name, const std::string& input, const unsigned int filters, const unsigned int kernelSize, const unsigned int stride,
+                           const std::string& padding, const std::string& activation)
+{
+  const std::vector<unsigned int>& inputDimensions = dimensions.at(input);
+  add(name, "Conv2D", "\"filters\": " + std::to_string(filters) + ", " + slidingWindowConfig("kernel_size", kernelSize, stride, padding) +
+      ", \"dilation_rate\": [1, 1], \"activation\": \"" + activation + "\", \"use_bias\": true", {input},
+      {slidingWindowSize(inputDimensions[0], kernelSize, stride, padding), slidingWindowSize(inputDimensions[1], kernelSize, stride, padding), filters});
+  const float range = 1.f / std::sqrt(static_cast<float>(kernelSize * kernelSize * inputDimensions[2]));
+  weights.push_back({name, "kernel", {kernelSize, kernelSize, inputDimensions[2], filters}, -range, range});
+  weights.push_back({name, "bias", {filters}, -0.5f, 0.5f});
+}
+
+void KerasModel::addDepthwiseConv2D(const std::string& name, const std::string& input, const unsigned int kernelSize, const unsigned int stride,
+                                    const std::string& padding, const std::string& activation)
+{
+  const std::vector<unsigned int>& inputDimensions = dimensions.at(input);
+  add(name, "DepthwiseConv2D", slidingWindowConfig("kernel_size", kernelSize, stride, padding) +
+      ", \"dilation_rate\": [1, 1], \"depth_multiplier\": 1, \"activation\": \"" + activation + "\", \"use_bias\": true", {input},
+      {slidingWindowSize(inputDimensions[0], kernelSize, stride, padding), slidingWindowSize(inputDimensions[1], kernelSize, stride, padding), inputDimensions[2]});
+  const float range = 1.f / static_cast<float>(kernelSize);
+  weights.push_back({name, "depthwise_kernel", {kernelSize, kernelSize, inputDimensions[2], 1}, -range, range});
+  weights.push_back({name, "bias", {inputDimensions[2]}, -0.5f, 0.5f});
+}
+
+void KerasModel::addBatchNormalization(const std::string& name, const std::string& input)
+{
+  const std::vector<unsigned int> inputDimensions = dimensions.at(input);
+  add(name, "BatchNormalization", "\"axis\": -1, \"epsilon\": 0.001, \"center\": true, \"scale\": true", {input}, inputDimensions);
+  weights.push_back({name, "gamma", {inputDimensions.back()}, 0.5f, 1.5f});
+  weights.push_back({name, "beta", {inputDimensions.back()}, -0.5f, 0.5f});
+  weights.push_back({name, "moving_mean", {inputDimensions.back()}, -0.5f, 0.5f});
+  weights.push_back({name, "moving_variance", {inputDimensions.back()}, 0.5f, 1.5f});
+}
+
+void KerasModel::addActivation(const std::string& name, const std::string& input, const std::string& activation)
+{
+  add(name, "Activation", "\"activation\": \"" + activation + "\"", {input}, dimensions.at(input));
+}
+
+void KerasModel::addPooling2D(const std::string& name, const std::string& input, const std::string& className, const unsigned int poolSize, const unsigned int stride,
+                              const std::string& padding)
+{
+  const std::vector<unsigned int>& inputDimensions = dimensions.at(input);
+  add(name, className, slidingWindowConfig("pool_size", poolSize, stride, padding), {input},
+      {slidingWindowSize(inputDimensions[0], poolSize, stride, padding), slidingWindowSize(inputDimensions[1], poolSize, stride, padding), inputDimensions[2]});
+}
+
+void KerasModel::addMerge(const std::string& name, const std::vector<std::string>& inputs, const std::string& className)
+{
+  std::vector<unsigned int> outputDimensions = dimensions.at(inputs.front());
+  if(className == "Concatenate")
+  {
+    outputDimensions.back() = 0;
+    for(const std::string& input : inputs)
+      outputDimensions.back() += dimensions.at(input).back();
+  }
+  add(name, className, className == "Concatenate" ? "\"axis\": -1" : "", inputs, outputDimensions);
+}
+
+void KerasModel::addFlatten(const std::string& name, const std::string& input)
+{
+  const std::vector<unsigned int>& inputDimensions = dimensions.at(input);
+  unsigned int size = 1;
+  for(const unsigned int dimension : inputDimensions)
+    size *= dimension;
+  add(name, "Flatten", "\"data_format\": \"channels_last\"", {input}, {size});
+}
+
+void KerasModel::addDense(const std::string& name, const std::string& input, const unsigned int units, const std::string& activation)
+{
+  const std::vector<unsigned int>& inputDimensions = dimensions.at(input);
+  add(name, "Dense", "\"units\": " + std::to_string(units) + ", \"activation\": \"" + activation + "\", \"use_bias\": true", {input}, {units});
+  const float range = 1.f / std::sqrt(static_cast<float>(inputDimensions.back()));
+  weights.push_back({name, "kernel", {inputDimensions.back(), units}, -range, range});
+  weights.push_back({name, "bias", {units}, -0.5f, 0.5f});
+}
+
+void KerasModel::add(const std::string& name, const std::string& className, const std::string& config, const std::vector<std::string>& inputs,
+                     const std::vector<unsigned int>& dimensions)
+{
+  layers.push_back({name, className, config, inputs});
+  this->dimensions[name] = dimensions;
+}
+
+void KerasModel::write(const std::string& filename, const std::vector<std::string>& outputs, const unsigned int seed) const
+{
+  // The model configuration of a functional Keras model
+  std::ostringstream config;
+  config << "{\"class_name\": \"Model\", \"config\": {\"name\": \"model\", \"layers\": [";
+  for(std::size_t i = 0; i < layers.size(); ++i)
+  {
+    const Layer& layer = layers[i];
+    config << (i ? ", " : "") << "{\"name\": \"" << layer.name << "\", \"class_name\": \"" << layer.className << "\", \"config\": {\"name\": \"" << layer.name << "\""
+           << (layer.config.empty() ? "" : ", ") << layer.config << "}, \"inbound_nodes\": [";
+    if(!layer.inputs.empty())
+    {
+      config << "[";
+      for(std::size_t j = 0; j < layer.inputs.size(); ++j)
+        config << (j ? ", " : "") << "[\"" << layer.inputs[j] << "\", 0, 0, {}]";
+      config << "]";
+    }
+    config << "]}";
+  }
+  config << "], \"input_layers\": [";
+  for(std::size_t i = 0; i < inputs.size(); ++i)
+    config << (i ? ", " : "") << "[\"" << inputs[i] << "\", 0, 0]";
+  config << "], \"output_layers\": [";
+  for(std::size_t i = 0; i < outputs.size(); ++i)
+    config << (i ? ", " : "") << "[\"" << outputs[i] << "\", 0, 0]";
+  config << "]}}";
+
+  const hid_t file = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if(file < 0)
+    throw std::runtime_error("Could not create " + filename);
+  writeStringAttribute(file, "keras_version", "2.2.4");
+  writeStringAttribute(file, "model_config", config.str());
+
+  // The weights of each layer are stored in a group that lists their names
+  std::mt19937 generator(seed);
+  const hid_t modelWeights = H5Gcreate2(file, "model_weights", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  for(const Layer& layer : layers)
+  {
+    if(std::none_of(weights.begin(), weights.end(), [&layer](const Weights& w) { return w.layer == layer.name; }))
+      continue;
+    const hid_t layerGroup = H5Gcreate2(modelWeights, layer.name.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    const hid_t weightsGroup = H5Gcreate2(layerGroup, layer.name.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    std::vector<std::string> names;
+    for(const Weights& w : weights)
+    {
+      if(w.layer != layer.name)
+        continue;
+      names.push_back(layer.name + "/" + w.name + ":0");
+
+      const std::vector<hsize_t> shape(w.dimensions.begin(), w.dimensions.end());
+      std::size_t size = 1;
+      for(const hsize_t dimension : shape)
+        size *= dimension;
+      std::vector<float> data(size);
+      std::uniform_real_distribution<float> distribution(w.min, w.max);
+      for(float& value : data)
+        value = distribution(generator);
+
+      const hid_t space = H5Screate_simple(static_cast<int>(shape.size()), shape.data(), nullptr);
+      const hid_t dataset = H5Dcreate2(weightsGroup, (w.name + ":0").c_str(), H5T_IEEE_F32LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      H5Dwrite(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+      H5Dclose(dataset);
+      H5Sclose(space);
+    }
+
+    // The names are stored as an array of fixed length strings
+    std::size_t length = 0;
+    for(const std::string& name : names)
+      length = std::max(length, name.size());
+    std::vector<char> buffer(length * names.size(), 0);
+    for(std::size_t i = 0; i < names.size(); ++i)
+      std::memcpy(buffer.data() + i * length, names[i].data(), names[i].size());
+    const hid_t type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(type, length);
+    H5Tset_strpad(type, H5T_STR_NULLPAD);
+    const hsize_t count = names.size();
+    const hid_t space = H5Screate_simple(1, &count, nullptr);
+    const hid_t attribute = H5Acreate2(layerGroup, "weight_names", type, space, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attribute, type, buffer.data());
+    H5Aclose(attribute);
+    H5Sclose(space);
+    H5Tclose(type);
+    H5Gclose(weightsGroup);
+    H5Gclose(layerGroup);
+  }
+  H5Gclose(modelWeights);
+  H5Fclose(file);
+}
+
+std::string KerasModel::temporaryFilename(const std::string& extension)
+{
+  const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+  std::string name = std::string(info->test_suite_name()) + "." + info->name();
+  std::replace(name.begin(), name.end(), '/', '_');
+  return ::testing::TempDir() + name + extension;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file KerasModel.h
+ *
+ * This file declares a class that writes Keras HDF5 models with random weights, such that tests can compile nets of several layers.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+class KerasModel
+{
+public:
+  /**
+   * Adds an input layer.
+   * @param name The name of the layer.
+   * @param dimensions The dimensions of the input (without the batch dimension).
+   */
+  void addInput(const std::string& name, const std::vector<unsigned int>& dimensions);
+
+  /**
+   * Adds a Conv2D layer with biases.
+   * @param name The name of the layer.
+   * @param input The name of the layer that computes the input.
+   * @param filters The number of output channels.
+   * @param kernelSize The height and width of the kernel.
+   * @param stride The vertical and horizontal stride.
+   * @param padding "valid" or "same".
+   * @param activation The name of the activation function.
+   */
+  void addConv2D(const std::string& name, const std::string& input, unsigned int filters, unsigned int kernelSize, unsigned int stride,
+                 const std::string& padding, const std::string& activation);
+
+  /**
+   * Adds a DepthwiseConv2D layer with biases and a depth multiplier of 1.
+   * @param name The name of the layer.
+   * @param input The name of the layer that computes the input.
+   * @param kernelSize The height and width of the kernel.
+   * @param stride The vertical and horizontal stride.
+   * @param padding "valid" or "same".
+   * @param activation The name of the activation function.
+   */
+  void addDepthwiseConv2D(const std::string& name, const std::string& input, unsigned int kernelSize, unsigned int stride,
+                          const std::string& padding, const std::string& activation);
+
+  /**
+   * Adds a BatchNormalization layer over the channels.
+   * @param name The name of the layer.
+   * @param input The name of the layer that computes the input.
+   */
+  void addBatchNormalization(const std::string& name, const std::string& input);
+
+  /**
+   * Adds an Activation layer.
+   * @param name The name of the layer.
+   * @param input The name of the layer that computes the input.
+   * @param activation The name of the activation function.
+   */
+  void addActivation(const std::string& name, const std::string& input, const std::string& activation);
+
+  /**
+   * Adds a MaxPooling2D or AveragePooling2D layer.
+   * @param name The name of the layer.
+   * @param input The name of the layer that computes the input.
+   * @param className "MaxPooling2D" or "AveragePooling2D".
+   * @param poolSize The height and width of the pooling window.
+   * @param stride The vertical and horizontal stride.
+   * @param padding "valid" or "same".
+   */
+  void addPooling2D(const std::string& name, const std::string& input, const std::string& className, unsigned int poolSize, unsigned int stride,
+                    const std::string& padding);
+
+  /**
+   * Adds a layer that merges several inputs, i.e. an Add or a Concatenate (over the channels) layer.
+   * @param name The name of the layer.
+   * @param inputs The names of the layers that compute the inputs.
+   * @param className "Add" or "Concatenate".
+   */
+  void addMerge(const std::string& name, const std::vector<std::string>& inputs, const std::string& className);
+
+  /**
+   * Adds a Flatten layer.
+   * @param name The name of the layer.
+   * @param input The name of the layer that computes the input.
+   */
+  void addFlatten(const std::string& name, const std::string& input);
+
+  /**
+   * Adds a Dense layer with biases.
+   * @param name The name of the layer.
+   * @param input The name of the layer that computes the input.
+   * @param units The number of outputs.
+   * @param activation The name of the activation function.
+   */
+  void addDense(const std::string& name, const std::string& input, unsigned int units, const std::string& activation);
+
+  /**
+   * Writes the model with random weights to a file.
+   * @param filename The name of the file.
+   * @param outputs The names of the layers that compute the outputs of the model.
+   * @param seed The seed of the random weights.
+   */
+  void write(const std::string& filename, const std::vector<std::string>& outputs, unsigned int seed = 0) const;
+
+  /**
+   * Returns the name of a file in the temporary directory that is unique to the current test (tests may run in parallel).
+   * @param extension The extension of the file (including the dot).
+   */
+  static std::string temporaryFilename(const std::string& extension);
+
+private:
+  /** The description of a layer in the model configuration. */
+  struct Layer
+  {
+    std::string name;
+    std::string className;
+    std::string config; /**< The entries of the configuration (without the name) as JSON. */
+    std::vector<std::string> inputs;
+  };
+
+  /** The description of a weight tensor. */
+  struct Weights
+  {
+    std::string layer;
+    std::string name;
+    std::vector<unsigned int> dimensions;
+    float min;
+    float max;
+  };
+
+  /**
+   * Adds a layer.
+   * @param name The name of the layer.
+   * @param className The Keras class of the layer.
+   * @param config The entries of the configuration (without the name) as JSON.
+   * @param inputs The names of the layers that compute the inputs.
+   * @param dimensions The dimensions of the output.
+   */
+  void add(const std::string& name, const std::string& className, const std::string& config, const std::vector<std::string>& inputs,
+           const std::vector<unsigned int>& dimensions);
+
+  std::vector<Layer> layers;
+  std::vector<std::string> inputs;
+  std::vector<Weights> weights;
+  std::map<std::string, std::vector<unsigned int>> dimensions; /**< The output dimensions of each layer. */
+};
@@ -0,0 +1,78 @@
+/**
+ * @file Activation.cpp
+ *
+ * This file defines a test for the Activation layer.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class ActivationTest : public ::testing::TestWithParam<std::tuple<unsigned int, ActivationFunctionId, bool>>
+{
+  static const Node& buildNode(ActivationLayer* l, unsigned int size, ActivationFunctionId activation)
+  {
+    l->nodes.clear();
+    l->activationId = activation;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back({size});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<2>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-2.f, 2.f);
+
+    ActivationLayer l;
+    const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()));
+    c.compile(n, settings);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(ActivationTest, ProducesSameOutputAsSimpleNN)
+{
+  // Some of the functions are approximated using an approximation of the exponential function
+  EXPECT_LT(getError(), 0.1f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, ActivationTest,
+                        ::testing::Combine(/* size */ ::testing::Values(3u, 13u, 128u),
+                                           /* activation */ ::testing::Values(ActivationFunctionId::relu, ActivationFunctionId::sigmoid, ActivationFunctionId::tanH,
+                                                                              ActivationFunctionId::hardSigmoid, ActivationFunctionId::elu, ActivationFunctionId::selu,
+                                                                              ActivationFunctionId::softsign),
+                                           /* AVX2 */ ::testing::Bool()));
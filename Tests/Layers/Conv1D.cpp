@@ -0,0 +1,90 @@
+/**
+ * @file Conv1D.cpp
+ *
+ * This file defines a test for the Conv1D layer.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class Conv1DTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, PaddingType, ActivationFunctionId, bool>>
+{
+  static const Node& buildNode(Conv1DLayer* l, unsigned int kernelSize, unsigned int stride, unsigned int inputChannels, unsigned int outputChannels,
+                               PaddingType padding, ActivationFunctionId activation, std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->stride = stride;
+    l->weights.reshape(kernelSize, inputChannels, outputChannels);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(outputChannels);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = activation;
+    l->padding = padding;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back({17, inputChannels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useFMA3 = std::get<6>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      Conv1DLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()),
+                                std::get<4>(GetParam()), std::get<5>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(Conv1DTest, ProducesSameOutputAsSimpleNN)
+{
+  EXPECT_LT(getError(), 1e-4f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, Conv1DTest,
+                        ::testing::Combine(/* kernel size */ ::testing::Values(1u, 3u, 5u), /* stride */ ::testing::Values(1u, 2u),
+                                           /* input channels */ ::testing::Values(1u, 3u, 8u), /* output channels */ ::testing::Values(5u, 16u, 130u),
+                                           /* padding */ ::testing::Values(PaddingType::valid, PaddingType::same),
+                                           /* activation */ ::testing::Values(ActivationFunctionId::linear, ActivationFunctionId::relu),
+                                           /* FMA3 */ ::testing::Bool()));
@@ -0,0 +1,95 @@
+/**
+ * @file Conv2D.cpp
+ *
+ * This file defines a test for the Conv2D layer.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class Conv2DTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, ActivationFunctionId, bool, bool, unsigned int, bool>>
+{
+  static const Node& buildNode(Conv2DLayer* l, unsigned int kernelSize, unsigned int stride, unsigned int inputChannels, unsigned int outputChannels,
+                               ActivationFunctionId activation, std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->strides = {stride, stride};
+    l->weights.reshape(kernelSize, kernelSize, inputChannels, outputChannels);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(outputChannels);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = activation;
+    l->padding = PaddingType::valid;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back({7, 7, inputChannels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<5>(GetParam());
+    settings.useHalfPrecisionWeights = std::get<6>(GetParam());
+    settings.threads = std::get<7>(GetParam());
+    settings.useX64 = std::get<8>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      Conv2DLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()),
+                                std::get<4>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(Conv2DTest, ProducesSameOutputAsSimpleNN)
+{
+  // Half precision weights are rounded to 11 significant bits
+  EXPECT_LT(getError(), std::get<6>(GetParam()) ? std::get<0>(GetParam()) * std::get<0>(GetParam()) * std::get<2>(GetParam()) * 1e-3f : 1e-4f);
+}
+
+// On x64, most of the convolutions with 8 input channels are computed as im2col and GEMM (see GEMMConv2D.cpp), so the direct convolution is tested on x86
+INSTANTIATE_TEST_CASE_P(Layers, Conv2DTest,
+                        ::testing::Combine(/* kernel size */ ::testing::Values(1u, 3u), /* stride */ ::testing::Values(1u, 2u),
+                                           /* input channels */ ::testing::Values(3u, 8u), /* output channels */ ::testing::Values(5u, 16u, 130u),
+                                           /* activation */ ::testing::Values(ActivationFunctionId::linear, ActivationFunctionId::relu),
+                                           /* AVX2 */ ::testing::Bool(), /* half precision weights */ ::testing::Bool(),
+                                           /* threads */ ::testing::Values(1u, 3u), /* x64 */ ::testing::Bool()));
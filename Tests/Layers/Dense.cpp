@@ -0,0 +1,88 @@
+/**
+ * @file Dense.cpp
+ *
+ * This file defines a test for the Dense layer.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class DenseTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, ActivationFunctionId, bool, bool, unsigned int>>
+{
+  static const Node& buildNode(DenseLayer* l, unsigned int inputs, unsigned int outputs, ActivationFunctionId activation, std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->weights.reshape(inputs, outputs);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(outputs);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = activation;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back({inputs});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<3>(GetParam());
+    settings.useHalfPrecisionWeights = std::get<4>(GetParam());
+    settings.threads = std::get<5>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      DenseLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(DenseTest, ProducesSameOutputAsSimpleNN)
+{
+  // Half precision weights are rounded to 11 significant bits
+  EXPECT_LT(getError(), std::get<4>(GetParam()) ? std::get<0>(GetParam()) * 1e-3f : 1e-4f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, DenseTest,
+                        ::testing::Combine(/* inputs */ ::testing::Values(1u, 3u, 16u, 37u, 200u), /* outputs */ ::testing::Values(1u, 5u, 16u, 130u),
+                                           /* activation */ ::testing::Values(ActivationFunctionId::linear, ActivationFunctionId::relu),
+                                           /* AVX2 */ ::testing::Bool(), /* half precision weights */ ::testing::Bool(),
+                                           /* threads */ ::testing::Values(1u, 3u)));
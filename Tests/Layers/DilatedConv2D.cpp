@@ -0,0 +1,166 @@
+/**
+ * @file DilatedConv2D.cpp
+ *
+ * This file defines tests for dilated Conv2D and DepthwiseConv2D layers.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class DilatedConv2DTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, PaddingType, unsigned int, unsigned int, bool, bool>>
+{
+  static const Node& buildNode(Conv2DLayer* l, unsigned int kernelSize, unsigned int dilation, PaddingType padding, unsigned int inputChannels, unsigned int outputChannels,
+                               std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->strides = {1, 1};
+    l->dilation = {dilation, dilation};
+    l->weights.reshape(kernelSize, kernelSize, inputChannels, outputChannels);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(outputChannels);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = ActivationFunctionId::relu;
+    l->padding = padding;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back({9, 11, inputChannels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<5>(GetParam());
+    settings.useX64 = std::get<6>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      Conv2DLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()), std::get<4>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(DilatedConv2DTest, ProducesSimilarOutputAsSimpleNN)
+{
+  EXPECT_LT(getError(), 1e-4f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, DilatedConv2DTest,
+                        ::testing::Combine(/* kernel size */ ::testing::Values(2u, 3u), /* dilation */ ::testing::Values(2u, 3u),
+                                           /* padding */ ::testing::Values(PaddingType::valid, PaddingType::same),
+                                           /* input channels */ ::testing::Values(3u, 8u), /* output channels */ ::testing::Values(5u, 16u),
+                                           /* AVX2 */ ::testing::Bool(), /* x64 */ ::testing::Bool()));
+
+class DilatedDepthwiseConv2DTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, unsigned int, PaddingType, unsigned int, unsigned int>>
+{
+  static const Node& buildNode(DepthwiseConv2DLayer* l, unsigned int kernelSize, unsigned int dilation, unsigned int stride, PaddingType padding, unsigned int channels,
+                               std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->strides = {stride, stride};
+    l->dilation = {dilation, dilation};
+    l->weights.reshape(kernelSize, kernelSize, channels, 1);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(channels);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = ActivationFunctionId::relu;
+    l->padding = padding;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    // Odd sizes, such that the padding of same convolutions with stride 2 is never negative
+    n.inputDimensions.push_back({9, 11, channels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.threads = std::get<5>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      DepthwiseConv2DLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()), std::get<4>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(DilatedDepthwiseConv2DTest, ProducesSimilarOutputAsSimpleNN)
+{
+  EXPECT_LT(getError(), 1e-4f);
+}
+
+// A dilation of 1 is included, because the channel batches of the depthwise convolution are compiled the same way
+INSTANTIATE_TEST_CASE_P(Layers, DilatedDepthwiseConv2DTest,
+                        ::testing::Combine(/* kernel size */ ::testing::Values(2u, 3u), /* dilation */ ::testing::Values(1u, 2u), /* stride */ ::testing::Values(1u, 2u),
+                                           /* padding */ ::testing::Values(PaddingType::valid, PaddingType::same),
+                                           /* channels */ ::testing::Values(1u, 3u, 8u, 20u, 100u), /* threads */ ::testing::Values(1u, 3u)));
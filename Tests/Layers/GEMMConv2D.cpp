@@ -0,0 +1,94 @@
+/**
+ * @file GEMMConv2D.cpp
+ *
+ * This file defines a test for Conv2D layers that are computed as a matrix
+ * product (after an im2col of the input unless the kernel is 1x1 and the
+ * stride is 1).
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class GEMMConv2DTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, PaddingType, unsigned int, unsigned int, bool, bool, unsigned int>>
+{
+  static const Node& buildNode(Conv2DLayer* l, unsigned int kernelSize, unsigned int stride, PaddingType padding, unsigned int inputChannels, unsigned int outputChannels,
+                               std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->strides = {stride, stride};
+    l->weights.reshape(kernelSize, kernelSize, inputChannels, outputChannels);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(outputChannels);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = ActivationFunctionId::relu;
+    l->padding = padding;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    // Odd sizes, such that the padding of same convolutions with stride 2 is never negative
+    n.inputDimensions.push_back({9, 11, inputChannels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<5>(GetParam());
+    settings.useFMA3 = std::get<6>(GetParam());
+    settings.threads = std::get<7>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      Conv2DLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()), std::get<4>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(GEMMConv2DTest, ProducesSimilarOutputAsSimpleNN)
+{
+  EXPECT_LT(getError(), 1e-4f);
+}
+
+// The kernels of 5x5 and of 3x3 with 20 input channels do not fit into the registers of the im2col
+INSTANTIATE_TEST_CASE_P(Layers, GEMMConv2DTest,
+                        ::testing::Combine(/* kernel size */ ::testing::Values(1u, 3u, 5u), /* stride */ ::testing::Values(1u, 2u),
+                                           /* padding */ ::testing::Values(PaddingType::valid, PaddingType::same),
+                                           /* input channels */ ::testing::Values(4u, 20u), /* output channels */ ::testing::Values(5u, 40u),
+                                           /* AVX2 */ ::testing::Bool(), /* FMA3 */ ::testing::Bool(), /* threads */ ::testing::Values(1u, 3u)));
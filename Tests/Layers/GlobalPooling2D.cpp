@@ -0,0 +1,78 @@
+/**
+ * @file GlobalPooling2D.cpp
+ *
+ * This file defines a test for the GlobalMaxPooling2D and GlobalAveragePooling2D layers.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class GlobalPooling2DTest : public ::testing::TestWithParam<std::tuple<PoolingMethod, unsigned int, unsigned int, bool>>
+{
+  static const Node& buildNode(GlobalPooling2DLayer* l, unsigned int imageSize, unsigned int channels)
+  {
+    l->nodes.clear();
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back({imageSize, imageSize + 2, channels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<3>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    GlobalMaxPooling2DLayer maxLayer;
+    GlobalAveragePooling2DLayer averageLayer;
+    GlobalPooling2DLayer* l = std::get<0>(GetParam()) == PoolingMethod::max ? static_cast<GlobalPooling2DLayer*>(&maxLayer) : static_cast<GlobalPooling2DLayer*>(&averageLayer);
+    const Node& n = buildNode(l, std::get<1>(GetParam()), std::get<2>(GetParam()));
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(GlobalPooling2DTest, ProducesSameOutputAsSimpleNN)
+{
+  EXPECT_LT(getError(), 1e-5f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, GlobalPooling2DTest,
+                        ::testing::Combine(/* method */ ::testing::Values(PoolingMethod::max, PoolingMethod::average),
+                                           /* image size */ ::testing::Values(1u, 7u),
+                                           /* channels */ ::testing::Values(1u, 2u, 3u, 8u, 13u, 61u, 130u, 300u, 2048u),
+                                           /* AVX2 */ ::testing::Bool()));
@@ -0,0 +1,83 @@
+/**
+ * @file Pooling2D.cpp
+ *
+ * This file defines a test for the MaxPooling2D and AveragePooling2D layers.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class Pooling2DTest : public ::testing::TestWithParam<std::tuple<PoolingMethod, unsigned int, unsigned int, PaddingType, unsigned int, bool, unsigned int>>
+{
+  static const Node& buildNode(Pooling2DLayer* l, unsigned int kernelSize, unsigned int stride, PaddingType padding, unsigned int channels)
+  {
+    l->nodes.clear();
+    l->kernelSize = {kernelSize, kernelSize};
+    l->strides = {stride, stride};
+    l->padding = padding;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back({9, 11, channels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<5>(GetParam());
+    settings.threads = std::get<6>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    MaxPooling2DLayer maxLayer;
+    AveragePooling2DLayer averageLayer;
+    Pooling2DLayer* l = std::get<0>(GetParam()) == PoolingMethod::max ? static_cast<Pooling2DLayer*>(&maxLayer) : static_cast<Pooling2DLayer*>(&averageLayer);
+    const Node& n = buildNode(l, std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()), std::get<4>(GetParam()));
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(Pooling2DTest, ProducesSameOutputAsSimpleNN)
+{
+  EXPECT_LT(getError(), 1e-5f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, Pooling2DTest,
+                        ::testing::Combine(/* method */ ::testing::Values(PoolingMethod::max, PoolingMethod::average),
+                                           /* kernel size */ ::testing::Values(2u, 3u), /* stride */ ::testing::Values(1u, 2u),
+                                           /* padding */ ::testing::Values(PaddingType::valid, PaddingType::same),
+                                           /* channels */ ::testing::Values(1u, 3u, 8u, 13u, 64u),
+                                           /* AVX2 */ ::testing::Bool(), /* threads */ ::testing::Values(1u, 3u)));
@@ -0,0 +1,134 @@
+/**
+ * @file Quantized.cpp
+ *
+ * This file defines a test for Dense and Conv2D layers that are computed with
+ * quantized weights and inputs.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class QuantizedTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, ActivationFunctionId, bool, bool>>
+{
+  static const Node& buildNode(Layer* l, const std::vector<unsigned int>& inputDimensions)
+  {
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    n.inputDimensions.push_back(inputDimensions);
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  /** The number of products that are summed up for each output. */
+  unsigned int inputsPerOutput() const
+  {
+    return std::get<0>(GetParam()) ? std::get<0>(GetParam()) * std::get<0>(GetParam()) * std::get<2>(GetParam()) : std::get<2>(GetParam());
+  }
+
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.quantize = true;
+    settings.useAVX2 = std::get<5>(GetParam());
+    if(std::get<6>(GetParam()))
+    {
+      // The inputs are uniformly distributed in [-1, 1], so this is the range that a calibration would find
+      std::string filename = std::string("QuantizedTest_") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".txt";
+      std::replace(filename.begin(), filename.end(), '/', '_');
+      std::ofstream(filename) << "quantized\t-1\t1\n";
+      settings.quantizationParameters = filename;
+    }
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+    const unsigned int kernelSize = std::get<0>(GetParam());
+    const unsigned int stride = std::get<1>(GetParam());
+    const unsigned int inputChannels = std::get<2>(GetParam());
+    const unsigned int outputChannels = std::get<3>(GetParam());
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      std::unique_ptr<Layer> l;
+      std::vector<unsigned int> inputDimensions;
+      if(kernelSize)
+      {
+        Conv2DLayer* conv = new Conv2DLayer;
+        l.reset(conv);
+        conv->strides = {stride, stride};
+        conv->weights.reshape(kernelSize, kernelSize, inputChannels, outputChannels);
+        for(float& w : conv->weights)
+          w = dist(generator);
+        conv->biases.resize(outputChannels);
+        for(float& b : conv->biases)
+          b = dist(generator);
+        conv->hasBiases = true;
+        conv->activationId = std::get<4>(GetParam());
+        conv->padding = PaddingType::same;
+        inputDimensions = {7, 7, inputChannels};
+      }
+      else
+      {
+        DenseLayer* dense = new DenseLayer;
+        l.reset(dense);
+        dense->weights.reshape(inputChannels, outputChannels);
+        for(float& w : dense->weights)
+          w = dist(generator);
+        dense->biases.resize(outputChannels);
+        for(float& b : dense->biases)
+          b = dist(generator);
+        dense->hasBiases = true;
+        dense->activationId = std::get<4>(GetParam());
+        inputDimensions = {inputChannels};
+      }
+      l->name = "quantized";
+      const Node& n = buildNode(l.get(), inputDimensions);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = dist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    if(!settings.quantizationParameters.empty())
+      std::remove(settings.quantizationParameters.c_str());
+    return absError;
+  }
+};
+
+TEST_P(QuantizedTest, ProducesSimilarOutputAsSimpleNN)
+{
+  // The rounding errors of the 7 bit inputs and 8 bit weights are independent, so their sum grows with the square root of the number of products
+  EXPECT_LT(getError(), std::sqrt(static_cast<float>(inputsPerOutput())) * 0.05f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, QuantizedTest,
+                        ::testing::Combine(/* kernel size (0 = Dense) */ ::testing::Values(0u, 1u, 3u), /* stride */ ::testing::Values(1u, 2u),
+                                           /* input channels */ ::testing::Values(16u, 36u), /* output channels */ ::testing::Values(5u, 16u, 70u),
+                                           /* activation */ ::testing::Values(ActivationFunctionId::linear, ActivationFunctionId::relu),
+                                           /* AVX2 */ ::testing::Bool(), /* calibrated range */ ::testing::Bool()));
@@ -0,0 +1,94 @@
+/**
+ * @file SameConv2D.cpp
+ *
+ * This file defines a test for Conv2D layers with same padding that are
+ * computed by the direct convolution, which pads the windows at the borders
+ * of the input itself.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class SameConv2DTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, bool, bool, unsigned int>>
+{
+  static const Node& buildNode(Conv2DLayer* l, unsigned int kernelSize, unsigned int stride, unsigned int inputChannels, unsigned int outputChannels,
+                               std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->strides = {stride, stride};
+    l->weights.reshape(kernelSize, kernelSize, inputChannels, outputChannels);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(outputChannels);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = ActivationFunctionId::relu;
+    l->padding = PaddingType::same;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    // Odd sizes, such that the padding of same convolutions with stride 2 is never negative
+    n.inputDimensions.push_back({9, 11, inputChannels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useWinograd = false;
+    settings.useAVX2 = std::get<4>(GetParam());
+    settings.useX64 = std::get<5>(GetParam());
+    settings.threads = std::get<6>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      Conv2DLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(SameConv2DTest, ProducesSimilarOutputAsSimpleNN)
+{
+  EXPECT_LT(getError(), 1e-4f);
+}
+
+// The kernel size 2 pads only after the input, 5 has windows that lie outside of the input by two filter rows and columns
+INSTANTIATE_TEST_CASE_P(Layers, SameConv2DTest,
+                        ::testing::Combine(/* kernel size */ ::testing::Values(2u, 3u, 5u), /* stride */ ::testing::Values(1u, 2u),
+                                           /* input channels */ ::testing::Values(3u, 8u), /* output channels */ ::testing::Values(5u, 16u),
+                                           /* AVX2 */ ::testing::Bool(), /* x64 */ ::testing::Bool(), /* threads */ ::testing::Values(1u, 3u)));
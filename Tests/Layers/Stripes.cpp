@@ -0,0 +1,90 @@
+/**
+ * @file Stripes.cpp
+ *
+ * This file defines a test for chains of layers that are executed in horizontal stripes.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class StripesTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, bool, bool>>
+{
+public:
+  /**
+   * Writes a chain of convolution, depthwise convolution, batch normalization, activation and pooling layers to a file.
+   * @param filename The name of the file.
+   * @param height The number of rows of the input.
+   */
+  static void writeModel(const std::string& filename, const unsigned int height)
+  {
+    KerasModel model;
+    model.addInput("input", {height, 29, 8});
+    model.addConv2D("conv1", "input", 16, 3, 1, "same", "relu");
+    model.addDepthwiseConv2D("depthwise", "conv1", 3, 1, "same", "linear");
+    model.addBatchNormalization("bn1", "depthwise");
+    model.addActivation("relu1", "bn1", "relu");
+    model.addPooling2D("pool1", "relu1", "MaxPooling2D", 2, 2, "valid");
+    model.addConv2D("conv2", "pool1", 24, 3, 1, "valid", "linear");
+    model.addBatchNormalization("bn2", "conv2");
+    model.addActivation("relu2", "bn2", "relu");
+    model.addPooling2D("pool2", "relu2", "AveragePooling2D", 2, 1, "valid");
+    model.write(filename, {"pool2"});
+  }
+
+  /**
+   * Returns the maximum difference between the outputs of the net compiled with and without stripes relative to the largest output.
+   */
+  float getError() const
+  {
+    const std::string filename = KerasModel::temporaryFilename(".h5");
+    writeModel(filename, std::get<0>(GetParam()));
+
+    CompilationSettings settings;
+    settings.useX64 = std::get<2>(GetParam());
+    settings.useAVX2 = std::get<3>(GetParam());
+    CompiledNN layers;
+    layers.compile(filename, settings);
+    settings.stripeCacheSize = std::get<1>(GetParam());
+    CompiledNN stripes;
+    stripes.compile(filename, settings);
+    std::remove(filename.c_str());
+
+    // Executing the layers in stripes must not need more memory
+    EXPECT_LE(stripes.tensorMemory(), layers.tensorMemory());
+
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float maxError = 0.f;
+    for(unsigned int i = 0; i < 3; ++i)
+    {
+      for(auto p = layers.input(0).begin(); p < layers.input(0).end(); p++)
+        *p = inputDist(generator);
+      stripes.input(0).copyFrom(layers.input(0));
+      layers.apply();
+      stripes.apply();
+
+      float maxOutput = 1.f;
+      for(const float output : layers.output(0))
+        maxOutput = std::max(maxOutput, std::abs(output));
+      maxError = std::max(maxError, layers.output(0).maxAbsError(stripes.output(0)) / maxOutput);
+    }
+    return maxError;
+  }
+};
+
+TEST_P(StripesTest, ProducesSameOutputAsLayerByLayer)
+{
+  // The tiles of Winograd convolutions begin at the first row of each stripe, so the results may differ slightly
+  EXPECT_LT(getError(), 1e-5f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, StripesTest,
+                        ::testing::Combine(/* input height */ ::testing::Values(48u, 37u), /* stripe cache size */ ::testing::Values(8192u, 16384u, 65536u),
+                                           /* x64 */ ::testing::Bool(), /* AVX2 */ ::testing::Bool()));
@@ -0,0 +1,93 @@
+/**
+ * @file WinogradConv2D.cpp
+ *
+ * This file defines a test for Conv2D layers that are computed with the
+ * Winograd algorithm (3x3 kernels, stride 1 and enough channels).
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/SimpleNN.h"
+#include "CompiledNN/Model.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class WinogradConv2DTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int, unsigned int, ActivationFunctionId, bool, bool, unsigned int>>
+{
+  static const Node& buildNode(Conv2DLayer* l, unsigned int inputSize, unsigned int inputChannels, unsigned int outputChannels,
+                               ActivationFunctionId activation, std::mt19937& generator)
+  {
+    std::uniform_real_distribution<float> weightDist(-1.f, 1.f);
+
+    l->nodes.clear();
+    l->strides = {1, 1};
+    l->weights.reshape(3, 3, inputChannels, outputChannels);
+    for(float& w : l->weights)
+      w = weightDist(generator);
+    l->biases.resize(outputChannels);
+    for(float& b : l->biases)
+      b = weightDist(generator);
+    l->hasBiases = true;
+    l->activationId = activation;
+    l->padding = PaddingType::valid;
+
+    l->nodes.emplace_back(l);
+    Node& n = l->nodes.back();
+    n.inputs.emplace_back(nullptr, 0, 0);
+    // The width differs from the height, such that the output has both an odd and an even number of rows and columns
+    n.inputDimensions.push_back({inputSize, inputSize + 1, inputChannels});
+    l->calcOutputDimensions(n);
+    for(std::size_t i = 0; i < n.outputDimensions.size(); ++i)
+      n.outputs.emplace_back(l, 0, i);
+    return n;
+  }
+
+  mutable std::mt19937 generator;
+
+public:
+  float getError() const
+  {
+    CompiledNN c;
+    CompilationSettings settings;
+    settings.useAVX2 = std::get<4>(GetParam());
+    settings.useFMA3 = std::get<5>(GetParam());
+    settings.threads = std::get<6>(GetParam());
+
+    std::vector<TensorXf> testOutputTensors(1);
+
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float absError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      Conv2DLayer l;
+      const Node& n = buildNode(&l, std::get<0>(GetParam()), std::get<1>(GetParam()), std::get<2>(GetParam()), std::get<3>(GetParam()), generator);
+      c.compile(n, settings);
+
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+
+      SimpleNN::apply({TensorXf(c.input(0))}, testOutputTensors, n);
+      c.apply();
+
+      const float err = testOutputTensors[0].maxAbsError(c.output(0));
+      if(err > absError)
+        absError = err;
+    }
+    return absError;
+  }
+};
+
+TEST_P(WinogradConv2DTest, ProducesSimilarOutputAsSimpleNN)
+{
+  // The transformations add rounding errors to each of the 9 * inputChannels products that are summed up
+  EXPECT_LT(getError(), std::get<1>(GetParam()) * 1e-5f);
+}
+
+INSTANTIATE_TEST_CASE_P(Layers, WinogradConv2DTest,
+                        ::testing::Combine(/* input size */ ::testing::Values(4u, 7u, 10u), /* input channels */ ::testing::Values(16u, 24u, 48u),
+                                           /* output channels */ ::testing::Values(16u, 40u, 136u),
+                                           /* activation */ ::testing::Values(ActivationFunctionId::linear, ActivationFunctionId::relu),
+                                           /* AVX2 */ ::testing::Bool(), /* FMA3 */ ::testing::Bool(), /* threads */ ::testing::Values(1u, 3u)));
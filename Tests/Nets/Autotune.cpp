@@ -0,0 +1,122 @@
+/**
+ * @file Autotune.cpp
+ *
+ * This file defines a test for nets whose code variants are chosen by benchmarks and stored in a tuning database.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "CompiledNN/Model.h"
+#include "CompiledNN/SimpleNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class AutotuneTest : public ::testing::TestWithParam<std::tuple<bool, bool>>
+{
+public:
+  /**
+   * Returns the inode of a file, which changes when the file is replaced.
+   */
+  static ino_t inode(const std::string& filename)
+  {
+    struct stat status;
+    return stat(filename.c_str(), &status) ? 0 : status.st_ino;
+  }
+
+  /**
+   * Returns the maximum difference between the outputs of a compiled net and SimpleNN relative to the largest output.
+   */
+  static float getError(CompiledNN& c, const Model& model)
+  {
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+    std::vector<TensorXf> testInputTensors(1), testOutputTensors(1);
+
+    float maxError = 0.f;
+    for(unsigned int i = 0; i < 3; ++i)
+    {
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+      testInputTensors[0] = TensorXf(c.input(0));
+      SimpleNN::apply(testInputTensors, testOutputTensors, model);
+      c.apply();
+
+      float maxOutput = 1.f;
+      for(const float output : testOutputTensors[0])
+        maxOutput = std::max(maxOutput, std::abs(output));
+      maxError = std::max(maxError, testOutputTensors[0].maxAbsError(c.output(0)) / maxOutput);
+    }
+    return maxError;
+  }
+
+  void run() const
+  {
+    const std::string modelFilename = KerasModel::temporaryFilename(".h5");
+    const std::string databaseFilename = KerasModel::temporaryFilename(".txt");
+    KerasModel kerasModel;
+    kerasModel.addInput("input", {18, 16, 8});
+    kerasModel.addConv2D("conv1", "input", 16, 3, 1, "valid", "relu");
+    kerasModel.addConv2D("conv2", "conv1", 24, 3, 2, "valid", "relu");
+    kerasModel.addFlatten("flatten", "conv2");
+    kerasModel.addDense("dense", "flatten", 40, "linear");
+    kerasModel.write(modelFilename, {"dense"});
+    const Model model(modelFilename);
+    std::remove(databaseFilename.c_str());
+
+    CompilationSettings settings;
+    settings.useX64 = std::get<0>(GetParam());
+    settings.useAVX2 = std::get<1>(GetParam());
+    settings.autotune = true;
+    settings.tuningDatabase = databaseFilename;
+    CompiledNN c;
+    c.compile(model, settings);
+    EXPECT_LT(getError(c, model), 1e-4f);
+
+    // The database contains the chosen variant of each tuned operation
+    std::ifstream stream(databaseFilename);
+    std::string line;
+    std::vector<std::string> lines;
+    while(std::getline(stream, line))
+      lines.push_back(line);
+    stream.close();
+    ASSERT_FALSE(lines.empty());
+
+    // Tuned operations have at least two variants, so that they can be switched to another one, which a compilation must use without benchmarking again
+    std::ostringstream changed;
+    for(const std::string& entry : lines)
+    {
+      const std::size_t variantBegin = entry.rfind('\t') + 1;
+      changed << entry.substr(0, variantBegin) << (entry.substr(variantBegin) == "0" ? "1" : "0") << '\n';
+    }
+    std::ofstream(databaseFilename) << changed.str();
+    const ino_t databaseInode = inode(databaseFilename);
+
+    CompiledNN reused;
+    reused.compile(model, settings);
+    EXPECT_LT(getError(reused, model), 1e-4f);
+    EXPECT_EQ(inode(databaseFilename), databaseInode);
+    std::ifstream reread(databaseFilename);
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(reread), std::istreambuf_iterator<char>()), changed.str());
+
+    std::remove(modelFilename.c_str());
+    std::remove(databaseFilename.c_str());
+  }
+};
+
+TEST_P(AutotuneTest, ProducesSameOutputAsSimpleNN)
+{
+  run();
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, AutotuneTest,
+                        ::testing::Combine(/* x64 */ ::testing::Bool(), /* AVX2 */ ::testing::Bool()));
@@ -0,0 +1,80 @@
+/**
+ * @file Batch.cpp
+ *
+ * This file defines a test for nets that process batches of several samples.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class BatchTest : public ::testing::TestWithParam<std::tuple<unsigned int, bool, bool>>
+{
+public:
+  /**
+   * Returns the maximum difference between the outputs of each sample of a batch and the outputs of a net that processes single samples.
+   */
+  float getError() const
+  {
+    const unsigned int batchSize = std::get<0>(GetParam());
+    const std::string filename = KerasModel::temporaryFilename(".h5");
+    KerasModel model;
+    model.addInput("input", {10, 9, 3});
+    model.addConv2D("conv", "input", 8, 3, 1, "valid", "relu");
+    model.addPooling2D("pool", "conv", "AveragePooling2D", 2, 2, "valid");
+    model.addFlatten("flatten", "pool");
+    model.addDense("dense1", "flatten", 20, "relu");
+    model.addDense("dense2", "dense1", 6, "linear");
+    model.write(filename, {"dense2"});
+
+    CompilationSettings settings;
+    settings.useX64 = std::get<1>(GetParam());
+    settings.useAVX2 = std::get<2>(GetParam());
+    CompiledNN single;
+    single.compile(filename, settings);
+    settings.batchSize = batchSize;
+    CompiledNN batch;
+    batch.compile(filename, settings);
+    std::remove(filename.c_str());
+    EXPECT_EQ(batch.batchSize(), batchSize);
+    EXPECT_EQ(batch.input(0).size(), batchSize * single.input(0).size());
+    EXPECT_EQ(batch.output(0).size(), batchSize * single.output(0).size());
+
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float maxError = 0.f;
+    for(unsigned int i = 0; i < 3; ++i)
+    {
+      for(auto p = batch.input(0).begin(); p < batch.input(0).end(); p++)
+        *p = inputDist(generator);
+      batch.apply();
+
+      for(unsigned int sample = 0; sample < batchSize; ++sample)
+      {
+        const std::size_t inputSize = single.input(0).size();
+        const std::size_t outputSize = single.output(0).size();
+        std::copy_n(batch.input(0).begin() + sample * inputSize, inputSize, single.input(0).begin());
+        single.apply();
+        for(std::size_t j = 0; j < outputSize; ++j)
+          maxError = std::max(maxError, std::abs(single.output(0)[j] - batch.output(0)[sample * outputSize + j]));
+      }
+    }
+    return maxError;
+  }
+};
+
+TEST_P(BatchTest, ProducesSameOutputAsSingleSamples)
+{
+  EXPECT_LT(getError(), 1e-5f);
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, BatchTest,
+                        ::testing::Combine(/* batch size */ ::testing::Values(2u, 3u), /* x64 */ ::testing::Bool(), /* AVX2 */ ::testing::Bool()));
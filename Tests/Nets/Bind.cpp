@@ -0,0 +1,83 @@
+/**
+ * @file Bind.cpp
+ *
+ * This file defines a test for nets whose inputs and outputs are bound to user memory.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace NeuralNetwork;
+
+class BindTest : public ::testing::TestWithParam<std::tuple<bool, bool>>
+{
+public:
+  void run() const
+  {
+    const std::string filename = KerasModel::temporaryFilename(".h5");
+    KerasModel model;
+    model.addInput("input", {11, 13, 3});
+    model.addConv2D("conv", "input", 8, 3, 2, "valid", "relu");
+    model.addBatchNormalization("bn", "conv");
+    model.addFlatten("flatten", "bn");
+    model.addDense("dense", "flatten", 7, "linear");
+    model.write(filename, {"dense"});
+
+    CompilationSettings settings;
+    settings.useX64 = std::get<0>(GetParam());
+    settings.reentrant = std::get<1>(GetParam());
+    CompiledNN reference;
+    reference.compile(filename, settings);
+    settings.bindIO = true;
+    CompiledNN c;
+    c.compile(filename, settings);
+    std::remove(filename.c_str());
+
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+    const std::size_t inputSize = reference.input(0).size();
+    const std::size_t outputSize = reference.output(0).size();
+    const float unwritten = 12345.f;
+
+    // The buffers need room for three floats more than the tensors have elements
+    std::vector<float> input(inputSize + 3), output(outputSize + 3, unwritten);
+    for(std::size_t i = 0; i < inputSize; ++i)
+      input[i] = inputDist(generator);
+    std::copy_n(input.data(), inputSize, reference.input(0).begin());
+    reference.apply();
+
+    // A bound net reads from and writes to the buffers instead of its own tensors
+    std::fill(c.input(0).begin(), c.input(0).end(), 0.f);
+    c.bindInput(0, input.data());
+    c.bindOutput(0, output.data());
+    c.apply();
+    for(std::size_t i = 0; i < outputSize; ++i)
+      EXPECT_EQ(output[i], reference.output(0)[i]);
+
+    // After unbinding, the net uses its own tensors again and leaves the buffers alone
+    c.bindInput(0, nullptr);
+    c.bindOutput(0, nullptr);
+    std::fill(output.begin(), output.end(), unwritten);
+    for(auto p = reference.input(0).begin(); p < reference.input(0).end(); p++)
+      *p = inputDist(generator);
+    c.input(0).copyFrom(reference.input(0));
+    reference.apply();
+    c.apply();
+    EXPECT_EQ(c.output(0).maxAbsError(reference.output(0)), 0.f);
+    EXPECT_TRUE(std::all_of(output.begin(), output.end(), [unwritten](const float value) { return value == unwritten; }));
+  }
+};
+
+TEST_P(BindTest, ReadsAndWritesBoundBuffers)
+{
+  run();
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, BindTest,
+                        ::testing::Combine(/* x64 */ ::testing::Bool(), /* reentrant */ ::testing::Bool()));
@@ -0,0 +1,79 @@
+/**
+ * @file Branches.cpp
+ *
+ * This file defines a test for nets whose independent branches are executed by several threads.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class BranchesTest : public ::testing::TestWithParam<std::tuple<std::string, unsigned int, bool>>
+{
+public:
+  /**
+   * Returns the maximum difference between the outputs of the net compiled for several threads and for a single thread relative to the largest output.
+   */
+  float getError() const
+  {
+    const std::string filename = KerasModel::temporaryFilename(".h5");
+    KerasModel model;
+    model.addInput("input", {20, 18, 4});
+    model.addConv2D("stem", "input", 16, 3, 1, "same", "relu");
+    model.addConv2D("a1", "stem", 8, 1, 1, "same", "relu");
+    model.addConv2D("a2", "a1", 16, 3, 1, "same", "relu");
+    model.addDepthwiseConv2D("b1", "stem", 3, 1, "same", "relu");
+    model.addConv2D("b2", "b1", 16, 1, 1, "same", "linear");
+    model.addPooling2D("c", "stem", "MaxPooling2D", 3, 1, "same");
+    model.addMerge("merge", {"a2", "b2", "c"}, std::get<0>(GetParam()));
+    model.addConv2D("head", "merge", 8, 3, 2, "valid", "relu");
+    model.write(filename, {"head", "b2"});
+
+    CompilationSettings settings;
+    settings.useX64 = std::get<2>(GetParam());
+    CompiledNN single;
+    single.compile(filename, settings);
+    settings.threads = std::get<1>(GetParam());
+    CompiledNN multi;
+    multi.compile(filename, settings);
+    std::remove(filename.c_str());
+
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+
+    float maxError = 0.f;
+    for(unsigned int i = 0; i < 5; ++i)
+    {
+      for(auto p = single.input(0).begin(); p < single.input(0).end(); p++)
+        *p = inputDist(generator);
+      multi.input(0).copyFrom(single.input(0));
+      single.apply();
+      multi.apply();
+
+      for(std::size_t j = 0; j < single.numOfOutputs(); ++j)
+      {
+        float maxOutput = 1.f;
+        for(const float output : single.output(j))
+          maxOutput = std::max(maxOutput, std::abs(output));
+        maxError = std::max(maxError, single.output(j).maxAbsError(multi.output(j)) / maxOutput);
+      }
+    }
+    return maxError;
+  }
+};
+
+TEST_P(BranchesTest, ProducesSameOutputAsSingleThread)
+{
+  EXPECT_LT(getError(), 1e-5f);
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, BranchesTest,
+                        ::testing::Combine(/* merge */ ::testing::Values(std::string("Concatenate"), std::string("Add")),
+                                           /* threads */ ::testing::Values(2u, 3u), /* x64 */ ::testing::Bool()));
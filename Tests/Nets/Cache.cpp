@@ -0,0 +1,148 @@
+/**
+ * @file Cache.cpp
+ *
+ * This file defines a test for nets whose generated code is cached in a file.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+using namespace NeuralNetwork;
+
+/** The ways in which a cache file is changed before it is loaded again. */
+enum class CacheDamage
+{
+  none,
+  key,
+  truncated,
+  corrupted,
+};
+
+class CacheTest : public ::testing::TestWithParam<CacheDamage>
+{
+public:
+  /**
+   * Returns the contents of a file.
+   */
+  static std::string readFile(const std::string& filename)
+  {
+    std::ifstream stream(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  }
+
+  /**
+   * Replaces the contents of a file.
+   */
+  static void writeFile(const std::string& filename, const std::string& contents)
+  {
+    std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+    stream.write(contents.data(), contents.size());
+  }
+
+  /**
+   * Returns the inode of a file, which changes when the file is replaced.
+   */
+  static ino_t inode(const std::string& filename)
+  {
+    struct stat status;
+    return stat(filename.c_str(), &status) ? 0 : status.st_ino;
+  }
+
+  void run() const
+  {
+    const std::string modelFilename = KerasModel::temporaryFilename(".h5");
+    const std::string cacheFilename = KerasModel::temporaryFilename(".cnn");
+    KerasModel model;
+    model.addInput("input", {12, 10, 3});
+    model.addConv2D("conv", "input", 8, 3, 1, "valid", "relu");
+    model.addPooling2D("pool", "conv", "MaxPooling2D", 2, 2, "valid");
+    model.addFlatten("flatten", "pool");
+    model.addDense("dense", "flatten", 5, "sigmoid");
+    model.write(modelFilename, {"dense"});
+    std::remove(cacheFilename.c_str());
+
+    // Nets that are cached are always reentrant
+    CompilationSettings settings;
+    CompiledNN reference;
+    settings.reentrant = true;
+    reference.compile(modelFilename, settings);
+    settings.reentrant = false;
+
+    CompiledNN first;
+    first.compile(modelFilename, cacheFilename, settings);
+    ASSERT_TRUE(first.valid());
+    ASSERT_TRUE(first.reentrant());
+    const std::string contents = readFile(cacheFilename);
+    ASSERT_FALSE(contents.empty());
+
+    switch(GetParam())
+    {
+      case CacheDamage::none:
+        break;
+      case CacheDamage::key:
+      {
+        // The key is stored at the beginning of the file
+        std::string changed(contents);
+        changed[0] ^= 1;
+        writeFile(cacheFilename, changed);
+        break;
+      }
+      case CacheDamage::truncated:
+        writeFile(cacheFilename, contents.substr(0, contents.size() / 2));
+        break;
+      case CacheDamage::corrupted:
+      {
+        // Change some bytes of the generated code at the end of the file
+        std::string changed(contents);
+        for(std::size_t i = changed.size() - 64; i < changed.size(); i += 8)
+          changed[i] = static_cast<char>(0xcc);
+        writeFile(cacheFilename, changed);
+        break;
+      }
+    }
+    const ino_t cacheInode = inode(cacheFilename);
+
+    // A valid cache file is used as it is, while any other file is replaced by a new one after compiling the net again
+    CompiledNN second;
+    second.compile(modelFilename, cacheFilename, settings);
+    ASSERT_TRUE(second.valid());
+    if(GetParam() == CacheDamage::none)
+      EXPECT_EQ(inode(cacheFilename), cacheInode);
+    else
+      EXPECT_NE(inode(cacheFilename), cacheInode);
+    EXPECT_EQ(readFile(cacheFilename), contents);
+    EXPECT_EQ(second.workspaceSize(), reference.workspaceSize());
+
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+    for(unsigned int i = 0; i < 3; ++i)
+    {
+      for(auto p = reference.input(0).begin(); p < reference.input(0).end(); p++)
+        *p = inputDist(generator);
+      first.input(0).copyFrom(reference.input(0));
+      second.input(0).copyFrom(reference.input(0));
+      reference.apply();
+      first.apply();
+      second.apply();
+      EXPECT_EQ(first.output(0).maxAbsError(reference.output(0)), 0.f);
+      EXPECT_EQ(second.output(0).maxAbsError(reference.output(0)), 0.f);
+    }
+
+    std::remove(modelFilename.c_str());
+    std::remove(cacheFilename.c_str());
+  }
+};
+
+TEST_P(CacheTest, ProducesSameOutputAsCompiledNet)
+{
+  run();
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, CacheTest,
+                        ::testing::Values(CacheDamage::none, CacheDamage::key, CacheDamage::truncated, CacheDamage::corrupted));
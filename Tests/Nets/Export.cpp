@@ -0,0 +1,161 @@
+/**
+ * @file Export.cpp
+ *
+ * This file defines a test for nets that are exported to ELF objects.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <elf.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace NeuralNetwork;
+
+class ExportTest : public ::testing::TestWithParam<bool>
+{
+public:
+  /**
+   * Returns the contents of a file.
+   */
+  static std::string readFile(const std::string& filename)
+  {
+    std::ifstream stream(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  }
+
+  /**
+   * Returns the value of a macro that the header defines as an unsigned integer (or -1 if the header does not define it).
+   */
+  static long long macroValue(const std::string& header, const std::string& macro)
+  {
+    const std::string definition = "#define " + macro + " ";
+    const std::size_t pos = header.find(definition);
+    return pos == std::string::npos ? -1 : std::stoll(header.substr(pos + definition.size()));
+  }
+
+  void run() const
+  {
+    const std::string modelFilename = KerasModel::temporaryFilename(".h5");
+    const std::string objectFilename = KerasModel::temporaryFilename(".o");
+    const std::string headerFilename = KerasModel::temporaryFilename(".h");
+    KerasModel model;
+    model.addInput("input", {12, 10, 3});
+    model.addConv2D("conv", "input", 8, 3, 1, "valid", "relu");
+    model.addBatchNormalization("bn", "conv");
+    model.addFlatten("flatten", "bn");
+    model.addDense("dense", "flatten", 4, "sigmoid");
+    model.write(modelFilename, {"dense"});
+
+    // Only reentrant nets can be exported
+    CompilationSettings settings;
+    settings.bindIO = GetParam();
+    CompiledNN c;
+    c.compile(modelFilename, settings);
+    EXPECT_FALSE(c.exportObject(objectFilename, headerFilename, "testnet"));
+    settings.reentrant = true;
+    c.compile(modelFilename, settings);
+    std::remove(modelFilename.c_str());
+    ASSERT_TRUE(c.exportObject(objectFilename, headerFilename, "testnet"));
+    const std::string object = readFile(objectFilename);
+    const std::string header = readFile(headerFilename);
+    std::remove(objectFilename.c_str());
+    std::remove(headerFilename.c_str());
+
+    // The header describes the workspace and the tensors of the net
+    EXPECT_EQ(macroValue(header, "TESTNET_WORKSPACE_SIZE"), static_cast<long long>(c.workspaceSize()));
+    EXPECT_EQ(macroValue(header, "TESTNET_BATCH_SIZE"), 1);
+    EXPECT_EQ(macroValue(header, "TESTNET_NUM_INPUTS"), 1);
+    EXPECT_EQ(macroValue(header, "TESTNET_NUM_OUTPUTS"), 1);
+    EXPECT_NE(header.find("void testnet_run(void* workspace);"), std::string::npos);
+    EXPECT_NE(header.find("static inline void testnet_apply(const float* const* inputs, float* const* outputs, void* workspace)"), std::string::npos);
+
+    // The object is a relocatable ELF file for x86-64
+    ASSERT_GE(object.size(), sizeof(Elf64_Ehdr));
+    Elf64_Ehdr elfHeader;
+    std::memcpy(&elfHeader, object.data(), sizeof(elfHeader));
+    ASSERT_EQ(std::memcmp(elfHeader.e_ident, ELFMAG, SELFMAG), 0);
+    EXPECT_EQ(elfHeader.e_ident[EI_CLASS], ELFCLASS64);
+    EXPECT_EQ(elfHeader.e_type, ET_REL);
+    EXPECT_EQ(elfHeader.e_machine, EM_X86_64);
+    ASSERT_EQ(elfHeader.e_shentsize, sizeof(Elf64_Shdr));
+    ASSERT_LE(elfHeader.e_shoff + elfHeader.e_shnum * sizeof(Elf64_Shdr), object.size());
+    std::vector<Elf64_Shdr> sections(elfHeader.e_shnum);
+    std::memcpy(sections.data(), object.data() + elfHeader.e_shoff, sections.size() * sizeof(Elf64_Shdr));
+    ASSERT_LT(elfHeader.e_shstrndx, sections.size());
+    auto sectionName = [&](const Elf64_Shdr& section)
+    {
+      return std::string(object.data() + sections[elfHeader.e_shstrndx].sh_offset + section.sh_name);
+    };
+    auto findSection = [&](const std::string& name) -> const Elf64_Shdr*
+    {
+      for(const Elf64_Shdr& section : sections)
+        if(sectionName(section) == name)
+          return &section;
+      return nullptr;
+    };
+    const Elf64_Shdr* text = findSection(".text");
+    const Elf64_Shdr* rodata = findSection(".rodata");
+    const Elf64_Shdr* rela = findSection(".rela.text");
+    const Elf64_Shdr* symtab = findSection(".symtab");
+    ASSERT_TRUE(text && rodata && rela && symtab);
+    ASSERT_LT(symtab->sh_link, sections.size());
+    const char* strtab = object.data() + sections[symtab->sh_link].sh_offset;
+
+    // The run function is a global symbol and each layer has a local function symbol
+    std::vector<Elf64_Sym> symbols(symtab->sh_size / sizeof(Elf64_Sym));
+    std::memcpy(symbols.data(), object.data() + symtab->sh_offset, symbols.size() * sizeof(Elf64_Sym));
+    const Elf64_Half textIndex = static_cast<Elf64_Half>(text - sections.data());
+    const Elf64_Half rodataIndex = static_cast<Elf64_Half>(rodata - sections.data());
+    bool hasRun = false;
+    std::size_t layerFunctions = 0;
+    for(const Elf64_Sym& symbol : symbols)
+    {
+      const std::string name = strtab + symbol.st_name;
+      if(name == "testnet_run")
+      {
+        hasRun = true;
+        EXPECT_EQ(ELF64_ST_BIND(symbol.st_info), STB_GLOBAL);
+        EXPECT_EQ(ELF64_ST_TYPE(symbol.st_info), STT_FUNC);
+        EXPECT_EQ(symbol.st_shndx, textIndex);
+        EXPECT_EQ(symbol.st_value, 0u);
+      }
+      else if(name.compare(0, 8, "testnet:") == 0)
+      {
+        ++layerFunctions;
+        EXPECT_EQ(ELF64_ST_BIND(symbol.st_info), STB_LOCAL);
+        EXPECT_EQ(ELF64_ST_TYPE(symbol.st_info), STT_FUNC);
+        EXPECT_LE(symbol.st_value + symbol.st_size, text->sh_size);
+      }
+    }
+    EXPECT_TRUE(hasRun);
+    EXPECT_GT(layerFunctions, 0u);
+
+    // The code refers to the constants of the net through PC-relative relocations against the read-only data
+    std::vector<Elf64_Rela> relocations(rela->sh_size / sizeof(Elf64_Rela));
+    std::memcpy(relocations.data(), object.data() + rela->sh_offset, relocations.size() * sizeof(Elf64_Rela));
+    EXPECT_FALSE(relocations.empty());
+    for(const Elf64_Rela& relocation : relocations)
+    {
+      EXPECT_EQ(ELF64_R_TYPE(relocation.r_info), static_cast<unsigned int>(R_X86_64_PC32));
+      ASSERT_LT(ELF64_R_SYM(relocation.r_info), symbols.size());
+      EXPECT_EQ(symbols[ELF64_R_SYM(relocation.r_info)].st_shndx, rodataIndex);
+      EXPECT_LE(relocation.r_offset + 4, text->sh_size);
+    }
+  }
+};
+
+TEST_P(ExportTest, WritesObjectAndHeader)
+{
+  if(sizeof(void*) != 8)
+    GTEST_SKIP() << "Only nets that are compiled on a 64 bit host can be exported.";
+  run();
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, ExportTest, /* bind inputs and outputs */ ::testing::Bool());
@@ -0,0 +1,173 @@
+/**
+ * @file JitRegistry.cpp
+ *
+ * This file defines a test for nets whose code is made known to perf and GDB.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+  // The JIT interface of GDB as declared by CompiledNN/Util/JitRegistry.cpp
+  struct jit_code_entry
+  {
+    jit_code_entry* next_entry;
+    jit_code_entry* prev_entry;
+    const char* symfile_addr;
+    std::uint64_t symfile_size;
+  };
+
+  struct jit_descriptor
+  {
+    std::uint32_t version;
+    std::uint32_t action_flag;
+    jit_code_entry* relevant_entry;
+    jit_code_entry* first_entry;
+  };
+
+  extern jit_descriptor __jit_debug_descriptor;
+}
+
+using namespace NeuralNetwork;
+
+class JitRegistryTest : public ::testing::TestWithParam<bool>
+{
+public:
+  /**
+   * Writes a model with a merged batch normalization and returns its filename.
+   */
+  static std::string writeModel()
+  {
+    const std::string filename = KerasModel::temporaryFilename(".h5");
+    KerasModel model;
+    model.addInput("input", {12, 10, 3});
+    model.addConv2D("conv", "input", 8, 3, 1, "valid", "linear");
+    model.addBatchNormalization("bn", "conv");
+    model.addPooling2D("pool", "bn", "MaxPooling2D", 2, 2, "valid");
+    model.addFlatten("flatten", "pool");
+    model.addDense("dense", "flatten", 5, "relu");
+    model.write(filename, {"dense"});
+    return filename;
+  }
+
+  /**
+   * Returns the lines that have been appended to the perf map of the process since it had the given size.
+   */
+  static std::vector<std::string> perfMapLines(const std::string& filename, const std::streamoff previousSize)
+  {
+    std::ifstream stream(filename);
+    stream.seekg(previousSize);
+    std::vector<std::string> lines;
+    std::string line;
+    while(std::getline(stream, line))
+      lines.push_back(line);
+    return lines;
+  }
+};
+
+TEST_P(JitRegistryTest, AppendsFunctionsToPerfMap)
+{
+  const std::string perfMapFilename = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+  std::streamoff previousSize = 0;
+  {
+    std::ifstream stream(perfMapFilename, std::ios::ate);
+    if(stream)
+      previousSize = stream.tellg();
+  }
+
+  // The profile lists the layers of all operations
+  const std::string filename = writeModel();
+  CompilationSettings settings;
+  settings.useX64 = GetParam();
+  settings.profile = true;
+  settings.perfMap = true;
+  CompiledNN c;
+  c.compile(filename, settings);
+  std::remove(filename.c_str());
+  std::vector<std::string> operations;
+  for(const CompiledNN::OperationProfile& op : c.profile())
+    operations.push_back("CompiledNN:" + op.layer);
+  ASSERT_FALSE(operations.empty());
+
+  // Each function is described by a line "<address> <size> <name>", and the functions cover the code without gaps
+  const std::vector<std::string> lines = perfMapLines(perfMapFilename, previousSize);
+  ASSERT_GE(lines.size(), operations.size());
+  std::vector<std::string> functions;
+  unsigned long long end = 0;
+  for(const std::string& line : lines)
+  {
+    std::istringstream stream(line);
+    unsigned long long address = 0, size = 0;
+    std::string name;
+    stream >> std::hex >> address >> size >> name;
+    ASSERT_FALSE(stream.fail()) << line;
+    EXPECT_GT(size, 0u) << line;
+    if(end)
+      EXPECT_EQ(address, end) << line;
+    end = address + size;
+    EXPECT_TRUE(name == "CompiledNN" || name.compare(0, 11, "CompiledNN:") == 0) << line;
+    if(name != "CompiledNN")
+      functions.push_back(name);
+  }
+
+  // Each operation has exactly one function
+  EXPECT_EQ(functions, operations);
+  EXPECT_EQ(functions.front().compare(0, 18, "CompiledNN:conv+bn"), 0) << functions.front();
+  EXPECT_EQ(functions.back(), "CompiledNN:dense");
+
+  if(previousSize == 0)
+    std::remove(perfMapFilename.c_str());
+}
+
+TEST_P(JitRegistryTest, RegistersCodeWithGDB)
+{
+  if(sizeof(void*) != 8)
+    GTEST_SKIP() << "Code is only registered with GDB on x86-64 hosts.";
+
+  const std::string filename = writeModel();
+  CompilationSettings settings;
+  settings.useX64 = GetParam();
+  ASSERT_EQ(__jit_debug_descriptor.first_entry, nullptr);
+  {
+    // The registered symbol file is an ELF file
+    settings.gdbJIT = true;
+    CompiledNN c;
+    c.compile(filename, settings);
+    ASSERT_NE(__jit_debug_descriptor.first_entry, nullptr);
+    EXPECT_EQ(__jit_debug_descriptor.relevant_entry, __jit_debug_descriptor.first_entry);
+    EXPECT_EQ(__jit_debug_descriptor.action_flag, 1u);
+    const jit_code_entry& entry = *__jit_debug_descriptor.first_entry;
+    EXPECT_EQ(entry.prev_entry, nullptr);
+    EXPECT_EQ(entry.next_entry, nullptr);
+    ASSERT_GE(entry.symfile_size, 4u);
+    EXPECT_EQ(std::memcmp(entry.symfile_addr, "\177ELF", 4), 0);
+
+    // Compiling the net again releases the previous code
+    settings.gdbJIT = false;
+    c.compile(filename, settings);
+    EXPECT_EQ(__jit_debug_descriptor.first_entry, nullptr);
+    EXPECT_EQ(__jit_debug_descriptor.action_flag, 2u);
+
+    settings.gdbJIT = true;
+    c.compile(filename, settings);
+    EXPECT_NE(__jit_debug_descriptor.first_entry, nullptr);
+  }
+  std::remove(filename.c_str());
+
+  // Destroying the net releases its code
+  EXPECT_EQ(__jit_debug_descriptor.first_entry, nullptr);
+  EXPECT_EQ(__jit_debug_descriptor.action_flag, 2u);
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, JitRegistryTest, /* x64 */ ::testing::Bool());
@@ -0,0 +1,85 @@
+/**
+ * @file Profile.cpp
+ *
+ * This file defines a test for nets that count the time spent in each operation.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class ProfileTest : public ::testing::TestWithParam<std::tuple<bool, unsigned int>>
+{
+public:
+  void run() const
+  {
+    const std::string filename = KerasModel::temporaryFilename(".h5");
+    KerasModel model;
+    model.addInput("input", {16, 14, 3});
+    model.addConv2D("conv", "input", 8, 3, 1, "valid", "linear");
+    model.addBatchNormalization("bn", "conv");
+    model.addActivation("relu", "bn", "relu");
+    model.addPooling2D("pool", "relu", "MaxPooling2D", 2, 2, "valid");
+    model.addFlatten("flatten", "pool");
+    model.addDense("dense", "flatten", 10, "softmax");
+    model.write(filename, {"dense"});
+
+    CompilationSettings settings;
+    settings.useX64 = std::get<0>(GetParam());
+    settings.threads = std::get<1>(GetParam());
+    CompiledNN c;
+    c.compile(filename, settings);
+    EXPECT_TRUE(c.profile().empty());
+    settings.profile = true;
+    c.compile(filename, settings);
+    std::remove(filename.c_str());
+
+    // The batch normalization is merged into the convolution
+    std::vector<CompiledNN::OperationProfile> profile = c.profile();
+    ASSERT_FALSE(profile.empty());
+    EXPECT_EQ(profile.front().layer.compare(0, 8, "conv+bn+"), 0) << profile.front().layer;
+    EXPECT_TRUE(std::any_of(profile.begin(), profile.end(), [](const CompiledNN::OperationProfile& op) { return op.layer == "pool"; }));
+    EXPECT_EQ(profile.back().layer, "dense");
+    for(const CompiledNN::OperationProfile& op : profile)
+    {
+      EXPECT_EQ(op.calls, 0u) << op.layer;
+      EXPECT_EQ(op.cycles, 0u) << op.layer;
+    }
+
+    // Each operation is counted once per application
+    for(unsigned int i = 0; i < 7; ++i)
+      c.apply();
+    profile = c.profile();
+    std::uint64_t cycles = 0;
+    for(const CompiledNN::OperationProfile& op : profile)
+    {
+      EXPECT_EQ(op.calls, 7u) << op.layer;
+      cycles += op.cycles;
+    }
+    EXPECT_GT(cycles, 0u);
+
+    c.resetProfile();
+    for(const CompiledNN::OperationProfile& op : c.profile())
+    {
+      EXPECT_EQ(op.calls, 0u) << op.layer;
+      EXPECT_EQ(op.cycles, 0u) << op.layer;
+    }
+    c.apply();
+    c.apply();
+    for(const CompiledNN::OperationProfile& op : c.profile())
+      EXPECT_EQ(op.calls, 2u) << op.layer;
+  }
+};
+
+TEST_P(ProfileTest, CountsCallsOfEachOperation)
+{
+  run();
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, ProfileTest,
+                        ::testing::Combine(/* x64 */ ::testing::Bool(), /* threads */ ::testing::Values(1u, 3u)));
@@ -0,0 +1,94 @@
+/**
+ * @file Reentrant.cpp
+ *
+ * This file defines a test for reentrant nets that are applied by several threads at once.
+ */
+
+#include "CompiledNN/CompiledNN.h"
+#include "../KerasModel.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <tuple>
+
+using namespace NeuralNetwork;
+
+class ReentrantTest : public ::testing::TestWithParam<std::tuple<bool, bool>>
+{
+public:
+  /**
+   * Returns the number of outputs that differ between the net applied by several threads with their own workspaces and the net applied by a single thread.
+   */
+  std::size_t getMismatches() const
+  {
+    constexpr unsigned int threads = 4;
+    constexpr unsigned int runs = 20;
+
+    const std::string filename = KerasModel::temporaryFilename(".h5");
+    KerasModel model;
+    model.addInput("input", {16, 14, 3});
+    model.addConv2D("conv1", "input", 8, 3, 1, "same", "relu");
+    model.addBatchNormalization("bn", "conv1");
+    model.addPooling2D("pool", "bn", "MaxPooling2D", 2, 2, "valid");
+    model.addDepthwiseConv2D("depthwise", "pool", 3, 1, "valid", "relu");
+    model.addFlatten("flatten", "depthwise");
+    model.addDense("dense", "flatten", 10, "softmax");
+    model.write(filename, {"dense"});
+
+    CompilationSettings settings;
+    settings.useX64 = std::get<0>(GetParam());
+    settings.useAVX2 = std::get<1>(GetParam());
+    settings.reentrant = true;
+    CompiledNN c;
+    c.compile(filename, settings);
+    std::remove(filename.c_str());
+    EXPECT_TRUE(c.reentrant());
+
+    // The outputs of all runs of all threads are computed in advance by the single-threaded apply method
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> inputDist(-1.f, 1.f);
+    std::vector<std::vector<float>> inputs(threads * runs), expectedOutputs(threads * runs), outputs(threads * runs);
+    for(std::size_t i = 0; i < inputs.size(); ++i)
+    {
+      for(auto p = c.input(0).begin(); p < c.input(0).end(); p++)
+        *p = inputDist(generator);
+      c.apply();
+      inputs[i].assign(c.input(0).begin(), c.input(0).end());
+      expectedOutputs[i].assign(c.output(0).begin(), c.output(0).end());
+      outputs[i].resize(expectedOutputs[i].size());
+    }
+
+    // Each thread applies the net with its own workspace, which must be aligned to 64 bytes
+    std::vector<std::vector<unsigned char>> workspaces(threads, std::vector<unsigned char>(c.workspaceSize() + 63));
+    std::vector<std::thread> workers;
+    for(unsigned int t = 0; t < threads; ++t)
+      workers.emplace_back([&, t]
+      {
+        void* workspace = workspaces[t].data() + (64 - reinterpret_cast<std::uintptr_t>(workspaces[t].data()) % 64) % 64;
+        for(unsigned int run = 0; run < runs; ++run)
+        {
+          const float* input = inputs[t * runs + run].data();
+          float* output = outputs[t * runs + run].data();
+          c.apply(&input, &output, workspace);
+        }
+      });
+    for(std::thread& worker : workers)
+      worker.join();
+
+    std::size_t mismatches = 0;
+    for(std::size_t i = 0; i < outputs.size(); ++i)
+      for(std::size_t j = 0; j < outputs[i].size(); ++j)
+        mismatches += outputs[i][j] != expectedOutputs[i][j];
+    return mismatches;
+  }
+};
+
+TEST_P(ReentrantTest, ProducesSameOutputInEachThread)
+{
+  EXPECT_EQ(getMismatches(), 0u);
+}
+
+INSTANTIATE_TEST_CASE_P(Nets, ReentrantTest,
+                        ::testing::Combine(/* x64 */ ::testing::Bool(), /* AVX2 */ ::testing::Bool()));
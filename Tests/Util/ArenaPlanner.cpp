@@ -0,0 +1,86 @@
+/**
+ * @file ArenaPlanner.cpp
+ *
+ * This file defines a test for the function that packs the tensors of a net into an arena.
+ */
+
+#include "CompiledNN/CompiledNN/Util/ArenaPlanner.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+using namespace NeuralNetwork::CompiledNNImpl;
+
+class ArenaPlannerTest : public ::testing::TestWithParam<std::tuple<unsigned int, unsigned int>>
+{
+public:
+  /**
+   * Creates blocks with random sizes and lifetimes.
+   * @param count The number of blocks.
+   * @param steps The number of steps in which blocks are used.
+   * @param seed The seed of the random numbers.
+   */
+  static std::vector<ArenaBlock> createBlocks(const unsigned int count, const unsigned int steps, const unsigned int seed)
+  {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<std::size_t> sizeDist(1, 64);
+    std::uniform_int_distribution<std::size_t> stepDist(0, steps - 1);
+    std::vector<ArenaBlock> blocks(count);
+    for(ArenaBlock& block : blocks)
+    {
+      block.size = sizeDist(generator) * 64;
+      block.firstUse = stepDist(generator);
+      block.lastUse = std::min<std::size_t>(steps - 1, block.firstUse + stepDist(generator) % 4);
+    }
+    return blocks;
+  }
+};
+
+TEST_P(ArenaPlannerTest, SeparatesBlocksThatAreAliveAtTheSameTime)
+{
+  for(unsigned int seed = 0; seed < 20; ++seed)
+  {
+    std::vector<ArenaBlock> blocks = createBlocks(std::get<0>(GetParam()), std::get<1>(GetParam()), seed);
+    const std::size_t arenaSize = planArena(blocks);
+
+    std::size_t sumOfSizes = 0, end = 0;
+    for(const ArenaBlock& block : blocks)
+    {
+      sumOfSizes += block.size;
+      end = std::max(end, block.offset + block.size);
+    }
+    EXPECT_EQ(arenaSize, end);
+    EXPECT_LE(arenaSize, sumOfSizes);
+
+    for(std::size_t i = 0; i < blocks.size(); ++i)
+      for(std::size_t j = i + 1; j < blocks.size(); ++j)
+      {
+        const ArenaBlock& a = blocks[i];
+        const ArenaBlock& b = blocks[j];
+        if(a.firstUse <= b.lastUse && b.firstUse <= a.lastUse)
+          EXPECT_TRUE(a.offset + a.size <= b.offset || b.offset + b.size <= a.offset) << "blocks " << i << " and " << j << " with seed " << seed;
+      }
+
+    // The arena cannot be smaller than the blocks that are alive in any step
+    for(unsigned int step = 0; step < std::get<1>(GetParam()); ++step)
+    {
+      std::size_t alive = 0;
+      for(const ArenaBlock& block : blocks)
+        if(block.firstUse <= step && step <= block.lastUse)
+          alive += block.size;
+      EXPECT_GE(arenaSize, alive);
+    }
+  }
+}
+
+TEST(ArenaPlanner, SharesMemoryBetweenBlocksThatAreNotAliveAtTheSameTime)
+{
+  std::vector<ArenaBlock> blocks = {{128, 0, 1}, {256, 2, 3}, {64, 4, 4}, {192, 5, 6}};
+  EXPECT_EQ(planArena(blocks), 256u);
+  for(const ArenaBlock& block : blocks)
+    EXPECT_EQ(block.offset, 0u);
+}
+
+INSTANTIATE_TEST_CASE_P(Util, ArenaPlannerTest,
+                        ::testing::Combine(/* blocks */ ::testing::Values(1u, 2u, 10u, 100u), /* steps */ ::testing::Values(1u, 5u, 50u)));